@@ -0,0 +1,50 @@
+#ifndef ADC_PHASE_H
+#define ADC_PHASE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Арифметика фазы меандра TIM2 для кадров АЦП (adc_stream.c, ISR TC ADC1) без HAL: на вход — снимки
+   регистров, на выход — номер отсчёта. На хосте её гоняет HostTools/tests/test_adc_phase.c.
+   TIM15 сбрасывается по TRGO TIM2, поэтому отсчёт k (0..P-1) периода меандра приходит ровно через
+   k*T15 тактов после его начала. */
+
+#define ADC_EDGE_RING       64u   // записей кольца захвата фронтов (степень двойки)
+
+// Геометрия для измерения по счётчикам (adc_phase_refresh)
+typedef struct {
+    uint32_t t15;    // тактов таймера на отсчёт, (PSC+1)(ARR+1) TIM15
+    uint32_t div15;  // PSC+1 TIM15
+    uint32_t div2;   // PSC+1 TIM2
+    uint32_t guard;  // тактов от триггера до отсчёта в NDTR (преобразование + DMA)
+} adc_phase_geom_t;
+
+// Фаза первого отсчёта кадра длины n (0..P-1) по счётчикам или -1. Снимок в порядке чтения:
+// c15 = CNT TIM15, c2 = CNT TIM2, ndtr = NDTR потока АЦП, c15b = CNT TIM15 ещё раз; cur — N, на
+// который взведён DMA (длина активного банка). Последний триггер TIM15 k_r — по CNT обоих таймеров:
+// от начала периода прошло c2*(PSC2+1) тактов, от триггера — c15*(PSC15+1). В активный банк после него
+// легло cur-ndtr отсчётов, поэтому первый отсчёт кадра — k_r - (cur-ndtr) - (n-1) по модулю P.
+// -1: между чтениями CNT15 был триггер, отсчёт последнего триггера ещё не в NDTR или NDTR не из cur.
+int32_t adc_phase_counters(const adc_phase_geom_t *g, uint32_t p, uint32_t n, uint32_t cur,
+                           uint32_t c15, uint32_t c2, uint32_t ndtr, uint32_t c15b);
+
+// Номер отсчёта фронта в кадре длины n или -1 по записям кольца захвата [rd, w) (индексы по модулю
+// ADC_EDGE_RING; запись — NDTR потока АЦП в момент фронта). ndtr — NDTR активного банка, прочитан
+// после позиции кольца w. Записи с прошлого TC легли либо в этот банк, либо в следующий (фронт успел
+// после переключения банков, до чтения кольца): NDTR записей следующего банка не меньше ndtr, поэтому
+// запись с NDTR ниже ndtr — точно этот кадр. Берётся последняя такая; более свежие записи у начала
+// банка неоднозначны, их число прибавляется к *amb.
+int32_t adc_edge_pick(const volatile uint32_t *ring, uint32_t rd, uint32_t w, uint32_t ndtr, uint32_t n,
+                      uint32_t *amb);
+
+// Фаза первого отсчёта кадра, в котором отсчёт idx — начало периода P
+static inline uint32_t adc_phase_from_edge(uint32_t idx, uint32_t p) { return (p - idx % p) % p; }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_PHASE_H */
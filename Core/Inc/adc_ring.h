@@ -0,0 +1,66 @@
+#ifndef ADC_RING_H
+#define ADC_RING_H
+
+#include <stdint.h>
+/* FIFO_FRAMES и __DMB — из main.h: включать после него (как lockin.h/frame_rice.h, заголовок сам
+   main.h не тянет — на хосте его подменяет HostTools/tests/host/main.h) */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Кольцо кадров АЦП без блокировок (SPSC): производитель — ISR TC ADC1 (adc_stream.c), потребитель —
+   основной цикл. Модуль не зависит от HAL: на хосте его гоняет HostTools/tests/test_adc_ring.c.
+   Кадр seq лежит в слоте seq & (FIFO_FRAMES-1). Слоты кадров wr и wr+1 всегда у DMA (активный и
+   свободный банк DBM), поэтому потребителю доступны не больше ADC_RING_READABLE последних кадров.
+   frame_wr_seq и поколения слотов пишет только ISR; frame_rd_seq, frame_overflow_drops и
+   frame_torn — только потребитель. */
+#define ADC_RING_READABLE   (FIFO_FRAMES - 2u)
+
+// Поколение слота: чётное 2*seq — в слоте готовый кадр seq, нечётное 2*seq+1 — слот отдан банку DMA
+// под кадр seq. Потребитель сверяет его после чтения слота (adc_stream_validate).
+#define ADC_GEN_READY(seq)  ((uint32_t)(seq) << 1)
+#define ADC_GEN_DMA(seq)    (((uint32_t)(seq) << 1) | 1u)
+#define ADC_GEN_NONE        0xFFFFFFFFu
+
+extern volatile uint32_t frame_wr_seq;         // записано (ISR)
+extern volatile uint32_t frame_rd_seq;         // выдано (main)
+extern volatile uint32_t frame_overflow_drops; // отброшено при переполнении
+extern volatile uint32_t frame_backlog_max;    // максимум backlog
+extern volatile uint32_t frame_torn;           // разорвано: DMA занял слот во время чтения
+extern volatile uint32_t adc_ring_gen[FIFO_FRAMES];
+
+// --- Производитель (ISR; сброс — при остановленном DMA) ---
+// Обнулить счётчики; слоты 0 и 1 сразу отданы банкам M0/M1 под кадры 0 и 1
+void adc_ring_clear(void);
+// Кадр seq дописан DMA: слот готов к чтению
+static inline void adc_ring_ready(uint32_t seq) { adc_ring_gen[seq & (FIFO_FRAMES - 1u)] = ADC_GEN_READY(seq); }
+// Слот idx отдан банку DMA под кадр seq — до записи его адреса в M0AR/M1AR
+static inline void adc_ring_to_dma(uint32_t idx, uint32_t seq) { adc_ring_gen[idx] = ADC_GEN_DMA(seq); }
+// Опубликовать кадр seq (после adc_ring_ready и передачи слота DMA); возвращает backlog wr - rd
+static inline uint32_t adc_ring_publish(uint32_t seq)
+{
+    __DMB();
+    frame_wr_seq = seq + 1u;
+    uint32_t backlog = seq + 1u - frame_rd_seq;
+    if (backlog > frame_backlog_max) frame_backlog_max = backlog;
+    return backlog;
+}
+
+// --- Потребитель (только основной цикл, прерывания не блокируются) ---
+// Взять кадр из кольца. latest=1 — последний готовый, промежуточные пропускаются; latest=0 — по
+// порядку, при отставании больше, чем кольцо удерживает, — самый старый целый. Кадры, которые DMA
+// уже перезаписал, считает только frame_overflow_drops; *skipped — целые кадры, намеренно
+// пропущенные ради latest (при latest=0 всегда 0). 0 — новых кадров нет.
+uint8_t adc_stream_acquire(uint32_t *seq, uint32_t *skipped, uint8_t latest);
+// Проверка после чтения слота: 1 — кадр seq целый; 0 — слот уже отдан DMA под следующий круг
+// (кадр разорван и должен быть отброшен, счётчик frame_torn)
+uint8_t adc_stream_validate(uint32_t seq);
+// Вернуть взятый кадр seq в кольцо (следующий acquire выдаст его снова), если DMA его ещё не занял
+void adc_stream_unget(uint32_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_RING_H */
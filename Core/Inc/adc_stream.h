@@ -9,6 +9,7 @@ void adc_stream_stop(void);
 #include <stdint.h>
 #include <stddef.h>
 #include "main.h" // FIFO_FRAMES / profile params
+#include "adc_ring.h" // кольцо кадров: frame_wr_seq/frame_rd_seq, acquire/validate/unget
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,15 +21,16 @@ extern "C" {
 #endif
 
 // Внешние буферы DMA (максимальный размер строки = MAX_FRAME_SAMPLES)
+#if ADC_STREAM_DUAL_MODE
+// Один поток DMA: слово = ADC1 (биты 15..0) | ADC2 (биты 31..16), отсчёты каналов выровнены аппаратно
+extern uint32_t adc12_buffers[FIFO_FRAMES][MAX_FRAME_SAMPLES];
+#else
 extern uint16_t adc1_buffers[FIFO_FRAMES][MAX_FRAME_SAMPLES];
 extern uint16_t adc2_buffers[FIFO_FRAMES][MAX_FRAME_SAMPLES];
+#endif
 
-// Счётчики состояния FIFO
-extern volatile uint32_t frame_wr_seq;         // записано (ISR)
-extern volatile uint32_t frame_rd_seq;         // выдано (main)
-extern volatile uint32_t frame_overflow_drops; // отброшено при переполнении
+// Счётчики кольца (frame_wr_seq, frame_rd_seq, потери) — adc_ring.h
 extern volatile uint32_t frame_sent_seq;       // отправлено по USB (успешно)
-extern volatile uint32_t frame_backlog_max;    // максимум backlog
 
 // Время последнего полного DMA кадра (ms HAL_GetTick) для диагностики
 extern volatile uint32_t adc_last_full0_ms;
@@ -45,19 +47,115 @@ typedef struct {
     uint32_t dma_half1; // ADC2 half transfers
     uint32_t dma_full1; // ADC2 full transfers
     uint16_t active_samples; // current profile samples per buffer
-    uint16_t reserved;
+    uint16_t dma_samples; // N the DMA is armed with (differs while a switch is pending)
+    uint32_t frame_torn; // frames whose slot DMA reclaimed while being read
+    uint32_t switches; // profile switches applied at a frame boundary (DMA kept running)
+    uint32_t switch_deferred; // boundaries skipped: a sample already landed in the new bank
+    uint32_t switch_slip; // a sample landed between the check and the stream disable
+    uint32_t switch_restarts; // N changes done by a full DMA restart
+    uint8_t  switch_pending; // switch requested, waiting for the next boundary
 } adc_stream_debug_t;
 
 void adc_stream_init(void);
 HAL_StatusTypeDef adc_stream_start(ADC_HandleTypeDef* a1, ADC_HandleTypeDef* a2);
 HAL_StatusTypeDef adc_stream_restart(ADC_HandleTypeDef* a1, ADC_HandleTypeDef* a2);
+// Взятие кадра из кольца (adc_stream_acquire/validate/unget) — adc_ring.h
+// N кадра seq (с ним DMA заполнял слот); *first=1 — первый кадр после смены профиля
+// (на границе кадра или перезапуском DMA). Читать после acquire, проверять validate.
+uint16_t adc_stream_frame_samples(uint32_t seq, uint8_t *first);
+// Без проверки целостности: указатели на слот действительны, пока его не займёт DMA
 uint8_t adc_get_frame(uint16_t **ch1, uint16_t **ch2, uint16_t *samples);
+#if ADC_STREAM_DUAL_MODE
+// Кадр как есть (слова {ADC1 | ADC2<<16}); adc_get_frame в dual-режиме раскладывает его
+// во внутренний scratch, действительный до следующего вызова
+uint8_t adc_get_frame_packed(const uint32_t **ab, uint16_t *samples);
+#endif
+// Разложить n слов {ch1 | ch2<<16} на два массива отсчётов
+void adc_stream_split(const uint32_t *ab, uint16_t *ch1, uint16_t *ch2, uint32_t n);
 void adc_stream_get_debug(adc_stream_debug_t *out);
 
+// Время завершения DMA кадра seq (последний отсчёт кадра), мкс от timebase_init.
+// Действительно, пока слот seq не перезаписан следующим кругом кольца.
+uint64_t adc_stream_frame_time_us(uint32_t seq);
+
+// --- Фаза меандра TIM2 (синхронное детектирование) ---
+// Отсчёты нумеруются внутри периода меандра: k = 0..P-1, отсчёт k взят через k периодов TIM15 после
+// фронта TIM2 (TIM15 сбрасывается по TRGO TIM2), P = ceil(T2/T15). Оба таймера должны быть на одном такте.
+// Фазу кадра даёт захват фронта TIM2 потоком DMA2 (ADC_EDGE_CAPTURE) или, при кратных периодах
+// (ACQS.aligned), счётчики TIM2/TIM15 в TC; между измерениями она ведётся по N.
+#define ADC_PHASE_NONE 0xFFFFu
+#define ADC_PHASE_SRC_COUNTERS    0x01u  // измерение по счётчикам возможно
+#define ADC_PHASE_SRC_CAPTURE_ON  0x02u  // поток захвата фронтов запущен
+#define ADC_PHASE_SRC_CAPTURE     0x04u  // захват годен для текущих TIM15/времени преобразования
+typedef struct {
+    uint16_t period;   // P: отсчётов на период меандра (0 — фаза недоступна)
+    uint16_t high;     // H: отсчёты k < H — высокий уровень TIM2_CH2
+    uint8_t  locked;   // фаза кадров известна (было хотя бы одно измерение после старта DMA)
+    uint8_t  src;      // ADC_PHASE_SRC_*
+    uint32_t meas;     // измерений фазы в TC по CNT TIM2/TIM15
+    uint32_t fix;      // измерение поправило ведение по N (отсчёт потерян при смене профиля)
+    uint32_t dirty;    // кадров без измерения — фаза взята из ведения по N
+    uint32_t edge_meas; // кадров с фазой по захваченному фронту
+    uint32_t edges;    // фронтов захвачено
+    uint32_t edge_amb; // фронтов у границы банка, не использованных (банк неоднозначен)
+} adc_phase_info_t;
+// Фаза первого отсчёта кадра seq (0..P-1) или ADC_PHASE_NONE. Читать после acquire, проверять validate.
+uint16_t adc_stream_frame_phase(uint32_t seq);
+void adc_stream_get_phase(adc_phase_info_t *out);
+
+// --- Произвольный режим захвата (SET_ACQ) ---
+// Fs задаёт TIM15 (TRGO по переполнению): Fs = f_tim / ((PSC+1)(ARR+1)). N — длина кадра АЦП,
+// ограничена слотом кольца (MAX_FRAME_SAMPLES); частота кадров Fs/N — пределами ниже.
+#ifndef ADC_ACQ_SAMPLES_MIN
+#define ADC_ACQ_SAMPLES_MIN   32u
+#endif
+#ifndef ADC_ACQ_FRAME_HZ_MIN
+#define ADC_ACQ_FRAME_HZ_MIN  1u      // кадр не длиннее секунды
+#endif
+#ifndef ADC_ACQ_FRAME_HZ_MAX
+#define ADC_ACQ_FRAME_HZ_MAX  2000u   // прерывание DMA и трансфер USB на каждый кадр
+#endif
+// Преобразование (выборка + SAR) должно занимать не больше этой доли периода триггера, %
+#ifndef ADC_ACQ_CONV_DUTY_PCT
+#define ADC_ACQ_CONV_DUTY_PCT 80u
+#endif
+// Аппаратный оверсэмплинг (CFGR2): ratio преобразований на триггер, сумма >> shift. Отсчёт остаётся
+// 16-битным словом DMA, поэтому shift >= ceil(log2 ratio): выигрыш — в шуме и числе отсчётов, не в ширине.
+#define ADC_OVS_RATIO_MAX     1024u
+#define ADC_OVS_SHIFT_MAX     11u
+
+typedef struct {
+    uint32_t fs_req_hz;      // запрошенная Fs (для профилей из таблицы — табличная)
+    uint64_t fs_millihz;     // достигнутая Fs, мГц
+    uint32_t tim_clk_hz;     // такт ядра TIM15
+    uint16_t tim_psc;        // PSC
+    uint16_t tim_arr;        // ARR
+    uint32_t adc_clk_hz;     // такт АЦП после делителей
+    uint16_t conv_ns;        // выборка + SAR, нс
+    uint16_t samples;        // N
+    uint8_t  smp_code;       // ADC_SAMPLETIME_* (0 = 1.5 такта ... 7 = 810.5 такта)
+    uint8_t  aligned;        // период меандра TIM2 — целое число периодов TIM15
+    uint16_t ovs_ratio;      // преобразований на отсчёт (1 — оверсэмплинг выключен)
+    uint8_t  ovs_shift;      // сдвиг суммы вправо
+    uint8_t  bits;           // значащих бит в отсчёте: 16 + ceil(log2 ratio) - shift
+} adc_acq_t;
+
+// Рассчитать режим без применения. ovs_ratio 0/1 — без оверсэмплинга. 0 — успех; -1 — N вне
+// [ADC_ACQ_SAMPLES_MIN, MAX_FRAME_SAMPLES] или Fs=0; -2 — Fs недостижима на TIM15; -3 — АЦП не успевает
+// преобразовать (с учётом ovs_ratio); -4 — Fs/N вне пределов; -6 — ratio/shift вне пределов или сумма шире 16 бит
+int adc_stream_plan_acq(uint32_t fs_hz, uint16_t samples, uint16_t ovs_ratio, uint8_t ovs_shift, adc_acq_t *out);
+// Рассчитать и применить (TIM15, время выборки, оверсэмплинг, перезапуск DMA): профиль становится ADC_PROFILE_CUSTOM
+int adc_stream_set_acq(uint32_t fs_hz, uint16_t samples, uint16_t ovs_ratio, uint8_t ovs_shift, adc_acq_t *out);
+// Фактический режим по регистрам TIM15/АЦП (для любого профиля)
+void adc_stream_get_acq(adc_acq_t *out);
+
 /* Getter функции для получения текущих параметров профиля */
 uint8_t adc_stream_get_profile(void);
 uint16_t adc_stream_get_active_samples(void);
 uint16_t adc_stream_get_buf_rate(void);
+// Фактическая частота отсчётов (по TIM15), Гц, и значащие биты отсчёта — для заголовка кадра
+uint32_t adc_stream_get_sample_rate(void);
+uint8_t adc_stream_get_sample_bits(void);
 
 // Хук: вызывается из ISR (ADC1 half/full) с количеством добавленных кадров FIFO (frames_added)
 void adc_stream_on_new_frames(uint32_t frames_added);
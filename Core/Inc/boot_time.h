@@ -0,0 +1,40 @@
+#ifndef BOOT_TIME_H
+#define BOOT_TIME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Время загрузки: от сброса до первого кадра. CYCCNT включает и обнуляет Reset_Handler
+   (startup_stm32h723vgtx.s) до копирования образов, поэтому метки считаются от сброса
+   и включают копирование ITCM/.data из flash. До переключения тактирования ядро идёт от HSI
+   (HSI_VALUE), после — SystemCoreClock: отрезки переводятся в мкс каждый на своей частоте.
+   Каждая метка фиксируется один раз за загрузку (первое наступление события). */
+typedef enum {
+    BOOT_MARK_MAIN = 0,   /* вход в main() */
+    BOOT_MARK_CLOCK,      /* SystemClock_Config выполнен (PLL, рабочая частота) */
+    BOOT_MARK_USB_INIT,   /* MX_USB_DEVICE_Init выполнен */
+    BOOT_MARK_LOOP,       /* вход в основной цикл */
+    BOOT_MARK_CONFIGURED, /* хост выбрал конфигурацию (SET_CONFIGURATION) */
+    BOOT_MARK_START,      /* первая команда START */
+    BOOT_MARK_ADC_FRAME,  /* первый кадр АЦП (DMA TC) */
+    BOOT_MARK_TX_FRAME,   /* первая пара кадров ушла хосту */
+    BOOT_MARK_COUNT
+} boot_mark_t;
+
+/* Сразу после SystemClock_Config: запоминает циклы и частоту в момент переключения, ставит CLOCK */
+void boot_time_clock_switched(void);
+
+/* Отметить событие (повторные вызовы ничего не делают). Из любого контекста. */
+void boot_mark(boot_mark_t id);
+
+/* Время метки от сброса в мкс; 0xFFFFFFFF — событие ещё не наступало */
+uint32_t boot_mark_us(boot_mark_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOOT_TIME_H */
@@ -0,0 +1,61 @@
+#ifndef CYC_PROF_H
+#define CYC_PROF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Профилировщик горячего пути по DWT CYCCNT: для каждого участка — число входов, min/max/среднее
+   и гистограмма log2 циклов (корзина k: [2^k, 2^(k+1)), последняя — всё длиннее). Время участка
+   включающее: вложенные участки и вытеснившие его прерывания входят в него. Читается и
+   сбрасывается по EP0 (VND_CMD_GET_PROF / VND_CMD_PROF_RESET), HostTools/prof_report.py. */
+#ifndef CYC_PROF_ENABLE
+#define CYC_PROF_ENABLE 1
+#endif
+#define CYC_PROF_BINS 24u /* до 2^23 циклов (~15 мс при 550 МГц) в последней корзине */
+
+/* Номера участков — часть протокола (USBprotocol.txt §4.18), только дописывать */
+typedef enum {
+    CYC_PROF_ADC_CPLT = 0,   /* HAL_ADC_ConvCpltCallback (кадр ADC1) */
+    CYC_PROF_PREP_PAIR,      /* vnd_prepare_pair, вызовы, собравшие пару */
+    CYC_PROF_PREP_STEREO,    /* vnd_prepare_stereo_pair: раскладка L/R */
+    CYC_PROF_VND_TX,         /* USBD_VND_Transmit / TransmitZC: постановка передачи (vnd_tx_submit) */
+    CYC_PROF_VND_TXCPLT,     /* USBD_VND_TxCplt */
+    CYC_PROF_OTG_IRQ,        /* OTG_HS_IRQHandler */
+    CYC_PROF_COUNT
+} cyc_prof_id_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t hist[CYC_PROF_BINS];
+} cyc_prof_stats_t;
+
+#if CYC_PROF_ENABLE
+#define CYC_PROF_BEGIN(v)   uint32_t v = DWT->CYCCNT
+#define CYC_PROF_END(id, v) cyc_prof_add((id), DWT->CYCCNT - (v))
+#define CYC_PROF_ADD(id, c) cyc_prof_add((id), (c))   /* циклы уже посчитаны на месте */
+#else
+#define CYC_PROF_BEGIN(v)   do{}while(0)
+#define CYC_PROF_END(id, v) do{}while(0)
+#define CYC_PROF_ADD(id, c) do{}while(0)
+#endif
+
+/* Учесть один вход участка длительностью cyc циклов. Из любого контекста. */
+void cyc_prof_add(cyc_prof_id_t id, uint32_t cyc);
+/* Снимок участка; возвращает мс с последнего сброса */
+uint32_t cyc_prof_get(cyc_prof_id_t id, cyc_prof_stats_t *out);
+/* Обнулить все участки */
+void cyc_prof_reset(void);
+/* Короткое имя участка (до 8 символов) */
+const char *cyc_prof_name(cyc_prof_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CYC_PROF_H */
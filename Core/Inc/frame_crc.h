@@ -0,0 +1,50 @@
+#ifndef FRAME_CRC_H
+#define FRAME_CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CRC16-CCITT-FALSE (poly 0x1021, init 0xFFFF, без рефлексии) на аппаратном блоке CRC.
+   Кадр vendor (заголовок 32 B + payload) считается асинхронно: 30 байт заголовка и
+   невыровненные края пишет CPU, выровненную середину payload подаёт в CRC->DR канал MDMA.
+   Результат кладётся в поле crc16 (байты 30..31, LE). Параметры блока задаёт MX_CRC_Init. */
+
+/* Готовность движка: вызвать после MX_CRC_Init/MX_MDMA_Init */
+void frame_crc_init(void);
+
+/* Поставить кадр в очередь подсчёта. Заголовок и payload менять до завершения нельзя.
+   *pending увеличивается при постановке и уменьшается, когда crc16 записан в кадр.
+   0 — очередь полна или движок не готов (кадр надо отправить без флага CRC).
+   Вызывать только из основного цикла. */
+int frame_crc_submit(uint8_t *frame, uint32_t len, volatile uint8_t *pending);
+
+/* Сбросить очередь (STOP/перезапуск): незавершённые кадры остаются без crc16 */
+void frame_crc_flush(void);
+
+/* Хук: вызывается из IRQ MDMA, когда подсчёт завершил хотя бы один кадр (*pending уже уменьшен).
+   Слабое определение пустое; модуль USB переопределяет его, чтобы сразу ставить кадр в EP. */
+void frame_crc_on_done(void);
+
+/* Синхронный CRC16 непрерывного буфера (короткие кадры CDC). Если блок занят асинхронной
+   очередью — программный подсчёт. */
+uint16_t frame_crc16(const uint8_t *data, size_t len);
+
+typedef struct {
+    uint32_t frames;      /* кадров посчитано асинхронно */
+    uint32_t skipped;     /* отказов постановки (очередь полна) */
+    uint32_t mdma_err;    /* ошибок MDMA (кадр досчитан CPU) */
+    uint32_t sw_fallback; /* синхронных подсчётов программно (блок был занят) */
+    uint8_t  queue_hwm;   /* максимум глубины очереди */
+} frame_crc_stats_t;
+void frame_crc_get_stats(frame_crc_stats_t *out);
+void frame_crc_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_CRC_H */
@@ -0,0 +1,47 @@
+#ifndef FRAME_RICE_H
+#define FRAME_RICE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Сжатие payload кадров vendor без потерь (флаг VND_FLAGS_RICE, команда SET_COMPRESS).
+   Каждый канал (плоскость) кодируется независимо, плоскости идут подряд в одном битовом
+   потоке (старший бит первым):
+     - первый отсчёт плоскости — 16 бит как есть;
+     - остальные — разности d = x[i] - x[i-1] (по модулю 2^16), zigzag u = (d << 1) ^ (d >> 15);
+     - разности идут блоками по FRAME_RICE_BLOCK: 4 бита параметра p, затем отсчёты блока.
+       p = 0..14 — код Райса: u >> p нулями в унарном виде, единица, младшие p бит u;
+       p = FRAME_RICE_ESC — блок без сжатия: u по 16 бит.
+   Поток добит нулевыми битами до кратности 4 байт. Длина payload в байтах — в заголовке кадра. */
+#define FRAME_RICE_BLOCK    32u
+#define FRAME_RICE_KMAX     14u
+#define FRAME_RICE_ESC      15u
+
+/* Сжать nplanes массивов по n отсчётов в out (ёмкость cap байт — размер несжатого payload).
+   Возвращает длину сжатого payload (кратна 4) или 0, если он не короче cap: тогда кадр
+   отправляется как есть. Запись в out не выходит за cap. */
+uint32_t frame_rice_encode(const uint16_t *const planes[], uint32_t nplanes, uint32_t n,
+                           uint8_t *out, uint32_t cap);
+
+typedef struct {
+    uint32_t frames;      /* кадров ушло сжатыми */
+    uint32_t raw_frames;  /* кадров без выигрыша (ушли как есть) */
+    uint32_t blocks;      /* блоков разностей всего */
+    uint32_t raw_blocks;  /* из них без сжатия (p = FRAME_RICE_ESC) */
+    uint64_t bytes_in;    /* несжатых байт payload (все попытки) */
+    uint64_t bytes_out;   /* байт payload в эфире: сжатые или исходные при отказе */
+    uint64_t samples;     /* отсчётов через кодер */
+    uint64_t cyc_sum;     /* циклы DWT на кодирование */
+    uint32_t cyc_max;     /* максимум на кадр */
+} frame_rice_stats_t;
+void frame_rice_get_stats(frame_rice_stats_t *out);
+void frame_rice_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_RICE_H */
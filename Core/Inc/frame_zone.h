@@ -0,0 +1,51 @@
+#ifndef FRAME_ZONE_H
+#define FRAME_ZONE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Зоны ROI кадра vendor (SET_WINDOWS / SET_ROI_US / SET_ROI, usb_vendor_app.c) без HAL: разрешение
+   заданных зон в отсчёты кадра из n отсчётов, размер payload и сборка отсчётов зон подряд.
+   На хосте их гоняет HostTools/tests/test_frame_zone.c.
+   Payload с зонами: таблица {u16 N, u16 0}, затем cnt пар {u16 start, u16 len}, за ней отсчёты зон. */
+#define FRAME_ZONES_MAX        8u
+#define FRAME_ZONE_TAB_BYTES(zc) ((zc) ? 4u * ((uint32_t)(zc) + 1u) : 0u)
+
+typedef struct { uint32_t start, len; } frame_zone_cfg_t;  // отсчёты или мкс от начала кадра
+
+// Зоны для кадра из n отсчётов: tab[0] = {N, 0}, tab[1..cnt] = {start, len} — ровно то, что уходит
+// в начале payload
+typedef struct {
+    uint16_t n;
+    uint32_t fs;
+    uint8_t  cnt;            // 0 — кадр целиком
+    uint16_t samples;        // отсчётов во всех зонах
+    uint16_t tab[FRAME_ZONES_MAX + 1u][2];
+} frame_zone_map_t;
+
+// Разрешить cfg_cnt зон (по возрастанию, без перекрытий) для кадра из n отсчётов по bps байт на
+// отсчёт. us: зоны в мкс — начало округляется вниз, конец вверх по fs (отсчёт в зоне, если его
+// интервал [i, i+1)/fs задевает зону); перекрытие соседних зон после округления срезается.
+// Зоны обрезаются по N. Если зоны не уменьшают кадр (таблица + отсчёты зон не меньше кадра
+// целиком) или все вне кадра — cnt = 0.
+void frame_zone_resolve(frame_zone_map_t *zr, const frame_zone_cfg_t *cfg, uint32_t cfg_cnt, uint8_t us,
+                        uint32_t fs, uint16_t n, uint32_t bps);
+
+// Отсчёты зон zr (cnt > 0) подряд из плоскостей ch1/ch2 в dst1/dst2; возвращает их число (zr->samples)
+uint32_t frame_zone_gather(const frame_zone_map_t *zr, const uint16_t *ch1, const uint16_t *ch2,
+                           uint16_t *dst1, uint16_t *dst2);
+
+// Байт payload кадра из n отсчётов по bps байт на отсчёт (без заголовка): с зонами — таблица и
+// отсчёты зон, без них — кадр целиком
+static inline uint32_t frame_zone_payload_bytes(const frame_zone_map_t *zr, uint16_t n, uint32_t bps) {
+    return zr->cnt ? FRAME_ZONE_TAB_BYTES(zr->cnt) + (uint32_t)zr->samples * bps : (uint32_t)n * bps;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_ZONE_H */
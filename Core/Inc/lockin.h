@@ -0,0 +1,70 @@
+#ifndef LOCKIN_H
+#define LOCKIN_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Синхронное детектирование (lock-in) по меандру TIM2 для обоих каналов АЦП.
+   Отсчёт k периода меандра (0..P-1, фаза от adc_stream_frame_phase) умножается на опорные ±1:
+     ref_I(k) = +1 при k < H (высокий уровень TIM2_CH2), иначе -1;
+     ref_Q(k) = ref_I(k - Q0 mod P), Q0 = round(P/4) — опора I, задержанная на четверть периода.
+   Суммы копятся целыми за M периодов, начиная с границы периода (k = 0), и закрываются записью
+   lockin_rec_t. Разрыв (пропуск кадров АЦП, фаза неизвестна или не сошлась) сбрасывает
+   незаконченную запись, следующая начнётся с ближайшей границы периода и получит флаг GAP.
+   При H != P/2 опоры несут постоянную составляющую: хост вычитает sum*(2H-P)/P из I (и из Q). */
+#define LOCKIN_REC_SIZE       64u
+#define LOCKIN_REC_FIFO       64u     /* записей ждут отправки (степень двойки) */
+#define LOCKIN_REC_FLAG_GAP   0x0001u /* перед записью был разрыв (старт, потеря кадров или фазы) */
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;            /* номер записи с lockin_reset */
+    uint32_t t_end_us;       /* время последнего отсчёта записи, мкс (младшие 32 бита timebase) */
+    uint16_t periods;        /* M — периодов меандра в записи */
+    uint16_t period_samples; /* P — отсчётов на период */
+    uint16_t high_samples;   /* H — отсчётов высокого уровня опоры */
+    uint16_t flags;          /* LOCKIN_REC_FLAG_* */
+    int64_t  i[2];           /* Σ x·ref_I по каналам ADC1, ADC2 */
+    int64_t  q[2];           /* Σ x·ref_Q */
+    uint64_t sum[2];         /* Σ x (M·P отсчётов) */
+} lockin_rec_t;
+_Static_assert(sizeof(lockin_rec_t) == LOCKIN_REC_SIZE, "lockin_rec_t must be 64 bytes");
+
+/* Новая сессия: геометрия опоры (P, H из adc_stream_get_phase), M периодов на запись, Fs для меток.
+   period = 0 — фазы нет, кадры только считаются в no_phase. */
+void lockin_reset(uint16_t period, uint16_t high, uint16_t periods, uint32_t fs_hz);
+
+/* Один кадр АЦП seq из n отсчётов на канал: плоскости ch1/ch2 или слова {ADC1 | ADC2<<16} (ab != NULL).
+   k0 — фаза первого отсчёта (ADC_PHASE_NONE — неизвестна), t_us — время последнего отсчёта кадра.
+   Возвращает число записей, закрытых этим кадром. */
+uint32_t lockin_feed(uint32_t seq, const uint16_t *ch1, const uint16_t *ch2, const uint32_t *ab,
+                     uint32_t n, uint16_t k0, uint64_t t_us);
+
+/* Кадр, только что отданный в lockin_feed, оказался разорван: убрать закрытые им записи (их число
+   вернул lockin_feed) и начатую запись — следующая начнётся после разрыва. */
+void lockin_abort(uint32_t drop_recent);
+
+/* Записей готово к отправке */
+uint32_t lockin_ready(void);
+/* Скопировать до max записей подряд в dst (LOCKIN_REC_SIZE байт каждая), вернуть их число */
+uint32_t lockin_pop(uint8_t *dst, uint32_t max);
+
+typedef struct {
+    uint32_t records;     /* записей закрыто */
+    uint32_t frames;      /* кадров АЦП обработано */
+    uint32_t gaps;        /* разрывов: пропуск кадров или фаза не сошлась с ожидаемой */
+    uint32_t no_phase;    /* кадров без фазы (P = 0 или фаза ещё не измерена) */
+    uint32_t aborted;     /* незаконченных записей сброшено */
+    uint32_t overflow;    /* записей потеряно: очередь на отправку полна */
+    uint64_t cyc_sum;     /* циклы DWT на обработку кадров */
+    uint32_t cyc_max;     /* максимум на кадр */
+} lockin_stats_t;
+void lockin_get_stats(lockin_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOCKIN_H */
@@ -11,6 +11,13 @@
     # запустить сборку (можно без -j или указать нужное число потоков)
     make -j4 all
     # целевой ELF: Debug\BMI30.stm32h7.elf
+    # что попало в ITCM/DTCM/AXI (горячий путь, занятость регионов):
+    python ..\HostTools\mem_placement.py BMI30.stm32h7.elf
+
+  Автономная загрузка из flash (без отладчика): в CubeIDE создать конфигурацию Release_Flash
+  (копия Debug), в C/C++ Build > Settings > MCU GCC Linker > General указать
+  ../STM32H723VGTX_FLASH.ld вместо ../STM32H723VGTX_RAM.ld. Прошивка — так же, вариант 1;
+  время от сброса до первого кадра — страница BOOT (HostTools/vendor_ctrl_status.py).
 
   Очистка:
     cd Debug
@@ -91,6 +98,12 @@ extern ADC_HandleTypeDef hadc1;
 extern ADC_HandleTypeDef hadc2;
 // Экспорт системного счётчика SysTick тиков
 extern volatile uint32_t systick_heartbeat;
+// Средняя длительность итерации основного цикла за последнюю секунду, циклы DWT
+extern volatile uint32_t loop_cycle_last_avg;
+// Загрузка CPU за последнюю секунду (main.c, MAIN_IDLE_WFI): занятость и доля ISR, ‰; пробуждения из WFI/с
+extern volatile uint16_t cpu_load_permille;
+extern volatile uint16_t cpu_isr_permille;
+extern volatile uint32_t cpu_wakeups_per_s;
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
@@ -138,10 +151,34 @@ enum {
     ADC_PROFILE_D_MAX     = 3,
     ADC_PROFILE_COUNT
 };
+// Произвольный профиль (SET_ACQ): Fs и N заданы хостом, TIM15 пересчитан под Fs — вне таблицы
+#define ADC_PROFILE_CUSTOM 0xFFu
 
 #define MAX_FRAME_SAMPLES 1360u   // Максимум из поддерживаемых профилей (для статических буферов)
 #define FIFO_FRAMES       8u      // Глубина FIFO (кратно 4: half/full DMA = 4 кадра)
 
+// Dual regular simultaneous: ADC2 — slave ADC1, оба запускаются одним триггером TIM15,
+// один поток DMA (DMA1_Stream0) забирает общий регистр CDR словами {ADC1 | ADC2<<16}.
+// 0 — два независимых АЦП на двух потоках DMA (как раньше).
+#ifndef ADC_STREAM_DUAL_MODE
+#define ADC_STREAM_DUAL_MODE 0
+#endif
+
+// I-Cache и D-Cache ядра M7 (включаются сразу после MPU_Config). Кэшируется AXI SRAM (код, данные
+// RAM_EXEC) с write-back; буферы DMA АЦП (.adc_dma) — некэшируемый регион, пул кадров USB при
+// USBD_OTG_DMA_ENABLE (.usb_dma) — write-through. DTCM кэш не обслуживает. 0 — кэши выключены.
+#ifndef MCU_CACHE_ENABLE
+#define MCU_CACHE_ENABLE 1
+#endif
+
+// Горячий путь в TCM (секции в STM32H723VGTX_*.ld, список ITCM — itcm_sections.ld, отчёт — HostTools/mem_placement.py):
+// ITCM_FUNC — функция в ITCM (64K, 0 тактов ожидания, выборка не делит AXI с DMA);
+// DTCM_BSS  — обнуляемая переменная в начале .bss в DTCM, рядом с прочими метаданными кольца.
+// Функции HAL/USB-стека и сгенерированные CubeMX обработчики переносятся правилами в .ld
+// (по именам секций -ffunction-sections). Вызовы между ITCM и AXI идут через veneer линкера.
+#define ITCM_FUNC __attribute__((section(".itcm_text")))
+#define DTCM_BSS  __attribute__((section(".bss.dtcm")))
+
 // Компиляционный дефолт (будет заменён рантайм профилем)
 #define FRAME_SAMPLES_DEFAULT 912u
 
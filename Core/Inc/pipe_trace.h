@@ -0,0 +1,72 @@
+#ifndef PIPE_TRACE_H
+#define PIPE_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Журнал событий тракта АЦП -> USB: кольцо фиксированных записей {CYCCNT, событие, seq, arg} на каждом
+   переходе (конец DMA, сборка пары, постановка в LL, DataIn, ZLP, TxCplt, разблокировки, команды).
+   Кольцо перезаписывает старые записи (бортовой самописец): после зависания в нём остаётся то,
+   что ему предшествовало. Хост читает его страницами по EP0 (VND_CMD_GET_EVENTS) не останавливая
+   стрим; HostTools/pipe_timeline.py строит по нему временную шкалу и задержки кадров. */
+#ifndef PIPE_TRACE_ENABLE
+#define PIPE_TRACE_ENABLE 1
+#endif
+#define PIPE_TRACE_RECS 512u /* записей (степень двойки, не больше 32768), 8 KB в DTCM */
+
+#define PT_SEQ_NONE 0xFFFFFFFFu /* событие не относится к кадру */
+
+/* Номера событий — часть протокола (USBprotocol.txt §4.17), только дописывать */
+typedef enum {
+    PT_EV_ADC_TC     = 1, /* кадр АЦП готов (DMA TC): seq = кадр АЦП, arg = кадров в кольце АЦП */
+    PT_EV_PREP_BEGIN = 2, /* сборка пары взяла кадр АЦП: seq = кадр АЦП, arg = отсчётов */
+    PT_EV_PREP_END   = 3, /* пара собрана: seq = seq пары, arg = кадр АЦП; seq = PT_SEQ_NONE — кадр разорван */
+    PT_EV_LL_TX      = 4, /* кусок передачи поставлен в USBD_LL_Transmit: seq = seq кадра, arg = байт */
+    PT_EV_DATAIN     = 5, /* DataIn Vendor IN: seq = seq кадра, arg = байт поставлено к этому моменту */
+    PT_EV_ZLP        = 6, /* поставлен ZLP: seq = seq кадра, arg = длина передачи */
+    PT_EV_TXCPLT     = 7, /* USBD_VND_TxCplt: seq = seq кадра (PT_SEQ_NONE — не рабочий кадр), arg = байт */
+    PT_EV_UNSTICK    = 8, /* принудительная разблокировка: arg = причина (pt_unstick_t) | мс << 8 */
+    PT_EV_CMD        = 9, /* команда по bulk OUT: arg = код | длина << 8 */
+} pt_event_t;
+
+typedef enum {
+    PT_UNSTICK_EP = 1,        /* EP_UNSTUCK: IN висит > 200 мс */
+    PT_UNSTICK_TXQ_RETRY,     /* кадр head очереди передачи поставлен заново */
+    PT_UNSTICK_BURST_DROP,    /* пачка burst потеряна */
+    PT_UNSTICK_ACK_FALLBACK,  /* ACK на START не ушёл */
+    PT_UNSTICK_ACK_TIMEOUT,   /* ACK на START без DataIn */
+    PT_UNSTICK_TEST_TIMEOUT,  /* тестовый кадр без DataIn */
+} pt_unstick_t;
+
+typedef struct {
+    uint32_t cyc;   /* DWT CYCCNT */
+    uint32_t seq;
+    uint32_t arg;
+    uint16_t idx;   /* младшие 16 бит номера записи (проверка целостности на хосте) */
+    uint8_t  id;    /* pt_event_t */
+    uint8_t  ctx;   /* IPSR: 0 — основной цикл, иначе номер исключения */
+} pipe_rec_t;
+_Static_assert(sizeof(pipe_rec_t) == 16, "pipe_rec_t must be 16 bytes");
+
+#if PIPE_TRACE_ENABLE
+#define PIPE_EVT(id, seq, arg) pipe_trace_emit((uint8_t)(id), (uint32_t)(seq), (uint32_t)(arg))
+#else
+#define PIPE_EVT(id, seq, arg) do{}while(0)
+#endif
+
+/* Записать событие (через PIPE_EVT). Из любого контекста. */
+void pipe_trace_emit(uint8_t id, uint32_t seq, uint32_t arg);
+
+/* Скопировать до max записей, начиная с записи, младшие 16 бит номера которой равны from16
+   (старше самой старой в кольце — с самой старой). *first — номер первой отданной записи,
+   *wr — номер следующей записи (всего записано). Возвращает число записей. */
+uint32_t pipe_trace_read(uint16_t from16, pipe_rec_t *dst, uint32_t max, uint32_t *first, uint32_t *wr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIPE_TRACE_H */
@@ -0,0 +1,33 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Монотонное время устройства на счётчике циклов DWT->CYCCNT, расширенном до 64 бит.
+   32-битный CYCCNT переполняется раз в ~7.8 с на 550 МГц; старшее слово ведёт timebase_cyc64(),
+   а timebase_tick() из SysTick гарантирует, что ни одно переполнение не пропущено. */
+
+/* Включить DWT CYCCNT (его уже включает Reset_Handler) и запомнить частоту ядра.
+   Вызвать после SystemClock_Config, до запуска АЦП и USB. Счётчик не сбрасывается никогда:
+   время отсчитывается от сброса. */
+void timebase_init(void);
+
+/* 64-битные циклы ядра. Можно вызывать из любого контекста (короткая секция под PRIMASK). */
+uint64_t timebase_cyc64(void);
+
+/* Перевод циклов в микросекунды и текущее время в мкс */
+uint64_t timebase_cyc_to_us(uint64_t cyc);
+static inline uint64_t timebase_us64(void) { return timebase_cyc_to_us(timebase_cyc64()); }
+
+/* Из SysTick_Handler (1 кГц): отслеживание переполнений CYCCNT без других вызовов */
+void timebase_tick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMEBASE_H */
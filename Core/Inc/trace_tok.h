@@ -0,0 +1,83 @@
+#ifndef TRACE_TOK_H
+#define TRACE_TOK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Токенизированный трейс: форматирование откладывается до хоста.
+   TRACE_TOK("fmt", args...) кладёт в кольцо ID строки формата, метку DWT CYCCNT и аргументы как
+   32-битные слова; printf не вызывается. Строки формата (с префиксом "файл:строка\x1f") собирает
+   компилятор в секцию .trace_fmt — в .ld она INFO (в образ не грузится), адрес строки = смещение
+   в секции = ID. Таблицу ID берёт из ELF HostTools/trace_decode.py, он же читает кольцо по EP0
+   (VND_CMD_GET_TRACE) и восстанавливает текст.
+   Аргументы — целые до 32 бит (приводятся к uint32_t); 64-битные — через TT_U64(x) (два слова,
+   в формате %ll*), строки %s — только указатели на константы прошивки (хост читает их из ELF).
+   Запись: слово0 = ID[19:0] | nargs[23:20] | seq[31:24], слово1 = CYCCNT, затем nargs слов. */
+#ifndef TRACE_TOK_ENABLE
+#define TRACE_TOK_ENABLE 1
+#endif
+#define TRACE_TOK_RING_WORDS 2048u /* слов кольца (степень двойки), 8 KB в DTCM */
+#define TRACE_TOK_MAX_ARGS   15u
+
+#define TT_U64(x) ((uint32_t)(uint64_t)(x)), ((uint32_t)((uint64_t)(x) >> 32))
+
+/* Число аргументов (0..15) и приведение каждого к слову */
+#define TT_NARGS(...) TT_NARGS_(0, ##__VA_ARGS__, 15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0)
+#define TT_NARGS_(_0,_1,_2,_3,_4,_5,_6,_7,_8,_9,_10,_11,_12,_13,_14,_15,N,...) N
+#define TT_W(x) ((uint32_t)(x))
+#define TT_MAP0()
+#define TT_MAP1(a)                                  ,TT_W(a)
+#define TT_MAP2(a,b)                                ,TT_W(a),TT_W(b)
+#define TT_MAP3(a,b,c)                              TT_MAP2(a,b),TT_W(c)
+#define TT_MAP4(a,b,c,d)                            TT_MAP3(a,b,c),TT_W(d)
+#define TT_MAP5(a,b,c,d,e)                          TT_MAP4(a,b,c,d),TT_W(e)
+#define TT_MAP6(a,b,c,d,e,f)                        TT_MAP5(a,b,c,d,e),TT_W(f)
+#define TT_MAP7(a,b,c,d,e,f,g)                      TT_MAP6(a,b,c,d,e,f),TT_W(g)
+#define TT_MAP8(a,b,c,d,e,f,g,h)                    TT_MAP7(a,b,c,d,e,f,g),TT_W(h)
+#define TT_MAP9(a,b,c,d,e,f,g,h,i)                  TT_MAP8(a,b,c,d,e,f,g,h),TT_W(i)
+#define TT_MAP10(a,b,c,d,e,f,g,h,i,j)               TT_MAP9(a,b,c,d,e,f,g,h,i),TT_W(j)
+#define TT_MAP11(a,b,c,d,e,f,g,h,i,j,k)             TT_MAP10(a,b,c,d,e,f,g,h,i,j),TT_W(k)
+#define TT_MAP12(a,b,c,d,e,f,g,h,i,j,k,l)           TT_MAP11(a,b,c,d,e,f,g,h,i,j,k),TT_W(l)
+#define TT_MAP13(a,b,c,d,e,f,g,h,i,j,k,l,m)         TT_MAP12(a,b,c,d,e,f,g,h,i,j,k,l),TT_W(m)
+#define TT_MAP14(a,b,c,d,e,f,g,h,i,j,k,l,m,n)       TT_MAP13(a,b,c,d,e,f,g,h,i,j,k,l,m),TT_W(n)
+#define TT_MAP15(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o)     TT_MAP14(a,b,c,d,e,f,g,h,i,j,k,l,m,n),TT_W(o)
+#define TT_CAT(a,b)  TT_CAT_(a,b)
+#define TT_CAT_(a,b) a##b
+#define TT_MAP(...)  TT_CAT(TT_MAP, TT_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define TT_STR(x)    TT_STR_(x)
+#define TT_STR_(x)   #x
+
+#if TRACE_TOK_ENABLE
+#define TRACE_TOK(fmt, ...) do { \
+        static const char _tt_fmt[] __attribute__((section(".trace_fmt"), used)) = \
+            __FILE__ ":" TT_STR(__LINE__) "\x1f" fmt; \
+        trace_tok_emit((uint32_t)_tt_fmt, TT_NARGS(__VA_ARGS__) TT_MAP(__VA_ARGS__)); \
+    } while(0)
+#else
+#define TRACE_TOK(fmt, ...) do{}while(0)
+#endif
+
+/* Записать событие (через TRACE_TOK). Из любого контекста; кольцо полно — запись теряется
+   (dropped, пропуск seq на хосте). */
+void trace_tok_emit(uint32_t id, uint32_t nargs, ...);
+
+/* Забрать целые записи из кольца в dst (не больше max_words слов), вернуть число слов */
+uint32_t trace_tok_read(uint32_t *dst, uint32_t max_words);
+
+typedef struct {
+    uint32_t records;     /* записей принято */
+    uint32_t dropped;     /* записей потеряно: кольцо полно */
+    uint32_t words_read;  /* слов отдано хосту */
+    uint16_t level;       /* занято слов сейчас */
+    uint16_t level_hwm;   /* максимум */
+} trace_tok_stats_t;
+void trace_tok_get_stats(trace_tok_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_TOK_H */
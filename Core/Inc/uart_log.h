@@ -0,0 +1,49 @@
+#ifndef UART_LOG_H
+#define UART_LOG_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Неблокирующий лог в USART1: printf (_write в syscalls.c) копирует строку в кольцо и сразу
+   возвращается, кольцо в фоне выгружает TX DMA (DMA1_Stream2). Из любого контекста, включая ISR:
+   запись — резервирование места и memcpy под PRIMASK (без ожидания UART), выгрузка — из прерываний
+   DMA/USART1. Кольцо в некэшируемом окне .adc_dma (DMA1 не видит DTCM), обслуживание кэша не нужно.
+   Не влезающая в кольцо строка отбрасывается целиком и учитывается в dropped_*; до uart_log_start
+   строки копятся (ранний баннер до инициализации USART1 не теряется). */
+#define UART_LOG_RING 4096u /* байт (степень двойки) */
+
+/* После MX_USART1_UART_Init: начать выгрузку накопленного */
+void uart_log_start(void);
+/* Перед переинициализацией USART1: дождаться конца текущего DMA-куска и остановить выгрузку */
+void uart_log_suspend(uint32_t timeout_ms);
+/* Дождаться выгрузки всего кольца (перед сбросом/остановом), 0 — не успели. Нужны прерывания. */
+int uart_log_flush(uint32_t timeout_ms);
+
+/* Положить len байт в кольцо; возвращает len или 0 (нет места, строка отброшена) */
+uint32_t uart_log_write(const char *p, uint32_t len);
+
+typedef struct {
+    uint32_t writes;          /* принято строк (вызовов uart_log_write) */
+    uint32_t bytes_in;        /* байт принято в кольцо */
+    uint32_t bytes_out;       /* байт выгружено DMA */
+    uint32_t dropped_writes;  /* строк отброшено: кольцо полно */
+    uint32_t dropped_bytes;
+    uint32_t dma_chunks;      /* запусков TX DMA */
+    uint32_t dma_errors;      /* ошибок UART/DMA (кусок считается потерянным) */
+    uint16_t level;           /* занято сейчас, байт */
+    uint16_t level_hwm;       /* максимум заполнения кольца, байт */
+    uint8_t  running;         /* выгрузка разрешена (uart_log_start) */
+    uint8_t  busy;            /* DMA-кусок в полёте */
+    uint64_t wr_cyc_sum;      /* циклы DWT на принятые uart_log_write */
+    uint32_t wr_cyc_max;      /* максимум на вызов */
+} uart_log_stats_t;
+void uart_log_get_stats(uart_log_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UART_LOG_H */
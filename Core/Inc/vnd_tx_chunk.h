@@ -0,0 +1,33 @@
+#ifndef VND_TX_CHUNK_H
+#define VND_TX_CHUNK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Куски передачи Vendor IN (vnd_tx_next_chunk, usbd_cdc_custom.c) без HAL: длина очередного куска
+   и копия куска в bounce-буфер для USBD_VND_Transmit. На хосте их гоняет
+   HostTools/tests/bench_tx_copy.c. */
+
+/* Максимальный кусок одного LL-трансфера. Кадр длиннее уходит цепочкой таких кусков
+   в рамках одной логической передачи: кусок кратен MPS (64 FS / 512 HS, проверка в
+   usbd_cdc_custom.c), поэтому хост не видит короткого пакета до конца кадра. Он же — размер
+   bounce-буфера vnd_tx_buf. */
+#define VND_TX_CHUNK_MAX 2048u
+
+// Длина следующего куска передачи из total байт, из которых queued уже поставлено в LL
+static inline uint32_t vnd_tx_chunk_len(uint32_t total, uint32_t queued) {
+    uint32_t remain = total - queued;
+    return (remain > VND_TX_CHUNK_MAX) ? VND_TX_CHUNK_MAX : remain;
+}
+
+// Копия куска src[0..n) (n <= VND_TX_CHUNK_MAX) в bounce; возвращает bounce — его и отдают в LL
+const uint8_t *vnd_tx_chunk_bounce(uint8_t *bounce, const uint8_t *src, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VND_TX_CHUNK_H */
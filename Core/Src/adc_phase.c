@@ -0,0 +1,28 @@
+/* Фаза меандра для кадров АЦП: счётчики TIM2/TIM15 и кольцо захвата фронтов (см. adc_phase.h) */
+#include "main.h"
+#include "adc_phase.h"
+
+_Static_assert((ADC_EDGE_RING & (ADC_EDGE_RING - 1u)) == 0u, "ADC_EDGE_RING must be a power of two");
+
+ITCM_FUNC int32_t adc_phase_counters(const adc_phase_geom_t *g, uint32_t p, uint32_t n, uint32_t cur,
+                                     uint32_t c15, uint32_t c2, uint32_t ndtr, uint32_t c15b) {
+    uint32_t since = c15 * g->div15;
+    if (c15b < c15 || since < g->guard || ndtr > cur) return -1;
+    int64_t e = (int64_t)c2 * g->div2 + (g->div2 - 1u) / 2u - since - (g->div15 - 1u) / 2u;
+    e += (int64_t)p * g->t15; // не отрицательное у начала периода
+    int64_t kr = (e + g->t15 / 2u) / g->t15;
+    int64_t k = (kr - (int64_t)(cur - ndtr) - (int64_t)(n - 1u)) % (int64_t)p;
+    if (k < 0) k += p;
+    return (int32_t)k;
+}
+
+ITCM_FUNC int32_t adc_edge_pick(const volatile uint32_t *ring, uint32_t rd, uint32_t w, uint32_t ndtr, uint32_t n,
+                                uint32_t *amb) {
+    uint32_t cnt = (w - rd) & (ADC_EDGE_RING - 1u);
+    for (uint32_t i = cnt; i > 0u; i--) {
+        uint32_t v = ring[(rd + i - 1u) & (ADC_EDGE_RING - 1u)] & 0xFFFFu;
+        if (v != 0u && v < ndtr && v <= n) return (int32_t)(n - v);
+        (*amb)++;
+    }
+    return -1;
+}
@@ -0,0 +1,55 @@
+/* Кольцо кадров АЦП без блокировок: счётчики, поколения слотов, сторона потребителя (см. adc_ring.h) */
+#include "main.h"
+#include "adc_ring.h"
+
+volatile uint32_t frame_wr_seq = 0;      // сколько кадров записано (ISR)
+volatile uint32_t frame_rd_seq = 0;      // сколько кадров прочитано потребителем
+volatile uint32_t frame_overflow_drops = 0; // отброшено при переполнении
+volatile uint32_t frame_backlog_max = 0; // максимальный (wr-rd)
+volatile uint32_t frame_torn = 0;        // кадров, слот которых DMA занял во время чтения (потребитель)
+
+// Поколение слота (пишет только ISR), см. ADC_GEN_*
+DTCM_BSS volatile uint32_t adc_ring_gen[FIFO_FRAMES];
+
+_Static_assert(FIFO_FRAMES >= 4u && (FIFO_FRAMES & (FIFO_FRAMES - 1u)) == 0u, "FIFO_FRAMES: степень двойки >= 4");
+
+void adc_ring_clear(void) {
+    frame_wr_seq = frame_rd_seq = 0;
+    frame_overflow_drops = 0;
+    frame_backlog_max = 0;
+    frame_torn = 0;
+    for (uint32_t i = 0; i < FIFO_FRAMES; i++) adc_ring_gen[i] = ADC_GEN_NONE;
+    adc_ring_gen[0] = ADC_GEN_DMA(0u);
+    adc_ring_gen[1] = ADC_GEN_DMA(1u);
+}
+
+uint8_t adc_stream_acquire(uint32_t *seq, uint32_t *skipped, uint8_t latest) {
+    uint32_t wr = frame_wr_seq;
+    uint32_t rd = frame_rd_seq;
+    uint32_t backlog = wr - rd;
+    if (backlog == 0u) return 0;
+    uint32_t s = rd;
+    if (backlog > ADC_RING_READABLE) {
+        /* Старые кадры уже у DMA: потеряны, самый старый из ещё целых — wr - READABLE */
+        s = wr - ADC_RING_READABLE;
+        frame_overflow_drops += s - rd;
+    }
+    uint32_t oldest = s;
+    if (latest) s = wr - 1u;
+    frame_rd_seq = s + 1u;
+    __DMB(); /* чтение слота — после чтения frame_wr_seq */
+    if (skipped) *skipped = s - oldest;
+    *seq = s;
+    return 1;
+}
+
+void adc_stream_unget(uint32_t seq) {
+    if ((frame_wr_seq - seq) <= ADC_RING_READABLE) frame_rd_seq = seq;
+}
+
+uint8_t adc_stream_validate(uint32_t seq) {
+    __DMB(); /* поколение — после чтения данных слота */
+    if (adc_ring_gen[seq & (FIFO_FRAMES - 1u)] == ADC_GEN_READY(seq)) return 1;
+    frame_torn++;
+    return 0;
+}
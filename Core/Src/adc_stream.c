@@ -4,6 +4,11 @@
 #include <stdio.h>
 #include "main.h"
 #include "adc_stream.h"
+#include "adc_phase.h"
+#include "timebase.h"
+#include "boot_time.h"
+#include "pipe_trace.h"
+#include "cyc_prof.h"
 
 /* Управление логированием этого модуля: по умолчанию выключено, чтобы не спамить из ISR */
 #ifndef ADC_LOG_ENABLE
@@ -20,22 +25,36 @@
 extern ADC_HandleTypeDef* s_adc1;
 extern ADC_HandleTypeDef* s_adc2;
 extern volatile uint32_t s_next_ring_index;
+static void adc_ring_reset(void);
 
 // Выводит count семплов из последнего доступного кадра в терминал (ch2 — если true, то второй канал)
 void adc_stream_print_samples(uint32_t count, bool ch2) {
     ADC_LOGF("Старт вывода семплов\r\n");
     uint32_t seq = frame_wr_seq ? (frame_wr_seq - 1) : 0;
     uint32_t index = seq & (FIFO_FRAMES - 1u);
-    uint16_t *buf = ch2 ? adc2_buffers[index] : adc1_buffers[index];
     ADC_LOGF("[ADC][SAMPLES] ch%d seq=%lu index=%lu: ", ch2 ? 2 : 1, (unsigned long)seq, (unsigned long)index);
     uint16_t max = adc_stream_get_active_samples();
+#if ADC_STREAM_DUAL_MODE
+    const uint32_t *ab = adc12_buffers[index];
+    for (uint32_t i = 0; i < count && i < max; ++i) {
+        ADC_LOGF("%u ", (unsigned)(uint16_t)(ch2 ? (ab[i] >> 16) : ab[i]));
+    }
+#else
+    uint16_t *buf = ch2 ? adc2_buffers[index] : adc1_buffers[index];
     for (uint32_t i = 0; i < count && i < max; ++i) {
         ADC_LOGF("%u ", buf[i]);
     }
+#endif
     ADC_LOGF("\r\n");
 }
-// Остановка стрима ADC: корректно останавливает DMA и ADC, сбрасывает буферы
-void adc_stream_stop(void) {
+// Остановка DMA и АЦП без сброса кольца
+static void adc_stream_halt(void) {
+#if ADC_STREAM_DUAL_MODE
+    /* Останавливает оба АЦП пары и общий поток DMA */
+    if (s_adc1) {
+        HAL_ADCEx_MultiModeStop_DMA(s_adc1);
+    }
+#else
     if (s_adc1) {
         HAL_ADC_Stop_DMA(s_adc1);
         HAL_ADC_Stop(s_adc1);
@@ -44,10 +63,13 @@ void adc_stream_stop(void) {
         HAL_ADC_Stop_DMA(s_adc2);
         HAL_ADC_Stop(s_adc2);
     }
-    frame_wr_seq = frame_rd_seq = 0;
-    frame_overflow_drops = 0;
-    frame_backlog_max = 0;
-    s_next_ring_index = 0;
+#endif
+}
+
+// Остановка стрима ADC: корректно останавливает DMA и ADC, сбрасывает буферы
+void adc_stream_stop(void) {
+    adc_stream_halt();
+    adc_ring_reset();
     ADC_LOGF("[ADC][STOP] DMA и ADC остановлены, буферы сброшены\r\n");
 }
 
@@ -85,6 +107,12 @@ void adc_stream_stop(void) {
 #define ADC2_DISABLE_DMA_IRQS 1
 #endif
 
+/* Захват фронта меандра TIM2 потоком DMA2 (фаза отсчётов кадра без опроса GPIO).
+    1 = включено, 0 = фаза только по счётчикам TIM2/TIM15 в TC (нужны кратные периоды). */
+#ifndef ADC_EDGE_CAPTURE
+#define ADC_EDGE_CAPTURE 1
+#endif
+
 static volatile uint32_t dbg_dma1_half_count = 0, dbg_dma1_full_count = 0;
 extern DMA_HandleTypeDef hdma_adc1; /* из auto-generated кода */
 extern DMA_HandleTypeDef hdma_adc2;
@@ -98,19 +126,89 @@ static const adc_stream_profile_t g_profiles[ADC_PROFILE_COUNT] = {
 };
 static uint8_t g_active_profile = ADC_PROFILE_B_DEFAULT;
 static uint16_t g_active_samples = 912; // runtime N
+static adc_stream_profile_t g_custom_profile; // ADC_PROFILE_CUSTOM (SET_ACQ), fs_hz — достигнутая
+static uint32_t g_custom_fs_req = 0;          // Fs, запрошенная в SET_ACQ
+static uint32_t g_fs_eff_hz = 0;              // фактическая Fs по TIM15 (для заголовка кадра)
+static uint8_t  g_sample_bits = 16;           // значащих бит отсчёта после оверсэмплинга
 
-// Выравнивание по линии кэша для снижения побочных эффектов DCache (32 байт)
-__attribute__((aligned(32))) uint16_t adc1_buffers[FIFO_FRAMES][MAX_FRAME_SAMPLES];
-__attribute__((aligned(32))) uint16_t adc2_buffers[FIFO_FRAMES][MAX_FRAME_SAMPLES];
+// Буферы, которые пишет DMA1/DMA2: DTCM им недоступна, секция .adc_dma в AXI SRAM —
+// некэшируемый регион MPU (MPU_Config), обслуживание D-Cache не нужно. Не обнуляется при старте.
+#define ADC_DMA_BUF __attribute__((section(".adc_dma"), aligned(32)))
+#if ADC_STREAM_DUAL_MODE
+ADC_DMA_BUF uint32_t adc12_buffers[FIFO_FRAMES][MAX_FRAME_SAMPLES];
+// Раскладка кадра для adc_get_frame (потребители, которым нужны каналы по отдельности)
+static uint16_t s_split_ch1[MAX_FRAME_SAMPLES], s_split_ch2[MAX_FRAME_SAMPLES];
+#else
+ADC_DMA_BUF uint16_t adc1_buffers[FIFO_FRAMES][MAX_FRAME_SAMPLES];
+ADC_DMA_BUF uint16_t adc2_buffers[FIFO_FRAMES][MAX_FRAME_SAMPLES];
+#endif
 
-volatile uint32_t frame_wr_seq = 0;      // сколько кадров записано (ISR)
-volatile uint32_t frame_rd_seq = 0;      // сколько кадров прочитано потребителем
-volatile uint32_t frame_overflow_drops = 0; // отброшено при переполнении
+// Счётчики кольца и поколения слотов — adc_ring.c
 volatile uint32_t frame_sent_seq = 0;    // успешно отправлено по USB (увеличивается вызывающим кодом)
-volatile uint32_t frame_backlog_max = 0; // максимальный (wr-rd)
 volatile uint32_t adc_last_full0_ms = 0; // время последнего полного DMA ADC1
 volatile uint32_t adc_last_full1_ms = 0; // время последнего полного DMA ADC2
 
+// Метка завершения DMA кадра (64-битные циклы DWT) по слоту кольца; пишется в ISR до frame_wr_seq++
+DTCM_BSS static volatile uint64_t s_frame_cyc[FIFO_FRAMES];
+
+// Длина кадра в слоте (пишет ISR до ADC_GEN_READY): N, с которым DMA заполнял слот,
+// и признак первого кадра после смены N — по нему потребитель перефиксирует размер
+#define ADC_SLOT_FIRST      0x8000u
+DTCM_BSS static volatile uint16_t s_slot_info[FIFO_FRAMES];
+
+// Смена профиля на границе кадра (без остановки DMA): запрос пишет adc_stream_set_profile(),
+// применяет ISR TC ADC1. Все поля — под PRIMASK, ISR читает их тоже под PRIMASK.
+static volatile uint16_t s_dma_samples = 0;  // N, на который сейчас взведён DMA (0 — ещё не запускался)
+static volatile uint16_t s_sw_samples = 0;   // N запрошенного профиля
+static volatile uint8_t  s_sw_pending = 0;   // запрос ждёт границы кадра
+static volatile uint8_t  s_sw_mark = 0;      // следующий завершённый кадр — первый с новым N
+static volatile uint32_t s_sw_count = 0;     // смен на границе кадра
+static volatile uint32_t s_sw_deferred = 0;  // границ пропущено: в активный банк уже пришёл отсчёт
+static volatile uint32_t s_sw_slip = 0;      // отсчёт пришёл между проверкой и остановкой потока
+static volatile uint32_t s_sw_restarts = 0;  // смен N перезапуском DMA (TIM15/SMP, DMA стоял)
+
+// Фаза меандра TIM2 для отсчётов (синхронное детектирование, фронты в заголовке кадра). TIM15 сбрасывается
+// по TRGO TIM2, поэтому отсчёт k (0..P-1) периода меандра приходит ровно через k*T15 тактов после его начала.
+// Геометрию считает adc_phase_refresh() при остановленном DMA; ведёт фазу ISR TC ADC1.
+static uint16_t s_ph_period = 0;             // P: отсчётов на период меандра (0 — фаза недоступна)
+static uint16_t s_ph_high = 0;               // H: отсчёты k < H — высокий уровень TIM2_CH2 (PWM1, CCR2)
+static adc_phase_geom_t s_ph_geo = { 0u, 1u, 1u, 0u }; // такты отсчёта, делители, запас NDTR (adc_phase.h)
+static volatile uint16_t s_ph_next = ADC_PHASE_NONE; // фаза первого отсчёта следующего кадра
+DTCM_BSS static volatile uint16_t s_slot_phase[FIFO_FRAMES];  // фаза первого отсчёта кадра в слоте (пишет ISR до READY)
+static volatile uint32_t s_ph_meas = 0;      // измерений фазы по счётчикам TIM2/TIM15
+static volatile uint32_t s_ph_fix = 0;       // измерение разошлось с ведением по N (отсчёт потерян при смене)
+static volatile uint32_t s_ph_dirty = 0;     // кадров без измерения (нет фронта, TC рядом с триггером): фаза ведётся по N
+static uint8_t s_ph_cnt = 0;                 // измерение по счётчикам возможно (периоды кратны, CNT TIM2 не груб)
+
+#if ADC_EDGE_CAPTURE
+// Захват фронта: запрос TIM2_UP (начало периода меандра; тот же фронт сбрасывает TIM15 и запускает
+// отсчёт k=0) — поток DMA2 копирует NDTR потока АЦП ADC1 в кольцо, без прерываний. Отсчёт фронта
+// доходит до NDTR только после преобразования, поэтому N-NDTR — его номер в банке, активном на фронте.
+// Кольцо разбирает ISR TC ADC1 (adc_edge_at_tc).
+#define ADC_EDGE_DMA_TICKS  48u   // фронт -> DMAMUX -> чтение NDTR потоком DMA2, тактов таймера, с запасом
+static DMA_HandleTypeDef hdma_edge;
+ADC_DMA_BUF static volatile uint32_t s_edge_ring[ADC_EDGE_RING];
+static uint8_t  s_edge_run = 0;              // поток захвата запущен
+static uint8_t  s_edge_ok = 0;               // захват годен для текущей геометрии (adc_phase_refresh)
+static uint32_t s_edge_rd = 0;               // позиция кольца, разобранная прошлым TC
+static volatile uint32_t s_edge_count = 0;   // фронтов захвачено
+static volatile uint32_t s_edge_amb = 0;     // фронтов у границы банка: банк неоднозначен, не использованы
+static volatile uint32_t s_ph_edge = 0;      // кадров с фазой по захваченному фронту
+static void adc_edge_sync(void);
+static void adc_edge_start(void);
+#endif
+
+// Сброс кольца при остановленном DMA: слоты 0 и 1 сразу отданы банкам M0/M1 под кадры 0 и 1
+static void adc_ring_reset(void) {
+    adc_ring_clear();
+    for (uint32_t i = 0; i < FIFO_FRAMES; i++) { s_slot_info[i] = 0; s_slot_phase[i] = ADC_PHASE_NONE; }
+    s_ph_next = ADC_PHASE_NONE; // после перезапуска DMA фазу первого кадра меряем заново
+#if ADC_EDGE_CAPTURE
+    adc_edge_sync();            // фронты до перезапуска относятся к старым банкам
+#endif
+    s_next_ring_index = 2 % FIFO_FRAMES;
+}
+
 // Debug: DMA event counters
 static volatile uint32_t dma_half0 = 0, dma_full0 = 0, dma_half1 = 0, dma_full1 = 0;
 
@@ -123,8 +221,13 @@ ADC_HandleTypeDef* s_adc2 = NULL;
 // Публичные функции профиля
 uint8_t adc_stream_get_profile(void) { return g_active_profile; }
 uint16_t adc_stream_get_active_samples(void) { return g_active_samples; }
-uint16_t adc_stream_get_buf_rate(void) { return g_profiles[g_active_profile].buf_rate_hz; }
-uint32_t adc_stream_get_fs(void) { return g_profiles[g_active_profile].fs_hz; }
+static const adc_stream_profile_t *adc_active_prof(void) {
+    return (g_active_profile == ADC_PROFILE_CUSTOM) ? &g_custom_profile : &g_profiles[g_active_profile];
+}
+uint16_t adc_stream_get_buf_rate(void) { return adc_active_prof()->buf_rate_hz; }
+uint32_t adc_stream_get_fs(void) { return adc_active_prof()->fs_hz; }
+uint32_t adc_stream_get_sample_rate(void) { return g_fs_eff_hz; }
+uint8_t adc_stream_get_sample_bits(void) { return g_sample_bits; }
 
 static HAL_StatusTypeDef adc_stream_apply_profile(void) {
     if (!s_adc1 || !s_adc2) {
@@ -134,16 +237,44 @@ static HAL_StatusTypeDef adc_stream_apply_profile(void) {
     uint32_t total_samples = (uint32_t)g_active_samples;
     ADC_LOGF("[ADC][APPLY_PROFILE] profile=%u samples=%u\r\n", (unsigned)g_active_profile, (unsigned)g_active_samples);
     // Остановить DMA перед запуском с новым размером
+#if ADC_STREAM_DUAL_MODE
+    HAL_ADCEx_MultiModeStop_DMA(s_adc1);
+#else
     HAL_ADC_Stop_DMA(s_adc1);
     HAL_ADC_Stop_DMA(s_adc2);
+#endif
     ADC_LOGF("[ADC][APPLY_PROFILE] DMA остановлен, подготовка к запуску\r\n");
-    frame_wr_seq = frame_rd_seq = 0;
-    frame_overflow_drops = 0;
-    frame_backlog_max = 0;
-    s_next_ring_index = 2 % FIFO_FRAMES; // M0->buf0, M1->buf1 уже заняты при старте; начнём с 2
+    adc_ring_reset(); // M0->buf0, M1->buf1 заняты при старте; свободный банк пойдёт на buf2
+    {
+        /* Перезапуск поглощает незавершённую смену на границе кадра; кадр 0 нового N помечаем */
+        uint32_t pm = __get_PRIMASK();
+        __disable_irq();
+        s_sw_pending = 0;
+        if (s_dma_samples != 0u && s_dma_samples != (uint16_t)total_samples) {
+            s_sw_restarts++;
+            s_sw_mark = 1;
+        }
+        s_dma_samples = (uint16_t)total_samples;
+        __set_PRIMASK(pm);
+    }
     #if DIAG_DISABLE_ADC_DMA
         ADC_LOGF("[ADC][DIAG] DMA start suppressed (DIAG_DISABLE_ADC_DMA=1) total_samples=%lu\r\n", (unsigned long)total_samples);
         return HAL_OK;
+    #elif ADC_STREAM_DUAL_MODE
+    /* Пара ADC1+ADC2 на одном потоке DMA ADC1: N слов {ADC1 | ADC2<<16} на буфер.
+       ADC2 стартует вместе с мастером, второго потока и его прерываний нет. */
+    HAL_StatusTypeDef rc = HAL_ADCEx_MultiModeStart_DMA(s_adc1, adc12_buffers[0], total_samples);
+    ADC_LOGF("[ADC][APPLY_PROFILE] HAL_ADCEx_MultiModeStart_DMA rc=%d\r\n", (int)rc);
+    if (rc != HAL_OK) return HAL_ERROR;
+        {
+            DMA_Stream_TypeDef *st = (DMA_Stream_TypeDef*)hdma_adc1.Instance;
+            st->M1AR = (uint32_t)adc12_buffers[1];
+            st->CR  |= (uint32_t)(1u<<18); /* DBM */
+            st->CR &= ~((uint32_t)(1u<<3)); /* только TC */
+            ADC_LOGF("[ADC][DMA1S0] dual CR=0x%08lX NDTR=%lu PAR=0x%08lX M0AR=0x%08lX\r\n",
+                   (unsigned long)st->CR, (unsigned long)st->NDTR,
+                   (unsigned long)st->PAR, (unsigned long)st->M0AR);
+        }
     #else
         // Старт ADC1 DMA на буфер[0] длиной N
     HAL_StatusTypeDef rc1 = HAL_ADC_Start_DMA(s_adc1, (uint32_t*)adc1_buffers[0], total_samples);
@@ -197,9 +328,107 @@ static HAL_StatusTypeDef adc_stream_apply_profile(void) {
     return HAL_OK;
 }
 
+static void adc_acq_restore_boot(void);
+
+// Поток DMA ADC1 идёт (EN=1): смену N можно отложить до границы кадра
+static uint8_t adc_stream_dma_running(void) {
+#if DIAG_DISABLE_ADC_DMA
+    return 0;
+#else
+    if (!s_adc1 || !s_adc2 || s_dma_samples == 0u) return 0;
+    return (((DMA_Stream_TypeDef*)hdma_adc1.Instance)->CR & 1u) ? 1u : 0u; /* EN */
+#endif
+}
+
+// Запросить смену N на ближайшей границе кадра; возврат к текущему N снимает запрос
+static void adc_switch_request(uint16_t samples) {
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    s_sw_samples = samples;
+    s_sw_pending = (samples != s_dma_samples) ? 1u : 0u;
+    __set_PRIMASK(pm);
+}
+
+// Выполнить запрос из TC кадра seq (ISR ADC1), до переадресации свободного банка.
+// В DBM NDTR общий для обоих банков и записывается только при EN=0, поэтому поток
+// перевзводится: активный банк (слот seq+1) ещё пуст — останавливаем поток, ставим новый NDTR,
+// M0 = слот seq+1, M1 = слот seq+2, CT=0 и включаем снова. Триггер TIM15 не трогаем: если отсчёт
+// придёт, пока EN=0, запрос АЦП дождётся включения потока. 1 — поток перевзведён.
+static ITCM_FUNC uint8_t adc_switch_at_tc(uint32_t seq) {
+    if (!s_sw_pending) return 0;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    uint32_t cur = s_dma_samples;
+    uint16_t n = s_sw_samples;
+    DMA_Stream_TypeDef *st1 = (DMA_Stream_TypeDef*)hdma_adc1.Instance;
+    uint8_t idle = s_sw_pending && (st1->NDTR == cur);
+#if !ADC_STREAM_DUAL_MODE && !DIAG_SINGLE_ADC1
+    /* ADC2 без прерываний: его банк должен уже переключиться вместе с ADC1 (тот же CT) */
+    DMA_Stream_TypeDef *st2 = (DMA_Stream_TypeDef*)hdma_adc2.Instance;
+    idle = idle && (st2->NDTR == cur) && (((st1->CR ^ st2->CR) & (1u<<19)) == 0u);
+#endif
+    if (!idle) {
+        if (s_sw_pending) s_sw_deferred++;
+        __set_PRIMASK(pm);
+        return 0;
+    }
+    uint32_t a = (seq + 1u) & (FIFO_FRAMES - 1u);
+    uint32_t b = (seq + 2u) & (FIFO_FRAMES - 1u);
+    st1->CR &= ~1u; /* EN */
+#if !ADC_STREAM_DUAL_MODE && !DIAG_SINGLE_ADC1
+    st2->CR &= ~1u;
+    while (st2->CR & 1u) { }
+#endif
+    while (st1->CR & 1u) { }
+    uint8_t slip = (st1->NDTR != cur);
+    /* Остановка потока выставляет TCIF — сбрасываем, чтобы не получить ложный кадр */
+    __HAL_DMA_CLEAR_FLAG(&hdma_adc1, __HAL_DMA_GET_TC_FLAG_INDEX(&hdma_adc1) | __HAL_DMA_GET_HT_FLAG_INDEX(&hdma_adc1) |
+                         __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_adc1) | __HAL_DMA_GET_DME_FLAG_INDEX(&hdma_adc1) |
+                         __HAL_DMA_GET_FE_FLAG_INDEX(&hdma_adc1));
+    adc_ring_to_dma(b, seq + 2u);
+    st1->NDTR = n;
+#if ADC_STREAM_DUAL_MODE
+    st1->M0AR = (uint32_t)adc12_buffers[a];
+    st1->M1AR = (uint32_t)adc12_buffers[b];
+#else
+    st1->M0AR = (uint32_t)adc1_buffers[a];
+    st1->M1AR = (uint32_t)adc1_buffers[b];
+#endif
+    st1->CR &= ~(1u<<19); /* CT=0: первым заполняется M0 */
+#if !ADC_STREAM_DUAL_MODE && !DIAG_SINGLE_ADC1
+    slip |= (st2->NDTR != cur);
+    __HAL_DMA_CLEAR_FLAG(&hdma_adc2, __HAL_DMA_GET_TC_FLAG_INDEX(&hdma_adc2) | __HAL_DMA_GET_HT_FLAG_INDEX(&hdma_adc2) |
+                         __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_adc2) | __HAL_DMA_GET_DME_FLAG_INDEX(&hdma_adc2) |
+                         __HAL_DMA_GET_FE_FLAG_INDEX(&hdma_adc2));
+    st2->NDTR = n;
+    st2->M0AR = (uint32_t)adc2_buffers[a];
+    st2->M1AR = (uint32_t)adc2_buffers[b];
+    st2->CR &= ~(1u<<19);
+    st2->CR |= 1u;
+#endif
+    st1->CR |= 1u;
+    /* Отсчёт, успевший лечь в слот seq+1 до остановки, перезапишется: кадр seq+1 всё равно первый с новым N */
+    if (slip) s_sw_slip++;
+    s_next_ring_index = (seq + 3u) & (FIFO_FRAMES - 1u);
+    s_dma_samples = n;
+    s_sw_pending = 0;
+    s_sw_mark = 1;
+    s_sw_count++;
+    __set_PRIMASK(pm);
+    return 1;
+}
+
 int adc_stream_set_profile(uint8_t prof_id) {
     if (prof_id >= ADC_PROFILE_COUNT) return -1;
     if (prof_id == g_active_profile) return 0; // уже
+    if (g_active_profile != ADC_PROFILE_CUSTOM && adc_stream_dma_running()) {
+        /* TIM15 и время выборки общие для всей таблицы — меняется только N: без остановки DMA */
+        g_active_profile = prof_id;
+        g_active_samples = g_profiles[prof_id].samples_per_buf;
+        adc_switch_request(g_active_samples);
+        return 0;
+    }
+    if (g_active_profile == ADC_PROFILE_CUSTOM) adc_acq_restore_boot(); // таблица — с TIM15 из CubeMX
     g_active_profile = prof_id;
     g_active_samples = g_profiles[prof_id].samples_per_buf;
     if (s_adc1 && s_adc2) {
@@ -208,10 +437,262 @@ int adc_stream_set_profile(uint8_t prof_id) {
     return 0;
 }
 
+// --- Произвольный режим захвата (SET_ACQ) ---
+extern TIM_HandleTypeDef htim15;
+extern TIM_HandleTypeDef htim2;
+
+// Длительность выборки по коду SMP, в полутактах АЦП (1.5, 2.5, 8.5, 16.5, 32.5, 64.5, 387.5, 810.5)
+static const uint16_t s_smp_x2[8] = { 3u, 5u, 17u, 33u, 65u, 129u, 775u, 1621u };
+#define ADC_ACQ_SAR_X2  17u   // SAR 16 бит — 8.5 такта
+
+// Настройки из CubeMX, к которым возвращаемся при выборе профиля из таблицы
+static uint8_t  s_boot_saved = 0;
+static uint32_t s_boot_psc, s_boot_arr, s_boot_ccr1, s_boot_smp, s_boot_ovs_ratio, s_boot_ovs_shift;
+
+// Такт таймеров на шине APB с частотой pclk (RM0468, RCC_CFGR.TIMPRE)
+static uint32_t adc_acq_tim_clk(uint32_t pclk) {
+    uint32_t hclk = HAL_RCC_GetHCLKFreq();
+    uint32_t div = pclk ? (hclk / pclk) : 1u;
+    uint32_t lim = (RCC->CFGR & RCC_CFGR_TIMPRE) ? 4u : 2u;
+    return (div <= lim) ? hclk : pclk * lim;
+}
+
+// Такт ядра АЦП (ADC12_COMMON->CCR: CKMODE/PRESC)
+static uint32_t adc_acq_adc_clk(void) {
+    static const uint16_t presc[12] = { 1u, 2u, 4u, 6u, 8u, 10u, 12u, 16u, 32u, 64u, 128u, 256u };
+    uint32_t ccr = ADC12_COMMON->CCR;
+    uint32_t ckmode = (ccr >> 16) & 3u;
+    uint32_t f;
+    if (ckmode) {
+        f = HAL_RCC_GetHCLKFreq() / ((ckmode == 3u) ? 4u : ckmode);
+    } else {
+        uint32_t p = (ccr >> 18) & 0xFu;
+        f = (uint32_t)HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_ADC) / presc[(p < 12u) ? p : 11u];
+    }
+    return f / 2u; // делитель /2 на входе АЦП (STM32H72x/73x)
+}
+
+// SMPR канала первого ранга (в стриме он единственный)
+static volatile uint32_t *adc_acq_smpr(ADC_TypeDef *adc, uint32_t *shift) {
+    uint32_t ch = (adc->SQR1 >> 6) & 0x1Fu;
+    *shift = (ch % 10u) * 3u;
+    return (ch < 10u) ? &adc->SMPR1 : &adc->SMPR2;
+}
+static uint32_t adc_acq_get_smp(ADC_TypeDef *adc) {
+    uint32_t sh; volatile uint32_t *r = adc_acq_smpr(adc, &sh);
+    return (*r >> sh) & 7u;
+}
+static void adc_acq_set_smp(ADC_TypeDef *adc, uint32_t smp) {
+    uint32_t sh; volatile uint32_t *r = adc_acq_smpr(adc, &sh);
+    *r = (*r & ~(7u << sh)) | ((smp & 7u) << sh);
+}
+
+// Оверсэмплинг регулярного канала (CFGR2): ratio преобразований подряд на один триггер (TROVS=0),
+// сумма сдвигается вправо на shift. Возвращает ratio (1 — выключен).
+static uint32_t adc_acq_get_ovs(ADC_TypeDef *adc, uint32_t *shift) {
+    uint32_t c = adc->CFGR2;
+    if (!(c & ADC_CFGR2_ROVSE)) { *shift = 0; return 1u; }
+    *shift = (c & ADC_CFGR2_OVSS) >> ADC_CFGR2_OVSS_Pos;
+    return ((c & ADC_CFGR2_OVSR) >> ADC_CFGR2_OVSR_Pos) + 1u;
+}
+static void adc_acq_set_ovs(ADC_TypeDef *adc, uint32_t ratio, uint32_t shift) {
+    uint32_t c = adc->CFGR2 & ~(ADC_CFGR2_ROVSE | ADC_CFGR2_TROVS | ADC_CFGR2_ROVSM | ADC_CFGR2_OVSS | ADC_CFGR2_OVSR);
+    if (ratio > 1u) c |= ADC_CFGR2_ROVSE | ((ratio - 1u) << ADC_CFGR2_OVSR_Pos) | (shift << ADC_CFGR2_OVSS_Pos);
+    adc->CFGR2 = c;
+}
+// Значащих бит в отсчёте: сумма ratio 16-битных результатов занимает 16 + ceil(log2 ratio) бит
+static uint8_t adc_acq_bits(uint32_t ratio, uint32_t shift) {
+    uint32_t lg = 0;
+    while ((1u << lg) < ratio) lg++;
+    return (uint8_t)(16u + lg - shift);
+}
+
+static void adc_acq_save_boot(void) {
+    if (s_boot_saved || !s_adc1) return;
+    TIM_TypeDef *t = htim15.Instance;
+    s_boot_psc = t->PSC; s_boot_arr = t->ARR; s_boot_ccr1 = t->CCR1;
+    s_boot_smp = adc_acq_get_smp(s_adc1->Instance);
+    s_boot_ovs_ratio = adc_acq_get_ovs(s_adc1->Instance, &s_boot_ovs_shift);
+    s_boot_saved = 1;
+}
+
+// Геометрия фазы по регистрам TIM2/TIM15/АЦП. Оба таймера должны быть на одном такте; на период
+// меандра приходится P = ceil(T2/T15) триггеров (сброс TIM15 по фронту — тоже триггер). Фазу кадра
+// даёт захват фронта, если отсчёт фронта и предыдущий не пересекаются с чтением NDTR потоком DMA2,
+// либо счётчики в TC — при кратных периодах и ошибке оценки по CNT TIM2 (шаг PSC+1) меньше T15/2.
+#define ADC_PHASE_DMA_TICKS  64u   // EOC -> запрос DMA -> NDTR, с запасом
+static void adc_phase_refresh(void) {
+    TIM_TypeDef *t15 = htim15.Instance, *t2 = htim2.Instance;
+    uint32_t tclk = adc_acq_tim_clk(HAL_RCC_GetPCLK2Freq());
+    uint32_t div15 = (t15->PSC & 0xFFFFu) + 1u, div2 = (t2->PSC & 0xFFFFu) + 1u;
+    uint32_t t15_ticks = div15 * ((t15->ARR & 0xFFFFu) + 1u);
+    uint64_t t2_ticks = (uint64_t)div2 * ((t2->ARR & 0xFFFFFFFFu) + 1u);
+    uint64_t p = t15_ticks ? (t2_ticks + t15_ticks - 1u) / t15_ticks : 0u;
+    s_ph_period = 0;
+    s_ph_cnt = 0;
+#if ADC_EDGE_CAPTURE
+    s_edge_ok = 0;
+#endif
+    s_ph_next = ADC_PHASE_NONE;
+    if (tclk != adc_acq_tim_clk(HAL_RCC_GetPCLK1Freq())) return;
+    if (p < 4u || p > 0xFFFFu) return;
+    uint32_t sh = 0, r = s_adc1 ? adc_acq_get_ovs(s_adc1->Instance, &sh) : 1u;
+    uint32_t smp = s_adc1 ? adc_acq_get_smp(s_adc1->Instance) : 0u;
+    uint32_t aclk = adc_acq_adc_clk();
+    uint64_t conv = aclk ? ((uint64_t)(s_smp_x2[smp] + ADC_ACQ_SAR_X2) * r * tclk) / (2u * (uint64_t)aclk) : t15_ticks;
+    uint64_t last = t2_ticks - (p - 1u) * t15_ticks; // от последнего триггера периода до фронта (= T15 при кратных)
+    s_ph_cnt = ((t2_ticks % t15_ticks) == 0u && t15_ticks > div15 + div2 + 32u) ? 1u : 0u;
+#if ADC_EDGE_CAPTURE
+    /* Кольцо разбирается раз в кадр: фронтов на кадр должно быть заметно меньше его длины */
+    s_edge_ok = (s_edge_run && conv >= ADC_EDGE_DMA_TICKS && last >= conv + ADC_PHASE_DMA_TICKS &&
+                 MAX_FRAME_SAMPLES / p + 4u <= ADC_EDGE_RING) ? 1u : 0u;
+    if (!s_ph_cnt && !s_edge_ok) return;
+#else
+    (void)last;
+    if (!s_ph_cnt) return;
+#endif
+    uint64_t high = ((uint64_t)t2->CCR2 * div2 + t15_ticks - 1u) / t15_ticks; // k*T15 < CCR2*(PSC+1)
+    s_ph_geo.t15 = t15_ticks;
+    s_ph_geo.div15 = div15; s_ph_geo.div2 = div2;
+    s_ph_geo.guard = (uint32_t)((conv < t15_ticks) ? conv : t15_ticks) + ADC_PHASE_DMA_TICKS;
+    s_ph_high = (uint16_t)((high < p) ? high : p);
+    s_ph_period = (uint16_t)p;
+}
+
+// Обновить формат отсчётов по регистрам TIM15 и ADC1
+static void adc_acq_refresh_fmt(void) {
+    TIM_TypeDef *t = htim15.Instance;
+    uint64_t ticks = (uint64_t)((t->PSC & 0xFFFFu) + 1u) * ((t->ARR & 0xFFFFu) + 1u);
+    g_fs_eff_hz = (uint32_t)(((uint64_t)adc_acq_tim_clk(HAL_RCC_GetPCLK2Freq()) + ticks / 2u) / ticks);
+    uint32_t sh = 0, r = s_adc1 ? adc_acq_get_ovs(s_adc1->Instance, &sh) : 1u;
+    g_sample_bits = adc_acq_bits(r, sh);
+    adc_phase_refresh();
+}
+
+// Перепрограммировать TIM15, время выборки и оверсэмплинг при остановленных DMA/АЦП; счётчик — с нуля
+static void adc_acq_program(uint32_t psc, uint32_t arr, uint32_t ccr1, uint32_t smp, uint32_t ovs_ratio, uint32_t ovs_shift) {
+    TIM_TypeDef *t = htim15.Instance;
+    t->PSC = psc; t->ARR = arr; t->CCR1 = ccr1;
+    t->CNT = 0;
+    t->EGR = TIM_EGR_UG; // загрузить PSC/ARR из preload сразу
+    t->SR = 0;
+    if (s_adc1) { adc_acq_set_smp(s_adc1->Instance, smp); adc_acq_set_ovs(s_adc1->Instance, ovs_ratio, ovs_shift); }
+    if (s_adc2) { adc_acq_set_smp(s_adc2->Instance, smp); adc_acq_set_ovs(s_adc2->Instance, ovs_ratio, ovs_shift); }
+    adc_acq_refresh_fmt();
+}
+
+static void adc_acq_restore_boot(void) {
+    if (!s_boot_saved) return;
+    TIM_TypeDef *t = htim15.Instance;
+    uint32_t run = t->CR1 & TIM_CR1_CEN;
+    t->CR1 &= ~TIM_CR1_CEN;
+    adc_stream_halt(); // apply_profile перезапустит DMA с новым N
+    adc_acq_program(s_boot_psc, s_boot_arr, s_boot_ccr1, s_boot_smp, s_boot_ovs_ratio, s_boot_ovs_shift);
+    t->CR1 |= run;
+}
+
+// Заполнить описание режима по делителям TIM15, коду SMP и оверсэмплингу
+static void adc_acq_fill(adc_acq_t *a, uint32_t psc, uint32_t arr, uint32_t smp,
+                         uint32_t ovs_ratio, uint32_t ovs_shift, uint16_t samples) {
+    uint32_t tclk = adc_acq_tim_clk(HAL_RCC_GetPCLK2Freq()); // TIM15 — APB2
+    uint32_t aclk = adc_acq_adc_clk();
+    uint64_t ticks = (uint64_t)(psc + 1u) * (arr + 1u);
+    a->tim_clk_hz = tclk;
+    a->tim_psc = (uint16_t)psc;
+    a->tim_arr = (uint16_t)arr;
+    a->fs_millihz = ((uint64_t)tclk * 1000u + ticks / 2u) / ticks;
+    a->adc_clk_hz = aclk;
+    a->smp_code = (uint8_t)smp;
+    uint64_t ns = aclk ? ((uint64_t)(s_smp_x2[smp & 7u] + ADC_ACQ_SAR_X2) * ovs_ratio * 500000000u) / aclk : 0u;
+    a->conv_ns = (ns > 0xFFFFu) ? 0xFFFFu : (uint16_t)ns;
+    a->samples = samples;
+    a->ovs_ratio = (uint16_t)ovs_ratio;
+    a->ovs_shift = (uint8_t)ovs_shift;
+    a->bits = adc_acq_bits(ovs_ratio, ovs_shift);
+    // Меандр TIM2 (APB1) сбрасывает TIM15 по TRGO: отсчёты равномерны, только если период кратен
+    uint32_t t2clk = adc_acq_tim_clk(HAL_RCC_GetPCLK1Freq());
+    uint64_t t2 = (uint64_t)(htim2.Instance->PSC + 1u) * (htim2.Instance->ARR + 1u);
+    a->aligned = (t2clk && ((t2 * tclk) % ((uint64_t)t2clk * ticks)) == 0u) ? 1u : 0u;
+}
+
+int adc_stream_plan_acq(uint32_t fs_hz, uint16_t samples, uint16_t ovs_ratio, uint8_t ovs_shift, adc_acq_t *out) {
+    if (!out) return -1;
+    if (fs_hz == 0u || samples < ADC_ACQ_SAMPLES_MIN || samples > MAX_FRAME_SAMPLES) return -1;
+    if (ovs_ratio == 0u) ovs_ratio = 1u;
+    if (ovs_ratio > ADC_OVS_RATIO_MAX || ovs_shift > ADC_OVS_SHIFT_MAX || (ovs_ratio == 1u && ovs_shift)) return -6;
+    if (adc_acq_bits(ovs_ratio, ovs_shift) > 16u) return -6; // сумма не помещается в слово DMA
+    uint64_t frame_mhz = ((uint64_t)fs_hz * 1000u) / samples;
+    if (frame_mhz < ADC_ACQ_FRAME_HZ_MIN * 1000u || frame_mhz > ADC_ACQ_FRAME_HZ_MAX * 1000u) return -4;
+    uint32_t tclk = adc_acq_tim_clk(HAL_RCC_GetPCLK2Freq());
+    uint64_t ticks = ((uint64_t)tclk + fs_hz / 2u) / fs_hz; // тактов таймера на отсчёт
+    if (ticks < 2u || ticks > 65536ull * 65536ull) return -2;
+    // Разложение ticks на (PSC+1)(ARR+1): наименьший PSC с минимальной ошибкой частоты
+    uint32_t p0 = (uint32_t)((ticks + 65535u) / 65536u);
+    uint32_t best_p = 0, best_a = 0;
+    uint64_t best_err = UINT64_MAX;
+    uint64_t want = (uint64_t)fs_hz * 1000u;
+    for (uint32_t p = p0; p <= 65536u && p < p0 + 256u; p++) {
+        uint64_t a = ((uint64_t)tclk + (uint64_t)p * fs_hz / 2u) / ((uint64_t)p * fs_hz);
+        if (a < 2u) a = 2u;
+        if (a > 65536u) a = 65536u;
+        uint64_t got = ((uint64_t)tclk * 1000u) / ((uint64_t)p * a);
+        uint64_t err = (got > want) ? (got - want) : (want - got);
+        if (err < best_err) { best_err = err; best_p = p; best_a = (uint32_t)a; }
+        if (err == 0u) break;
+    }
+    if (best_p == 0u) return -2;
+    // Время выборки: текущее, если ovs_ratio преобразований укладываются в период триггера, иначе короче
+    adc_acq_save_boot();
+    uint32_t aclk = adc_acq_adc_clk();
+    uint64_t period_x2 = ((uint64_t)aclk * 2u * best_p * best_a) / tclk; // период в полутактах АЦП
+    uint32_t smp = s_boot_saved ? s_boot_smp : 0u;
+    for (;;) {
+        if ((uint64_t)(s_smp_x2[smp] + ADC_ACQ_SAR_X2) * ovs_ratio * 100u <= period_x2 * ADC_ACQ_CONV_DUTY_PCT) break;
+        if (smp == 0u) return -3;
+        smp--;
+    }
+    adc_acq_fill(out, best_p - 1u, best_a - 1u, smp, ovs_ratio, ovs_shift, samples);
+    out->fs_req_hz = fs_hz;
+    return 0;
+}
+
+int adc_stream_set_acq(uint32_t fs_hz, uint16_t samples, uint16_t ovs_ratio, uint8_t ovs_shift, adc_acq_t *out) {
+    adc_acq_t a;
+    int rc = adc_stream_plan_acq(fs_hz, samples, ovs_ratio, ovs_shift, &a);
+    if (rc != 0) return rc;
+    if (!s_adc1 || !s_adc2) return -5;
+    TIM_TypeDef *t = htim15.Instance;
+    uint32_t run = t->CR1 & TIM_CR1_CEN;
+    t->CR1 &= ~TIM_CR1_CEN; // триггеров нет, пока АЦП и DMA перенастраиваются
+    adc_stream_halt();
+    adc_acq_program(a.tim_psc, a.tim_arr, ((uint32_t)a.tim_arr + 1u) / 2u, a.smp_code, a.ovs_ratio, a.ovs_shift);
+    g_custom_profile.samples_per_buf = samples;
+    g_custom_profile.fs_hz = (uint32_t)((a.fs_millihz + 500u) / 1000u);
+    uint32_t fb = (g_custom_profile.fs_hz + samples / 2u) / samples;
+    g_custom_profile.buf_rate_hz = (uint16_t)(fb ? fb : 1u);
+    g_custom_fs_req = fs_hz;
+    g_active_profile = ADC_PROFILE_CUSTOM;
+    g_active_samples = samples;
+    HAL_StatusTypeDef st = adc_stream_apply_profile();
+    t->CR1 |= run;
+    ADC_LOGF("[ADC][SET_ACQ] fs=%lu psc=%u arr=%u smp=%u ovs=%u>>%u N=%u rc=%d\r\n", (unsigned long)fs_hz,
+             (unsigned)a.tim_psc, (unsigned)a.tim_arr, (unsigned)a.smp_code, (unsigned)a.ovs_ratio,
+             (unsigned)a.ovs_shift, (unsigned)samples, (int)st);
+    if (out) *out = a;
+    return (st == HAL_OK) ? 0 : -5;
+}
+
+void adc_stream_get_acq(adc_acq_t *out) {
+    if (!out) return;
+    TIM_TypeDef *t = htim15.Instance;
+    uint32_t smp = s_adc1 ? adc_acq_get_smp(s_adc1->Instance) : 0u;
+    uint32_t sh = 0, r = s_adc1 ? adc_acq_get_ovs(s_adc1->Instance, &sh) : 1u;
+    adc_acq_fill(out, t->PSC & 0xFFFFu, t->ARR & 0xFFFFu, smp, r, sh, g_active_samples);
+    out->fs_req_hz = (g_active_profile == ADC_PROFILE_CUSTOM) ? g_custom_fs_req : adc_active_prof()->fs_hz;
+}
+
 void adc_stream_init(void) {
-    frame_wr_seq = frame_rd_seq = 0;
-    frame_overflow_drops = 0;
-    frame_backlog_max = 0;
+    adc_ring_reset();
 }
 
 HAL_StatusTypeDef adc_stream_start(ADC_HandleTypeDef* a1, ADC_HandleTypeDef* a2) {
@@ -219,6 +700,10 @@ HAL_StatusTypeDef adc_stream_start(ADC_HandleTypeDef* a1, ADC_HandleTypeDef* a2)
     g_active_profile = ADC_PROFILE_B_DEFAULT;
     g_active_samples = g_profiles[g_active_profile].samples_per_buf;
     adc_stream_init();
+#if ADC_EDGE_CAPTURE
+    adc_edge_start();
+#endif
+    adc_acq_refresh_fmt();
     ADC_LOGF("[ADC][START] profile=%u samples=%u\r\n", (unsigned)g_active_profile, (unsigned)g_active_samples);
     HAL_StatusTypeDef rc = adc_stream_apply_profile();
     ADC_LOGF("[ADC][START] adc_stream_apply_profile rc=%d\r\n", (int)rc);
@@ -231,27 +716,179 @@ HAL_StatusTypeDef adc_stream_restart(ADC_HandleTypeDef* a1, ADC_HandleTypeDef* a
     return adc_stream_apply_profile();
 }
 
+uint16_t adc_stream_frame_samples(uint32_t seq, uint8_t *first) {
+    uint16_t info = s_slot_info[seq & (FIFO_FRAMES - 1u)];
+    if (first) *first = (info & ADC_SLOT_FIRST) ? 1u : 0u;
+    return (uint16_t)(info & ~ADC_SLOT_FIRST);
+}
+
 uint8_t adc_get_frame(uint16_t **ch1, uint16_t **ch2, uint16_t *samples) {
     if (!ch1 || !ch2 || !samples) {
         ADC_LOGF("[ADC][GET_FRAME] ERROR: ch1/ch2/samples NULL\r\n");
         return 0;
     }
-    __disable_irq();
-    if (frame_rd_seq == frame_wr_seq) {
-        __enable_irq();
+    uint32_t seq;
+    if (!adc_stream_acquire(&seq, NULL, 0u)) {
         ADC_LOGF("[ADC][GET_FRAME] Нет новых кадров: frame_wr_seq=%lu frame_rd_seq=%lu\r\n", (unsigned long)frame_wr_seq, (unsigned long)frame_rd_seq);
         return 0;
     }
-    uint32_t seq = frame_rd_seq++;
-    __enable_irq();
     uint32_t index = seq & (FIFO_FRAMES - 1u);
+    uint16_t n = adc_stream_frame_samples(seq, NULL);
+#if ADC_STREAM_DUAL_MODE
+    adc_stream_split(adc12_buffers[index], s_split_ch1, s_split_ch2, n);
+    *ch1 = s_split_ch1;
+    *ch2 = s_split_ch2;
+#else
     *ch1 = adc1_buffers[index];
     *ch2 = adc2_buffers[index];
-    *samples = g_active_samples;
-    ADC_LOGF("[ADC][GET_FRAME] OK: seq=%lu index=%lu samples=%u\r\n", (unsigned long)seq, (unsigned long)index, (unsigned)g_active_samples);
+#endif
+    *samples = n;
+    ADC_LOGF("[ADC][GET_FRAME] OK: seq=%lu index=%lu samples=%u\r\n", (unsigned long)seq, (unsigned long)index, (unsigned)n);
     return 1;
 }
 
+#if ADC_STREAM_DUAL_MODE
+uint8_t adc_get_frame_packed(const uint32_t **ab, uint16_t *samples) {
+    if (!ab || !samples) return 0;
+    uint32_t seq;
+    if (!adc_stream_acquire(&seq, NULL, 0u)) return 0;
+    *ab = adc12_buffers[seq & (FIFO_FRAMES - 1u)];
+    *samples = adc_stream_frame_samples(seq, NULL);
+    return 1;
+}
+#endif
+
+void adc_stream_split(const uint32_t *ab, uint16_t *ch1, uint16_t *ch2, uint32_t n) {
+    uint32_t i = 0;
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    /* По два слова за шаг: PKHBT/PKHTB собирают пары отсчётов каждого канала в одно слово */
+    for (; i + 1u < n; i += 2u) {
+        uint32_t a = ab[i], b = ab[i + 1u];
+        uint32_t c1 = __PKHBT(a, b, 16); /* ch1[i] | ch1[i+1]<<16 */
+        uint32_t c2 = __PKHTB(b, a, 16); /* ch2[i] | ch2[i+1]<<16 */
+        memcpy(&ch1[i], &c1, 4u);
+        memcpy(&ch2[i], &c2, 4u);
+    }
+#endif
+    for (; i < n; i++) {
+        ch1[i] = (uint16_t)ab[i];
+        ch2[i] = (uint16_t)(ab[i] >> 16);
+    }
+}
+
+uint64_t adc_stream_frame_time_us(uint32_t seq) {
+    return timebase_cyc_to_us(s_frame_cyc[seq & (FIFO_FRAMES - 1u)]);
+}
+
+uint16_t adc_stream_frame_phase(uint32_t seq) {
+    return s_slot_phase[seq & (FIFO_FRAMES - 1u)];
+}
+
+void adc_stream_get_phase(adc_phase_info_t *out) {
+    if (!out) return;
+    out->period = s_ph_period;
+    out->high = s_ph_high;
+    out->locked = (s_ph_period && s_ph_next != ADC_PHASE_NONE) ? 1u : 0u;
+    out->meas = s_ph_meas;
+    out->fix = s_ph_fix;
+    out->dirty = s_ph_dirty;
+    out->src = (uint8_t)(s_ph_cnt ? ADC_PHASE_SRC_COUNTERS : 0u);
+#if ADC_EDGE_CAPTURE
+    out->src |= (uint8_t)((s_edge_run ? ADC_PHASE_SRC_CAPTURE_ON : 0u) | (s_edge_ok ? ADC_PHASE_SRC_CAPTURE : 0u));
+    out->edge_meas = s_ph_edge;
+    out->edges = s_edge_count;
+    out->edge_amb = s_edge_amb;
+#else
+    out->edge_meas = out->edges = out->edge_amb = 0;
+#endif
+}
+
+#if ADC_EDGE_CAPTURE
+static uint32_t adc_edge_wr(void) {
+    return (ADC_EDGE_RING - ((DMA_Stream_TypeDef*)hdma_edge.Instance)->NDTR) & (ADC_EDGE_RING - 1u);
+}
+
+// Разобранное — по текущую позицию кольца (DMA АЦП перезапущен или перевзведён)
+static void adc_edge_sync(void) {
+    if (s_edge_run) s_edge_rd = adc_edge_wr();
+}
+
+// Запуск потока захвата (один раз, до adc_phase_refresh): DMA2_Stream7 по запросу TIM2_UP
+static void adc_edge_start(void) {
+    if (s_edge_run) return;
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    hdma_edge.Instance = DMA2_Stream7;
+    hdma_edge.Init.Request = DMA_REQUEST_TIM2_UP;
+    hdma_edge.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_edge.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_edge.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_edge.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD; // регистры DMA — только словами
+    hdma_edge.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma_edge.Init.Mode = DMA_CIRCULAR;
+    hdma_edge.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    hdma_edge.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_edge) != HAL_OK) return;
+    if (HAL_DMA_Start(&hdma_edge, (uint32_t)&((DMA_Stream_TypeDef*)hdma_adc1.Instance)->NDTR,
+                      (uint32_t)s_edge_ring, ADC_EDGE_RING) != HAL_OK) return;
+    __HAL_TIM_ENABLE_DMA(&htim2, TIM_DMA_UPDATE);
+    s_edge_run = 1;
+    s_edge_rd = adc_edge_wr();
+}
+
+// Номер отсчёта фронта в кадре этого TC (длина n) или -1: разбор записей с прошлого TC (adc_edge_pick)
+static ITCM_FUNC int32_t adc_edge_at_tc(uint32_t n) {
+    uint32_t w = adc_edge_wr();
+    uint32_t ndtr = ((DMA_Stream_TypeDef*)hdma_adc1.Instance)->NDTR; // после позиции кольца
+    uint32_t amb = 0;
+    s_edge_count += (w - s_edge_rd) & (ADC_EDGE_RING - 1u);
+    int32_t idx = adc_edge_pick(s_edge_ring, s_edge_rd, w, ndtr, n, &amb);
+    s_edge_amb += amb;
+    s_edge_rd = w;
+    return idx;
+}
+#endif
+
+// Фаза кадра seq из TC ADC1 (до смены N и переадресации банков), n — его длина.
+// Захваченный фронт даёт номер отсчёта k=0 в кадре (adc_edge_at_tc). Без него — по счётчикам TIM2/TIM15
+// (adc_phase_counters). Измерение годно, только если между чтениями CNT15 не было триггера и отсчёт
+// последнего триггера уже в NDTR; иначе фаза ведётся по N от предыдущего кадра (точно, пока отсчёты
+// не теряются).
+static ITCM_FUNC int32_t adc_phase_by_counters(uint32_t p, uint32_t n) {
+    TIM_TypeDef *t15 = htim15.Instance, *t2 = htim2.Instance;
+    uint32_t c15 = t15->CNT & 0xFFFFu;
+    uint32_t c2 = t2->CNT;
+    uint32_t ndtr = ((DMA_Stream_TypeDef*)hdma_adc1.Instance)->NDTR;
+    uint32_t c15b = t15->CNT & 0xFFFFu;
+    int32_t k = adc_phase_counters(&s_ph_geo, p, n, s_dma_samples, c15, c2, ndtr, c15b);
+    if (k >= 0) s_ph_meas++;
+    return k;
+}
+
+static ITCM_FUNC void adc_phase_at_tc(uint32_t seq, uint32_t n) {
+    uint32_t p = s_ph_period;
+    uint16_t k0 = ADC_PHASE_NONE;
+    int32_t k = -1;
+#if ADC_EDGE_CAPTURE
+    int32_t idx = s_edge_run ? adc_edge_at_tc(n) : -1; // кольцо разбираем и без фазы
+    if (p && s_edge_ok && idx >= 0) {
+        k = (int32_t)adc_phase_from_edge((uint32_t)idx, p);
+        s_ph_edge++;
+    }
+#endif
+    if (p) {
+        k0 = s_ph_next;
+        if (k < 0 && s_ph_cnt) k = adc_phase_by_counters(p, n);
+        if (k >= 0) {
+            if (k0 != ADC_PHASE_NONE && k0 != (uint16_t)k) s_ph_fix++;
+            k0 = (uint16_t)k;
+        } else {
+            s_ph_dirty++;
+        }
+        s_ph_next = (k0 == ADC_PHASE_NONE) ? ADC_PHASE_NONE : (uint16_t)((k0 + n) % p);
+    }
+    s_slot_phase[seq & (FIFO_FRAMES - 1u)] = k0;
+}
+
 void adc_stream_get_debug(adc_stream_debug_t *out) {
     if (!out) return;
     out->frame_wr_seq = frame_wr_seq;
@@ -261,7 +898,13 @@ void adc_stream_get_debug(adc_stream_debug_t *out) {
     out->dma_half0 = dma_half0; out->dma_full0 = dma_full0;
     out->dma_half1 = dma_half1; out->dma_full1 = dma_full1;
     out->active_samples = g_active_samples;
-    out->reserved = 0;
+    out->dma_samples = s_dma_samples;
+    out->frame_torn = frame_torn;
+    out->switches = s_sw_count;
+    out->switch_deferred = s_sw_deferred;
+    out->switch_slip = s_sw_slip;
+    out->switch_restarts = s_sw_restarts;
+    out->switch_pending = s_sw_pending;
 }
 
 // Weak hook (can be overridden in higher-level module, e.g. USB)
@@ -287,9 +930,17 @@ void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc) {
     }
 }
 
-void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
+ITCM_FUNC void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
+    CYC_PROF_BEGIN(prof_t0);
     if (hadc->Instance == (s_adc1 ? s_adc1->Instance : NULL)) {
+    /* Метка кадра — первым делом, чтобы остальной код ISR в неё не входил */
+    uint64_t t_cyc = timebase_cyc64();
+    boot_mark(BOOT_MARK_ADC_FRAME);
     dma_full0++; dbg_dma1_full_count++;
+#if ADC_STREAM_DUAL_MODE
+    /* ADC2 пришёл тем же потоком: счётчики второго канала ведём вместе с первым */
+    dma_full1++;
+#endif
 #if DIAG_DMA_CALLBACK_LIMIT
     if(dbg_dma1_full_count > DIAG_DMA_CALLBACK_LIMIT){
         HAL_ADC_Stop_DMA(s_adc1);
@@ -299,27 +950,41 @@ void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
         return;
     }
 #endif
+        /* Один полный буфер (N выборок) готов: кадр seq лежит в слоте seq & (FIFO_FRAMES-1) */
+        uint32_t seq = frame_wr_seq;
+        s_frame_cyc[seq & (FIFO_FRAMES - 1u)] = t_cyc;
+        s_slot_info[seq & (FIFO_FRAMES - 1u)] = (uint16_t)(s_dma_samples | (s_sw_mark ? ADC_SLOT_FIRST : 0u));
+        s_sw_mark = 0;
+        adc_phase_at_tc(seq, s_dma_samples);
+        adc_ring_ready(seq);
         adc_last_full0_ms = HAL_GetTick();
-        /* Один полный буфер (N выборок) готов */
-        uint32_t frames_added = 1u;
-    frame_wr_seq += frames_added;
-    ADC_LOGF("[ADC][DMA] ConvCplt: frame_wr_seq=%lu frame_rd_seq=%lu\r\n", (unsigned long)frame_wr_seq, (unsigned long)frame_rd_seq);
-        uint32_t backlog = frame_wr_seq - frame_rd_seq;
-        if (backlog > frame_backlog_max) frame_backlog_max = backlog;
-        if (backlog > FIFO_FRAMES) {
-            uint32_t excess = backlog - FIFO_FRAMES;
-            frame_overflow_drops += excess;
-            frame_rd_seq += excess;
-        }
-        adc_stream_on_new_frames(frames_added);
+#if ADC_STREAM_DUAL_MODE
+        adc_last_full1_ms = adc_last_full0_ms;
+#endif
 
         /* Продвинем адрес свободного банка DMA на следующий слот кольца — для ADC1 и ADC2.
-           В DBM разрешено писать в неактивный банк: определяем по биту CT (CR[19]). */
-        do {
+           В DBM разрешено писать в неактивный банк: определяем по биту CT (CR[19]).
+           Слот помечается отданным DMA (кадр seq+2) до смены адреса — потребитель, читающий
+           прежний кадр этого слота, увидит смену поколения в adc_stream_validate().
+           При смене профиля поток перевзведён целиком — оба банка уже назначены. */
+#if ADC_EDGE_CAPTURE
+        if (adc_switch_at_tc(seq)) adc_edge_sync(); /* фронты до перевзвода потока — к старому N */
+        else do {
+#else
+        if (!adc_switch_at_tc(seq)) do {
+#endif
             uint32_t idx = s_next_ring_index; // выбрать следующий буфер
             if (idx >= FIFO_FRAMES) idx &= (FIFO_FRAMES-1u);
+            adc_ring_to_dma(idx, seq + 2u);
             DMA_Stream_TypeDef *st1 = (DMA_Stream_TypeDef*)hdma_adc1.Instance;
             uint32_t cr1 = st1->CR;
+            #if ADC_STREAM_DUAL_MODE
+            if (cr1 & (1u<<19)) {
+                st1->M0AR = (uint32_t)adc12_buffers[idx];
+            } else {
+                st1->M1AR = (uint32_t)adc12_buffers[idx];
+            }
+            #else
             if (cr1 & (1u<<19)) {
                 /* CT=1 => сейчас активен M1, значит завершился M0 -> переадресуем M0 на следующий */
                 st1->M0AR = (uint32_t)adc1_buffers[idx];
@@ -336,8 +1001,17 @@ void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
                 st2->M1AR = (uint32_t)adc2_buffers[idx];
             }
             #endif
+            #endif /* ADC_STREAM_DUAL_MODE */
             s_next_ring_index = (idx + 1u) & (FIFO_FRAMES - 1u);
         } while(0);
+
+        /* Публикация: frame_wr_seq пишет только ISR, frame_rd_seq — только потребитель.
+           Переполнение кольца разбирает потребитель в adc_stream_acquire(). */
+        uint32_t backlog = adc_ring_publish(seq);
+        ADC_LOGF("[ADC][DMA] ConvCplt: frame_wr_seq=%lu frame_rd_seq=%lu\r\n", (unsigned long)frame_wr_seq, (unsigned long)frame_rd_seq);
+        PIPE_EVT(PT_EV_ADC_TC, seq, backlog);
+        adc_stream_on_new_frames(1u);
+        CYC_PROF_END(CYC_PROF_ADC_CPLT, prof_t0);
     } else if (hadc->Instance == (s_adc2 ? s_adc2->Instance : NULL)) {
         dma_full1++;
         adc_last_full1_ms = HAL_GetTick();
@@ -0,0 +1,34 @@
+/* Время загрузки от сброса до первого кадра (см. boot_time.h) */
+#include "main.h"
+#include "boot_time.h"
+#include "timebase.h"
+
+static uint64_t bt_cyc[BOOT_MARK_COUNT];         /* циклы от сброса */
+static volatile uint8_t bt_set[BOOT_MARK_COUNT]; /* метка записана */
+static uint64_t bt_clk_cyc;                      /* циклы в момент переключения на PLL */
+static uint32_t bt_clk_hz;                       /* SystemCoreClock после переключения */
+
+void boot_time_clock_switched(void)
+{
+    bt_clk_cyc = timebase_cyc64();
+    bt_clk_hz = SystemCoreClock;
+    boot_mark(BOOT_MARK_CLOCK);
+}
+
+ITCM_FUNC void boot_mark(boot_mark_t id)
+{
+    if((unsigned)id >= BOOT_MARK_COUNT || bt_set[id]) return;
+    bt_cyc[id] = timebase_cyc64();
+    bt_set[id] = 1u;
+}
+
+uint32_t boot_mark_us(boot_mark_t id)
+{
+    if((unsigned)id >= BOOT_MARK_COUNT || !bt_set[id]) return 0xFFFFFFFFu;
+    uint64_t c = bt_cyc[id];
+    uint32_t hsi_per_us = HSI_VALUE / 1000000u;
+    if(!bt_clk_hz || c < bt_clk_cyc) return (uint32_t)(c / hsi_per_us);
+    uint32_t pll_per_us = bt_clk_hz / 1000000u;
+    if(pll_per_us == 0u) pll_per_us = 1u;
+    return (uint32_t)(bt_clk_cyc / hsi_per_us + (c - bt_clk_cyc) / pll_per_us);
+}
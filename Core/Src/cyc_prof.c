@@ -0,0 +1,51 @@
+/* Профилировщик горячего пути по DWT CYCCNT (см. cyc_prof.h) */
+#include <string.h>
+#include "main.h"
+#include "cyc_prof.h"
+
+static cyc_prof_stats_t cp_st[CYC_PROF_COUNT];
+static uint32_t cp_reset_ms;
+
+static const char *const cp_names[CYC_PROF_COUNT] = {
+    "ADC_CPLT", "PREP", "STEREO", "VND_TX", "TXCPLT", "OTG_IRQ",
+};
+
+ITCM_FUNC void cyc_prof_add(cyc_prof_id_t id, uint32_t cyc)
+{
+    if((uint32_t)id >= CYC_PROF_COUNT) return;
+    uint32_t bin = 31u - __CLZ(cyc | 1u);
+    if(bin >= CYC_PROF_BINS) bin = CYC_PROF_BINS - 1u;
+    cyc_prof_stats_t *s = &cp_st[id];
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    if(!s->count || cyc < s->min) s->min = cyc;
+    if(cyc > s->max) s->max = cyc;
+    s->count++;
+    s->sum += cyc;
+    s->hist[bin]++;
+    __set_PRIMASK(pm);
+}
+
+uint32_t cyc_prof_get(cyc_prof_id_t id, cyc_prof_stats_t *out)
+{
+    if((uint32_t)id >= CYC_PROF_COUNT || !out) return 0;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    *out = cp_st[id];
+    __set_PRIMASK(pm);
+    return HAL_GetTick() - cp_reset_ms;
+}
+
+void cyc_prof_reset(void)
+{
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    memset(cp_st, 0, sizeof(cp_st));
+    cp_reset_ms = HAL_GetTick();
+    __set_PRIMASK(pm);
+}
+
+const char *cyc_prof_name(cyc_prof_id_t id)
+{
+    return ((uint32_t)id < CYC_PROF_COUNT) ? cp_names[id] : "?";
+}
@@ -0,0 +1,186 @@
+/* Аппаратный CRC16 кадров vendor: блок CRC + подача payload каналом MDMA (см. frame_crc.h) */
+#include <string.h>
+#include "main.h"
+#include "frame_crc.h"
+
+extern CRC_HandleTypeDef hcrc;
+extern MDMA_HandleTypeDef hmdma_crc;
+
+#define FRAME_CRC_HDR_BYTES 30u   /* заголовок без поля crc16 */
+#define FRAME_CRC_HDR_SIZE  32u
+#define FRAME_CRC_QUEUE     32u   /* степень двойки: 2 пачки burst по 16 кадров или очередь TX */
+
+typedef struct {
+    uint8_t *frame;
+    uint32_t len;
+    volatile uint8_t *pending;
+} frame_crc_job_t;
+
+static frame_crc_job_t fc_q[FRAME_CRC_QUEUE];
+static volatile uint8_t fc_head = 0;  /* постановка (основной цикл) */
+static volatile uint8_t fc_tail = 0;  /* текущий/следующий кадр (движок) */
+/* 1 — блок CRC занят: кадр в MDMA или синхронный подсчёт. Захват только под PRIMASK. */
+static volatile uint8_t fc_busy = 0;
+static uint8_t fc_ready = 0;
+static const uint8_t *fc_rest;        /* хвост текущего кадра после выровненной середины */
+static uint32_t fc_rest_len;
+static volatile frame_crc_stats_t fc_st;
+
+static uint16_t crc16_sw(const uint8_t *p, size_t len)
+{
+    uint16_t crc = 0xFFFFu;
+    for(size_t i = 0; i < len; i++){
+        crc ^= (uint16_t)p[i] << 8;
+        for(int b = 0; b < 8; b++) crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+/* Побайтовая запись в DR: порядок байт кадра сохраняется (CRC без рефлексии) */
+static inline void fc_feed(const uint8_t *p, uint32_t n)
+{
+    volatile uint8_t *dr = (volatile uint8_t *)&hcrc.Instance->DR;
+    while(n--) *dr = *p++;
+}
+
+static inline int fc_claim(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    int ok = !fc_busy;
+    if(ok) fc_busy = 1;
+    if(!primask) __enable_irq();
+    return ok;
+}
+
+/* Закрыть кадр в хвосте очереди: дописать хвост, сохранить crc16, освободить слот */
+static void fc_finish(void)
+{
+    frame_crc_job_t *j = &fc_q[fc_tail & (FRAME_CRC_QUEUE - 1u)];
+    fc_feed(fc_rest, fc_rest_len);
+    uint16_t crc = (uint16_t)hcrc.Instance->DR;
+    j->frame[30] = (uint8_t)crc; j->frame[31] = (uint8_t)(crc >> 8);
+    __DMB();
+    (*j->pending)--;
+    fc_tail = (uint8_t)(fc_tail + 1u);
+    fc_st.frames++;
+}
+
+/* Обработать очередь (fc_busy уже захвачен). Выход с fc_busy=1, если кадр ушёл в MDMA. */
+static void fc_run(void)
+{
+    while(fc_tail != fc_head){
+        frame_crc_job_t *j = &fc_q[fc_tail & (FRAME_CRC_QUEUE - 1u)];
+        __HAL_CRC_DR_RESET(&hcrc);
+        fc_feed(j->frame, FRAME_CRC_HDR_BYTES);
+        const uint8_t *pl = j->frame + FRAME_CRC_HDR_SIZE;
+        uint32_t n = j->len - FRAME_CRC_HDR_SIZE;
+        /* MDMA читает словами: голову до выравнивания на 4 пишет CPU */
+        uint32_t head = (uint32_t)(-(uintptr_t)pl) & 3u;
+        if(head > n) head = n;
+        fc_feed(pl, head); pl += head; n -= head;
+        uint32_t mid = n & ~3u;
+        fc_rest = pl + mid; fc_rest_len = n - mid;
+        if(mid){
+            /* MDMA читает память мимо кэша: кадры в DTCM или в write-through .usb_dma (MPU_Config),
+               payload уже в RAM — достаточно дождаться буфера записи */
+            __DSB();
+            if(HAL_MDMA_Start_IT(&hmdma_crc, (uint32_t)pl, (uint32_t)&hcrc.Instance->DR, mid, 1) == HAL_OK) return;
+            fc_st.mdma_err++;
+            fc_feed(pl, mid);
+        }
+        fc_finish();
+    }
+    fc_busy = 0;
+}
+
+void __attribute__((weak)) frame_crc_on_done(void) { }
+
+static void fc_mdma_cplt(MDMA_HandleTypeDef *h)
+{
+    (void)h;
+    fc_finish();
+    fc_run();
+    frame_crc_on_done();
+}
+
+static void fc_mdma_error(MDMA_HandleTypeDef *h)
+{
+    (void)h;
+    /* Состояние блока неизвестно: кадр в хвосте пересчитываем целиком силами CPU */
+    frame_crc_job_t *j = &fc_q[fc_tail & (FRAME_CRC_QUEUE - 1u)];
+    fc_st.mdma_err++;
+    __HAL_CRC_DR_RESET(&hcrc);
+    fc_feed(j->frame, FRAME_CRC_HDR_BYTES);
+    fc_rest = j->frame + FRAME_CRC_HDR_SIZE; fc_rest_len = j->len - FRAME_CRC_HDR_SIZE;
+    fc_finish();
+    fc_run();
+    frame_crc_on_done();
+}
+
+void frame_crc_init(void)
+{
+    HAL_MDMA_RegisterCallback(&hmdma_crc, HAL_MDMA_XFER_CPLT_CB_ID, fc_mdma_cplt);
+    HAL_MDMA_RegisterCallback(&hmdma_crc, HAL_MDMA_XFER_ERROR_CB_ID, fc_mdma_error);
+    fc_head = fc_tail = 0; fc_busy = 0;
+    fc_ready = 1;
+}
+
+int frame_crc_submit(uint8_t *frame, uint32_t len, volatile uint8_t *pending)
+{
+    if(!fc_ready || len < FRAME_CRC_HDR_SIZE) return 0;
+    /* Очередь делят основной цикл и колбэк MDMA: на время постановки колбэк запрещён */
+    HAL_NVIC_DisableIRQ(MDMA_IRQn);
+    uint8_t depth = (uint8_t)(fc_head - fc_tail);
+    if(depth >= FRAME_CRC_QUEUE){
+        HAL_NVIC_EnableIRQ(MDMA_IRQn);
+        fc_st.skipped++;
+        return 0;
+    }
+    frame_crc_job_t *j = &fc_q[fc_head & (FRAME_CRC_QUEUE - 1u)];
+    j->frame = frame; j->len = len; j->pending = pending;
+    (*pending)++;
+    __DMB();
+    fc_head = (uint8_t)(fc_head + 1u);
+    if((uint8_t)(depth + 1u) > fc_st.queue_hwm) fc_st.queue_hwm = (uint8_t)(depth + 1u);
+    if(fc_claim()) fc_run();
+    HAL_NVIC_EnableIRQ(MDMA_IRQn);
+    return 1;
+}
+
+void frame_crc_flush(void)
+{
+    if(!fc_ready) return;
+    HAL_NVIC_DisableIRQ(MDMA_IRQn);
+    if(HAL_MDMA_GetState(&hmdma_crc) == HAL_MDMA_STATE_BUSY) (void)HAL_MDMA_Abort(&hmdma_crc);
+    fc_tail = fc_head;
+    fc_busy = 0;
+    HAL_NVIC_ClearPendingIRQ(MDMA_IRQn);
+    HAL_NVIC_EnableIRQ(MDMA_IRQn);
+}
+
+uint16_t frame_crc16(const uint8_t *data, size_t len)
+{
+    if(!fc_ready || fc_tail != fc_head || !fc_claim()){
+        fc_st.sw_fallback++;
+        return crc16_sw(data, len);
+    }
+    __HAL_CRC_DR_RESET(&hcrc);
+    fc_feed(data, (uint32_t)len);
+    uint16_t crc = (uint16_t)hcrc.Instance->DR;
+    /* Кадры, поставленные за время подсчёта (постановка видела fc_busy=1), запускаем сами */
+    fc_run();
+    return crc;
+}
+
+void frame_crc_get_stats(frame_crc_stats_t *out)
+{
+    if(!out) return;
+    out->frames = fc_st.frames; out->skipped = fc_st.skipped; out->mdma_err = fc_st.mdma_err;
+    out->sw_fallback = fc_st.sw_fallback; out->queue_hwm = fc_st.queue_hwm;
+}
+
+void frame_crc_reset_stats(void)
+{
+    memset((void *)&fc_st, 0, sizeof(fc_st));
+}
@@ -0,0 +1,118 @@
+/* Сжатие payload кадров vendor: разности первого порядка + код Райса по блокам (см. frame_rice.h) */
+#include <string.h>
+#include "main.h"
+#include "frame_rice.h"
+
+/* Битовый писатель: старший бит первым, между вызовами в acc остаётся < 8 бит */
+typedef struct {
+    uint8_t *p;
+    uint64_t acc;
+    uint32_t bits;
+} fr_bw_t;
+
+static volatile frame_rice_stats_t fr_st;
+
+/* v < 2^n, n <= 32 */
+static inline void fr_put(fr_bw_t *w, uint32_t v, uint32_t n)
+{
+    w->acc = (w->acc << n) | v;
+    w->bits += n;
+    while(w->bits >= 8u){ w->bits -= 8u; *w->p++ = (uint8_t)(w->acc >> w->bits); }
+}
+
+static inline void fr_rice(fr_bw_t *w, uint32_t u, uint32_t k)
+{
+    uint32_t q = u >> k, lo = u & ((1u << k) - 1u);
+    /* Частый случай: нули унарной части, единица и остаток — одной записью */
+    if(q + 1u + k <= 32u){ fr_put(w, (1u << k) | lo, q + 1u + k); return; }
+    while(q >= 32u){ fr_put(w, 0u, 32u); q -= 32u; }
+    fr_put(w, 1u, q + 1u);
+    if(k) fr_put(w, lo, k);
+}
+
+static inline uint32_t fr_log2(uint32_t v){ return v ? 31u - (uint32_t)__builtin_clz(v) : 0u; }
+
+/* Одна плоскость. used — занято бит потока, limit — ёмкость в битах. 0 — поток не влез. */
+static int fr_plane(fr_bw_t *w, const uint16_t *x, uint32_t n, uint32_t *used, uint32_t limit,
+                    uint32_t *blocks, uint32_t *raw_blocks)
+{
+    uint32_t u[FRAME_RICE_BLOCK];
+    uint16_t prev = x[0];
+    if(*used + 16u > limit) return 0;
+    fr_put(w, prev, 16u); *used += 16u;
+    for(uint32_t i = 1; i < n; ){
+        uint32_t m = n - i;
+        if(m > FRAME_RICE_BLOCK) m = FRAME_RICE_BLOCK;
+        uint32_t sum = 0;
+        for(uint32_t j = 0; j < m; j++){
+            uint16_t cur = x[i + j];
+            int16_t d = (int16_t)(uint16_t)(cur - prev);
+            prev = cur;
+            u[j] = (uint16_t)(((uint16_t)d << 1) ^ (uint16_t)(d >> 15)); /* zigzag: 0,-1,1,-2… -> 0,1,2,3… */
+            sum += u[j];
+        }
+        i += m;
+        /* Оценка по сумме: стоимость m*(k+1) + sum>>k минимальна около k = log2(среднего) - 0.5 */
+        uint32_t k = fr_log2(sum / m);
+        if(k && (sum >> (k - 1u)) <= (sum >> k) + m) k--; /* k-1 не дороже по той же оценке */
+        uint32_t cost = 4u + 16u * m, p = FRAME_RICE_ESC;
+        if(k <= FRAME_RICE_KMAX){
+            uint32_t bits = 4u + m * (k + 1u);
+            for(uint32_t j = 0; j < m; j++) bits += u[j] >> k;
+            if(bits < cost){ cost = bits; p = k; }
+        }
+        if(*used + cost > limit) return 0;
+        *used += cost;
+        (*blocks)++;
+        fr_put(w, p, 4u);
+        if(p == FRAME_RICE_ESC){
+            (*raw_blocks)++;
+            for(uint32_t j = 0; j < m; j++) fr_put(w, u[j], 16u);
+        } else {
+            for(uint32_t j = 0; j < m; j++) fr_rice(w, u[j], p);
+        }
+    }
+    return 1;
+}
+
+uint32_t frame_rice_encode(const uint16_t *const planes[], uint32_t nplanes, uint32_t n,
+                           uint8_t *out, uint32_t cap)
+{
+    if(!n || !nplanes || !out) return 0;
+    uint32_t t0 = DWT->CYCCNT;
+    fr_bw_t w = { out, 0u, 0u };
+    uint32_t used = 0, blocks = 0, raw_blocks = 0, len = 0;
+    /* Выигрыш нужен хотя бы на одно слово: ограничиваем поток cap-4 байтами */
+    uint32_t limit = (cap > 4u) ? (cap - 4u) * 8u : 0u;
+    int ok = 1;
+    for(uint32_t c = 0; ok && c < nplanes; c++) ok = fr_plane(&w, planes[c], n, &used, limit, &blocks, &raw_blocks);
+    if(ok){
+        len = ((used + 31u) / 32u) * 4u;
+        uint32_t pad = len * 8u - used;
+        while(pad){ uint32_t b = (pad > 32u) ? 32u : pad; fr_put(&w, 0u, b); pad -= b; }
+    }
+    uint32_t cyc = DWT->CYCCNT - t0;
+    uint32_t raw = nplanes * n * 2u;
+    if(ok){ fr_st.frames++; fr_st.bytes_out += len; }
+    else  { fr_st.raw_frames++; fr_st.bytes_out += raw; }
+    fr_st.blocks += blocks; fr_st.raw_blocks += raw_blocks;
+    fr_st.bytes_in += raw;
+    fr_st.samples += (uint64_t)nplanes * n;
+    fr_st.cyc_sum += cyc;
+    if(cyc > fr_st.cyc_max) fr_st.cyc_max = cyc;
+    return len;
+}
+
+void frame_rice_get_stats(frame_rice_stats_t *out)
+{
+    if(!out) return;
+    out->frames = fr_st.frames; out->raw_frames = fr_st.raw_frames;
+    out->blocks = fr_st.blocks; out->raw_blocks = fr_st.raw_blocks;
+    out->bytes_in = fr_st.bytes_in; out->bytes_out = fr_st.bytes_out;
+    out->samples = fr_st.samples; out->cyc_sum = fr_st.cyc_sum; out->cyc_max = fr_st.cyc_max;
+}
+
+void frame_rice_reset_stats(void)
+{
+    memset((void *)&fr_st, 0, sizeof(fr_st));
+}
@@ -0,0 +1,42 @@
+/* Зоны ROI кадра vendor: разрешение в отсчёты и сборка отсчётов зон (см. frame_zone.h) */
+#include <string.h>
+#include "main.h"
+#include "frame_zone.h"
+
+void frame_zone_resolve(frame_zone_map_t *zr, const frame_zone_cfg_t *cfg, uint32_t cfg_cnt, uint8_t us,
+                        uint32_t fs, uint16_t n, uint32_t bps)
+{
+    zr->n = n; zr->fs = fs; zr->cnt = 0; zr->samples = 0;
+    uint32_t end = 0, m = 0, k = 0;
+    for(uint32_t z = 0; z < cfg_cnt && k < FRAME_ZONES_MAX; z++){
+        /* В 64 битах: u32 мкс * Fs и start + len не переполняются */
+        uint64_t st = cfg[z].start, e = st + cfg[z].len;
+        if(us){
+            e = (e * fs + 999999u) / 1000000u;
+            st = (st * fs) / 1000000u;
+        }
+        if(st < end) st = end; /* стык после округления мкс */
+        if(st >= n) break;
+        if(e > n) e = n;
+        if(e <= st) continue;
+        k++;
+        zr->tab[k][0] = (uint16_t)st; zr->tab[k][1] = (uint16_t)(e - st);
+        m += (uint32_t)(e - st); end = (uint32_t)e;
+    }
+    if(!k || FRAME_ZONE_TAB_BYTES(k) + m * bps >= (uint32_t)n * bps) return;
+    zr->tab[0][0] = n; zr->tab[0][1] = 0;
+    zr->cnt = (uint8_t)k; zr->samples = (uint16_t)m;
+}
+
+uint32_t frame_zone_gather(const frame_zone_map_t *zr, const uint16_t *ch1, const uint16_t *ch2,
+                           uint16_t *dst1, uint16_t *dst2)
+{
+    uint32_t o = 0;
+    for(uint32_t z = 1; z <= zr->cnt; z++){
+        uint32_t st = zr->tab[z][0], ln = zr->tab[z][1];
+        memcpy(&dst1[o], ch1 + st, ln * 2u);
+        memcpy(&dst2[o], ch2 + st, ln * 2u);
+        o += ln;
+    }
+    return o;
+}
@@ -0,0 +1,188 @@
+/* Синхронное детектирование по меандру TIM2: суммы I/Q за M периодов на канал (см. lockin.h) */
+#include <string.h>
+#include "main.h"
+#include "lockin.h"
+
+/* Опоры I и Q постоянны между точками излома H, Q0, Q0+H и P: период делится максимум на 4 отрезка,
+   на каждом отсчёты только суммируются, знак прикладывается к сумме отрезка. */
+#define LK_SEG_MAX 4u
+
+typedef struct {
+    uint16_t p, h, m;        /* период, высокий уровень, периодов на запись */
+    uint32_t fs;             /* Гц, для метки последнего отсчёта записи */
+    uint8_t  nseg;
+    uint16_t seg_end[LK_SEG_MAX];
+    int8_t   seg_i[LK_SEG_MAX], seg_q[LK_SEG_MAX];
+    uint8_t  synced;         /* запись идёт: k — фаза следующего отсчёта, next_seq — следующий кадр */
+    uint16_t k;
+    uint32_t next_seq;
+    uint16_t periods;        /* закрыто периодов в текущей записи */
+    uint32_t acc_n;          /* отсчётов в текущей записи */
+    int64_t  i[2], q[2];
+    uint64_t sum[2];
+    uint16_t flags;          /* флаги текущей записи */
+    uint32_t rec_seq;
+} lk_state_t;
+
+static lk_state_t lk;
+/* Очередь записей: пишет lockin_feed, читает lockin_pop — оба из таска vendor */
+static lockin_rec_t lk_fifo[LOCKIN_REC_FIFO];
+static uint32_t lk_head, lk_tail;
+static lockin_stats_t lk_st;
+
+_Static_assert((LOCKIN_REC_FIFO & (LOCKIN_REC_FIFO - 1u)) == 0u, "LOCKIN_REC_FIFO must be a power of two");
+
+static void lk_clear_acc(void)
+{
+    lk.periods = 0; lk.acc_n = 0;
+    lk.i[0] = lk.i[1] = 0; lk.q[0] = lk.q[1] = 0;
+    lk.sum[0] = lk.sum[1] = 0;
+}
+
+/* Разрыв: незаконченная запись теряется, следующая начнётся с границы периода */
+static void lk_break(void)
+{
+    if(lk.synced && (lk.acc_n || lk.periods)) lk_st.aborted++;
+    lk_clear_acc();
+    lk.synced = 0;
+    lk.flags = LOCKIN_REC_FLAG_GAP;
+}
+
+void lockin_reset(uint16_t period, uint16_t high, uint16_t periods, uint32_t fs_hz)
+{
+    memset(&lk, 0, sizeof(lk));
+    memset(&lk_st, 0, sizeof(lk_st));
+    lk_head = lk_tail = 0;
+    lk.flags = LOCKIN_REC_FLAG_GAP;
+    lk.m = periods ? periods : 1u;
+    lk.fs = fs_hz;
+    if(period < 4u || high == 0u || high >= period) return; /* опора вырождена — lk.p = 0 */
+    lk.p = period; lk.h = high;
+    uint32_t q0 = ((uint32_t)period + 2u) / 4u;
+    uint32_t cand[LK_SEG_MAX] = { high, q0, (q0 + high) % period, period };
+    /* Точки излома по возрастанию, без нулей и повторов */
+    for(uint32_t a = 0; a < LK_SEG_MAX; a++){
+        uint32_t best = 0xFFFFFFFFu;
+        uint32_t prev = lk.nseg ? lk.seg_end[lk.nseg - 1u] : 0u;
+        for(uint32_t b = 0; b < LK_SEG_MAX; b++) if(cand[b] > prev && cand[b] < best) best = cand[b];
+        if(best == 0xFFFFFFFFu) break;
+        lk.seg_end[lk.nseg++] = (uint16_t)best;
+    }
+    for(uint32_t s = 0; s < lk.nseg; s++){
+        uint32_t st = s ? lk.seg_end[s - 1u] : 0u;
+        lk.seg_i[s] = (st < high) ? 1 : -1;
+        lk.seg_q[s] = (((st + period - q0) % period) < high) ? 1 : -1;
+    }
+}
+
+/* Суммы отсчётов [j, j+len) по каналам; len <= P <= 65535, поэтому 32 бит хватает */
+static void lk_sums(const uint16_t *ch1, const uint16_t *ch2, const uint32_t *ab,
+                    uint32_t j, uint32_t len, uint32_t *s1, uint32_t *s2)
+{
+    uint32_t a = 0, b = 0;
+    if(ab){
+        const uint32_t *w = ab + j;
+        for(uint32_t i = 0; i < len; i++){ uint32_t v = w[i]; a += v & 0xFFFFu; b += v >> 16; }
+    } else {
+        const uint16_t *x = ch1 + j, *y = ch2 + j;
+        for(uint32_t i = 0; i < len; i++){ a += x[i]; b += y[i]; }
+    }
+    *s1 = a; *s2 = b;
+}
+
+static void lk_emit(uint64_t t_last_us)
+{
+    if((lk_tail - lk_head) >= LOCKIN_REC_FIFO){
+        lk_st.overflow++;
+    } else {
+        lockin_rec_t *r = &lk_fifo[lk_tail & (LOCKIN_REC_FIFO - 1u)];
+        r->seq = lk.rec_seq;
+        r->t_end_us = (uint32_t)t_last_us;
+        r->periods = lk.m;
+        r->period_samples = lk.p;
+        r->high_samples = lk.h;
+        r->flags = lk.flags;
+        for(uint32_t c = 0; c < 2u; c++){ r->i[c] = lk.i[c]; r->q[c] = lk.q[c]; r->sum[c] = lk.sum[c]; }
+        lk_tail++;
+    }
+    /* Номер расходуется и при переполнении: хост видит пропуск по seq */
+    lk.rec_seq++;
+    lk_st.records++;
+    lk_clear_acc();
+    lk.flags = 0;
+}
+
+uint32_t lockin_feed(uint32_t seq, const uint16_t *ch1, const uint16_t *ch2, const uint32_t *ab,
+                     uint32_t n, uint16_t k0, uint64_t t_us)
+{
+    uint32_t c0 = DWT->CYCCNT;
+    uint32_t before = lk_st.records;
+    lk_st.frames++;
+    if(!lk.p || k0 >= lk.p){
+        lk_st.no_phase++;
+        lk_break();
+    } else {
+        if(lk.synced && (seq != lk.next_seq || k0 != lk.k)){ lk_st.gaps++; lk_break(); }
+        lk.next_seq = seq + 1u;
+        uint32_t j = 0, k = k0;
+        if(!lk.synced){
+            /* Запись начинается с границы периода: хвост текущего периода пропускаем */
+            j = (lk.p - k0) % lk.p; k = 0;
+            lk.synced = (j < n) ? 1u : 0u;
+        }
+        if(lk.synced){
+            uint32_t s = 0;
+            while(k >= lk.seg_end[s]) s++;
+            while(j < n){
+                uint32_t len = lk.seg_end[s] - k;
+                if(len > n - j) len = n - j;
+                uint32_t a, b;
+                lk_sums(ch1, ch2, ab, j, len, &a, &b);
+                if(lk.seg_i[s] > 0){ lk.i[0] += a; lk.i[1] += b; } else { lk.i[0] -= a; lk.i[1] -= b; }
+                if(lk.seg_q[s] > 0){ lk.q[0] += a; lk.q[1] += b; } else { lk.q[0] -= a; lk.q[1] -= b; }
+                lk.sum[0] += a; lk.sum[1] += b;
+                j += len; k += len; lk.acc_n += len;
+                if(k < lk.seg_end[s]) continue;
+                if(++s < lk.nseg) continue;
+                s = 0; k = 0;
+                if(++lk.periods >= lk.m){
+                    /* Последний отсчёт записи — j-1; кадр закончился отсчётом n-1 в момент t_us */
+                    uint64_t back = lk.fs ? ((uint64_t)(n - j) * 1000000u) / lk.fs : 0u;
+                    lk_emit(t_us - back);
+                }
+            }
+            lk.k = (uint16_t)k;
+        }
+    }
+    uint32_t cyc = DWT->CYCCNT - c0;
+    lk_st.cyc_sum += cyc;
+    if(cyc > lk_st.cyc_max) lk_st.cyc_max = cyc;
+    return lk_st.records - before;
+}
+
+void lockin_abort(uint32_t drop_recent)
+{
+    uint32_t have = lk_tail - lk_head;
+    lk_tail -= (drop_recent < have) ? drop_recent : have;
+    lk_break();
+}
+
+uint32_t lockin_ready(void)
+{
+    return lk_tail - lk_head;
+}
+
+uint32_t lockin_pop(uint8_t *dst, uint32_t max)
+{
+    uint32_t k = 0;
+    while(k < max && lk_head != lk_tail){
+        memcpy(dst + k * LOCKIN_REC_SIZE, &lk_fifo[lk_head & (LOCKIN_REC_FIFO - 1u)], LOCKIN_REC_SIZE);
+        lk_head++; k++;
+    }
+    return k;
+}
+
+void lockin_get_stats(lockin_stats_t *out)
+{
+    if(out) *out = lk_st;
+}
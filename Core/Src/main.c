@@ -71,6 +71,10 @@
 #include "lcd.h" // добавлено для LCD_WIDTH, цветов и API LCD
 #include "usb_vendor_app.h" // ДОБАВЛЕНО: сервис потокового интерфейса
 #include "build_info.h"      // Информация о версии/сборке
+#include "frame_crc.h"       // аппаратный CRC16 кадров vendor (CRC + MDMA)
+#include "timebase.h"        // 64-битное время на DWT (метки кадров АЦП)
+#include "boot_time.h"       // время от сброса до первого кадра (страница BOOT)
+#include "uart_log.h"        // неблокирующий printf: кольцо + TX DMA USART1
 // Для доступа к VID/PID/строкам USB
 #include "usbd_desc.h"
 /* --- SOFT RESET TRACE WRAPPER -------------------------------------------
@@ -127,6 +131,7 @@ static void soft_reset_trace_capture(uint32_t lr){
     soft_reset_trace_capture(_lr); \
     printf("[DIAG] SOFT_RESET trace#%lu lr=0x%08lX tick=%lu\r\n", \
            (unsigned long)(g_soft_reset_trace.write_idx-1u), (unsigned long)_lr, (unsigned long)HAL_GetTick()); \
+    (void)uart_log_flush(50); \
     for(volatile uint32_t _d=0; _d<100000; _d++){ __NOP(); } \
     __DSB(); __ISB(); \
     SCB->AIRCR = (0x5FAUL << SCB_AIRCR_VECTKEY_Pos) | (SCB->AIRCR & 0x700UL) | SCB_AIRCR_SYSRESETREQ_Msk; \
@@ -160,6 +165,11 @@ ADC_HandleTypeDef hadc1;
 ADC_HandleTypeDef hadc2;
 DMA_HandleTypeDef hdma_adc1;
 DMA_HandleTypeDef hdma_adc2;
+DMA_HandleTypeDef hdma_usart1_tx;
+
+CRC_HandleTypeDef hcrc;
+
+MDMA_HandleTypeDef hmdma_crc;
 
 DAC_HandleTypeDef hdac1;
 
@@ -267,7 +277,7 @@ static uint32_t dwt_cycle_per_sec __attribute__((unused)) = 0;            /* к
 static uint64_t loop_cycle_accum = 0;             /* накопленные циклы */
 static uint32_t loop_cycle_count = 0;             /* число измеренных итераций */
 static uint32_t loop_cycle_last_report_ms = 0;    /* отметка отчёта */
-static uint32_t loop_cycle_last_avg = 0;          /* последняя средняя длительность (циклы) */
+volatile uint32_t loop_cycle_last_avg = 0;        /* последняя средняя длительность (циклы), страница CACH */
 
 /* ===== HardFault Capture (.noinit) ===== */
 typedef struct {
@@ -411,6 +421,8 @@ void PeriphCommonClock_Config(void);
 static void MPU_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_DMA_Init(void);
+static void MX_MDMA_Init(void);
+static void MX_CRC_Init(void);
 static void MX_SPI4_Init(void);
 static void MX_TIM1_Init(void);
 static void MX_SPI2_Init(void);
@@ -442,6 +454,50 @@ static void lcd_print_padded_if_changed(int x, int y, const char* new_text,
 #ifndef ENABLE_UART_HEARTBEAT
 #define ENABLE_UART_HEARTBEAT 0
 #endif
+// Сон основного цикла в WFI, когда таску стрима нечего делать: 1=вкл (по умолчанию)
+#ifndef MAIN_IDLE_WFI
+#define MAIN_IDLE_WFI 1
+#endif
+#if ENABLE_UART_HEARTBEAT
+#undef MAIN_IDLE_WFI
+#define MAIN_IDLE_WFI 0 /* детектор замёрзшего SysTick [TICK-FROZEN] считает итерации холостого цикла */
+#endif
+
+/* ===== Загрузка CPU за секундное окно (DWT): простой в WFI и доля тяжёлых ISR ===== */
+static uint32_t idle_cycle_accum = 0;             /* циклы во сне WFI за окно */
+static uint32_t idle_wakeup_count = 0;            /* пробуждений за окно */
+static uint32_t load_win_cyc0 = 0;                /* CYCCNT начала окна */
+static uint32_t load_win_isr0[4];                 /* счётчики g_isr_cyc_* начала окна */
+volatile uint16_t cpu_load_permille = 0xFFFFu;    /* занятость CPU, ‰ (0xFFFF — не измеряется, MAIN_IDLE_WFI=0) */
+volatile uint16_t cpu_isr_permille = 0;           /* доля ISR DMA АЦП/TIM6/OTG_HS, ‰ */
+volatile uint32_t cpu_wakeups_per_s = 0;          /* пробуждений из WFI в секунду */
+
+/* Закрыть окно: занятость = 1 - сон/стена, ISR = сумма приращений g_isr_cyc_* (stm32h7xx_it.c)/стена.
+   Сон меряется при PRIMASK=1, поэтому ISR, разбудившее ядро, в него не попадает. */
+static void cpu_load_window(void)
+{
+  extern volatile uint32_t g_isr_cyc_adc, g_isr_cyc_adc2, g_isr_cyc_tim6, g_isr_cyc_otg;
+  __disable_irq();
+  uint32_t now = DWT->CYCCNT;
+  uint32_t isr[4] = { g_isr_cyc_adc, g_isr_cyc_adc2, g_isr_cyc_tim6, g_isr_cyc_otg };
+  __enable_irq();
+  uint32_t wall = now - load_win_cyc0;
+  uint64_t isr_d = 0;
+  for(uint32_t i = 0; i < 4u; i++){ isr_d += (uint32_t)(isr[i] - load_win_isr0[i]); load_win_isr0[i] = isr[i]; }
+  uint32_t idle = idle_cycle_accum;
+  uint32_t wk = idle_wakeup_count;
+  load_win_cyc0 = now;
+  idle_cycle_accum = 0; idle_wakeup_count = 0;
+  if(!wall) return;
+  if(idle > wall) idle = wall;
+  if(isr_d > wall) isr_d = wall; /* вложенные ISR учитываются дважды */
+#if MAIN_IDLE_WFI
+  cpu_load_permille = (uint16_t)(((uint64_t)(wall - idle) * 1000u) / wall);
+#endif
+  cpu_isr_permille = (uint16_t)((isr_d * 1000u) / wall);
+  cpu_wakeups_per_s = (uint32_t)(((uint64_t)wk * SystemCoreClock) / wall);
+}
+
 // --- Диагностика перезагрузок ---
 // Определите DIAG_HALT_BEFORE_LOOP чтобы остановить МК перед входом в while(1)
 // #define DIAG_HALT_BEFORE_LOOP 1
@@ -464,6 +520,7 @@ static void lcd_print_padded_if_changed(int x, int y, const char* new_text,
 
 static inline void diag_halt(const char *tag){
   printf("[DIAG] HALT %s\r\n", tag);
+  (void)uart_log_flush(100);
   __BKPT(0);
   while(1){ __NOP(); }
 }
@@ -510,6 +567,7 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
+  boot_mark(BOOT_MARK_MAIN);
   static uint32_t early_rsr_raw = 0; // первое чтение до HAL_Init
   early_rsr_raw = RCC->RSR; /* читаем как можно раньше */
   uint8_t iwdg_extended_early = 0;
@@ -535,6 +593,12 @@ int main(void)
   /* MPU Configuration--------------------------------------------------------*/
   MPU_Config();
 
+#if MCU_CACHE_ENABLE
+  /* Enable the CPU Cache: атрибуты регионов уже заданы MPU_Config */
+  SCB_EnableICache();
+  SCB_EnableDCache();
+#endif
+
   /* MCU Configuration--------------------------------------------------------*/
 
   /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
@@ -549,6 +613,7 @@ int main(void)
 
   /* Configure the system clock */
   SystemClock_Config();
+  boot_time_clock_switched();
 
   /* Configure the peripherals common clocks */
   PeriphCommonClock_Config();
@@ -556,7 +621,7 @@ int main(void)
   /* USER CODE BEGIN SysInit */
   /* РАННИЙ UART для диагностики: инициализация сразу после тактирования */
   MX_USART1_UART_Init();
-  setvbuf(stdout, NULL, _IONBF, 0);
+  setvbuf(stdout, NULL, _IONBF, 0); /* без буфера stdio: printf целиком уходит одним _write в кольцо лога */
   static uint32_t build_counter __attribute__((section(".noinit"))) = 0;
   build_counter++;
   printf("[BOOT] BUILD_TS=%s-%s COUNT=%lu SIGN=0x%08lX\r\n", __DATE__, __TIME__, (unsigned long)build_counter, (unsigned long)build_signature_hex);
@@ -591,11 +656,21 @@ int main(void)
     printf("[BOOT] IWDG_CFG=ENABLED (will init later)\r\n");
   #endif
   boot_diag_init(early_rsr_raw);
+  /* DWT CYCCNT — до MX_USB_DEVICE_Init и запуска АЦП: на нём метки времени кадров и счётчики
+     стоимости (частота ядра уже задана SystemClock_Config) */
+  timebase_init();
+#if MAIN_IDLE_WFI
+  /* В Sleep ядро гасит свой такт, а с ним встал бы и CYCCNT (метки кадров, учёт простоя).
+     DBGSLEEP_D1 держит такты D1 во сне: экономия — от остановки выполнения, не от гейтинга. */
+  DBGMCU->CR |= DBGMCU_CR_DBGSLEEP_D1;
+#endif
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
   MX_DMA_Init();
+  MX_MDMA_Init();
+  MX_CRC_Init();
   MX_SPI4_Init();
   MX_TIM1_Init();
   MX_SPI2_Init();
@@ -606,7 +681,9 @@ int main(void)
   MX_TIM2_Init();
   MX_TIM3_Init();
   MX_TIM15_Init();
+  frame_crc_init();
   MX_USB_DEVICE_Init();
+  boot_mark(BOOT_MARK_USB_INIT);
   /* Полностью исключаем инициализацию IWDG (даже если где-то потерян DIAG_DISABLE_IWDG) */
   printf("[DIAG] IWDG hard-disabled (no init call)\r\n");
   MX_USART1_UART_Init();
@@ -820,12 +897,10 @@ int main(void)
 
   printf("[INIT] Entering main loop...\r\n");
   g_progress_flags |= BOOT_PROGRESS_ENTER_LOOP;
-  /* Включаем DWT счётчик циклов (если не включён) для диагностики зависания */
-  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
-  DWT->LAR = 0xC5ACCE55; /* разблокировка (для некоторых ревизий) */
-  DWT->CYCCNT = 0;
-  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  boot_mark(BOOT_MARK_LOOP);
+  /* DWT счётчик циклов включён в timebase_init(); не сбрасываем — на нём метки времени кадров */
   uint32_t last_diag_ms = 0; /* для периодического аварийного принта даже если * не печатается */
+  load_win_cyc0 = DWT->CYCCNT;
   #ifdef DIAG_HALT_BEFORE_LOOP
     diag_halt("BEFORE_LOOP");
   #endif
@@ -998,8 +1073,23 @@ int main(void)
   if(ms_now - loop_cycle_last_report_ms >= 1000 && loop_cycle_count){
     loop_cycle_last_avg = (uint32_t)(loop_cycle_accum / loop_cycle_count);
     loop_cycle_accum = 0; loop_cycle_count = 0; loop_cycle_last_report_ms = ms_now;
+    cpu_load_window();
     /* printf отключён для изоляции зависания */
   }
+#if MAIN_IDLE_WFI
+  /* Работы нет — спим до прерывания. Проверка и WFI под PRIMASK: флаг, взведённый ISR между
+     ними, не теряется (отложенное прерывание будит WFI и при PRIMASK=1), а сам обработчик
+     выполнится после __enable_irq() и в сон не засчитается. */
+  __disable_irq();
+  if(!vnd_has_work()){
+    uint32_t idle_t0 = DWT->CYCCNT;
+    __DSB();
+    __WFI();
+    idle_cycle_accum += DWT->CYCCNT - idle_t0;
+    idle_wakeup_count++;
+  }
+  __enable_irq();
+#endif
   }
     /* USER CODE END WHILE */
 
@@ -1145,7 +1235,14 @@ static void MX_ADC1_Init(void)
 
   /** Configure the ADC multi-mode
   */
+#if ADC_STREAM_DUAL_MODE
+  /* ADC2 — slave: преобразования строго одновременно, данные парой в CDR (16 бит + 16 бит) */
+  multimode.Mode = ADC_DUALMODE_REGSIMULT;
+  multimode.DualModeData = ADC_DUALMODEDATAFORMAT_32_10_BITS;
+  multimode.TwoSamplingDelay = ADC_TWOSAMPLINGDELAY_1CYCLE;
+#else
   multimode.Mode = ADC_MODE_INDEPENDENT;
+#endif
   if (HAL_ADCEx_MultiModeConfigChannel(&hadc1, &multimode) != HAL_OK)
   {
     Error_Handler();
@@ -1198,7 +1295,12 @@ static void MX_ADC2_Init(void)
   hadc2.Init.DiscontinuousConvMode = DISABLE;
   hadc2.Init.ExternalTrigConv = ADC_EXTERNALTRIG_T15_TRGO;
   hadc2.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+#if ADC_STREAM_DUAL_MODE
+  /* Данные slave забирает DMA мастера через CDR; триггер slave в dual-режиме не используется */
+  hadc2.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DR;
+#else
   hadc2.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DMA_CIRCULAR;
+#endif
   hadc2.Init.Overrun = ADC_OVR_DATA_PRESERVED;
   hadc2.Init.LeftBitShift = ADC_LEFTBITSHIFT_NONE;
   hadc2.Init.OversamplingMode = DISABLE;
@@ -1725,6 +1827,8 @@ static void MX_USART1_UART_Init(void)
 {
 
   /* USER CODE BEGIN USART1_Init 0 */
+  /* Повторная инициализация не должна рвать DMA-кусок лога на середине */
+  uart_log_suspend(50);
   /* USER CODE END USART1_Init 0 */
 
   /* USER CODE BEGIN USART1_Init 1 */
@@ -1757,10 +1861,85 @@ static void MX_USART1_UART_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN USART1_Init 2 */
+  uart_log_start();
   /* USER CODE END USART1_Init 2 */
 
 }
 
+/**
+  * @brief CRC Initialization Function
+  * CRC16-CCITT-FALSE для кадров vendor (frame_crc.c): poly 0x1021, init 0xFFFF, байтовый вход
+  * @param None
+  * @retval None
+  */
+static void MX_CRC_Init(void)
+{
+
+  /* USER CODE BEGIN CRC_Init 0 */
+
+  /* USER CODE END CRC_Init 0 */
+
+  /* USER CODE BEGIN CRC_Init 1 */
+
+  /* USER CODE END CRC_Init 1 */
+  hcrc.Instance = CRC;
+  hcrc.Init.DefaultPolynomialUse = DEFAULT_POLYNOMIAL_DISABLE;
+  hcrc.Init.DefaultInitValueUse = DEFAULT_INIT_VALUE_DISABLE;
+  hcrc.Init.GeneratingPolynomial = 0x1021;
+  hcrc.Init.CRCLength = CRC_POLYLENGTH_16B;
+  hcrc.Init.InitValue = 0xFFFF;
+  hcrc.Init.InputDataInversionMode = CRC_INPUTDATA_INVERSION_NONE;
+  hcrc.Init.OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_DISABLE;
+  hcrc.InputDataFormat = CRC_INPUTDATA_FORMAT_BYTES;
+  if (HAL_CRC_Init(&hcrc) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN CRC_Init 2 */
+
+  /* USER CODE END CRC_Init 2 */
+
+}
+
+/**
+  * Enable MDMA controller clock and configure MDMA_Channel0 (SW request: payload кадра -> CRC->DR)
+  */
+static void MX_MDMA_Init(void)
+{
+
+  /* MDMA controller clock enable */
+  __HAL_RCC_MDMA_CLK_ENABLE();
+  /* Local variables */
+
+  /* Configure MDMA channel MDMA_Channel0 */
+  /* Configure MDMA request hmdma_crc on MDMA_Channel0 */
+  hmdma_crc.Instance = MDMA_Channel0;
+  hmdma_crc.Init.Request = MDMA_REQUEST_SW;
+  hmdma_crc.Init.TransferTriggerMode = MDMA_BLOCK_TRANSFER;
+  hmdma_crc.Init.Priority = MDMA_PRIORITY_LOW;
+  hmdma_crc.Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+  hmdma_crc.Init.SourceInc = MDMA_SRC_INC_WORD;
+  hmdma_crc.Init.DestinationInc = MDMA_DEST_INC_DISABLE;
+  hmdma_crc.Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+  hmdma_crc.Init.DestDataSize = MDMA_DEST_DATASIZE_BYTE;
+  hmdma_crc.Init.DataAlignment = MDMA_DATAALIGN_PACKENABLE;
+  hmdma_crc.Init.BufferTransferLength = 128;
+  hmdma_crc.Init.SourceBurst = MDMA_SOURCE_BURST_SINGLE;
+  hmdma_crc.Init.DestBurst = MDMA_DEST_BURST_SINGLE;
+  hmdma_crc.Init.SourceBlockAddressOffset = 0;
+  hmdma_crc.Init.DestBlockAddressOffset = 0;
+  if (HAL_MDMA_Init(&hmdma_crc) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /* MDMA interrupt initialization */
+  /* MDMA_IRQn interrupt configuration: уровень OTG_HS, чтобы колбэк CRC и TxCplt не вытесняли друг друга */
+  HAL_NVIC_SetPriority(MDMA_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(MDMA_IRQn);
+
+}
+
 /**
   * Enable DMA controller clock
   */
@@ -1774,8 +1953,11 @@ static void MX_DMA_Init(void)
   /* DMA1_Stream0_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 6, 0);
   HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
-  /* DMA1_Stream1_IRQn disabled intentionally (ADC2 DMA runs without IRQ) */
+  /* DMA1_Stream1_IRQn disabled intentionally (ADC2 DMA runs without IRQ; unused in ADC_STREAM_DUAL_MODE) */
   HAL_NVIC_DisableIRQ(DMA1_Stream1_IRQn);
+  /* DMA1_Stream2_IRQn interrupt configuration: TX лога USART1, ниже АЦП и USB */
+  HAL_NVIC_SetPriority(DMA1_Stream2_IRQn, 10, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream2_IRQn);
 
 }
 
@@ -2057,6 +2239,66 @@ void MPU_Config(void)
   MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
 
   HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+  /* AXI SRAM (код, rodata, образ .data, пулы): Normal write-back, write-allocate (TEX=1 C=1 B=1).
+     Регионы DMA ниже имеют больший номер и перекрывают его атрибуты */
+  MPU_InitStruct.Enable = MPU_REGION_ENABLE;
+  MPU_InitStruct.Number = MPU_REGION_NUMBER1;
+  MPU_InitStruct.BaseAddress = D1_AXISRAM_BASE;
+  MPU_InitStruct.Size = MPU_REGION_SIZE_512KB;
+  MPU_InitStruct.SubRegionDisable = 0x0;
+  MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+  MPU_InitStruct.AccessPermission = MPU_REGION_FULL_ACCESS;
+  MPU_InitStruct.DisableExec = MPU_INSTRUCTION_ACCESS_ENABLE;
+  MPU_InitStruct.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+  MPU_InitStruct.IsCacheable = MPU_ACCESS_CACHEABLE;
+  MPU_InitStruct.IsBufferable = MPU_ACCESS_BUFFERABLE;
+  HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+  /* Буферы DMA АЦП и кольцо фронтов TIM2 (секция .adc_dma, 64K в AXI SRAM): Normal non-cacheable.
+     DMA1/DMA2 пишут их постоянно, CPU читает кадр один раз — invalidate по кадрам не нужен */
+  {
+    extern uint8_t __adc_dma_start__[];
+    MPU_InitStruct.Number = MPU_REGION_NUMBER2;
+    MPU_InitStruct.BaseAddress = (uint32_t)__adc_dma_start__;
+    MPU_InitStruct.Size = MPU_REGION_SIZE_64KB;
+    MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+    MPU_InitStruct.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+    MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+    MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&MPU_InitStruct);
+  }
+#if USBD_OTG_DMA_ENABLE
+  /* Буферы EP0/OUT, дескрипторы и хэндлы USB (секция .usb_nocache, 16K в AXI SRAM):
+     Normal non-cacheable (TEX=1 C=0 B=0) — DMA ядра OTG и CPU видят одно и то же без обслуживания кэша */
+  {
+    extern uint8_t __usb_nocache_start__[];
+    MPU_InitStruct.Enable = MPU_REGION_ENABLE;
+    MPU_InitStruct.Number = MPU_REGION_NUMBER3;
+    MPU_InitStruct.BaseAddress = (uint32_t)__usb_nocache_start__;
+    MPU_InitStruct.Size = MPU_REGION_SIZE_16KB;
+    MPU_InitStruct.SubRegionDisable = 0x0;
+    MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+    MPU_InitStruct.AccessPermission = MPU_REGION_FULL_ACCESS;
+    MPU_InitStruct.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+    MPU_InitStruct.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+    MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+    MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&MPU_InitStruct);
+  }
+  /* Пул кадров USB (секция .usb_dma, 64K): Normal write-through, no write-allocate (TEX=0 C=1 B=0).
+     Сборка кадра сразу доходит до RAM, чтение (CRC, сжатие) идёт из кэша; перед передачей — только DSB */
+  {
+    extern uint8_t __usb_dma_start__[];
+    MPU_InitStruct.Number = MPU_REGION_NUMBER4;
+    MPU_InitStruct.BaseAddress = (uint32_t)__usb_dma_start__;
+    MPU_InitStruct.Size = MPU_REGION_SIZE_64KB;
+    MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL0;
+    MPU_InitStruct.IsCacheable = MPU_ACCESS_CACHEABLE;
+    MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&MPU_InitStruct);
+  }
+#endif
   /* Enables the MPU */
   HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
 
@@ -0,0 +1,41 @@
+/* Журнал событий тракта АЦП -> USB (см. pipe_trace.h) */
+#include "main.h"
+#include "pipe_trace.h"
+
+_Static_assert((PIPE_TRACE_RECS & (PIPE_TRACE_RECS - 1u)) == 0u && PIPE_TRACE_RECS <= 32768u,
+               "PIPE_TRACE_RECS must be a power of two not above 32768");
+
+static pipe_rec_t pt_ring[PIPE_TRACE_RECS];
+static volatile uint32_t pt_wr; /* номер следующей записи, свободно растущий */
+
+ITCM_FUNC void pipe_trace_emit(uint8_t id, uint32_t seq, uint32_t arg)
+{
+    uint32_t cyc = DWT->CYCCNT;
+    uint8_t ctx = (uint8_t)__get_IPSR();
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    uint32_t w = pt_wr;
+    pipe_rec_t *r = &pt_ring[w & (PIPE_TRACE_RECS - 1u)];
+    r->cyc = cyc; r->seq = seq; r->arg = arg;
+    r->idx = (uint16_t)w; r->id = id; r->ctx = ctx;
+    pt_wr = w + 1u;
+    __set_PRIMASK(pm);
+}
+
+uint32_t pipe_trace_read(uint16_t from16, pipe_rec_t *dst, uint32_t max, uint32_t *first, uint32_t *wr)
+{
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    uint32_t w = pt_wr;
+    /* Полный номер — ближайший не больше w с теми же младшими 16 битами */
+    uint32_t back = (uint16_t)((uint16_t)w - from16);
+    uint32_t avail = (w < PIPE_TRACE_RECS) ? w : PIPE_TRACE_RECS;
+    if(back > avail) back = avail;
+    uint32_t f = w - back;
+    uint32_t n = (back < max) ? back : max;
+    for(uint32_t i = 0; i < n; i++) dst[i] = pt_ring[(f + i) & (PIPE_TRACE_RECS - 1u)];
+    __set_PRIMASK(pm);
+    if(first) *first = f;
+    if(wr) *wr = w;
+    return n;
+}
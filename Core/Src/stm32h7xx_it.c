@@ -24,6 +24,8 @@
 /* USER CODE BEGIN Includes */
 #include <stdint.h>
 #include "lcd.h" // добавлено для вывода на экран при HardFault
+#include "timebase.h"
+#include "cyc_prof.h" // участок OTG_IRQ профилировщика
 extern volatile uint32_t systick_heartbeat; // добавлено: глобальный счётчик из main.c
 /* Прототип низкоуровневого вывода UART1 из main.c */
 extern void uart1_raw_putc(char c);
@@ -56,6 +58,17 @@ volatile uint32_t hardfault_cfsr=0, hardfault_hfsr=0, hardfault_bfar=0, hardfaul
 volatile uint32_t hardfault_active = 0; // 1 когда данные заполнены
 // Прототип обработчика захвата стека
 void HardFault_Capture(uint32_t *stack_addr);
+// Стоимость OTG_HS_IRQHandler (DWT): сравнение режимов FIFO-из-ISR и DMA ядра, экспорт в PERF
+volatile uint32_t g_otg_irq_count = 0;
+volatile uint64_t g_otg_irq_cycles = 0;
+// Стоимость ISR DMA АЦП (DMA1_Stream0, TC кадра): эффект размещения в ITCM, экспорт в CACH
+volatile uint32_t g_adc_irq_count = 0;
+volatile uint64_t g_adc_irq_cycles = 0;
+volatile uint32_t g_adc_irq_max = 0;
+// Время тяжёлых ISR для доли ISR в загрузке CPU (main.c): у каждого ISR свой 32-битный счётчик,
+// запись в него атомарна, поэтому OTG_HS (приоритет 5), вытеснивший ISR АЦП/TIM6 (6), не теряет
+// чужих циклов. Не сбрасываются по START: main.c суммирует приращения за окно по модулю 2^32.
+volatile uint32_t g_isr_cyc_adc = 0, g_isr_cyc_adc2 = 0, g_isr_cyc_tim6 = 0, g_isr_cyc_otg = 0;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -70,8 +83,11 @@ void HardFault_Capture(uint32_t *stack_addr);
 
 /* External variables --------------------------------------------------------*/
 extern PCD_HandleTypeDef hpcd_USB_OTG_HS;
+extern MDMA_HandleTypeDef hmdma_crc;
 extern DMA_HandleTypeDef hdma_adc1;
 extern DMA_HandleTypeDef hdma_adc2;
+extern DMA_HandleTypeDef hdma_usart1_tx;
+extern UART_HandleTypeDef huart1;
 extern DAC_HandleTypeDef hdac1;
 extern TIM_HandleTypeDef htim6;
 /* USER CODE BEGIN EV */
@@ -212,6 +228,7 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
+  timebase_tick(); // переполнения DWT CYCCNT для 64-битного времени
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -230,9 +247,15 @@ void DMA1_Stream0_IRQHandler(void)
 {
   /* USER CODE BEGIN DMA1_Stream0_IRQn 0 */
   /* minimized: no UART in IRQ */
+  uint32_t adc_t0 = DWT->CYCCNT;
   /* USER CODE END DMA1_Stream0_IRQn 0 */
   HAL_DMA_IRQHandler(&hdma_adc1);
   /* USER CODE BEGIN DMA1_Stream0_IRQn 1 */
+  uint32_t adc_cyc = DWT->CYCCNT - adc_t0;
+  g_adc_irq_cycles += adc_cyc;
+  g_isr_cyc_adc += adc_cyc;
+  g_adc_irq_count++;
+  if(adc_cyc > g_adc_irq_max) g_adc_irq_max = adc_cyc;
 
   /* USER CODE END DMA1_Stream0_IRQn 1 */
 }
@@ -244,13 +267,29 @@ void DMA1_Stream1_IRQHandler(void)
 {
   /* USER CODE BEGIN DMA1_Stream1_IRQn 0 */
   /* minimized: no UART in IRQ */
+  uint32_t adc2_t0 = DWT->CYCCNT;
   /* USER CODE END DMA1_Stream1_IRQn 0 */
   HAL_DMA_IRQHandler(&hdma_adc2);
   /* USER CODE BEGIN DMA1_Stream1_IRQn 1 */
+  g_isr_cyc_adc2 += DWT->CYCCNT - adc2_t0;
 
   /* USER CODE END DMA1_Stream1_IRQn 1 */
 }
 
+/**
+  * @brief This function handles DMA1 stream2 global interrupt.
+  */
+void DMA1_Stream2_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream2_IRQn 0 */
+
+  /* USER CODE END DMA1_Stream2_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_usart1_tx);
+  /* USER CODE BEGIN DMA1_Stream2_IRQn 1 */
+
+  /* USER CODE END DMA1_Stream2_IRQn 1 */
+}
+
 /**
   * @brief This function handles TIM6 global interrupt, DAC1_CH1 and DAC1_CH2 underrun error interrupts.
   */
@@ -258,14 +297,44 @@ void TIM6_DAC_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM6_DAC_IRQn 0 */
   /* minimized: no UART in IRQ */
+  uint32_t tim6_t0 = DWT->CYCCNT;
   /* USER CODE END TIM6_DAC_IRQn 0 */
   HAL_DAC_IRQHandler(&hdac1);
   HAL_TIM_IRQHandler(&htim6);
   /* USER CODE BEGIN TIM6_DAC_IRQn 1 */
+  g_isr_cyc_tim6 += DWT->CYCCNT - tim6_t0;
 
   /* USER CODE END TIM6_DAC_IRQn 1 */
 }
 
+/**
+  * @brief This function handles USART1 global interrupt.
+  */
+void USART1_IRQHandler(void)
+{
+  /* USER CODE BEGIN USART1_IRQn 0 */
+  /* TC последнего DMA-куска лога -> HAL_UART_TxCpltCallback (uart_log.c) */
+  /* USER CODE END USART1_IRQn 0 */
+  HAL_UART_IRQHandler(&huart1);
+  /* USER CODE BEGIN USART1_IRQn 1 */
+
+  /* USER CODE END USART1_IRQn 1 */
+}
+
+/**
+  * @brief This function handles MDMA global interrupt.
+  */
+void MDMA_IRQHandler(void)
+{
+  /* USER CODE BEGIN MDMA_IRQn 0 */
+
+  /* USER CODE END MDMA_IRQn 0 */
+  HAL_MDMA_IRQHandler(&hmdma_crc);
+  /* USER CODE BEGIN MDMA_IRQn 1 */
+
+  /* USER CODE END MDMA_IRQn 1 */
+}
+
 /**
   * @brief This function handles USB On The Go HS global interrupt.
   */
@@ -273,9 +342,15 @@ void OTG_HS_IRQHandler(void)
 {
   /* USER CODE BEGIN OTG_HS_IRQn 0 */
   /* minimized: no UART in IRQ */
+  uint32_t otg_t0 = DWT->CYCCNT;
   /* USER CODE END OTG_HS_IRQn 0 */
   HAL_PCD_IRQHandler(&hpcd_USB_OTG_HS);
   /* USER CODE BEGIN OTG_HS_IRQn 1 */
+  uint32_t otg_cyc = DWT->CYCCNT - otg_t0;
+  g_otg_irq_cycles += otg_cyc;
+  g_isr_cyc_otg += otg_cyc;
+  g_otg_irq_count++;
+  CYC_PROF_ADD(CYC_PROF_OTG_IRQ, otg_cyc);
 
   /* USER CODE END OTG_HS_IRQn 1 */
 }
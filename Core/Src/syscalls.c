@@ -32,6 +32,7 @@
 /* Redirect printf to UART */
 #include "stm32h7xx_hal.h"
 #include "main.h"
+#include "uart_log.h"
 
 
 /* Variables */
@@ -86,21 +87,19 @@ __attribute__((weak)) int _read(int file, char *ptr, int len)
 __attribute__((weak)) int _write(int file, char *ptr, int len)
 {
   (void)file;
-  int DataIdx;
-
-  for (DataIdx = 0; DataIdx < len; DataIdx++)
+  /* Одна строка printf — одна запись в кольцо лога; UART выгружает её DMA в фоне */
+  if (len > 0)
   {
-    __io_putchar(*ptr++);
+    (void)uart_log_write(ptr, (uint32_t)len);
   }
   return len;
 }
 
-/* Provide __io_putchar to send characters over USART1 */
+/* Provide __io_putchar to send characters over USART1 (через кольцо лога, без ожидания) */
 int __io_putchar(int ch)
 {
-  uint8_t c = (uint8_t)ch;
-  /* Transmit in blocking mode; small timeout is OK for logs */
-  (void)HAL_UART_Transmit(&huart1, &c, 1, 10);
+  char c = (char)ch;
+  (void)uart_log_write(&c, 1);
   return ch;
 }
 
@@ -0,0 +1,41 @@
+/* 64-битное время устройства на DWT->CYCCNT (см. timebase.h) */
+#include "main.h"
+#include "timebase.h"
+
+static volatile uint32_t tb_hi = 0;    /* старшее слово: число переполнений CYCCNT */
+static volatile uint32_t tb_last = 0;  /* последнее прочитанное значение CYCCNT */
+static uint32_t tb_cyc_per_us = 1u;
+
+void timebase_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55; /* разблокировка (для некоторых ревизий) */
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    tb_cyc_per_us = SystemCoreClock / 1000000u;
+    if(tb_cyc_per_us == 0u) tb_cyc_per_us = 1u;
+    /* CYCCNT идёт с Reset_Handler и не сбрасывается: tb_hi/tb_last продолжают счёт от сброса
+       (метки boot_time) */
+    (void)timebase_cyc64();
+}
+
+ITCM_FUNC uint64_t timebase_cyc64(void)
+{
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    uint32_t c = DWT->CYCCNT;
+    if(c < tb_last) tb_hi++;
+    tb_last = c;
+    uint64_t r = ((uint64_t)tb_hi << 32) | c;
+    __set_PRIMASK(pm);
+    return r;
+}
+
+uint64_t timebase_cyc_to_us(uint64_t cyc)
+{
+    return cyc / tb_cyc_per_us;
+}
+
+void timebase_tick(void)
+{
+    (void)timebase_cyc64();
+}
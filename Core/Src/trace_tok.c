@@ -0,0 +1,66 @@
+/* Токенизированный трейс: кольцо записей {ID, CYCCNT, аргументы} (см. trace_tok.h) */
+#include <stdarg.h>
+#include "main.h"
+#include "trace_tok.h"
+
+_Static_assert((TRACE_TOK_RING_WORDS & (TRACE_TOK_RING_WORDS - 1u)) == 0u, "TRACE_TOK_RING_WORDS must be a power of two");
+
+static uint32_t tt_ring[TRACE_TOK_RING_WORDS];
+static volatile uint32_t tt_head, tt_tail; /* слова, свободно растущие */
+static uint8_t tt_seq;                     /* номер записи, расходуется и при потере */
+static trace_tok_stats_t tt_st;
+
+ITCM_FUNC void trace_tok_emit(uint32_t id, uint32_t nargs, ...)
+{
+    uint32_t cyc = DWT->CYCCNT;
+    if(nargs > TRACE_TOK_MAX_ARGS) nargs = TRACE_TOK_MAX_ARGS;
+    uint32_t need = 2u + nargs;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    uint32_t h = tt_head, used = h - tt_tail;
+    uint8_t seq = tt_seq++;
+    if(need > TRACE_TOK_RING_WORDS - used){
+        tt_st.dropped++;
+        __set_PRIMASK(pm);
+        return;
+    }
+    tt_ring[h & (TRACE_TOK_RING_WORDS - 1u)] = (id & 0xFFFFFu) | (nargs << 20) | ((uint32_t)seq << 24);
+    tt_ring[(h + 1u) & (TRACE_TOK_RING_WORDS - 1u)] = cyc;
+    va_list ap;
+    va_start(ap, nargs);
+    for(uint32_t i = 0; i < nargs; i++) tt_ring[(h + 2u + i) & (TRACE_TOK_RING_WORDS - 1u)] = va_arg(ap, uint32_t);
+    va_end(ap);
+    tt_head = h + need;
+    used += need;
+    if(used > tt_st.level_hwm) tt_st.level_hwm = (uint16_t)used;
+    tt_st.records++;
+    __set_PRIMASK(pm);
+}
+
+uint32_t trace_tok_read(uint32_t *dst, uint32_t max_words)
+{
+    uint32_t k = 0;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    uint32_t t = tt_tail;
+    while(t != tt_head){
+        uint32_t need = 2u + ((tt_ring[t & (TRACE_TOK_RING_WORDS - 1u)] >> 20) & 0x0Fu);
+        if(k + need > max_words) break;
+        for(uint32_t i = 0; i < need; i++) dst[k++] = tt_ring[(t + i) & (TRACE_TOK_RING_WORDS - 1u)];
+        t += need;
+    }
+    tt_tail = t;
+    tt_st.words_read += k;
+    __set_PRIMASK(pm);
+    return k;
+}
+
+void trace_tok_get_stats(trace_tok_stats_t *out)
+{
+    if(!out) return;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    *out = tt_st;
+    out->level = (uint16_t)(tt_head - tt_tail);
+    __set_PRIMASK(pm);
+}
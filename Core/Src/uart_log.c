@@ -0,0 +1,133 @@
+/* Неблокирующий лог USART1 через TX DMA (см. uart_log.h) */
+#include <string.h>
+#include "main.h"
+#include "uart_log.h"
+
+extern UART_HandleTypeDef huart1;
+
+_Static_assert((UART_LOG_RING & (UART_LOG_RING - 1u)) == 0u, "UART_LOG_RING must be a power of two");
+
+/* Кольцо — в окне .adc_dma: некэшируемо для CPU и доступно DMA1 */
+static uint8_t ul_ring[UART_LOG_RING] __attribute__((section(".adc_dma"), aligned(32)));
+static volatile uint32_t ul_head, ul_tail; /* пишет uart_log_write / колбэк TX; свободно растущие */
+static volatile uint32_t ul_busy;          /* байт в текущем DMA-куске, 0 — простой */
+static volatile uint8_t ul_run;
+static uart_log_stats_t ul_st;
+
+/* Запустить следующий кусок: до конца кольца или до head. Только под PRIMASK. */
+static void ul_kick(void)
+{
+    if(ul_busy || !ul_run) return;
+    uint32_t t = ul_tail, n = ul_head - t;
+    if(!n) return;
+    uint32_t off = t & (UART_LOG_RING - 1u);
+    if(n > UART_LOG_RING - off) n = UART_LOG_RING - off;
+    if(HAL_UART_Transmit_DMA(&huart1, &ul_ring[off], (uint16_t)n) == HAL_OK){
+        ul_busy = n;
+        ul_st.dma_chunks++;
+    }
+}
+
+uint32_t uart_log_write(const char *p, uint32_t len)
+{
+    uint32_t c0 = DWT->CYCCNT;
+    if(!len) return 0;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    uint32_t h = ul_head, used = h - ul_tail;
+    if(len > UART_LOG_RING - used){
+        ul_st.dropped_writes++;
+        ul_st.dropped_bytes += len;
+        __set_PRIMASK(pm);
+        return 0;
+    }
+    uint32_t off = h & (UART_LOG_RING - 1u);
+    uint32_t first = UART_LOG_RING - off;
+    if(first > len) first = len;
+    memcpy(&ul_ring[off], p, first);
+    if(len > first) memcpy(ul_ring, p + first, len - first);
+    ul_head = h + len;
+    used += len;
+    if(used > ul_st.level_hwm) ul_st.level_hwm = (uint16_t)used;
+    ul_st.writes++;
+    ul_st.bytes_in += len;
+    ul_kick();
+    uint32_t cyc = DWT->CYCCNT - c0;
+    ul_st.wr_cyc_sum += cyc;
+    if(cyc > ul_st.wr_cyc_max) ul_st.wr_cyc_max = cyc;
+    __set_PRIMASK(pm);
+    return len;
+}
+
+void uart_log_start(void)
+{
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    ul_run = 1;
+    ul_kick();
+    __set_PRIMASK(pm);
+}
+
+void uart_log_suspend(uint32_t timeout_ms)
+{
+    uint32_t t0 = HAL_GetTick();
+    while(ul_busy && !__get_PRIMASK() && (HAL_GetTick() - t0) < timeout_ms){ __NOP(); }
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    ul_run = 0;
+    if(ul_busy){
+        /* Кусок не завершился (прерывания запрещены или UART стоит): бросаем его */
+        (void)HAL_UART_AbortTransmit(&huart1);
+        ul_tail += ul_busy; ul_busy = 0;
+        ul_st.dma_errors++;
+    }
+    __set_PRIMASK(pm);
+}
+
+int uart_log_flush(uint32_t timeout_ms)
+{
+    uint32_t t0 = HAL_GetTick();
+    /* Под PRIMASK колбэки DMA не придут и тик стоит — ждать бессмысленно */
+    while((ul_busy || ul_head != ul_tail) && ul_run && !__get_PRIMASK()){
+        if((HAL_GetTick() - t0) >= timeout_ms) return 0;
+    }
+    return (ul_head == ul_tail) ? 1 : 0;
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if(huart != &huart1) return;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    ul_tail += ul_busy;
+    ul_st.bytes_out += ul_busy;
+    ul_busy = 0;
+    ul_kick();
+    __set_PRIMASK(pm);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if(huart != &huart1) return;
+    /* Сколько байт куска ушло, неизвестно: кусок считаем потерянным */
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    if(huart->gState == HAL_UART_STATE_READY){
+        ul_tail += ul_busy; ul_busy = 0;
+        ul_st.dma_errors++;
+        ul_kick();
+    }
+    __set_PRIMASK(pm);
+}
+
+void uart_log_get_stats(uart_log_stats_t *out)
+{
+    if(!out) return;
+    uint32_t pm = __get_PRIMASK();
+    __disable_irq();
+    *out = ul_st;
+    out->running = ul_run;
+    out->busy = ul_busy ? 1u : 0u;
+    out->level = (uint16_t)(ul_head - ul_tail);
+    __set_PRIMASK(pm);
+}
@@ -1,6 +1,7 @@
 #include "usb_cdc_proto.h"
 #include "adc_stream.h"
 #include "main.h"
+#include "frame_crc.h"
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -88,9 +89,7 @@ void usb_stream_send_test_frame(void) {
     memcpy(buf, &hdr, sizeof(hdr));
     memcpy(buf + sizeof(hdr), pattern, sizeof(pattern));
     // CRC16 по 30 байтам заголовка + payload
-    uint16_t crc = 0xFFFFu; const uint8_t* p = buf; size_t len = 30 + sizeof(pattern);
-    for (size_t i=0;i<len;i++){ crc ^= (uint16_t)p[i] << 8; for (int b=0;b<8;b++){ crc = (crc & 0x8000)? (uint16_t)((crc<<1)^0x1021):(uint16_t)(crc<<1); } }
-    ((vendor_frame_hdr_t*)buf)->crc16 = crc;
+    ((vendor_frame_hdr_t*)buf)->crc16 = frame_crc16(buf, 30 + sizeof(pattern));
     // Паддинг до 64
     size_t total = sizeof(hdr) + sizeof(pattern);
     size_t pad = (64 - (total & 63u)) & 63u; if (pad) memset(buf+total,0,pad), total+=pad;
@@ -106,8 +105,8 @@ static uint16_t  s_frame_samples = 0; // полное количество вы
 static uint8_t   s_next_channel_to_send = 0; // 0 -> отправим ADC0, 1 -> ADC1
 static uint8_t   s_frame_active = 0;
 
-// CRC16 helper
-static uint16_t crc16_buf(const uint8_t* data, size_t len){ uint16_t crc=0xFFFFu; for(size_t i=0;i<len;i++){ crc^=(uint16_t)data[i]<<8; for(int b=0;b<8;b++){ if(crc&0x8000) crc=(uint16_t)((crc<<1)^0x1021); else crc=(uint16_t)(crc<<1);} } return crc; }
+// CRC16 helper: аппаратный блок CRC (программный подсчёт, только если блок занят кадрами vendor)
+static uint16_t crc16_buf(const uint8_t* data, size_t len){ return frame_crc16(data, len); }
 
 // Попытка отправить один USB кадр (один канал). Возврат 1 если отправлено.
 static uint8_t try_send_one_adc_frame(void){
@@ -0,0 +1,10 @@
+/* Куски передачи Vendor IN: копия куска в bounce-буфер (см. vnd_tx_chunk.h) */
+#include <string.h>
+#include "main.h"
+#include "vnd_tx_chunk.h"
+
+ITCM_FUNC const uint8_t *vnd_tx_chunk_bounce(uint8_t *bounce, const uint8_t *src, uint32_t n)
+{
+    memcpy(bounce, src, n);
+    return bounce;
+}
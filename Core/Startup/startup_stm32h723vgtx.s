@@ -59,8 +59,30 @@ defined in linker script */
   .type  Reset_Handler, %function
 Reset_Handler:
   ldr   sp, =_estack      /* set initial stack */
+/* DWT CYCCNT from reset: startup and boot timing (boot_time.c) */
+  ldr r0, =0xE000EDFC     /* DEMCR */
+  ldr r1, [r0]
+  orr r1, r1, #0x01000000 /* TRCENA */
+  str r1, [r0]
+  ldr r0, =0xE0001000     /* DWT_CTRL */
+  ldr r1, =0xC5ACCE55
+  str r1, [r0, #0xFB0]    /* DWT_LAR unlock */
+  movs r1, #0
+  str r1, [r0, #4]        /* CYCCNT = 0 */
+  ldr r1, [r0]
+  orr r1, r1, #1          /* CYCCNTENA */
+  str r1, [r0]
   bl  ExitRun0Mode        /* (generated by CubeMX) configure supply if needed */
   bl  SystemInit          /* CMSIS system clock init */
+/* Copy hot code image to ITCM (.itcm_text) */
+  ldr r0, =_siitcm
+  ldr r1, =_sitcm
+  ldr r2, =_eitcm
+0: cmp r1, r2
+  ittt lt
+  ldrlt r3, [r0], #4
+  strlt r3, [r1], #4
+  blt 0b
 /* Copy .data from flash to SRAM */
   ldr r0, =_sidata        /* flash source */
   ldr r1, =_sdata         /* ram destination start */
@@ -70,6 +92,23 @@ Reset_Handler:
   ldrlt r3, [r0], #4
   strlt r3, [r1], #4
   blt 1b
+/* Copy .usb_nocache (USB descriptors/handles for OTG DMA) to AXI SRAM */
+  ldr r0, =_siusb_nocache
+  ldr r1, =__usb_nocache_start__
+  ldr r2, =__usb_nocache_end__
+4: cmp r1, r2
+  ittt lt
+  ldrlt r3, [r0], #4
+  strlt r3, [r1], #4
+  blt 4b
+/* Zero .usb_dma (USB frame pool) */
+  ldr r0, =__usb_dma_start__
+  ldr r1, =__usb_dma_end__
+  movs r2, #0
+5: cmp r0, r1
+  itt lt
+  strlt r2, [r0], #4
+  blt 5b
 /* Zero .bss */
   ldr r0, =_sbss
   ldr r1, =_ebss
@@ -2,7 +2,7 @@
 # -*- coding: utf-8 -*-
 """
 Автоматизированный smoke-тест:
- 1. Сборка (make -C Debug)
+ 1. Сборка (make -C Debug) и отчёт о размещении в ITCM/DTCM (mem_placement.py)
  2. (Опц.) Прошивка через OpenOCD
  3. Тест №1: полный кадр (без усечения) – фиксируем TEST + пары ADC0/ADC1
  4. Тест №2: усечённый кадр (--trunc 256)
@@ -106,6 +106,9 @@ def main():
                 report['build']['tail'] = '\n'.join(out.splitlines()[-40:])
                 print(json.dumps(report, indent=2, ensure_ascii=False))
                 return 1
+            # Что попало в ITCM/DTCM (mem_placement.py), печатается до тестов
+            rc, out, _ = run_cmd([sys.executable, str(ROOT / 'HostTools' / 'mem_placement.py'), str(ELF_PATH)], cwd=ROOT)
+            print(out.rstrip())
     else:
         report['build'] = {'ok': True, 'skipped': True}
 
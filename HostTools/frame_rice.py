@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+# Распаковка сжатых кадров vendor (flags 0x10, CMD_SET_COMPRESS) — см. USBprotocol.txt §4.6.
+# - Быстрый путь: frame_rice_decode.c, собранный рядом в frame_rice_decode.so / .dll (ctypes).
+# - Без библиотеки работает запасной декодер на Python (медленнее, тот же результат).
+# - python frame_rice.py — самопроверка: кодирование тестовых сигналов и степень сжатия.
+
+import os, sys, struct, ctypes
+from array import array
+
+FLAG_RICE        = 0x10
+FLAG_PLANAR      = 0x08
+FRAME_VER_STEREO = 0x02
+
+BLOCK = 32
+KMAX  = 14
+ESC   = 15
+
+
+def _load_lib():
+    here = os.path.dirname(os.path.abspath(__file__))
+    name = 'frame_rice_decode.dll' if sys.platform.startswith('win') else 'frame_rice_decode.so'
+    path = os.path.join(here, name)
+    if not os.path.exists(path):
+        return None
+    try:
+        fn = ctypes.CDLL(path).frame_rice_decode
+    except (OSError, AttributeError):
+        return None
+    fn.argtypes = [ctypes.c_char_p, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32,
+                   ctypes.POINTER(ctypes.c_uint16)]
+    fn.restype = ctypes.c_int
+    return fn
+
+
+_c_decode = _load_lib()
+
+
+def have_c_decoder() -> bool:
+    return _c_decode is not None
+
+
+def _decode_py(data: bytes, nplanes: int, n: int) -> array:
+    """Запасной декодер: битовый поток старшим битом вперёд."""
+    bits = int.from_bytes(data, 'big')
+    total = len(data) * 8
+    pos = 0
+
+    def get(nb):
+        nonlocal pos
+        if pos + nb > total:
+            raise ValueError('RICE: stream too short')
+        pos += nb
+        return (bits >> (total - pos)) & ((1 << nb) - 1)
+
+    out = array('H', bytes(2 * nplanes * n))
+    for c in range(nplanes):
+        if n == 0:
+            continue
+        base = c * n
+        prev = get(16)
+        out[base] = prev
+        i = 1
+        while i < n:
+            m = min(BLOCK, n - i)
+            p = get(4)
+            if p > KMAX and p != ESC:
+                raise ValueError(f'RICE: bad block parameter {p}')
+            for j in range(m):
+                if p == ESC:
+                    u = get(16)
+                else:
+                    q = 0
+                    while get(1) == 0:
+                        q += 1
+                    u = (q << p) | (get(p) if p else 0)
+                    if u > 0xFFFF:
+                        raise ValueError('RICE: residual out of range')
+                d = (u >> 1) ^ -(u & 1)
+                prev = (prev + d) & 0xFFFF
+                out[base + i + j] = prev
+            i += m
+    return out
+
+
+def decode(data: bytes, nplanes: int, n: int) -> array:
+    """Распаковать nplanes плоскостей по n отсчётов (array('H'), плоскости подряд)."""
+    if _c_decode is not None:
+        out = (ctypes.c_uint16 * (nplanes * n))()
+        rc = _c_decode(bytes(data), len(data), nplanes, n, out)
+        if rc != 0:
+            raise ValueError(f'RICE: decode error {rc}')
+        return array('H', bytes(out))
+    return _decode_py(data, nplanes, n)
+
+
+def zone_tab_len(hdr: bytes) -> int:
+    """Байт таблицы зон ROI в начале payload (zone_count, байт 14): 4 * (zone_count + 1), 0 — кадр целиком."""
+    zc = hdr[14]
+    return 4 * (zc + 1) if zc else 0
+
+
+def comp_len(hdr: bytes) -> int:
+    """Длина сжатого payload из заголовка (байты 24..27)."""
+    return struct.unpack_from('<I', hdr, 24)[0]
+
+
+def frame_len(hdr: bytes) -> int:
+    """Полная длина кадра по заголовку: 32 + таблица зон + (сжатый — comp_len, иначе 2/4 * total_samples)."""
+    ver, flags = hdr[2], hdr[3]
+    zt = zone_tab_len(hdr)
+    if flags & FLAG_RICE:
+        return 32 + zt + comp_len(hdr)
+    ns = struct.unpack_from('<H', hdr, 12)[0]
+    return 32 + zt + ns * (4 if ver >= FRAME_VER_STEREO else 2)
+
+
+def payload(raw: bytes) -> bytes:
+    """Несжатые отсчёты кадра (как при SET_COMPRESS 0, без таблицы зон ROI): распаковка и раскладка L/R для v2."""
+    ver, flags = raw[2], raw[3]
+    ns = struct.unpack_from('<H', raw, 12)[0]
+    p0 = 32 + zone_tab_len(raw)
+    if not (flags & FLAG_RICE):
+        return bytes(raw[p0:p0 + ns * (4 if ver >= FRAME_VER_STEREO else 2)])
+    nplanes = 2 if ver >= FRAME_VER_STEREO else 1
+    s = decode(raw[p0:p0 + comp_len(raw)], nplanes, ns)
+    if nplanes == 2 and not (flags & FLAG_PLANAR):
+        il = array('H', bytes(4 * ns))
+        il[0::2] = s[:ns]
+        il[1::2] = s[ns:]
+        s = il
+    if sys.byteorder != 'little':
+        s.byteswap()
+    return s.tobytes()
+
+
+# ---- Эталонный кодер (зеркало Core/Src/frame_rice.c) — для самопроверки и оценки сжатия ----
+
+def encode(planes, cap: int):
+    acc = 0
+    nb = 0
+
+    def put(v, n):
+        nonlocal acc, nb
+        acc = (acc << n) | v
+        nb += n
+
+    limit = (cap - 4) * 8 if cap > 4 else 0
+    for x in planes:
+        prev = x[0]
+        put(prev, 16)
+        i = 1
+        n = len(x)
+        while i < n:
+            m = min(BLOCK, n - i)
+            u = []
+            for j in range(m):
+                d = (x[i + j] - prev) & 0xFFFF
+                prev = x[i + j]
+                d = d - 0x10000 if d & 0x8000 else d
+                u.append(((d << 1) ^ (d >> 15)) & 0xFFFF)
+            i += m
+            s = sum(u)
+            k = (s // m).bit_length() - 1 if s // m else 0
+            if k and (s >> (k - 1)) <= (s >> k) + m:
+                k -= 1
+            cost, p = 4 + 16 * m, ESC
+            if k <= KMAX:
+                b = 4 + m * (k + 1) + sum(v >> k for v in u)
+                if b < cost:
+                    cost, p = b, k
+            if nb + cost > limit:
+                return None
+            put(p, 4)
+            for v in u:
+                if p == ESC:
+                    put(v, 16)
+                else:
+                    put((1 << p) | (v & ((1 << p) - 1)), (v >> p) + 1 + p)
+    ln = (nb + 31) // 32 * 4
+    put(0, ln * 8 - nb)
+    return acc.to_bytes(ln, 'big') if ln else b''
+
+
+def _selftest():
+    import math, random
+    random.seed(1)
+    n = 1360
+    sig = {
+        'silence+noise(±4)': [32768 + random.randint(-4, 4) for _ in range(n)],
+        'sine 1kHz/272k 12bit + noise': [int(32768 + 2000 * math.sin(2 * math.pi * 1000 * i / 272000) + random.gauss(0, 3)) & 0xFFFF for i in range(n)],
+        'meander 50% + noise': [(40000 if (i // 136) % 2 else 25000) + random.randint(-8, 8) for i in range(n)],
+        'white noise 16bit': [random.randint(0, 0xFFFF) for _ in range(n)],
+    }
+    print(f"decoder: {'C (' + ('dll' if sys.platform.startswith('win') else 'so') + ')' if have_c_decoder() else 'python fallback'}")
+    for name, x in sig.items():
+        for nplanes in (1, 2):
+            planes = [x] * nplanes
+            raw = 2 * n * nplanes
+            enc = encode(planes, raw)
+            if enc is None:
+                print(f"{name:32s} planes={nplanes} raw (no gain)")
+                continue
+            dec = decode(enc, nplanes, n)
+            ok = list(dec) == [v for pl in planes for v in pl]
+            print(f"{name:32s} planes={nplanes} {raw}->{len(enc)} B ratio={len(enc) / raw:.3f} {'ok' if ok else 'MISMATCH'}")
+            if not ok:
+                sys.exit(1)
+
+
+if __name__ == '__main__':
+    _selftest()
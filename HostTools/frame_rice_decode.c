@@ -0,0 +1,100 @@
+/* Декодер payload кадров с флагом 0x10 (RICE) для хостовых утилит. Формат потока описан
+   в Core/Inc/frame_rice.h и USBprotocol.txt (§4.6). Python-обёртка и запасной декодер — frame_rice.py.
+   Сборка:
+     Linux/RPi: gcc -O2 -shared -fPIC -o frame_rice_decode.so frame_rice_decode.c
+     Windows:   gcc -O2 -shared -o frame_rice_decode.dll frame_rice_decode.c
+*/
+#include <stdint.h>
+
+#ifdef _WIN32
+#define FR_EXPORT __declspec(dllexport)
+#else
+#define FR_EXPORT __attribute__((visibility("default")))
+#endif
+
+#define FRAME_RICE_BLOCK 32u
+#define FRAME_RICE_KMAX  14u
+#define FRAME_RICE_ESC   15u
+
+/* Битовый читатель: acc выровнен по старшему биту, bits — валидных бит в acc */
+typedef struct {
+    const uint8_t *p, *end;
+    uint64_t acc;
+    uint32_t bits;
+} fr_br_t;
+
+static inline void fr_refill(fr_br_t *r)
+{
+    while(r->bits <= 56u && r->p < r->end){
+        r->acc |= (uint64_t)*r->p++ << (56u - r->bits);
+        r->bits += 8u;
+    }
+}
+
+/* n = 1..32; -1 — поток кончился */
+static inline int fr_get(fr_br_t *r, uint32_t n, uint32_t *v)
+{
+    if(r->bits < n){ fr_refill(r); if(r->bits < n) return -1; }
+    *v = (uint32_t)(r->acc >> (64u - n));
+    r->acc <<= n;
+    r->bits -= n;
+    return 0;
+}
+
+/* Унарная часть: число нулей до единицы */
+static inline int fr_unary(fr_br_t *r, uint32_t *q)
+{
+    uint32_t z = 0;
+    for(;;){
+        if(r->bits == 0u){ fr_refill(r); if(r->bits == 0u) return -1; }
+        if(r->acc == 0u){
+            z += r->bits; r->acc = 0; r->bits = 0;
+            if(z > 0xFFFFu) return -1;
+            continue;
+        }
+        uint32_t lz = (uint32_t)__builtin_clzll(r->acc);
+        z += lz;
+        r->acc <<= lz; r->acc <<= 1;
+        r->bits -= lz + 1u;
+        *q = z;
+        return z > 0xFFFFu ? -1 : 0;
+    }
+}
+
+/* Распаковать nplanes плоскостей по n отсчётов в out (плоскости подряд).
+   0 — успех; -1 — поток короче ожидаемого; -2 — неверный параметр блока/значение. */
+FR_EXPORT int frame_rice_decode(const uint8_t *src, uint32_t len, uint32_t nplanes, uint32_t n, uint16_t *out)
+{
+    fr_br_t r = { src, src + len, 0u, 0u };
+    for(uint32_t c = 0; c < nplanes; c++){
+        uint16_t *x = out + (uint64_t)c * n;
+        uint32_t v;
+        if(n == 0u) continue;
+        if(fr_get(&r, 16u, &v)) return -1;
+        uint16_t prev = (uint16_t)v;
+        x[0] = prev;
+        for(uint32_t i = 1; i < n; ){
+            uint32_t m = n - i, p;
+            if(m > FRAME_RICE_BLOCK) m = FRAME_RICE_BLOCK;
+            if(fr_get(&r, 4u, &p)) return -1;
+            if(p > FRAME_RICE_KMAX && p != FRAME_RICE_ESC) return -2;
+            for(uint32_t j = 0; j < m; j++){
+                uint32_t u;
+                if(p == FRAME_RICE_ESC){
+                    if(fr_get(&r, 16u, &u)) return -1;
+                } else {
+                    uint32_t q, lo = 0;
+                    if(fr_unary(&r, &q)) return -1;
+                    if(p && fr_get(&r, p, &lo)) return -1;
+                    u = (q << p) | lo;
+                    if(u > 0xFFFFu) return -2;
+                }
+                uint16_t d = (uint16_t)((u >> 1) ^ (0u - (u & 1u)));
+                prev = (uint16_t)(prev + d);
+                x[i + j] = prev;
+            }
+            i += m;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# Отчёт о размещении прошивки по памяти STM32H723 (после сборки, см. STM32H723VGTX_RAM.ld / _FLASH.ld):
+# - занятость ITCM / FLASH / DTCM / AXI (RAM_EXEC) / D2 / D3 по секциям ELF;
+# - что попало в ITCM (.itcm_text: ITCM_FUNC и правила .ld для HAL/USB-стека);
+# - метаданные в начале .bss в DTCM (DTCM_BSS, __dtcm_hot_start__..__dtcm_hot_end__);
+# - функции горячего пути, которые в ITCM не попали (нет -ffunction-sections, переименование в HAL).
+# Запуск: python HostTools/mem_placement.py [Debug/BMI30.stm32h7.elf] [--nm arm-none-eabi-nm]
+# Пост-сборка в CubeIDE: Properties > C/C++ Build > Settings > Build Steps > Post-build:
+#   python ../HostTools/mem_placement.py BMI30.stm32h7.elf
+# Код возврата 1 — ELF не прочитан; пропуски горячих функций только печатаются.
+
+import argparse, pathlib, subprocess, sys
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+ELF_DEFAULT = ROOT / 'Debug' / 'BMI30.stm32h7.elf'
+
+REGIONS = [  # имя, начало, длина — как MEMORY в .ld
+    ('ITCM', 0x00000000, 64 * 1024),
+    ('FLASH', 0x08000000, 1024 * 1024),  # только STM32H723VGTX_FLASH.ld
+    ('DTCM', 0x20000000, 128 * 1024),
+    ('AXI',  0x24000000, 320 * 1024),
+    ('D2',   0x30000000, 32 * 1024),
+    ('D3',   0x38000000, 16 * 1024),
+]
+
+# Функции, которые должны выполняться из ITCM (ITCM_FUNC и правила .itcm_text)
+HOT_CODE = [
+    'DMA1_Stream0_IRQHandler', 'OTG_HS_IRQHandler', 'HAL_DMA_IRQHandler', 'HAL_PCD_IRQHandler',
+    'HAL_ADC_ConvCpltCallback', 'adc_phase_at_tc', 'adc_phase_counters', 'adc_edge_pick', 'timebase_cyc64',
+    'USBD_VND_TxCplt', 'vnd_txq_on_txcplt', 'vnd_txq_kick', 'vnd_prepare_pair', 'vnd_prepare_stereo_pair',
+    'USBD_CDCVND_DataIn', 'vnd_tx_next_chunk', 'vnd_tx_chunk_bounce', 'USBD_LL_DataInStage', 'USBD_LL_Transmit',
+    'trace_tok_emit', 'pipe_trace_emit', 'cyc_prof_add',
+]
+
+
+def region_of(addr):
+    for name, base, size in REGIONS:
+        if base <= addr < base + size:
+            return name
+    return '?'
+
+
+def run(tool, *args):
+    return subprocess.run([tool, *args], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          check=True).stdout.decode('utf-8', errors='replace')
+
+
+def read_sections(size_tool, elf):
+    # arm-none-eabi-size -A: "<section> <size> <addr>"
+    secs = []
+    for line in run(size_tool, '-A', '-d', str(elf)).splitlines():
+        f = line.split()
+        if len(f) == 3 and f[0].startswith('.') and f[1].isdigit() and f[2].isdigit():
+            size, addr = int(f[1]), int(f[2])
+            if size and (addr or f[0] == '.itcm_text'):
+                secs.append((f[0], addr, size))
+    return secs
+
+
+def read_symbols(nm_tool, elf):
+    # arm-none-eabi-nm -S: "<addr> <size> <type> <name>"; символы без размера (метки .ld) — size 0
+    syms = []
+    for line in run(nm_tool, '-S', '--defined-only', str(elf)).splitlines():
+        f = line.split()
+        if len(f) == 4:
+            syms.append((int(f[0], 16) & ~1, int(f[1], 16), f[2], f[3]))
+        elif len(f) == 3:
+            syms.append((int(f[0], 16) & ~1, 0, f[1], f[2]))
+    return syms
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Размещение прошивки по ITCM/DTCM/AXI')
+    ap.add_argument('elf', nargs='?', default=str(ELF_DEFAULT))
+    ap.add_argument('--nm', default='arm-none-eabi-nm')
+    ap.add_argument('--size', default='arm-none-eabi-size')
+    args = ap.parse_args()
+    elf = pathlib.Path(args.elf)
+    try:
+        secs = read_sections(args.size, elf)
+        syms = read_symbols(args.nm, elf)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print(f"[PLACE] cannot read {elf}: {e}")
+        return 1
+
+    print(f"[PLACE] {elf}")
+    used = {name: 0 for name, _, _ in REGIONS}
+    for name, addr, size in secs:
+        reg = region_of(addr)
+        if reg in used:
+            used[reg] += size
+        print(f"  {name:<16} {reg:<5} 0x{addr:08X} {size:>7}")
+    for name, base, size in REGIONS:
+        print(f"[PLACE] {name:<5} {used[name]:>7} / {size:>7} B ({100.0 * used[name] / size:5.1f}%)")
+
+    addr_of = {n: a for a, _, _, n in syms}
+    itcm = sorted((a, s, n) for a, s, t, n in syms if t in 'tT' and region_of(a) == 'ITCM' and s)
+    print(f"[PLACE] ITCM code: {len(itcm)} functions, {sum(s for _, s, _ in itcm)} B")
+    for a, s, n in itcm:
+        print(f"  0x{a:08X} {s:>6}  {n}")
+
+    lo, hi = addr_of.get('__dtcm_hot_start__'), addr_of.get('__dtcm_hot_end__')
+    if lo is not None and hi is not None:
+        hot = sorted((a, s, n) for a, s, t, n in syms if t in 'bBdD' and s and lo <= a < hi)
+        print(f"[PLACE] DTCM hot data (.bss.dtcm): {hi - lo} B")
+        for a, s, n in hot:
+            print(f"  0x{a:08X} {s:>6}  {n}")
+
+    missing = [n for n in HOT_CODE if n in addr_of and region_of(addr_of[n]) != 'ITCM']
+    for n in missing:
+        print(f"[PLACE][WARN] {n} at 0x{addr_of[n]:08X} ({region_of(addr_of[n])}), expected ITCM")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+# Журнал событий тракта АЦП -> USB (Core/Inc/pipe_trace.h, USBprotocol.txt §4.17): чтение кольца по EP0
+# (VND_CMD_GET_EVENTS, 0x33) во время стрима, временная шкала и разбивка задержки каждого кадра:
+#   adc_wait  — DMA TC кадра АЦП -> сборка пары взяла его (очередь кадров АЦП)
+#   prep      — сборка пары (vnd_prepare_pair)
+#   txq_wait  — пара собрана -> первый кусок в USBD_LL_Transmit (очередь передачи)
+#   usb       — первый кусок -> последний TxCplt пары (A и B)
+#   total     — DMA TC -> последний TxCplt
+# Запуск:
+#   python HostTools/pipe_timeline.py                       — снимок кольца (последние 512 событий)
+#   python HostTools/pipe_timeline.py --start --seconds 2   — START, читать 2 с, STOP
+#   python HostTools/pipe_timeline.py --timeline            — печатать и сами события
+#   python HostTools/pipe_timeline.py --save ev.bin / --load ev.bin — сохранить / разобрать без устройства
+#   python HostTools/pipe_timeline.py --csv frames.csv      — задержки по кадрам
+# Пропуски (кольцо перезаписано раньше, чем прочитано) печатаются как [GAP].
+
+import argparse, struct, sys, time
+
+VID = 0xCAFE
+PID = 0x4001
+EP_OUT = 0x03
+CMD_START = 0x20
+CMD_STOP = 0x21
+VND_CMD_GET_EVENTS = 0x33
+EVT_HDR = struct.Struct('<IIHBBHHI')  # first, wr, count, version, rec_size, ring, reserved, sysclk_hz
+EVT_REC = struct.Struct('<IIIHBB')    # cyc, seq, arg, idx, id, ctx
+SEQ_NONE = 0xFFFFFFFF
+
+EVENTS = {1: 'ADC_TC', 2: 'PREP_BEGIN', 3: 'PREP_END', 4: 'LL_TX', 5: 'DATAIN', 6: 'ZLP',
+          7: 'TXCPLT', 8: 'UNSTICK', 9: 'CMD'}
+UNSTICK = {1: 'EP_UNSTUCK', 2: 'TXQ_RETRY', 3: 'BURST_DROP', 4: 'ACK_FALLBACK', 5: 'ACK_TIMEOUT',
+           6: 'TEST_TIMEOUT'}
+CTX = {0: 'main', 15: 'SysTick', 27: 'DMA1_S0', 28: 'DMA1_S1', 70: 'TIM6', 93: 'OTG_HS'}  # IPSR = IRQn + 16
+STAGES = ('adc_wait', 'prep', 'txq_wait', 'usb', 'total')
+
+
+def get_page(dev, from_idx, length=1024):
+    import usb.util
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, VND_CMD_GET_EVENTS, from_idx & 0xFFFF, 0, length, timeout=500))
+    if len(ba) < EVT_HDR.size:
+        raise IOError(f'short reply ({len(ba)} B)')
+    first, wr, count, ver, rsz, ring, _, sysclk = EVT_HDR.unpack_from(ba)
+    if ver != 1 or rsz != EVT_REC.size:
+        raise IOError(f'unknown format ver={ver} rec={rsz}')
+    recs = [(first + i,) + EVT_REC.unpack_from(ba, EVT_HDR.size + i * EVT_REC.size) for i in range(count)]
+    return first, wr, ring, sysclk, recs
+
+
+class Collector:
+    """Непрерывное чтение кольца с номера next; записи — (номер, cyc, seq, arg, idx, id, ctx)"""
+    def __init__(self, dev):
+        self.dev, self.recs, self.gaps, self.sysclk = dev, [], 0, 0
+        _, wr, ring, self.sysclk, _ = get_page(dev, 0, EVT_HDR.size + EVT_REC.size)
+        self.next = max(0, wr - ring)
+
+    def poll(self):
+        while True:
+            first, wr, _, self.sysclk, recs = get_page(self.dev, self.next)
+            if first > self.next:
+                self.gaps += first - self.next
+                print(f'[EVT][GAP] {first - self.next} event(s) overwritten before #{first}')
+            for r in recs:
+                if (r[0] & 0xFFFF) != r[4]:
+                    print(f'[EVT][WARN] record #{r[0]} idx mismatch ({r[4]})')
+            self.recs += recs
+            self.next = first + len(recs)
+            if not recs or self.next >= wr:
+                return
+
+
+def to_us(recs, sysclk):
+    """Метки CYCCNT (32 бита) -> мкс от первой записи; запись может опередить предыдущую на десятки циклов"""
+    out, t, prev = [], 0, None
+    mhz = (sysclk or 1) / 1e6
+    for r in recs:
+        if prev is not None:
+            d = (r[1] - prev) & 0xFFFFFFFF
+            if d >= 1 << 31:
+                d -= 1 << 32
+            t += d
+        prev = r[1]
+        out.append((t / mhz,) + tuple(r))
+    return out
+
+
+def describe(ev, seq, arg):
+    s = '' if seq == SEQ_NONE else f'seq={seq}'
+    if ev == 8:
+        return f'{s} {UNSTICK.get(arg & 0xFF, arg & 0xFF)} after {arg >> 8} ms'.strip()
+    if ev == 9:
+        return f'cmd=0x{arg & 0xFF:02X} len={arg >> 8}'
+    if ev == 3:
+        return f'seq={seq} adc={arg}' if seq != SEQ_NONE else f'TORN adc={arg}'
+    return f'{s} arg={arg}'.strip()
+
+
+def print_timeline(evs):
+    prev = None
+    for t, n, cyc, seq, arg, idx, ev, ctx in evs:
+        dt = 0.0 if prev is None else t - prev
+        prev = t
+        print(f'{t:12.2f} {dt:+9.2f}  {CTX.get(ctx, f"exc{ctx}"):<8} {EVENTS.get(ev, ev):<10} {describe(ev, seq, arg)}')
+
+
+def frame_rows(frames):
+    rows = []
+    for seq, f in frames.items():
+        if 'tx' not in f or 'cplt' not in f:
+            continue
+        have_tc, have_pb = f['tc'] is not None, f['pb'] is not None
+        rows.append({'seq': seq,
+                     'adc_wait': f['pb'] - f['tc'] if have_tc and have_pb else None,
+                     'prep': f['pe'] - f['pb'] if have_pb else None,
+                     'txq_wait': f['tx'] - f['pe'],
+                     'usb': f['cplt'] - f['tx'],
+                     'total': f['cplt'] - f['tc'] if have_tc else None})
+    return rows
+
+
+def frame_latency(evs):
+    """Задержки по seq пары; START (CMD 0x20) обнуляет нумерацию пар и кадров АЦП"""
+    rows, frames, tc, pb = [], {}, {}, {}
+    for t, n, cyc, seq, arg, idx, ev, ctx in evs:
+        if ev == 9 and (arg & 0xFF) == CMD_START:
+            rows += frame_rows(frames)
+            frames, tc, pb = {}, {}, {}
+        elif ev == 1:
+            tc[seq] = t
+        elif ev == 2:
+            pb[seq] = t
+        elif ev == 3 and seq != SEQ_NONE:
+            frames[seq] = {'tc': tc.get(arg), 'pb': pb.get(arg), 'pe': t}
+        elif ev == 4 and seq in frames:
+            frames[seq].setdefault('tx', t)
+        elif ev == 7 and seq in frames:
+            frames[seq]['cplt'] = t
+    return rows + frame_rows(frames)
+
+
+def print_summary(rows):
+    print(f'[EVT] frames with full path: {len(rows)}')
+    print(f'  {"stage":<9} {"n":>6} {"min":>9} {"mean":>9} {"p50":>9} {"p99":>9} {"max":>9}  us')
+    for st in STAGES:
+        v = sorted(r[st] for r in rows if r[st] is not None)
+        if not v:
+            continue
+        p = lambda q: v[min(len(v) - 1, int(q * len(v)))]
+        print(f'  {st:<9} {len(v):>6} {v[0]:9.2f} {sum(v) / len(v):9.2f} {p(0.5):9.2f} {p(0.99):9.2f} {v[-1]:9.2f}')
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Журнал событий тракта АЦП -> USB (VND_CMD_GET_EVENTS)')
+    ap.add_argument('--start', action='store_true', help='послать START перед чтением и STOP после')
+    ap.add_argument('--seconds', type=float, default=0.0, help='читать кольцо непрерывно N секунд')
+    ap.add_argument('--period', type=float, default=0.02, help='период опроса, с')
+    ap.add_argument('--timeline', action='store_true', help='печатать события')
+    ap.add_argument('--csv', help='задержки по кадрам в CSV')
+    ap.add_argument('--save', help='сохранить записи (сырые, 4 байта номер + 16 байт запись)')
+    ap.add_argument('--load', help='разобрать сохранённые записи вместо устройства')
+    ap.add_argument('--sysclk', type=int, default=550000000, help='такт CYCCNT для --load, Гц')
+    args = ap.parse_args()
+
+    if args.load:
+        data = open(args.load, 'rb').read()
+        sz = 4 + EVT_REC.size
+        recs = [struct.unpack_from('<I', data, o) + EVT_REC.unpack_from(data, o + 4) for o in range(0, len(data) - sz + 1, sz)]
+        sysclk = args.sysclk
+    else:
+        import usb.core
+        dev = usb.core.find(idVendor=VID, idProduct=PID)
+        if dev is None:
+            print('[EVT] device not found')
+            return 1
+        try:
+            if args.start:
+                dev.write(EP_OUT, bytes([CMD_START]), timeout=500)
+            col = Collector(dev)
+            t_end = time.time() + args.seconds
+            col.poll()
+            while time.time() < t_end:
+                time.sleep(args.period)
+                col.poll()
+        except (IOError, usb.core.USBError) as e:
+            print(f'[EVT] read failed: {e}')
+            return 1
+        finally:
+            if args.start:
+                try:
+                    dev.write(EP_OUT, bytes([CMD_STOP]), timeout=500)
+                except usb.core.USBError:
+                    pass
+        recs, sysclk = col.recs, col.sysclk
+        print(f'[EVT] {len(recs)} events, overwritten before read: {col.gaps}, sysclk={sysclk} Hz')
+        if args.save:
+            with open(args.save, 'wb') as f:
+                for r in recs:
+                    f.write(struct.pack('<I', r[0] & 0xFFFFFFFF) + EVT_REC.pack(*r[1:]))
+
+    evs = to_us(recs, sysclk)
+    if args.timeline:
+        print_timeline(evs)
+    rows = frame_latency(evs)
+    print_summary(rows)
+    if args.csv:
+        with open(args.csv, 'w') as f:
+            f.write('seq,' + ','.join(STAGES) + '\n')
+            for r in rows:
+                f.write(f"{r['seq']}," + ','.join('' if r[s] is None else f'{r[s]:.2f}' for s in STAGES) + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+# Профиль участков горячего пути прошивки (Core/Inc/cyc_prof.h, USBprotocol.txt §4.18): число входов,
+# min/среднее/max в циклах и мкс, доля времени CPU и гистограмма log2 циклов по каждому участку.
+# Запуск (стрим запускается отдельно, например vendor_stream_read.py):
+#   python HostTools/prof_report.py                  — профиль с последнего сброса
+#   python HostTools/prof_report.py --window 5       — сбросить, подождать 5 с под нагрузкой, прочитать
+#   python HostTools/prof_report.py --reset          — прочитать и сбросить
+#   python HostTools/prof_report.py --hist           — печатать гистограммы
+
+import argparse, struct, sys, time
+import usb.core, usb.util
+
+VID = 0xCAFE
+PID = 0x4001
+VND_CMD_GET_PROF = 0x34
+VND_CMD_PROF_RESET = 0x35
+PROF_HDR = struct.Struct('<BBBBII')  # version, zones, bins, rec_size, sysclk_hz, elapsed_ms
+PROF_REC = struct.Struct('<8sIIIQ')  # name, count, min, max, sum (+ bins x u32)
+
+
+def ctrl_get_prof(dev, reset=False):
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, VND_CMD_GET_PROF, 1 if reset else 0, 0, 1024, timeout=500))
+    if len(ba) < PROF_HDR.size:
+        return None
+    ver, zones, bins, rsz, sysclk, elapsed = PROF_HDR.unpack_from(ba)
+    if ver != 1 or len(ba) < PROF_HDR.size + zones * rsz:
+        return None
+    out = {'sysclk': sysclk, 'elapsed_ms': elapsed, 'zones': []}
+    for i in range(zones):
+        off = PROF_HDR.size + i * rsz
+        name, count, mn, mx, total = PROF_REC.unpack_from(ba, off)
+        hist = struct.unpack_from(f'<{bins}I', ba, off + PROF_REC.size)
+        out['zones'].append({'name': name.rstrip(b'\0').decode(), 'count': count, 'min': mn, 'max': mx,
+                             'sum': total, 'hist': hist})
+    return out
+
+
+def ctrl_prof_reset(dev):
+    bm = usb.util.build_request_type(usb.util.CTRL_OUT, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    dev.ctrl_transfer(bm, VND_CMD_PROF_RESET, 0, 0, None, timeout=500)
+
+
+def print_prof(p, show_hist):
+    mhz = (p['sysclk'] or 1) / 1e6
+    wall = p['elapsed_ms'] * 1e-3 * (p['sysclk'] or 1)
+    print(f"[PROF] {p['elapsed_ms']} ms since reset, sysclk={p['sysclk']} Hz")
+    print(f"  {'zone':<9} {'count':>9} {'min':>8} {'mean':>9} {'max':>9} cyc   {'mean':>8} {'max':>9} us  {'cpu%':>6}")
+    for z in p['zones']:
+        n = z['count']
+        mean = z['sum'] / n if n else 0.0
+        cpu = 100.0 * z['sum'] / wall if wall else 0.0
+        print(f"  {z['name']:<9} {n:>9} {z['min']:>8} {mean:>9.0f} {z['max']:>9}       "
+              f"{mean / mhz:>8.2f} {z['max'] / mhz:>9.2f}     {cpu:>6.2f}")
+    if not show_hist:
+        return
+    for z in p['zones']:
+        if not z['count']:
+            continue
+        print(f"[PROF] {z['name']} cycles histogram (log2)")
+        top = max(z['hist'])
+        last = len(z['hist']) - 1
+        for k, c in enumerate(z['hist']):
+            if not c:
+                continue
+            rng = f'>= {1 << k}' if k == last else f'{1 << k}..{(1 << (k + 1)) - 1}'
+            print(f"  {rng:>17} {c:>9} {'#' * max(1, round(40 * c / top))}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Профиль участков горячего пути (VND_CMD_GET_PROF)')
+    ap.add_argument('--window', type=float, default=0.0, help='сбросить, ждать N секунд, прочитать')
+    ap.add_argument('--reset', action='store_true', help='сбросить профиль после чтения')
+    ap.add_argument('--hist', action='store_true', help='печатать гистограммы')
+    args = ap.parse_args()
+    dev = usb.core.find(idVendor=VID, idProduct=PID)
+    if dev is None:
+        print('[PROF] device not found')
+        return 1
+    try:
+        if args.window > 0:
+            ctrl_prof_reset(dev)
+            time.sleep(args.window)
+        p = ctrl_get_prof(dev, args.reset)
+    except usb.core.USBError as e:
+        print(f'[PROF] request failed: {e}')
+        return 1
+    if p is None:
+        print('[PROF] bad reply')
+        return 1
+    print_prof(p, args.hist)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,102 @@
+/* Хостовый замер стоимости копии кадра vendor перед передачей: до zero-copy (USBD_VND_Transmit ->
+   vnd_tx_next_chunk с vnd_tx_bounce) и после (USBD_VND_TransmitZC: в LL уходит
+   указатель на кадр пула, копии нет). Куски и копию делают те же vnd_tx_chunk_len и
+   vnd_tx_chunk_bounce (Core/Src/vnd_tx_chunk.c), что и vnd_tx_next_chunk: куски до VND_TX_CHUNK_MAX
+   байт из кадра пула в bounce-буфер, выровненный на 32. Кадр — заголовок 32 байта + 2*N отсчётов
+   для профилей A..D. Это стоимость на хостовом CPU (нс и, на x86, такты TSC); на M7 ту же разницу
+   вместе с очисткой D-Cache меряет страница PERF (copy_* / zc_*, vendor_ctrl_status.py).
+   Сборка и запуск (из корня репозитория):
+     gcc -O2 -Wall -Wextra -I HostTools/tests/host -I Core/Inc -o bench_tx_copy \
+         HostTools/tests/bench_tx_copy.c Core/Src/vnd_tx_chunk.c
+     ./bench_tx_copy [кадров на размер]
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "vnd_tx_chunk.h"
+
+#define FRAME_HDR        32u
+#define POOL_FRAMES      8u     /* кадры пула по очереди, как A/B пар в g_frames */
+
+static uint8_t pool[POOL_FRAMES][FRAME_HDR + 2u * 1360u] __attribute__((aligned(32)));
+static uint8_t tx_buf[VND_TX_CHUNK_MAX] __attribute__((aligned(32)));
+static volatile const uint8_t *ll_ptr;  /* «USBD_LL_Transmit»: получает указатель куска */
+static volatile uint32_t ll_bytes;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t ticks(void)
+{
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* До: каждый кусок копируется в bounce-буфер и уходит оттуда */
+static void send_copy(const uint8_t *src, uint32_t len)
+{
+    for(uint32_t q = 0; q < len; ){
+        uint32_t n = vnd_tx_chunk_len(len, q);
+        const uint8_t *p = vnd_tx_chunk_bounce(tx_buf, src + q, n);
+        __asm__ volatile("" ::: "memory"); /* копия не выбрасывается: её читает «DMA/FIFO» */
+        ll_ptr = p; ll_bytes = n;
+        q += n;
+    }
+}
+
+/* После: в LL уходит сам кадр пула */
+static void send_zc(const uint8_t *src, uint32_t len)
+{
+    for(uint32_t q = 0; q < len; ){
+        uint32_t n = vnd_tx_chunk_len(len, q);
+        ll_ptr = src + q; ll_bytes = n;
+        q += n;
+    }
+}
+
+static void run(void (*send)(const uint8_t *, uint32_t), uint32_t len, uint32_t frames,
+                double *ns_out, double *tk_out)
+{
+    for(uint32_t f = 0; f < 1000u; f++) send(pool[f % POOL_FRAMES], len); /* прогрев */
+    uint64_t t0 = now_ns(), k0 = ticks();
+    for(uint32_t f = 0; f < frames; f++) send(pool[f % POOL_FRAMES], len);
+    uint64_t k1 = ticks(), t1 = now_ns();
+    *ns_out = (double)(t1 - t0) / frames;
+    *tk_out = (double)(k1 - k0) / frames;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 200000u;
+    static const struct { const char *prof; uint32_t n; } sizes[] = {
+        { "A", 1360u }, { "B", 912u }, { "C", 944u }, { "D", 976u },
+    };
+    for(uint32_t f = 0; f < POOL_FRAMES; f++)
+        for(uint32_t i = 0; i < sizeof(pool[0]); i++) pool[f][i] = (uint8_t)(f * 31u + i);
+
+    printf("[TXBENCH] per frame, %u frames per size, %s\n", frames, HAVE_TSC ? "ns and TSC ticks" : "ns");
+    printf("  prof  bytes   copy ns  zc ns   copy tsc  zc tsc\n");
+    for(uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+        uint32_t len = FRAME_HDR + 2u * sizes[s].n;
+        double cn, ct, zn, zt;
+        run(send_copy, len, frames, &cn, &ct);
+        run(send_zc, len, frames, &zn, &zt);
+        printf("  %-4s  %5u  %8.1f %6.1f  %8.0f %7.0f\n", sizes[s].prof, len, cn, zn, ct, zt);
+    }
+    return 0;
+}
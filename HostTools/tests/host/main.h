@@ -0,0 +1,22 @@
+/* Заглушка Core/Inc/main.h для хостовых тестов (HostTools/tests): модули Core/Src без HAL собираются
+   хостовым gcc с -I HostTools/tests/host впереди -I Core/Inc. Только то, что им нужно: размеры кольца
+   (совпадают с Core/Inc/main.h), атрибуты размещения в TCM, барьер и счётчик DWT (всегда 0). */
+#ifndef HOST_TEST_MAIN_H
+#define HOST_TEST_MAIN_H
+
+#include <stdint.h>
+
+#define MAX_FRAME_SAMPLES 1360u
+#define FIFO_FRAMES       8u
+
+#define ITCM_FUNC
+#define DTCM_BSS
+
+/* DMB на хосте — полный барьер: поток-«DMA» и потребитель в тестах идут на разных ядрах */
+#define __DMB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+typedef struct { volatile uint32_t CYCCNT; } host_dwt_t;
+static host_dwt_t host_dwt __attribute__((unused));
+#define DWT (&host_dwt)
+
+#endif /* HOST_TEST_MAIN_H */
@@ -0,0 +1,36 @@
+#!/bin/sh
+# Хостовые тесты чистых модулей прошивки (без HAL): сборка хостовым gcc и запуск.
+# Запуск из любого каталога: sh HostTools/tests/run_host_tests.sh
+# Сборка — во временный каталог; код возврата не 0, если хоть один тест не собрался или упал.
+set -u
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+CC=${CC:-gcc}
+CFLAGS="-O2 -Wall -Wextra -I $ROOT/HostTools/tests/host -I $ROOT/Core/Inc"
+FAILED=0
+
+run() {
+    name=$1; shift
+    if ! $CC $CFLAGS -o "$OUT/$name" "$@"; then
+        echo "[HOST-TEST] $name: build failed"; FAILED=1; return
+    fi
+    if "$OUT/$name"; then echo "[HOST-TEST] $name: ok"; else echo "[HOST-TEST] $name: FAILED"; FAILED=1; fi
+}
+
+run test_frame_rice "$ROOT/HostTools/tests/test_frame_rice.c" "$ROOT/Core/Src/frame_rice.c" \
+    "$ROOT/HostTools/frame_rice_decode.c" -lm
+run test_adc_ring "$ROOT/HostTools/tests/test_adc_ring.c" "$ROOT/Core/Src/adc_ring.c" -lpthread
+run test_lockin "$ROOT/HostTools/tests/test_lockin.c" "$ROOT/Core/Src/lockin.c"
+run test_adc_phase "$ROOT/HostTools/tests/test_adc_phase.c" "$ROOT/Core/Src/adc_phase.c"
+run test_frame_zone "$ROOT/HostTools/tests/test_frame_zone.c" "$ROOT/Core/Src/frame_zone.c"
+
+# Замеры: печатают таблицу, на результат не влияют
+bench() {
+    name=$1; shift
+    if $CC $CFLAGS -o "$OUT/$name" "$@"; then "$OUT/$name" 20000; else echo "[HOST-TEST] $name: build failed"; FAILED=1; fi
+}
+
+bench bench_tx_copy "$ROOT/HostTools/tests/bench_tx_copy.c" "$ROOT/Core/Src/vnd_tx_chunk.c"
+
+exit $FAILED
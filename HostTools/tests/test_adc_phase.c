@@ -0,0 +1,228 @@
+/* Проверка арифметики фазы меандра (Core/Src/adc_phase.c) на модели таймеров и DMA:
+     - adc_edge_pick: фронты каждые P отсчётов, поток кадров по n отсчётов, ISR TC с задержкой разбирает
+       записи кольца захвата (NDTR в момент фронта). Фронт, попавший в следующий банк до чтения кольца
+       («фронт перед кадром» для разбора следующего TC), и записи другого N обязаны отбрасываться; индексы
+       кольца проходят через конец (ADC_EDGE_RING). Найденный фронт обязан быть точным, не найденный —
+       только если в кадре не было фронта, не разобранного прошлым TC, или он у начала банка (NDTR записи
+       не ниже NDTR в ISR — не отличить от фронта следующего банка).
+     - adc_phase_counters: такты TIM15/TIM2 с делителями, P*T15 = T2, задержки преобразования и DMA,
+       чтения CNT15, CNT2, NDTR, CNT15 в ISR с разбросом; период меандра переходит через 0 между
+       последним триггером и первым отсчётом кадра. Ответ — точная фаза или -1 (триггер между чтениями,
+       отсчёт ещё не в NDTR); -1 только в этих случаях.
+   Сборка и запуск (из корня репозитория, все тесты — HostTools/tests/run_host_tests.sh):
+     gcc -O2 -Wall -Wextra -I HostTools/tests/host -I Core/Inc -o test_adc_phase \
+         HostTools/tests/test_adc_phase.c Core/Src/adc_phase.c
+     ./test_adc_phase [кадров на случай] [seed]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "main.h"
+#include "adc_phase.h"
+
+#define DMA_TICKS 64u   /* ADC_PHASE_DMA_TICKS (adc_stream.c) */
+
+static uint32_t rng = 1u;
+static uint32_t rnd(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+static uint32_t fails;
+
+/* Разобрать фиксированное кольцо: ожидаемый индекс и число неоднозначных записей */
+static void edge_case(const char *name, const uint32_t *vals, uint32_t cnt, uint32_t rd, uint32_t ndtr, uint32_t n,
+                      int32_t want, uint32_t want_amb)
+{
+    static uint32_t ring[ADC_EDGE_RING];
+    for(uint32_t i = 0; i < ADC_EDGE_RING; i++) ring[i] = 0xDEAD0000u | (rnd() & 0xFFFFu);
+    for(uint32_t i = 0; i < cnt; i++) ring[(rd + i) & (ADC_EDGE_RING - 1u)] = vals[i];
+    uint32_t amb = 0;
+    int32_t got = adc_edge_pick(ring, rd, (rd + cnt) & (ADC_EDGE_RING - 1u), ndtr, n, &amb);
+    if(got != want || amb != want_amb){
+        printf("[FAIL] edge %s: idx=%d amb=%u, expected %d %u\n", name, got, amb, want, want_amb);
+        fails++;
+    }
+}
+
+static void edge_fixed(void)
+{
+    /* n=100, ISR пришёл, когда в следующий банк легло 5 отсчётов: NDTR=95 */
+    static const uint32_t one[] = { 60 };                 /* фронт на отсчёте 40 кадра */
+    static const uint32_t two[] = { 90, 30 };             /* два фронта: берётся последний (70) */
+    static const uint32_t next[] = { 30, 97, 95 };        /* последние две — уже следующий банк */
+    static const uint32_t only_next[] = { 100, 98 };      /* фронт у начала следующего банка: кадр без фронта */
+    static const uint32_t old_n[] = { 50, 150, 0 };       /* запись прежнего N=200 и пустая запись */
+    static const uint32_t first[] = { 100 };              /* первый отсчёт кадра: как первый следующего банка */
+    static const uint32_t last[] = { 1 };                 /* фронт на последнем отсчёте кадра */
+    edge_case("one", one, 1, 10, 95, 100, 40, 0);
+    edge_case("two", two, 2, 10, 95, 100, 70, 0);
+    edge_case("next bank", next, 3, 10, 95, 100, 70, 2);
+    edge_case("only next bank", only_next, 2, 10, 95, 100, -1, 2);
+    edge_case("other N", old_n, 3, 10, 95, 100, 50, 2);
+    edge_case("first sample", first, 1, 10, 95, 100, -1, 1);
+    edge_case("last sample", last, 1, 10, 95, 100, 99, 0);
+    edge_case("empty", NULL, 0, 10, 95, 100, -1, 0);
+    /* N вырос до 200 на этом TC: активный банк длиннее кадра, NDTR=190; запись 150 — не из кадра n=100 */
+    static const uint32_t grown[] = { 40, 150 };
+    edge_case("N grew", grown, 2, 10, 190, 100, 60, 1);
+    /* Те же записи через конец кольца */
+    edge_case("next bank, wrap", next, 3, ADC_EDGE_RING - 2u, 95, 100, 70, 2);
+    edge_case("two, wrap", two, 2, ADC_EDGE_RING - 1u, 95, 100, 70, 0);
+}
+
+/* Поток: фронт на отсчётах e с (e + ph0) % P == 0; ISR кадра f видит L_f = (f+1)n + lat отсчётов */
+static void edge_stream(uint32_t frames)
+{
+    static uint32_t ring[ADC_EDGE_RING];
+    uint32_t found = 0, none = 0, cases = 0;
+    for(uint32_t c = 0; c < 40u; c++){
+        uint32_t n = 16u + rnd() % (MAX_FRAME_SAMPLES - 15u);
+        uint32_t pmin = n / (ADC_EDGE_RING - 8u) + 4u;        /* фронтов на кадр меньше кольца (s_edge_ok) */
+        uint32_t p = pmin + rnd() % (c & 1u ? 64u : 2048u);
+        uint32_t ph0 = rnd() % p;
+        uint32_t lat_max = 1u + rnd() % (n / 2u);
+        uint32_t w = rnd() % ADC_EDGE_RING, rd = w;
+        uint32_t e = (p - ph0) % p;                           /* следующий фронт (отсчёт) */
+        int64_t consumed = -1;                                /* фронты e <= consumed разобраны прошлым TC */
+        for(uint32_t f = 0; f < frames; f++){
+            uint32_t lat = rnd() % lat_max;
+            uint32_t seen = (f + 1u) * n + lat;               /* отсчётов легло к чтению позиции кольца */
+            /* Захват: фронт e записывается, когда в DMA легли отсчёты 0..e-1 — NDTR банка фронта */
+            for(; e <= seen; e += p) ring[w++ & (ADC_EDGE_RING - 1u)] = n - (e % n);
+            w &= ADC_EDGE_RING - 1u;
+            uint32_t ndtr = n - lat - rnd() % 3u;             /* NDTR читается после позиции кольца */
+            uint32_t amb = 0;
+            int32_t got = adc_edge_pick(ring, rd, w, ndtr, n, &amb);
+            rd = w;
+            /* Ожидание: последний фронт кадра f, если прошлый TC его ещё не видел и его NDTR ниже ndtr
+               (у начала банка запись не отличить от фронта следующего банка — только -1) */
+            uint32_t lo = f * n, hi = (f + 1u) * n;
+            uint32_t r = (hi - 1u + ph0) % p;                 /* отсчётов от последнего фронта до конца кадра */
+            int32_t want = -1;
+            if(r <= hi - 1u - lo && (int64_t)(hi - 1u - r) > consumed && r + 1u < ndtr)
+                want = (int32_t)(hi - 1u - r - lo);
+            consumed = seen;
+            if(got != want){
+                printf("[FAIL] edge stream n=%u P=%u ph0=%u frame %u: idx=%d expected %d (amb=%u)\n",
+                       n, p, ph0, f, got, want, amb);
+                fails++;
+                break;
+            }
+            if(got >= 0){
+                found++;
+                uint32_t k0 = adc_phase_from_edge((uint32_t)got, p);
+                if(k0 != (lo + ph0) % p){
+                    printf("[FAIL] edge stream n=%u P=%u frame %u: phase %u expected %u\n", n, p, f, k0, (lo + ph0) % p);
+                    fails++;
+                    break;
+                }
+            } else {
+                none++;
+            }
+        }
+        cases++;
+    }
+    printf("[PHASE] edge ring: %u streams, %u frames with edge, %u without\n", cases, found, none);
+    if(!found || !none){
+        printf("[FAIL] edge stream did not exercise both outcomes\n");
+        fails++;
+    }
+}
+
+/* Такты таймеров: отсчёт g — триггер в g*T15, фаза (g + ph0) % P (период TIM2 = P*T15 с начала в -ph0*T15) */
+static void counters_stream(uint32_t frames)
+{
+    uint32_t measured = 0, rejected = 0, cases = 0;
+    for(uint32_t c = 0; c < 200u; c++){
+        adc_phase_geom_t geo;
+        geo.div15 = 1u + rnd() % 4u;
+        uint32_t arr15 = 40u + rnd() % 400u;
+        geo.t15 = geo.div15 * arr15;
+        uint32_t p = 4u + rnd() % 600u;
+        uint64_t t2 = (uint64_t)p * geo.t15;
+        /* Делитель TIM2 — делитель T2, чтобы ARR был целым */
+        geo.div2 = 1u;
+        for(uint32_t tries = 0; tries < 16u; tries++){
+            uint32_t d = 1u + rnd() % 8u;
+            if(t2 % d == 0u){ geo.div2 = d; break; }
+        }
+        if(geo.t15 <= geo.div15 + geo.div2 + 32u) continue;     /* условие s_ph_cnt */
+        uint32_t conv = 1u + rnd() % (geo.t15 - 1u);            /* преобразование, тактов */
+        geo.guard = ((conv < geo.t15) ? conv : geo.t15) + DMA_TICKS;
+        uint32_t n = 4u + rnd() % (MAX_FRAME_SAMPLES - 3u);
+        uint32_t ph0 = rnd() % p;
+        uint64_t base = (uint64_t)ph0 * geo.t15;               /* период, содержащий отсчёт 0, начался в -base */
+        uint32_t lag = conv + rnd() % DMA_TICKS;               /* триггер -> отсчёт в NDTR (< guard) */
+        for(uint32_t f = 0; f < frames; f++){
+            /* TC кадра f: лёг последний отсчёт (f+1)n-1; ISR — с задержкой до 3 отсчётов */
+            uint64_t tr = (uint64_t)((f + 1u) * n - 1u) * geo.t15 + lag + rnd() % (3u * geo.t15);
+            uint64_t t_c15 = tr, t_c2 = tr + rnd() % 4u, t_nd = t_c2 + rnd() % 4u, t_c15b = t_nd + rnd() % 4u;
+            /* CNT: такты от последнего триггера / от начала периода, через делитель */
+            uint32_t c15 = (uint32_t)((t_c15 % geo.t15) / geo.div15);
+            uint32_t c2 = (uint32_t)(((t_c2 + base) % t2) / geo.div2);
+            uint32_t c15b = (uint32_t)((t_c15b % geo.t15) / geo.div15);
+            /* Отсчёт g в NDTR, если g*T15 + lag <= t */
+            uint64_t landed = (t_nd - lag) / geo.t15 + 1u;
+            uint64_t in_bank = landed - (uint64_t)(f + 1u) * n;
+            if(in_bank >= n) continue;                          /* ISR опоздал на целый кадр */
+            uint32_t ndtr = n - (uint32_t)in_bank;
+            int32_t got = adc_phase_counters(&geo, p, n, n, c15, c2, ndtr, c15b);
+            uint32_t want = (uint32_t)(((uint64_t)f * n + ph0) % p);
+            if(got < 0){
+                /* -1 допустим только при триггере между чтениями или раньше запаса guard */
+                if(c15b >= c15 && c15 * geo.div15 >= geo.guard){
+                    printf("[FAIL] counters P=%u n=%u frame %u: rejected with c15=%u c15b=%u guard=%u\n",
+                           p, n, f, c15, c15b, geo.guard);
+                    fails++;
+                    break;
+                }
+                rejected++;
+                continue;
+            }
+            measured++;
+            if((uint32_t)got != want){
+                printf("[FAIL] counters P=%u n=%u T15=%u div15=%u div2=%u conv=%u frame %u: k=%d expected %u "
+                       "(c15=%u c2=%u ndtr=%u c15b=%u)\n", p, n, geo.t15, geo.div15, geo.div2, conv, f, got, want,
+                       c15, c2, ndtr, c15b);
+                fails++;
+                break;
+            }
+        }
+        cases++;
+    }
+    printf("[PHASE] counters: %u geometries, %u frames measured, %u rejected\n", cases, measured, rejected);
+    if(!measured){
+        printf("[FAIL] counters measured too few frames\n");
+        fails++;
+    }
+}
+
+/* Переход периода через 0: последний триггер у начала периода, первый отсчёт кадра — в прошлом */
+static void counters_fixed(void)
+{
+    adc_phase_geom_t geo = { 100u, 1u, 1u, 20u };
+    /* P=10, n=25: ISR через 50 тактов после триггера k_r=2 (c2=250 от начала периода), NDTR=24:
+       в новом банке 1 отсчёт, первый отсчёт кадра — 2 - 1 - 24 = -23 ≡ 7 (mod 10) */
+    int32_t k = adc_phase_counters(&geo, 10u, 25u, 25u, 50u, 250u, 24u, 50u);
+    if(k != 7){ printf("[FAIL] counters wrap: k=%d expected 7\n", k); fails++; }
+    /* Триггер между чтениями CNT15 (c15b < c15) и отсчёт ещё не в NDTR (since < guard) — -1 */
+    if(adc_phase_counters(&geo, 10u, 25u, 25u, 50u, 250u, 24u, 3u) != -1){ printf("[FAIL] counters: c15b < c15 accepted\n"); fails++; }
+    if(adc_phase_counters(&geo, 10u, 25u, 25u, 10u, 210u, 24u, 10u) != -1){ printf("[FAIL] counters: since < guard accepted\n"); fails++; }
+    if(adc_phase_counters(&geo, 10u, 25u, 25u, 50u, 250u, 26u, 50u) != -1){ printf("[FAIL] counters: ndtr > cur accepted\n"); fails++; }
+    /* k_r = 0 у самого начала периода: e без +P*T15 было бы отрицательным */
+    k = adc_phase_counters(&geo, 10u, 25u, 25u, 30u, 30u, 25u, 30u);
+    if(k != 6){ printf("[FAIL] counters k_r=0: k=%d expected 6\n", k); fails++; }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 2000u;
+    rng = (argc > 2) ? ((uint32_t)strtoul(argv[2], NULL, 0) | 1u) : 0x5EED1u;
+    edge_fixed();
+    counters_fixed();
+    edge_stream(frames);
+    counters_stream(frames);
+    printf("[PHASE] %u failures\n", fails);
+    return fails ? 1 : 0;
+}
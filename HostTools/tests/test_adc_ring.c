@@ -0,0 +1,139 @@
+/* Нагрузочный тест кольца кадров АЦП (Core/Src/adc_ring.c) на двух потоках:
+     - поток «DMA+ISR» пишет кадр seq в слот seq & (FIFO_FRAMES-1) по отсчёту и на «TC» повторяет
+       шаги HAL_ADC_ConvCpltCallback: adc_ring_ready(seq), adc_ring_to_dma(слот seq+2), adc_ring_publish(seq);
+     - поток-потребитель берёт кадры adc_stream_acquire (по порядку и latest), копирует слот, иногда
+       засыпает посреди копии (DMA успевает обогнать кольцо) и проверяет adc_stream_validate.
+   Провал: кадр, принятый validate, отличается от записанного (разорванный кадр прошёл проверку),
+   seq не растёт, или учёт не сходится: взято + overflow_drops + skipped = записано, целых + torn = взято.
+   Сборка и запуск (из корня репозитория, все тесты — HostTools/tests/run_host_tests.sh):
+     gcc -O2 -Wall -Wextra -I HostTools/tests/host -I Core/Inc -o test_adc_ring \
+         HostTools/tests/test_adc_ring.c Core/Src/adc_ring.c -lpthread
+     ./test_adc_ring [кадров] [seed]
+*/
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "main.h"
+#include "adc_ring.h"
+
+#define N 256u   /* отсчётов в кадре: меньше MAX_FRAME_SAMPLES, чтобы круг кольца был быстрым */
+
+static volatile uint16_t slots[FIFO_FRAMES][N];
+static volatile int writer_done = 0;
+static uint32_t total_frames;
+
+static inline uint16_t sample(uint32_t seq, uint32_t i) { return (uint16_t)(seq * 40503u + i * 7u); }
+
+static uint32_t rng = 1u;
+static uint32_t rnd(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+static void pause_us(long us)
+{
+    struct timespec ts = { 0, us * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+static void *writer(void *arg)
+{
+    (void)arg;
+    for(uint32_t seq = 0; seq < total_frames; seq++){
+        /* Слот seq отдан DMA на TC кадра seq-2 (слоты 0 и 1 — adc_ring_clear): пишем кадр */
+        volatile uint16_t *d = slots[seq & (FIFO_FRAMES - 1u)];
+        for(uint32_t i = 0; i < N; i++) d[i] = sample(seq, i);
+        /* TC: порядок как в HAL_ADC_ConvCpltCallback */
+        adc_ring_ready(seq);
+        adc_ring_to_dma((seq + 2u) & (FIFO_FRAMES - 1u), seq + 2u);
+        __DMB(); /* адрес банка пишется после поколения: DMA не начнёт слот раньше */
+        (void)adc_ring_publish(seq);
+        sched_yield(); /* темп «DMA»: на одном ядре потребитель успевает между кадрами */
+    }
+    __atomic_store_n(&writer_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    total_frames = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 200000u;
+    rng = (argc > 2) ? ((uint32_t)strtoul(argv[2], NULL, 0) | 1u) : 0x2468ACEu;
+    static uint16_t copy[N];
+    uint32_t taken = 0, intact = 0, skipped_sum = 0, ungets = 0, fails = 0;
+    uint32_t last = 0;
+    uint8_t have_last = 0;
+
+    adc_ring_clear();
+    pthread_t th;
+    if(pthread_create(&th, NULL, writer, NULL)){ printf("[FAIL] pthread_create\n"); return 1; }
+
+    for(;;){
+        int done = __atomic_load_n(&writer_done, __ATOMIC_ACQUIRE);
+        uint32_t seq, skipped = 0;
+        uint8_t latest = (rnd() & 3u) == 0u;
+        if(!adc_stream_acquire(&seq, &skipped, latest)){
+            if(done) break;
+            sched_yield();
+            continue;
+        }
+        skipped_sum += skipped;
+        if(!latest && skipped){
+            printf("[FAIL] seq %u: skipped=%u in order mode\n", seq, skipped);
+            fails++;
+        }
+        if(have_last && seq <= last){
+            printf("[FAIL] seq %u after %u\n", seq, last);
+            fails++;
+        }
+        /* Вернуть кадр (как сборка при нехватке места) — следующий acquire выдаст его же */
+        if((rnd() & 15u) == 0u){
+            adc_stream_unget(seq);
+            if(frame_rd_seq == seq){ ungets++; continue; }
+        }
+        have_last = 1; last = seq;
+        taken++;
+        const volatile uint16_t *s = slots[seq & (FIFO_FRAMES - 1u)];
+        uint32_t cut = (rnd() & 31u) == 0u ? rnd() % N : N;
+        for(uint32_t i = 0; i < N; i++){
+            if(i == cut) pause_us(20);  /* потребитель вытеснен посреди копии */
+            copy[i] = s[i];
+        }
+        if(!adc_stream_validate(seq)) continue;
+        intact++;
+        for(uint32_t i = 0; i < N; i++){
+            if(copy[i] != sample(seq, i)){
+                printf("[FAIL] seq %u passed validate but sample %u = 0x%04X, expected 0x%04X\n",
+                       seq, i, copy[i], sample(seq, i));
+                fails++;
+                break;
+            }
+        }
+        if((rnd() & 255u) == 0u) pause_us(50); /* потребитель отстал: переполнение кольца */
+    }
+    pthread_join(th, NULL);
+
+    printf("[RING] %u frames: taken=%u intact=%u torn=%u overflow=%u skipped=%u ungets=%u backlog_max=%u\n",
+           total_frames, taken, intact, frame_torn, frame_overflow_drops, skipped_sum, ungets, frame_backlog_max);
+    if(frame_wr_seq != total_frames || frame_rd_seq != total_frames){
+        printf("[FAIL] wr=%u rd=%u after drain\n", frame_wr_seq, frame_rd_seq);
+        fails++;
+    }
+    if(taken + frame_overflow_drops + skipped_sum != total_frames){
+        printf("[FAIL] taken + overflow + skipped = %u, written %u\n",
+               taken + frame_overflow_drops + skipped_sum, total_frames);
+        fails++;
+    }
+    if(intact + frame_torn != taken){
+        printf("[FAIL] intact + torn = %u, taken %u\n", intact + frame_torn, taken);
+        fails++;
+    }
+    /* Паузы потребителя обязаны довести кольцо до разрывов и переполнений, иначе тест ничего не проверил */
+    if(total_frames >= 100000u && (!frame_torn || !frame_overflow_drops || !intact)){
+        printf("[FAIL] torn/overflow paths not exercised\n");
+        fails++;
+    }
+    return fails ? 1 : 0;
+}
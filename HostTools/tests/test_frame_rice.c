@@ -0,0 +1,128 @@
+/* Проверка кодера сжатия payload (Core/Src/frame_rice.c) против хостового декодера
+   (HostTools/frame_rice_decode.c): на каждом кадре
+     - длина сжатого payload кратна 4 и меньше cap (иначе кодер обязан вернуть 0);
+     - распаковка даёт исходные отсчёты бит в бит;
+     - кодер не пишет за cap, в том числе при cap меньше несжатого payload.
+   Сигналы синтетические (тишина, синус с шумом, меандр, белый шум, переходы через 0/0xFFFF),
+   в конце печатается их степень сжатия — на реальных сигналах она меряется страницей COMP.
+   Сборка и запуск (из корня репозитория, все тесты — HostTools/tests/run_host_tests.sh):
+     gcc -O2 -Wall -Wextra -I HostTools/tests/host -I Core/Inc -o test_frame_rice \
+         HostTools/tests/test_frame_rice.c Core/Src/frame_rice.c HostTools/frame_rice_decode.c -lm
+     ./test_frame_rice [кадров] [seed]
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_rice.h"
+
+int frame_rice_decode(const uint8_t *src, uint32_t len, uint32_t nplanes, uint32_t n, uint16_t *out);
+
+#define GUARD      64u
+#define GUARD_BYTE 0xA5u
+
+enum { SIG_QUIET, SIG_SINE, SIG_MEANDER, SIG_NOISE, SIG_WRAP, SIG_COUNT };
+static const char *const sig_names[SIG_COUNT] = { "quiet", "sine+noise", "meander", "white noise", "wrap 0/FFFF" };
+
+static uint32_t rng = 1u;
+static uint32_t rnd(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+static void gen(uint16_t *x, uint32_t n, int sig)
+{
+    double ph = (rnd() % 1000u) * 0.001 * 2.0 * M_PI;
+    double w = 2.0 * M_PI / (double)(8u + rnd() % 200u);
+    uint32_t half = 4u + rnd() % 60u;
+    for(uint32_t i = 0; i < n; i++){
+        int32_t v;
+        switch(sig){
+        case SIG_QUIET:   v = 2048 + (int32_t)(rnd() % 7u) - 3; break;
+        case SIG_SINE:    v = 2048 + (int32_t)lrint(1500.0 * sin(ph + w * i)) + (int32_t)(rnd() % 33u) - 16; break;
+        case SIG_MEANDER: v = (((i / half) & 1u) ? 3000 : 1000) + (int32_t)(rnd() % 9u) - 4; break;
+        case SIG_NOISE:   v = (int32_t)(rnd() & 0xFFFFu); break;
+        default:          v = (int32_t)((i & 1u) ? 0xFFFFu - (rnd() % 4u) : rnd() % 4u); break;
+        }
+        x[i] = (uint16_t)v;
+    }
+}
+
+static int guard_ok(const uint8_t *buf, uint32_t cap)
+{
+    for(uint32_t i = 0; i < GUARD; i++) if(buf[cap + i] != GUARD_BYTE) return 0;
+    return 1;
+}
+
+#define N_MAX 1360u
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 20000u;
+    rng = (argc > 2) ? ((uint32_t)strtoul(argv[2], NULL, 0) | 1u) : 0x1234567u;
+    static const uint32_t fixed_n[] = { 1, 2, 31, 32, 33, 34, 64, 65, 912, 1360 };
+    const uint32_t nfixed = sizeof(fixed_n) / sizeof(fixed_n[0]);
+    static uint16_t src[2][N_MAX], dec[2 * N_MAX];
+    static uint8_t out[2 * N_MAX * 2 + GUARD];
+    uint64_t sig_in[SIG_COUNT] = { 0 }, sig_out[SIG_COUNT] = { 0 };
+    uint32_t sig_frames[SIG_COUNT] = { 0 }, sig_raw[SIG_COUNT] = { 0 };
+    uint32_t fails = 0, packed = 0, tight = 0;
+
+    for(uint32_t f = 0; f < frames; f++){
+        int sig = (int)(f % SIG_COUNT);
+        uint32_t n = (f / SIG_COUNT < nfixed) ? fixed_n[f / SIG_COUNT] : 1u + rnd() % N_MAX;
+        uint32_t np = 1u + (rnd() & 1u);
+        for(uint32_t c = 0; c < np; c++) gen(src[c], n, sig);
+        const uint16_t *const planes[2] = { src[0], src[1] };
+        uint32_t raw = np * n * 2u;
+        /* Каждый четвёртый кадр — с ёмкостью меньше несжатого payload: проверка границы записи */
+        uint32_t cap = ((f & 3u) == 3u) ? rnd() % (raw + 1u) : raw;
+        memset(out, GUARD_BYTE, cap + GUARD);
+        uint32_t len = frame_rice_encode(planes, np, n, out, cap);
+        if(!guard_ok(out, cap)){
+            printf("[FAIL] frame %u (%s n=%u planes=%u cap=%u): write past cap\n", f, sig_names[sig], n, np, cap);
+            fails++;
+            continue;
+        }
+        if(cap != raw){
+            tight++;
+            if(len && len >= cap){
+                printf("[FAIL] frame %u: len=%u >= cap=%u\n", f, len, cap);
+                fails++;
+            }
+            continue;
+        }
+        sig_frames[sig]++;
+        sig_in[sig] += raw;
+        sig_out[sig] += len ? len : raw;
+        if(!len){ sig_raw[sig]++; continue; }
+        packed++;
+        if((len & 3u) || len >= cap){
+            printf("[FAIL] frame %u (%s n=%u planes=%u): len=%u cap=%u\n", f, sig_names[sig], n, np, len, cap);
+            fails++;
+            continue;
+        }
+        int rc = frame_rice_decode(out, len, np, n, dec);
+        int same = (rc == 0);
+        for(uint32_t c = 0; same && c < np; c++) same = !memcmp(dec + c * n, src[c], n * 2u);
+        if(!same){
+            printf("[FAIL] frame %u (%s n=%u planes=%u): decode rc=%d, samples differ\n", f, sig_names[sig], n, np, rc);
+            fails++;
+        }
+    }
+
+    printf("[RICE] %u frames: %u compressed and bit-exact, %u with cap < raw, %u failures\n",
+           frames, packed, tight, fails);
+    for(int s = 0; s < SIG_COUNT; s++){
+        if(!sig_frames[s]) continue;
+        printf("  %-12s frames=%-6u raw=%-6u payload %5.1f%% of raw\n", sig_names[s], sig_frames[s], sig_raw[s],
+               100.0 * (double)sig_out[s] / (double)sig_in[s]);
+    }
+    /* Тишина и медленный сигнал обязаны сжиматься: иначе кодер сломан, даже если он «без потерь» */
+    if(sig_frames[SIG_QUIET] && sig_out[SIG_QUIET] * 2u > sig_in[SIG_QUIET]){
+        printf("[FAIL] quiet input compressed worse than 50%%\n");
+        fails++;
+    }
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+/* Проверка зон ROI кадра vendor (Core/Src/frame_zone.c):
+     - фиксированные случаи: округление мкс -> отсчёты (начало вниз, конец вверх), перекрытие соседних
+       зон после округления, обрезка по N, зоны вне кадра, «нет выигрыша -> cnt = 0» на самой границе;
+     - случайные зоны (отсчёты и мкс при разных Fs и N, пара A/B и стерео): отсчёты таблицы — ровно
+       объединение зон по модели «отсчёт i в зоне, если [i, i+1)/Fs задевает её», в пределах N, по
+       возрастанию без перекрытий; cnt = 0 только без выигрыша;
+     - сборка: frame_zone_gather пишет ровно samples отсчётов зон подряд (за ними буфер не тронут),
+       frame_zone_payload_bytes (размер кадра в vnd_frame_bytes) = таблица + собранные отсчёты * bps,
+       таблица начинается с {N, 0}.
+   Сборка и запуск (из корня репозитория, все тесты — HostTools/tests/run_host_tests.sh):
+     gcc -O2 -Wall -Wextra -I HostTools/tests/host -I Core/Inc -o test_frame_zone \
+         HostTools/tests/test_frame_zone.c Core/Src/frame_zone.c
+     ./test_frame_zone [случаев] [seed]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "frame_zone.h"
+
+#define GUARD 0xA5A5u
+
+static uint32_t rng = 1u;
+static uint32_t rnd(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+static uint32_t fails;
+
+/* Разрешить и сравнить таблицу с ожидаемой (want_cnt = 0 — кадр целиком) */
+static void zone_case(const char *name, const frame_zone_cfg_t *cfg, uint32_t k, uint8_t us, uint32_t fs,
+                      uint16_t n, uint32_t bps, const uint16_t (*want)[2], uint32_t want_cnt)
+{
+    frame_zone_map_t zr;
+    memset(&zr, 0x5A, sizeof(zr));
+    frame_zone_resolve(&zr, cfg, k, us, fs, n, bps);
+    int bad = zr.cnt != want_cnt;
+    uint32_t m = 0;
+    for(uint32_t z = 0; !bad && z < want_cnt; z++){
+        bad = zr.tab[z + 1u][0] != want[z][0] || zr.tab[z + 1u][1] != want[z][1];
+        m += want[z][1];
+    }
+    if(!bad && want_cnt) bad = zr.samples != m || zr.tab[0][0] != n || zr.tab[0][1] != 0u;
+    if(bad){
+        printf("[FAIL] zone %s: cnt=%u, expected %u:", name, zr.cnt, want_cnt);
+        for(uint32_t z = 1; z <= zr.cnt && z <= FRAME_ZONES_MAX; z++) printf(" {%u,%u}", zr.tab[z][0], zr.tab[z][1]);
+        printf("\n");
+        fails++;
+    }
+}
+
+static void zones_fixed(void)
+{
+    /* Fs = 1.5 МГц: 1 мкс = 1.5 отсчёта. Зона [1, 2) мкс задевает отсчёты 1 ([0.67, 1.33) мкс)
+       и 2 ([1.33, 2) мкс): начало 1.5 -> 1, конец 3.0 -> 3 */
+    static const frame_zone_cfg_t r1[] = { { 1u, 1u } };
+    static const uint16_t w1[][2] = { { 1u, 2u } };
+    zone_case("us rounding", r1, 1, 1u, 1500000u, 1000u, 2u, w1, 1);
+    /* Конец 3.3 мкс при 1 МГц -> 4 (вверх), начало 0.9 -> 0: зона [0.9, 3.3) мкс = отсчёты 0..3.
+       В мкс дробей нет, поэтому Fs = 10 МГц и зона [9, 33) «десятых»: те же 0..3 при 1 МГц */
+    static const frame_zone_cfg_t r2[] = { { 9u, 24u } };
+    static const uint16_t w2[][2] = { { 0u, 4u } };
+    zone_case("us floor/ceil", r2, 1, 1u, 100000u, 1000u, 2u, w2, 1);
+    /* Соседние зоны стыкуются после округления: [1, 2) и [2, 3) мкс при 1.5 МГц — отсчёты 1..2
+       и 3..4 (начало 3.0 -> 3), без перекрытия */
+    static const frame_zone_cfg_t r3[] = { { 1u, 1u }, { 2u, 1u } };
+    static const uint16_t w3[][2] = { { 1u, 2u }, { 3u, 2u } };
+    zone_case("us abut", r3, 2, 1u, 1500000u, 1000u, 2u, w3, 2);
+    /* Перекрытие после округления: [0, 1) и [1, 2) мкс при 1.4 МГц — 0..1 (1.4 -> 2) и 1..2
+       (начало 1.4 -> 1), второй срезается до отсчёта 2 */
+    static const frame_zone_cfg_t r4[] = { { 0u, 1u }, { 1u, 1u } };
+    static const uint16_t w4[][2] = { { 0u, 2u }, { 2u, 1u } };
+    zone_case("us overlap merge", r4, 2, 1u, 1400000u, 1000u, 2u, w4, 2);
+    /* Вторая зона целиком внутри первой после округления — пропускается: при 100 кГц [0, 5) мкс ->
+       отсчёт 0, [5, 8) -> тоже 0, [20, 21) -> отсчёт 2 */
+    static const frame_zone_cfg_t r5[] = { { 0u, 5u }, { 5u, 3u }, { 20u, 1u } };
+    static const uint16_t w5[][2] = { { 0u, 1u }, { 2u, 1u } };
+    zone_case("us swallowed", r5, 3, 1u, 100000u, 1000u, 2u, w5, 2);
+    /* Обрезка по N: зона через конец кадра, следующая за концом — отбрасывается */
+    static const frame_zone_cfg_t c1[] = { { 10u, 5u }, { 95u, 20u }, { 120u, 4u } };
+    static const uint16_t wc1[][2] = { { 10u, 5u }, { 95u, 5u } };
+    zone_case("clip N", c1, 3, 0u, 0u, 100u, 2u, wc1, 2);
+    /* Все зоны вне кадра */
+    static const frame_zone_cfg_t c2[] = { { 100u, 5u }, { 200u, 5u } };
+    zone_case("outside N", c2, 2, 0u, 0u, 100u, 2u, NULL, 0);
+    /* Огромные мкс: start + len и мкс * Fs не влезают в 32 бита — зона до конца кадра, дальняя — вне */
+    static const frame_zone_cfg_t o1[] = { { 10u, 0xFFFFFFFFu } };
+    static const uint16_t wo1[][2] = { { 10u, 90u } };
+    zone_case("us len overflow", o1, 1, 1u, 1000000u, 100u, 2u, wo1, 1);
+    static const frame_zone_cfg_t o2[] = { { 0u, 1u }, { 0xFFFFFFF0u, 0x100u } };
+    static const uint16_t wo2[][2] = { { 0u, 2u } };
+    zone_case("us start overflow", o2, 2, 1u, 2000000u, 100u, 2u, wo2, 1);
+    /* Нет выигрыша: таблица 4*(k+1) + m*bps против n*bps. n=100, bps=2: одна зона (8 байт таблицы)
+       выгодна при m*2 + 8 < 200, то есть m <= 95; m = 96 — кадр целиком */
+    static const frame_zone_cfg_t g1[] = { { 0u, 95u } };
+    static const uint16_t wg1[][2] = { { 0u, 95u } };
+    zone_case("gain edge", g1, 1, 0u, 0u, 100u, 2u, wg1, 1);
+    static const frame_zone_cfg_t g2[] = { { 0u, 96u } };
+    zone_case("no gain", g2, 1, 0u, 0u, 100u, 2u, NULL, 0);
+    /* Стерео (bps = 4): m = 97 уже выгодно (8 + 388 < 400), m = 98 — нет */
+    static const frame_zone_cfg_t g3[] = { { 3u, 97u } };
+    static const uint16_t wg3[][2] = { { 3u, 97u } };
+    zone_case("gain edge stereo", g3, 1, 0u, 0u, 100u, 4u, wg3, 1);
+    static const frame_zone_cfg_t g4[] = { { 2u, 98u } };
+    zone_case("no gain stereo", g4, 1, 0u, 0u, 100u, 4u, NULL, 0);
+    /* Три зоны: 16 байт таблицы, m = 91 -> 198 < 200 выгодно, m = 92 -> 200 — нет */
+    static const frame_zone_cfg_t g5[] = { { 0u, 31u }, { 35u, 31u }, { 70u, 30u } };
+    zone_case("no gain 3 zones", g5, 3, 0u, 0u, 100u, 2u, NULL, 0);
+    static const frame_zone_cfg_t g6[] = { { 0u, 31u }, { 40u, 30u }, { 70u, 30u } };
+    static const uint16_t wg6[][2] = { { 0u, 31u }, { 40u, 30u }, { 70u, 30u } };
+    zone_case("gain 3 zones", g6, 3, 0u, 0u, 100u, 2u, wg6, 3);
+    /* Зоны нет */
+    zone_case("none", NULL, 0, 0u, 0u, 100u, 2u, NULL, 0);
+}
+
+/* Модель: отсчёт i в зоне [s, s+l) (отсчёты) или задевает её ([i, i+1)/fs против [s, s+l) мкс) */
+static int covered(const frame_zone_cfg_t *cfg, uint32_t k, uint8_t us, uint32_t fs, uint32_t i)
+{
+    for(uint32_t z = 0; z < k; z++){
+        uint64_t s = cfg[z].start, e = s + cfg[z].len;
+        if(us ? ((uint64_t)i * 1000000u < e * fs && (uint64_t)(i + 1u) * 1000000u > s * fs) : (i >= s && i < e))
+            return 1;
+    }
+    return 0;
+}
+
+static void zones_random(uint32_t cases)
+{
+    static uint16_t ch1[MAX_FRAME_SAMPLES], ch2[MAX_FRAME_SAMPLES];
+    static uint16_t d1[MAX_FRAME_SAMPLES + 8u], d2[MAX_FRAME_SAMPLES + 8u];
+    static uint8_t cov[MAX_FRAME_SAMPLES];
+    uint32_t zoned = 0, whole = 0;
+    for(uint32_t c = 0; c < cases; c++){
+        uint16_t n = (uint16_t)(1u + rnd() % MAX_FRAME_SAMPLES);
+        uint32_t bps = (rnd() & 1u) ? 4u : 2u;
+        uint8_t us = (uint8_t)(rnd() & 1u);
+        uint32_t fs = us ? 1000u + rnd() % 8000000u : 0u;
+        /* Зоны по возрастанию без перекрытий (как принимает vnd_zone_set) в единицах кадра */
+        uint32_t span = us ? (uint32_t)(((uint64_t)n * 1000000u) / fs) + 2u : n;
+        frame_zone_cfg_t cfg[FRAME_ZONES_MAX];
+        uint32_t k = rnd() % (FRAME_ZONES_MAX + 1u), at = 0;
+        for(uint32_t z = 0; z < k; z++){
+            uint32_t step = span / (k ? k : 1u) + 1u;
+            cfg[z].start = at + rnd() % step;
+            cfg[z].len = 1u + rnd() % step;
+            if((rnd() & 7u) == 0u) cfg[z].len += span;      /* через конец кадра */
+            at = cfg[z].start + cfg[z].len;
+        }
+        frame_zone_map_t zr;
+        frame_zone_resolve(&zr, cfg, k, us, fs, n, bps);
+
+        uint32_t m = 0;
+        for(uint32_t i = 0; i < n; i++){ cov[i] = (uint8_t)covered(cfg, k, us, fs, i); m += cov[i]; }
+        if(!zr.cnt){
+            /* Кадр целиком: зон нет либо даже при всех k записях таблицы выигрыша нет */
+            if(m && FRAME_ZONE_TAB_BYTES(k) + m * bps < (uint32_t)n * bps){
+                printf("[FAIL] zone random %u: n=%u us=%u fs=%u k=%u m=%u bps=%u whole without reason\n",
+                       c, n, us, fs, k, m, bps);
+                fails++;
+                break;
+            }
+            if(frame_zone_payload_bytes(&zr, n, bps) != (uint32_t)n * bps){
+                printf("[FAIL] zone random %u: whole frame payload %u, expected %u\n", c,
+                       frame_zone_payload_bytes(&zr, n, bps), (uint32_t)n * bps);
+                fails++;
+                break;
+            }
+            whole++;
+            continue;
+        }
+        zoned++;
+        /* Таблица: {N, 0}, зоны по возрастанию без перекрытий внутри N, объединение = модель */
+        int bad = zr.tab[0][0] != n || zr.tab[0][1] != 0u || zr.cnt > k;
+        uint32_t end = 0, sum = 0;
+        static uint8_t got[MAX_FRAME_SAMPLES];
+        memset(got, 0, n);
+        for(uint32_t z = 1; !bad && z <= zr.cnt; z++){
+            uint32_t st = zr.tab[z][0], ln = zr.tab[z][1];
+            if(!ln || st < end || st + ln > n){ bad = 1; break; }
+            memset(got + st, 1, ln);
+            end = st + ln; sum += ln;
+        }
+        if(!bad) bad = memcmp(got, cov, n) != 0 || sum != m || zr.samples != m ||
+                       FRAME_ZONE_TAB_BYTES(zr.cnt) + m * bps >= (uint32_t)n * bps;
+        if(bad){
+            printf("[FAIL] zone random %u: n=%u us=%u fs=%u k=%u bps=%u: cnt=%u samples=%u, model %u\n",
+                   c, n, us, fs, k, bps, zr.cnt, zr.samples, m);
+            fails++;
+            break;
+        }
+        /* Сборка: ровно samples отсчётов зон подряд, дальше буфер не тронут */
+        for(uint32_t i = 0; i < n; i++){ ch1[i] = (uint16_t)rnd(); ch2[i] = (uint16_t)rnd(); }
+        for(uint32_t i = 0; i < MAX_FRAME_SAMPLES + 8u; i++){ d1[i] = GUARD; d2[i] = GUARD; }
+        uint32_t o = frame_zone_gather(&zr, ch1, ch2, d1, d2);
+        uint32_t j = 0;
+        for(uint32_t i = 0; !bad && i < n; i++){
+            if(!cov[i]) continue;
+            bad = j >= o || d1[j] != ch1[i] || d2[j] != ch2[i];
+            j++;
+        }
+        for(uint32_t i = o; !bad && i < o + 8u; i++) bad = d1[i] != GUARD || d2[i] != GUARD;
+        if(bad || o != zr.samples || j != o){
+            printf("[FAIL] zone random %u: gather wrote %u samples, zones %u\n", c, o, zr.samples);
+            fails++;
+            break;
+        }
+        /* Размер кадра (vnd_frame_bytes без заголовка) = таблица (memcpy zr.tab) + собранные отсчёты */
+        if(frame_zone_payload_bytes(&zr, n, bps) != FRAME_ZONE_TAB_BYTES(zr.cnt) + o * bps){
+            printf("[FAIL] zone random %u: payload %u, written %u\n", c, frame_zone_payload_bytes(&zr, n, bps),
+                   FRAME_ZONE_TAB_BYTES(zr.cnt) + o * bps);
+            fails++;
+            break;
+        }
+    }
+    printf("[ZONE] random: %u cases, %u zoned, %u whole\n", cases, zoned, whole);
+    if(!zoned || !whole){
+        printf("[FAIL] random cases did not exercise both outcomes\n");
+        fails++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t cases = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 200000u;
+    rng = (argc > 2) ? ((uint32_t)strtoul(argv[2], NULL, 0) | 1u) : 0x20E5u;
+    zones_fixed();
+    zones_random(cases);
+    printf("[ZONE] %u failures\n", fails);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+/* Проверка синхронного детектора (Core/Src/lockin.c) на синтетическом сигнале: меандр известной
+   амплитуды A и задержки d отсчётов (фазы) поверх постоянной составляющей, по два канала с разными A, d.
+   Кадры по n отсчётов идут через lockin_reset/lockin_feed/lockin_pop (плоскости ch1/ch2 и слова ab
+   через кадр), каждая запись сверяется с поотсчётной моделью: seq, флаг GAP, I, Q, Σx, t_end_us.
+   Для симметричного меандра (H = P/2, P кратно 4) I и Q сверяются ещё и с формулой:
+     I = A·M·(P - 4d), Q = A·M·(P - 4|d - P/4|), Σx = M·P·DC.
+   Разрывы: lockin_abort после кадра (разорванный кадр АЦП) — записи этого кадра не выходят, следующая
+   начинается с границы периода с флагом GAP; пропуск кадра по seq и скачок фазы — тоже GAP.
+   Сборка и запуск (из корня репозитория, все тесты — HostTools/tests/run_host_tests.sh):
+     gcc -O2 -Wall -Wextra -I HostTools/tests/host -I Core/Inc -o test_lockin \
+         HostTools/tests/test_lockin.c Core/Src/lockin.c
+     ./test_lockin
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lockin.h"
+
+#define PHASE_NONE 0xFFFFu /* ADC_PHASE_NONE (adc_stream.h) */
+#define N_MAX      1360u
+#define DC         2048
+#define MODEL_MAX  256u
+
+typedef struct {
+    uint16_t p, h, m;
+    uint32_t n;          /* отсчётов в кадре */
+    int32_t  a[2];       /* амплитуда меандра по каналам */
+    uint32_t d[2];       /* задержка меандра, отсчётов */
+    uint32_t noise;      /* размах шума (0 — без шума, проверка формулой) */
+} lk_case_t;
+
+/* Поотсчётная модель детектора: ожидаемые записи */
+typedef struct {
+    uint32_t seq, t_end;
+    uint16_t flags;
+    int64_t  i[2], q[2];
+    uint64_t sum[2];
+} exp_rec_t;
+
+static exp_rec_t exp_q[MODEL_MAX];
+static uint32_t exp_head, exp_tail;
+static struct {
+    int active;
+    uint32_t cnt, seq;
+    uint16_t flags;
+    int64_t i[2], q[2];
+    uint64_t sum[2];
+} md;
+
+static uint32_t rng = 1u;
+static uint32_t rnd(void)
+{
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+}
+
+static void model_break(void)
+{
+    md.active = 0;
+    md.flags = LOCKIN_REC_FLAG_GAP;
+}
+
+static void model_sample(const lk_case_t *c, uint32_t ph, const uint16_t x[2], uint32_t g)
+{
+    uint32_t q0 = (c->p + 2u) / 4u;
+    if(!md.active){
+        if(ph != 0u) return;
+        md.active = 1; md.cnt = 0;
+        memset(md.i, 0, sizeof(md.i)); memset(md.q, 0, sizeof(md.q)); memset(md.sum, 0, sizeof(md.sum));
+    }
+    int ri = (ph < c->h) ? 1 : -1;
+    int rq = (((ph + c->p - q0) % c->p) < c->h) ? 1 : -1;
+    for(int k = 0; k < 2; k++){
+        md.i[k] += ri * (int64_t)x[k];
+        md.q[k] += rq * (int64_t)x[k];
+        md.sum[k] += x[k];
+    }
+    if(++md.cnt < (uint32_t)c->p * c->m) return;
+    exp_rec_t *e = &exp_q[exp_tail++ % MODEL_MAX];
+    e->seq = md.seq++; e->t_end = g; e->flags = md.flags;
+    memcpy(e->i, md.i, sizeof(e->i)); memcpy(e->q, md.q, sizeof(e->q)); memcpy(e->sum, md.sum, sizeof(e->sum));
+    md.flags = 0; md.cnt = 0;
+    memset(md.i, 0, sizeof(md.i)); memset(md.q, 0, sizeof(md.q)); memset(md.sum, 0, sizeof(md.sum));
+}
+
+static uint32_t fails;
+
+/* Сверить записи, готовые в lockin, с моделью */
+static void check_pop(const lk_case_t *c, int formula)
+{
+    uint8_t buf[LOCKIN_REC_SIZE * 8];
+    uint32_t got;
+    while((got = lockin_pop(buf, 8)) != 0){
+        for(uint32_t r = 0; r < got; r++){
+            lockin_rec_t rec;
+            memcpy(&rec, buf + r * LOCKIN_REC_SIZE, sizeof(rec));
+            if(exp_head == exp_tail){
+                printf("[FAIL] P=%u: unexpected record seq=%u\n", c->p, rec.seq);
+                fails++;
+                continue;
+            }
+            const exp_rec_t *e = &exp_q[exp_head++ % MODEL_MAX];
+            int bad = rec.seq != e->seq || rec.flags != e->flags || rec.t_end_us != e->t_end ||
+                      rec.periods != c->m || rec.period_samples != c->p || rec.high_samples != c->h;
+            for(int k = 0; k < 2; k++)
+                bad |= rec.i[k] != e->i[k] || rec.q[k] != e->q[k] || rec.sum[k] != e->sum[k];
+            if(bad){
+                printf("[FAIL] P=%u H=%u rec seq=%u/%u flags=%u/%u t=%u/%u I=%lld/%lld Q=%lld/%lld S=%llu/%llu\n",
+                       c->p, c->h, rec.seq, e->seq, rec.flags, e->flags, rec.t_end_us, e->t_end,
+                       (long long)rec.i[0], (long long)e->i[0], (long long)rec.q[0], (long long)e->q[0],
+                       (unsigned long long)rec.sum[0], (unsigned long long)e->sum[0]);
+                fails++;
+            }
+            if(!formula) continue;
+            for(int k = 0; k < 2; k++){
+                int64_t d = (int64_t)c->d[k], q0 = c->p / 4;
+                int64_t ei = (int64_t)c->a[k] * c->m * (c->p - 4 * d);
+                int64_t eq = (int64_t)c->a[k] * c->m * (c->p - 4 * llabs(d - q0));
+                uint64_t es = (uint64_t)c->m * c->p * DC;
+                if(rec.i[k] != ei || rec.q[k] != eq || rec.sum[k] != es){
+                    printf("[FAIL] P=%u ch%d A=%d d=%u: I=%lld Q=%lld S=%llu, expected %lld %lld %llu\n",
+                           c->p, k + 1, c->a[k], c->d[k], (long long)rec.i[k], (long long)rec.q[k],
+                           (unsigned long long)rec.sum[k], (long long)ei, (long long)eq, (unsigned long long)es);
+                    fails++;
+                }
+            }
+        }
+    }
+}
+
+/* Прогнать случай: frames кадров; с вероятностью разрывы трёх видов (если gaps) */
+static void run_case(const lk_case_t *c, uint32_t frames, int gaps, int formula)
+{
+    static uint16_t x1[N_MAX], x2[N_MAX];
+    static uint32_t ab[N_MAX];
+    uint32_t off = rnd() % c->p;      /* фаза первого отсчёта потока */
+    uint32_t g = 1000u;               /* номер отсчёта = время, мкс (Fs = 1 МГц) */
+    uint32_t seq = 0, aborts = 0, seq_gaps = 0, jumps = 0, records = 0, exp_gaps = 0;
+    memset(&md, 0, sizeof(md));
+    md.flags = LOCKIN_REC_FLAG_GAP;
+    exp_head = exp_tail = 0;
+    lockin_reset(c->p, c->h, c->m, 1000000u);
+
+    for(uint32_t f = 0; f < frames; f++){
+        uint32_t ev = gaps ? rnd() % 40u : 99u;
+        /* Разрыв считается в stats.gaps, только если запись шла (после сброса детектор ещё не синхронен) */
+        if(ev == 0u){ seq++; g += c->n; seq_gaps++; exp_gaps += md.active; model_break(); } /* потерян кадр АЦП */
+        else if(ev == 1u){ off = (off + 1u) % c->p; jumps++; exp_gaps += md.active; model_break(); } /* фаза не сошлась */
+        uint32_t k0 = (g + off) % c->p;
+        uint32_t nmodel = exp_tail;
+        for(uint32_t j = 0; j < c->n; j++){
+            uint32_t ph = (k0 + j) % c->p;
+            uint16_t x[2];
+            for(int k = 0; k < 2; k++){
+                int sq = (((ph + c->p - c->d[k]) % c->p) < c->p / 2u) ? 1 : -1; /* меандр с задержкой d */
+                int32_t v = DC + sq * c->a[k] + (c->noise ? (int32_t)(rnd() % c->noise) - (int32_t)(c->noise / 2u) : 0);
+                x[k] = (uint16_t)v;
+            }
+            x1[j] = x[0]; x2[j] = x[1]; ab[j] = x[0] | ((uint32_t)x[1] << 16);
+            model_sample(c, ph, x, g + j);
+        }
+        uint32_t closed = (f & 1u) ? lockin_feed(seq, NULL, NULL, ab, c->n, (uint16_t)k0, g + c->n - 1u)
+                                   : lockin_feed(seq, x1, x2, NULL, c->n, (uint16_t)k0, g + c->n - 1u);
+        if(closed != exp_tail - nmodel){
+            printf("[FAIL] P=%u frame %u: feed closed %u records, model %u\n", c->p, f, closed, exp_tail - nmodel);
+            fails++;
+        }
+        records += closed;
+        if(gaps && rnd() % 40u == 0u){
+            /* Кадр оказался разорван: его записи не выходят, следующая — с границы периода, GAP */
+            lockin_abort(closed);
+            exp_tail = nmodel;
+            model_break();
+            aborts++;
+        }
+        check_pop(c, formula);
+        seq++; g += c->n;
+    }
+    if(exp_head != exp_tail){
+        printf("[FAIL] P=%u: %u records expected but not produced\n", c->p, exp_tail - exp_head);
+        fails++;
+    }
+    lockin_stats_t st;
+    lockin_get_stats(&st);
+    if(st.frames != frames || st.gaps != exp_gaps || st.no_phase || st.overflow){
+        printf("[FAIL] P=%u stats frames=%u gaps=%u no_phase=%u overflow=%u, expected %u %u 0 0\n",
+               c->p, st.frames, st.gaps, st.no_phase, st.overflow, frames, exp_gaps);
+        fails++;
+    }
+    printf("  P=%-4u H=%-4u M=%-3u n=%-4u records=%-5u aborts=%-3u seq_gaps=%-3u phase_jumps=%u\n",
+           c->p, c->h, c->m, c->n, records, aborts, seq_gaps, jumps);
+}
+
+int main(void)
+{
+    rng = 0x13579BDu;
+    /* Симметричный меандр без шума: I, Q по формуле (известные A и фаза d по каналам) */
+    static const lk_case_t exact[] = {
+        { 40, 20, 10, 123, { 1000, 300 }, { 3, 17 }, 0 },
+        { 40, 20,  1,   7, {  500, 900 }, { 0, 10 }, 0 },
+        { 8,   4, 64, 1360, { 1500, 20 }, { 2,  4 }, 0 },
+    };
+    /* Несимметричная опора, нечётный P, шум: сверка с поотсчётной моделью */
+    static const lk_case_t model[] = {
+        { 37, 11,  5, 100, { 800, 400 }, { 5, 30 }, 64 },
+        { 5,   2,  3,  13, { 1000, 1000 }, { 1, 3 }, 16 },
+        { 1000, 500, 2, 912, { 700, 50 }, { 250, 999 }, 200 },
+        { 91,  90,  4, 256, { 100, 1500 }, { 45, 2 }, 8 },
+    };
+    printf("[LOCKIN] exact square wave, no gaps\n");
+    for(uint32_t i = 0; i < sizeof(exact) / sizeof(exact[0]); i++) run_case(&exact[i], 400, 0, 1);
+    printf("[LOCKIN] exact square wave, aborts and gaps\n");
+    for(uint32_t i = 0; i < sizeof(exact) / sizeof(exact[0]); i++) run_case(&exact[i], 2000, 1, 1);
+    printf("[LOCKIN] asymmetric reference and noise, aborts and gaps\n");
+    for(uint32_t i = 0; i < sizeof(model) / sizeof(model[0]); i++) run_case(&model[i], 2000, 1, 0);
+
+    /* Фаза неизвестна и вырожденная опора: записей нет, кадры идут в no_phase */
+    static uint16_t z[64];
+    static const uint16_t geo[2][2] = { { 40, 20 }, { 3, 1 } };
+    for(uint32_t i = 0; i < 2; i++){
+        lockin_reset(geo[i][0], geo[i][1], 1, 1000000u);
+        for(uint32_t f = 0; f < 10; f++) (void)lockin_feed(f, z, z, NULL, 64, i ? 0 : PHASE_NONE, 0);
+        lockin_stats_t st;
+        lockin_get_stats(&st);
+        if(lockin_ready() || st.no_phase != 10u){
+            printf("[FAIL] P=%u H=%u k0=%s: ready=%u no_phase=%u\n", geo[i][0], geo[i][1], i ? "0" : "none",
+                   lockin_ready(), st.no_phase);
+            fails++;
+        }
+    }
+
+    printf("[LOCKIN] %u failures\n", fails);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+# Декодер токенизированного трейса прошивки (Core/Inc/trace_tok.h, USBprotocol.txt §4.16).
+# Таблица ID берётся из ELF: секция .trace_fmt (INFO, в образ не грузится), ID = смещение строки
+# "файл:строка\x1fформат" в секции. Аргументы %s — адреса констант прошивки, строки читаются из
+# загружаемых секций того же ELF. Кольцо читается по EP0: VND_CMD_GET_TRACE (0x31), пока flags.bit0.
+# Запуск:
+#   python HostTools/trace_decode.py [Debug/BMI30.stm32h7.elf]                 — читать устройство
+#   python HostTools/trace_decode.py ELF --follow                              — читать непрерывно
+#   python HostTools/trace_decode.py ELF --dump-table fmt.json                 — сохранить таблицу ID
+#   python HostTools/trace_decode.py --table fmt.json                          — читать без ELF (без %s)
+# ELF и прошивка должны быть от одной сборки: иначе ID указывают не на те строки.
+
+import argparse, json, pathlib, re, struct, sys, time
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+ELF_DEFAULT = ROOT / 'Debug' / 'BMI30.stm32h7.elf'
+
+VID = 0xCAFE
+PID = 0x4001
+VND_CMD_GET_TRACE = 0x31
+TRACE_HDR = struct.Struct('<HBBII')  # words, version, flags, dropped, sysclk_hz
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+def read_elf(path):
+    """Секции ELF32 LE: {имя: (addr, flags, type, bytes)}"""
+    b = pathlib.Path(path).read_bytes()
+    if b[:4] != b'\x7fELF' or b[4] != 1 or b[5] != 1:
+        raise ValueError('not an ELF32 little-endian file')
+    e_shoff, = struct.unpack_from('<I', b, 0x20)
+    e_shentsize, e_shnum, e_shstrndx = struct.unpack_from('<HHH', b, 0x2E)
+    hdrs = [struct.unpack_from('<IIIIIIIIII', b, e_shoff + i * e_shentsize) for i in range(e_shnum)]
+    names = hdrs[e_shstrndx]
+    secs = {}
+    for name, stype, flags, addr, off, size, _, _, _, _ in hdrs:
+        n = b[names[4] + name:b.index(b'\0', names[4] + name)].decode()
+        data = b'' if stype == SHT_NOBITS else b[off:off + size]
+        secs[n] = (addr, flags, stype, data)
+    return secs
+
+
+def table_from_elf(secs):
+    """ID -> (место, формат) по строкам секции .trace_fmt"""
+    if '.trace_fmt' not in secs:
+        raise ValueError('no .trace_fmt section (TRACE_TOK_ENABLE=0 or old linker script)')
+    data = secs['.trace_fmt'][3]
+    table, i = {}, 0
+    while i < len(data):
+        j = data.index(b'\0', i)
+        if j > i:
+            where, _, fmt = data[i:j].decode('utf-8', 'replace').partition('\x1f')
+            table[i] = (where, fmt)
+        i = j + 1
+    return table
+
+
+class ConstStrings:
+    """Строки %s: чтение C-строки по адресу из загружаемых секций ELF"""
+    def __init__(self, secs):
+        self.secs = [(a, d) for a, f, t, d in secs.values() if (f & SHF_ALLOC) and t != SHT_NOBITS and d]
+
+    def get(self, addr):
+        for a, d in self.secs:
+            if a <= addr < a + len(d):
+                end = d.find(b'\0', addr - a)
+                return d[addr - a:end if end >= 0 else len(d)].decode('utf-8', 'replace')
+        return f'<str@0x{addr:08X}>'
+
+
+CONV = re.compile(r'%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|z|j|t)?([diouxXcsp%])')
+
+
+def render(fmt, words, strings):
+    """printf-формат по словам аргументов; %ll* забирает два слова"""
+    out, pos, k = [], 0, 0
+    for m in CONV.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        if k >= len(words):
+            out.append('<?>')
+            continue
+        v = words[k]; k += 1
+        if length == 'll':
+            v |= (words[k] << 32) if k < len(words) else 0
+            k += 1
+        if conv == 's':
+            s = strings.get(v) if strings else f'<str@0x{v:08X}>'
+            out.append(('%' + flags + (width or '') + ('.' + prec if prec else '') + 's') % s)
+            continue
+        if conv in 'di':
+            bits = 64 if length == 'll' else 32
+            if v >= 1 << (bits - 1):
+                v -= 1 << bits
+        if conv == 'c':
+            out.append(chr(v & 0xFF))
+            continue
+        if conv == 'p':
+            out.append(f'0x{v:08X}')
+            continue
+        spec = '%' + flags + (width or '') + ('.' + prec if prec else '') + ('d' if conv in 'iu' else conv)
+        out.append(spec % v)
+    out.append(fmt[pos:])
+    return ''.join(out).rstrip('\r\n')
+
+
+class Decoder:
+    def __init__(self, table, strings):
+        self.table, self.strings = table, strings
+        self.seq = None
+        self.cyc_prev = None
+        self.t_us = 0.0
+        self.lost = 0
+
+    def feed(self, words, sysclk_hz):
+        i = 0
+        mhz = (sysclk_hz or 1) / 1e6
+        while i + 2 <= len(words):
+            w0, cyc = words[i], words[i + 1]
+            rid, nargs, seq = w0 & 0xFFFFF, (w0 >> 20) & 0xF, w0 >> 24
+            args = words[i + 2:i + 2 + nargs]
+            i += 2 + nargs
+            if self.seq is not None and seq != ((self.seq + 1) & 0xFF):
+                gap = (seq - self.seq - 1) & 0xFF
+                self.lost += gap
+                print(f'[TRACE][GAP] {gap} record(s) lost before seq={seq}')
+            self.seq = seq
+            # CYCCNT 32 бита: при 550 МГц оборот ~7.8 с; при редких записях дельта неоднозначна
+            if self.cyc_prev is not None:
+                self.t_us += ((cyc - self.cyc_prev) & 0xFFFFFFFF) / mhz
+            self.cyc_prev = cyc
+            where, fmt = self.table.get(rid, ('?', f'<unknown id 0x{rid:05X}>'))
+            print(f'{self.t_us:14.3f} us  {where:<28} {render(fmt, args, self.strings)}')
+
+
+def drain(dev, dec):
+    import usb.util
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    dropped = None
+    while True:
+        ba = bytes(dev.ctrl_transfer(bm, VND_CMD_GET_TRACE, 0, 0, 512, timeout=500))
+        if len(ba) < TRACE_HDR.size:
+            print(f'[TRACE] short reply ({len(ba)} B)')
+            return None
+        nwords, ver, flags, dropped, sysclk = TRACE_HDR.unpack_from(ba)
+        if ver != 1:
+            print(f'[TRACE] unknown version {ver}')
+            return None
+        words = list(struct.unpack_from(f'<{nwords}I', ba, TRACE_HDR.size))
+        dec.feed(words, sysclk)
+        if not (flags & 1):
+            return dropped
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Декодер токенизированного трейса (VND_CMD_GET_TRACE)')
+    ap.add_argument('elf', nargs='?', default=None)
+    ap.add_argument('--table', help='JSON-таблица ID вместо ELF (%%s тогда не раскрываются)')
+    ap.add_argument('--dump-table', metavar='JSON', help='сохранить таблицу ID из ELF и выйти')
+    ap.add_argument('--follow', action='store_true', help='опрашивать кольцо непрерывно')
+    ap.add_argument('--period', type=float, default=0.2, help='период опроса в --follow, с')
+    args = ap.parse_args()
+
+    strings = None
+    try:
+        if args.table:
+            table = {int(k): tuple(v) for k, v in json.loads(pathlib.Path(args.table).read_text()).items()}
+        else:
+            secs = read_elf(args.elf or ELF_DEFAULT)
+            table, strings = table_from_elf(secs), ConstStrings(secs)
+    except (OSError, ValueError) as e:
+        print(f'[TRACE] cannot load table: {e}')
+        return 1
+    print(f'[TRACE] {len(table)} format strings')
+    if args.dump_table:
+        pathlib.Path(args.dump_table).write_text(json.dumps({str(k): v for k, v in table.items()}, indent=1, ensure_ascii=False))
+        return 0
+
+    import usb.core
+    dev = usb.core.find(idVendor=VID, idProduct=PID)
+    if dev is None:
+        print('[TRACE] device not found')
+        return 1
+    dec = Decoder(table, strings)
+    dropped = 0
+    try:
+        while True:
+            d = drain(dev, dec)
+            if d is None:
+                return 1
+            dropped = d
+            if not args.follow:
+                break
+            time.sleep(args.period)
+    except KeyboardInterrupt:
+        pass
+    print(f'[TRACE] dropped on device: {dropped}, seq gaps seen: {dec.lost}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -35,7 +35,6 @@ def ctrl_get_status(dev):
     flags_rt = int.from_bytes(ba[48:50], 'little')
     flags2 = int.from_bytes(ba[50:52], 'little')
     sending_ch = ba[52]
-    pair_idx = int.from_bytes(ba[54:56], 'little')
     last_tx_len = int.from_bytes(ba[56:58], 'little')
     cur_stream_seq = int.from_bytes(ba[58:62], 'little')
     return {
@@ -55,10 +54,184 @@ def ctrl_get_status(dev):
         'flags_rt': flags_rt,
         'flags2': flags2,
         'sending_ch': sending_ch,
-        'pair_fill': (pair_idx >> 8) & 0xFF,
-        'pair_send': pair_idx & 0xFF,
+        'txq_depth': ba[54],
+        'txq_hwm': ba[55],
+        'txq_underrun': int.from_bytes(ba[62:64], 'little'),
         'last_tx_len': last_tx_len,
         'cur_stream_seq': cur_stream_seq,
+        # version>=3: загрузка CPU за последнюю секунду, % (0xFF — сборка без MAIN_IDLE_WFI)
+        'cpu_pct': ba[5] if ver >= 3 and ba[5] != 0xFF else None,
+        'isr_pct': ba[53] if ver >= 3 else None,
+    }
+
+STATUS_PAGE_PERF = 1
+
+def ctrl_get_perf(dev):
+    # Страница 1 GET_STATUS (wValue=1): стоимость подготовки передачи в циклах CPU (DWT)
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_PERF, 0, 64, timeout=500))
+    if len(ba) < 32 or ba[:4] != b'PERF':
+        return None
+    f = struct.unpack_from('<BBBBIIIIIIIIIIIIHIH', ba, 4)
+    return {
+        'ver': f[0],
+        'zero_copy': bool(f[1] & 0x01),
+        'dma': bool(f[1] & 0x02),
+        'crc': bool(f[1] & 0x04),
+        'compress': bool(f[1] & 0x08),
+        'burst_pairs': f[2],
+        'copy_cnt': f[4], 'copy_avg': f[5], 'copy_max': f[6],
+        'zc_cnt': f[7], 'zc_avg': f[8], 'zc_max': f[9],
+        'chained': f[10], 'chain_err': f[11],
+        'burst_sent': f[12], 'burst_drop': f[13],
+        'irq_cnt': f[14], 'irq_cyc_s': f[15], 'irq_permille': f[16],
+        'crc_frames': f[17], 'crc_skipped': f[18],
+    }
+
+STATUS_PAGE_COMP = 2
+
+def ctrl_get_comp(dev):
+    # Страница 2 GET_STATUS (wValue=2): сжатие payload (SET_COMPRESS) — степень сжатия и циклы кодера
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_COMP, 0, 64, timeout=500))
+    if len(ba) < 52 or ba[:4] != b'COMP':
+        return None
+    f = struct.unpack_from('<BBHIIIIQQHHII', ba, 4)
+    return {
+        'ver': f[0], 'on': bool(f[1] & 0x01),
+        'frames': f[3], 'raw_frames': f[4], 'blocks': f[5], 'raw_blocks': f[6],
+        'bytes_in': f[7], 'bytes_out': f[8], 'ratio_permille': f[9],
+        'cyc_per_sample': f[10] / 10.0, 'cyc_frame_avg': f[11], 'cyc_frame_max': f[12],
+    }
+
+STATUS_PAGE_ADC = 3
+
+def ctrl_get_adc(dev):
+    # Страница 3 GET_STATUS (wValue=3): кольцо кадров АЦП — потери при переполнении и разорванные кадры
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_ADC, 0, 64, timeout=500))
+    if len(ba) < 64 or ba[:4] != b'ADCS':
+        return None
+    f = struct.unpack_from('<BBBBHHIIIIIIIIQIHHHH', ba, 4)
+    return {
+        'ver': f[0], 'dual': bool(f[1] & 0x01), 'switch_pending': bool(f[1] & 0x02), 'profile': f[2], 'readable': f[3],
+        'samples': f[4], 'fifo': f[5],
+        'wr': f[6], 'rd': f[7], 'overflow': f[8], 'torn': f[9], 'backlog_max': f[10],
+        'skipped': f[11], 'dma0': f[12], 'dma1': f[13],
+        'last_us': f[14], 'last_seq': f[15],
+        'switches': f[16], 'switch_deferred': f[17], 'switch_slip': f[18], 'switch_restarts': f[19],
+    }
+
+STATUS_PAGE_ACQ = 4
+
+def ctrl_get_acq(dev):
+    # Страница 4 GET_STATUS (wValue=4): фактический режим захвата — TIM15 PSC/ARR, достигнутая Fs (SET_ACQ)
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_ACQ, 0, 64, timeout=500))
+    if len(ba) < 53 or ba[:4] != b'ACQS':
+        return None
+    f = struct.unpack_from('<BBBBIQIHHIHHIIIbHBB', ba, 4)
+    return {
+        'ver': f[0], 'custom': bool(f[1] & 0x01), 'aligned': bool(f[1] & 0x02), 'profile': f[2], 'smp': f[3],
+        'fs_req': f[4], 'fs': f[5] / 1000.0, 'tim_clk': f[6], 'psc': f[7], 'arr': f[8],
+        'adc_clk': f[9], 'conv_ns': f[10], 'samples': f[11], 'frame_hz': f[12] / 1000.0,
+        'ring_ms': f[13], 'payload_bps': f[14], 'last_rc': f[15],
+        'ovs': f[16], 'ovs_shift': f[17], 'bits': f[18],
+    }
+
+STATUS_PAGE_LOCKIN = 5
+STATUS_PAGE_PHASE = 6
+STATUS_PAGE_ZONE = 7
+
+def ctrl_get_lockin(dev):
+    # Страница 5 GET_STATUS (wValue=5): синхронный детектор — геометрия опоры, фаза меандра и учёт записей I/Q
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_LOCKIN, 0, 64, timeout=500))
+    if len(ba) < 64 or ba[:4] != b'LOCK':
+        return None
+    f = struct.unpack_from('<BBHHHBBH12I', ba, 4)
+    return {
+        'ver': f[0], 'on': bool(f[1] & 0x01), 'have_phase': bool(f[1] & 0x02), 'locked': bool(f[1] & 0x04),
+        'periods': f[2], 'P': f[3], 'H': f[4], 'recs_per_frame': f[5], 'pending': f[6],
+        'records': f[8], 'frames': f[9], 'gaps': f[10], 'no_phase': f[11], 'aborted': f[12], 'overflow': f[13],
+        'ph_meas': f[14], 'ph_fix': f[15], 'ph_dirty': f[16], 'cyc_avg': f[17], 'cyc_max': f[18], 'frames_out': f[19],
+    }
+
+def ctrl_get_phase(dev):
+    # Страница 6 GET_STATUS (wValue=6): фаза меандра TIM2 — источники измерения и счётчики фронтов
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_PHASE, 0, 64, timeout=500))
+    if len(ba) < 64 or ba[:4] != b'PHAS':
+        return None
+    f = struct.unpack_from('<BBHHH8I', ba, 4)
+    return {
+        'ver': f[0], 'counters': bool(f[1] & 0x01), 'capture_on': bool(f[1] & 0x02), 'capture': bool(f[1] & 0x04),
+        'locked': bool(f[1] & 0x08), 'P': f[2], 'H': f[3],
+        'edges': f[5], 'edge_meas': f[6], 'counter_meas': f[7], 'fix': f[8], 'dirty': f[9], 'edge_amb': f[10],
+        'frames_phase': f[11], 'frames_gpio': f[12],
+    }
+
+def ctrl_get_zone(dev):
+    # Страница 7 GET_STATUS (wValue=7): зоны ROI — действующая таблица и сэкономленный трафик
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_ZONE, 0, 64, timeout=500))
+    if len(ba) < 64 or ba[:4] != b'ZONE':
+        return None
+    f = struct.unpack_from('<BBBBHHIIQ16H', ba, 4)
+    cnt = f[3]
+    return {
+        'ver': f[0], 'on': bool(f[1] & 0x01), 'us': bool(f[1] & 0x02), 'applied': bool(f[1] & 0x04),
+        'cfg': f[2], 'count': cnt, 'N': f[4], 'samples': f[5], 'frames_zoned': f[6], 'frames_whole': f[7],
+        'saved': f[8], 'zones': [(f[9 + 2 * i], f[10 + 2 * i]) for i in range(cnt)],
+    }
+
+STATUS_PAGE_CACHE = 8
+
+def ctrl_get_cache(dev):
+    # Страница 8 GET_STATUS (wValue=8): кэши ядра, регионы DMA и циклы горячего пути
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_CACHE, 0, 64, timeout=500))
+    if len(ba) < 56 or ba[:4] != b'CACH':
+        return None
+    f = struct.unpack_from('<BBHIIIIIIIIIIII', ba, 4)
+    load, isr, wakeups = struct.unpack_from('<HHI', ba, 56) if len(ba) >= 64 else (0xFFFF, 0, 0)
+    return {
+        'ver': f[0], 'icache': bool(f[1] & 0x01), 'dcache': bool(f[1] & 0x02), 'usb_wt': bool(f[1] & 0x04),
+        'loop_cyc': f[3], 'prep_n': f[4], 'prep_avg': f[5], 'prep_max': f[6],
+        'adc_base': f[7], 'adc_size': f[8], 'usb_base': f[9], 'usb_size': f[10],
+        'adc_irq_avg': f[11], 'adc_irq_max': f[12], 'itcm': f[13], 'dtcm_hot': f[14],
+        'cpu_permille': None if load == 0xFFFF else load, 'isr_permille': isr, 'wakeups': wakeups,
+    }
+
+STATUS_PAGE_BOOT = 9
+BOOT_MARKS = ('main', 'clock', 'usb_init', 'loop', 'configured', 'start', 'adc_frame', 'tx_frame')
+
+def ctrl_get_boot(dev):
+    # Страница 9 GET_STATUS (wValue=9): метки загрузки, мкс от сброса (None — события ещё не было)
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_BOOT, 0, 64, timeout=500))
+    if len(ba) < 56 or ba[:4] != b'BOOT':
+        return None
+    f = struct.unpack_from('<BBHI8IIII', ba, 4)
+    return {
+        'ver': f[0], 'flash': bool(f[1] & 0x01), 'icache': bool(f[1] & 0x02), 'dcache': bool(f[1] & 0x04),
+        'sysclk': f[3], 'marks': {n: (None if v == 0xFFFFFFFF else v) for n, v in zip(BOOT_MARKS, f[4:12])},
+        'itcm_copy': f[12], 'data_copy': f[13], 'usb_copy': f[14],
+    }
+
+STATUS_PAGE_ULOG = 10
+
+def ctrl_get_ulog(dev):
+    # Страница 10 GET_STATUS (wValue=10): лог USART1 — кольцо, выгрузка DMA, потери, циклы на строку
+    bm = usb.util.build_request_type(usb.util.CTRL_IN, usb.util.CTRL_TYPE_VENDOR, usb.util.CTRL_RECIPIENT_DEVICE)
+    ba = bytes(dev.ctrl_transfer(bm, CMD_GET_STATUS, STATUS_PAGE_ULOG, 0, 64, timeout=500))
+    if len(ba) < 48 or ba[:4] != b'ULOG':
+        return None
+    f = struct.unpack_from('<BBHHHIIIIIIIII', ba, 4)
+    return {
+        'ver': f[0], 'run': bool(f[1] & 0x01), 'busy': bool(f[1] & 0x02), 'ring': f[2], 'level': f[3], 'hwm': f[4],
+        'writes': f[5], 'bytes_in': f[6], 'bytes_out': f[7], 'drop_w': f[8], 'drop_b': f[9],
+        'chunks': f[10], 'errors': f[11], 'cyc_avg': f[12], 'cyc_max': f[13],
     }
 
 def main():
@@ -88,10 +261,74 @@ def main():
         try:
             st = ctrl_get_status(dev)
             if st:
-                print(f"STAT v{st['ver']} flags2=0x{st['flags2']:04X} cur_samples={st['cur_samples']} wr={st['wr']} seq={st['cur_stream_seq']} sentA/B={st['sent0']}/{st['sent1']} dma0/1={st['dma0']}/{st['dma1']} sending={st['sending_ch']} pair {st['pair_fill']}/{st['pair_send']} lastTX={st['last_tx_len']}")
+                print(f"STAT v{st['ver']} flags2=0x{st['flags2']:04X} cur_samples={st['cur_samples']} wr={st['wr']} seq={st['cur_stream_seq']} sentA/B={st['sent0']}/{st['sent1']} dma0/1={st['dma0']}/{st['dma1']} sending={st['sending_ch']} txq {st['txq_depth']}/{st['txq_hwm']} und={st['txq_underrun']} lastTX={st['last_tx_len']}"
+                      + ('' if st['isr_pct'] is None else f" cpu={'n/a' if st['cpu_pct'] is None else str(st['cpu_pct']) + '%'} isr={st['isr_pct']}%"))
         except Exception as e:
             print(f"CTRL status err: {e}")
         time.sleep(0.3)
+    try:
+        pf = ctrl_get_perf(dev)
+        if pf:
+            print(f"PERF v{pf['ver']} zero_copy={int(pf['zero_copy'])} copy: n={pf['copy_cnt']} avg={pf['copy_avg']} max={pf['copy_max']} cyc | zc: n={pf['zc_cnt']} avg={pf['zc_avg']} max={pf['zc_max']} cyc | chained={pf['chained']} chain_err={pf['chain_err']} | burst k={pf['burst_pairs']} sent={pf['burst_sent']} drop={pf['burst_drop']} | otg dma={int(pf['dma'])} irq n={pf['irq_cnt']} cyc/s={pf['irq_cyc_s']} load={pf['irq_permille']/10:.1f}% | crc on={int(pf['crc'])} n={pf['crc_frames']} skip={pf['crc_skipped']}")
+    except Exception as e:
+        print(f"CTRL perf err: {e}")
+    try:
+        cp = ctrl_get_comp(dev)
+        if cp:
+            print(f"COMP v{cp['ver']} on={int(cp['on'])} frames={cp['frames']} raw_frames={cp['raw_frames']} blocks={cp['blocks']} raw_blocks={cp['raw_blocks']} | {cp['bytes_in']}->{cp['bytes_out']} B ratio={cp['ratio_permille']/10:.1f}% | enc {cp['cyc_per_sample']:.1f} cyc/sample, frame avg={cp['cyc_frame_avg']} max={cp['cyc_frame_max']} cyc")
+    except Exception as e:
+        print(f"CTRL comp err: {e}")
+    try:
+        ad = ctrl_get_adc(dev)
+        if ad:
+            print(f"ADCS v{ad['ver']} dual={int(ad['dual'])} prof={ad['profile']} N={ad['samples']} ring={ad['readable']}/{ad['fifo']} | wr={ad['wr']} rd={ad['rd']} backlog_max={ad['backlog_max']} | overflow={ad['overflow']} torn={ad['torn']} skipped={ad['skipped']} | dma0/1={ad['dma0']}/{ad['dma1']} | last seq={ad['last_seq']} t={ad['last_us']} us")
+            print(f"      switch: seamless={ad['switches']} deferred={ad['switch_deferred']} slip={ad['switch_slip']} restarts={ad['switch_restarts']} pending={int(ad['switch_pending'])}")
+    except Exception as e:
+        print(f"CTRL adc err: {e}")
+    try:
+        aq = ctrl_get_acq(dev)
+        if aq:
+            print(f"ACQS v{aq['ver']} prof={aq['profile']} custom={int(aq['custom'])} rc={aq['last_rc']} | Fs req={aq['fs_req']} got={aq['fs']:.3f} Hz (tim {aq['tim_clk']} Hz psc={aq['psc']} arr={aq['arr']} aligned={int(aq['aligned'])}) | adc {aq['adc_clk']} Hz smp={aq['smp']} ovs={aq['ovs']}>>{aq['ovs_shift']} bits={aq['bits']} conv={aq['conv_ns']} ns | N={aq['samples']} frames={aq['frame_hz']:.3f}/s ring={aq['ring_ms']} ms payload={aq['payload_bps']} B/s")
+    except Exception as e:
+        print(f"CTRL acq err: {e}")
+    try:
+        lk = ctrl_get_lockin(dev)
+        if lk:
+            print(f"LOCK v{lk['ver']} on={int(lk['on'])} phase={int(lk['have_phase'])} locked={int(lk['locked'])} | M={lk['periods']} P={lk['P']} H={lk['H']} recs/frame={lk['recs_per_frame']} pending={lk['pending']} | records={lk['records']} v3_frames={lk['frames_out']} adc_frames={lk['frames']} gaps={lk['gaps']} no_phase={lk['no_phase']} aborted={lk['aborted']} overflow={lk['overflow']} | phase meas={lk['ph_meas']} fix={lk['ph_fix']} dirty={lk['ph_dirty']} | {lk['cyc_avg']} cyc/frame (max {lk['cyc_max']})")
+    except Exception as e:
+        print(f"CTRL lockin err: {e}")
+    try:
+        ph = ctrl_get_phase(dev)
+        if ph:
+            print(f"PHAS v{ph['ver']} counters={int(ph['counters'])} capture_on={int(ph['capture_on'])} capture={int(ph['capture'])} locked={int(ph['locked'])} | P={ph['P']} H={ph['H']} | edges={ph['edges']} amb={ph['edge_amb']} | meas edge={ph['edge_meas']} counters={ph['counter_meas']} fix={ph['fix']} dirty={ph['dirty']} | frames phase={ph['frames_phase']} gpio={ph['frames_gpio']}")
+    except Exception as e:
+        print(f"CTRL phase err: {e}")
+    try:
+        zn = ctrl_get_zone(dev)
+        if zn:
+            print(f"ZONE v{zn['ver']} on={int(zn['on'])} us={int(zn['us'])} applied={int(zn['applied'])} | zones={zn['count']}/{zn['cfg']} {zn['zones']} N={zn['N']} samples={zn['samples']} | frames zoned={zn['frames_zoned']} whole={zn['frames_whole']} saved={zn['saved']} B")
+    except Exception as e:
+        print(f"CTRL zone err: {e}")
+    try:
+        ch = ctrl_get_cache(dev)
+        if ch:
+            cpu = 'n/a' if ch['cpu_permille'] is None else f"{ch['cpu_permille'] / 10:.1f}%"
+            print(f"CACH v{ch['ver']} icache={int(ch['icache'])} dcache={int(ch['dcache'])} usb_wt={int(ch['usb_wt'])} | loop_cyc={ch['loop_cyc']} cpu={cpu} isr={ch['isr_permille']/10:.1f}% wfi={ch['wakeups']}/s | prepare_pair n={ch['prep_n']} avg={ch['prep_avg']} max={ch['prep_max']} cyc | adc_irq avg={ch['adc_irq_avg']} max={ch['adc_irq_max']} cyc | itcm={ch['itcm']} dtcm_hot={ch['dtcm_hot']} B | adc_dma=0x{ch['adc_base']:08X}+{ch['adc_size']} usb_dma=0x{ch['usb_base']:08X}+{ch['usb_size']}")
+    except Exception as e:
+        print(f"CTRL cache err: {e}")
+    try:
+        bt = ctrl_get_boot(dev)
+        if bt:
+            marks = ' '.join(f"{n}={'-' if v is None else v}" for n, v in bt['marks'].items())
+            print(f"BOOT v{bt['ver']} flash={int(bt['flash'])} icache={int(bt['icache'])} dcache={int(bt['dcache'])} sysclk={bt['sysclk']} | us: {marks} | copy itcm={bt['itcm_copy']} data={bt['data_copy']} usb={bt['usb_copy']} B")
+    except Exception as e:
+        print(f"CTRL boot err: {e}")
+    try:
+        ul = ctrl_get_ulog(dev)
+        if ul:
+            print(f"ULOG v{ul['ver']} run={int(ul['run'])} busy={int(ul['busy'])} | ring={ul['level']}/{ul['ring']} hwm={ul['hwm']} | lines={ul['writes']} in={ul['bytes_in']} out={ul['bytes_out']} B | dropped lines={ul['drop_w']} bytes={ul['drop_b']} | dma chunks={ul['chunks']} err={ul['errors']} | write cyc avg={ul['cyc_avg']} max={ul['cyc_max']}")
+    except Exception as e:
+        print(f"CTRL ulog err: {e}")
     # STOP
     try:
         dev.write(EP_OUT, bytes([CMD_STOP]), timeout=500)
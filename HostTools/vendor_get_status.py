@@ -7,7 +7,7 @@ CMD_GET_STATUS=0x30; CMD_START=0x20; CMD_STOP=0x21
 LAYOUT = [
   (0,4,'sig'),      # 'STAT'
   (4,1,'version'),
-  (5,1,'reserved0'),
+  (5,1,'cpu_load_pct'),  # version>=3, 0xFF — не измеряется
   (6,2,'cur_samples'),
   (8,2,'frame_bytes'),
   (10,2,'test_frames'),
@@ -23,11 +23,12 @@ LAYOUT = [
   (48,2,'flags_runtime'),
   (50,2,'flags2'),
   (52,1,'sending_ch'),
-  (53,1,'reserved2'),
-  (54,2,'pair_idx'),
+  (53,1,'isr_pct'),       # version>=3
+  (54,1,'txq_depth'),
+  (55,1,'txq_hwm'),
   (56,2,'last_tx_len'),
   (58,4,'cur_stream_seq'),
-  (62,2,'reserved3'),
+  (62,2,'txq_underrun'),
 ]
 
 FLAG2_BITS = [
@@ -42,7 +42,6 @@ def parse_stat(buf: bytes):
     flags_runtime = int.from_bytes(buf[48:50], 'little')
     flags2 = int.from_bytes(buf[50:52], 'little')
     sending_ch = buf[52]
-    pair_idx = int.from_bytes(buf[54:56], 'little')
     last_tx_len = int.from_bytes(buf[56:58], 'little')
     cur_stream_seq = int.from_bytes(buf[58:62], 'little')
     return {
@@ -56,8 +55,9 @@ def parse_stat(buf: bytes):
         'flags_rt': flags_runtime,
         'flags2': flags2,
         'sending_ch': sending_ch,
-        'pair_fill': (pair_idx >> 8) & 0xFF,
-        'pair_send': pair_idx & 0xFF,
+        'txq_depth': buf[54],
+        'txq_hwm': buf[55],
+        'txq_underrun': int.from_bytes(buf[62:64], 'little'),
         'last_tx_len': last_tx_len,
         'cur_stream_seq': cur_stream_seq,
     }
@@ -86,7 +86,7 @@ def main():
         if head == b'STAT':
             st = parse_stat(bytes(data))
             if st:
-                print(f"STAT v{st['ver']} flags2=0x{st['flags2']:04X} cur_samples={st['cur_samples']} wr={st['wr']} seq={st['cur_stream_seq']} sentA/B={st['sent0']}/{st['sent1']} dma0/1={st['dma0']}/{st['dma1']} sending={st['sending_ch']} pair fs={st['pair_fill']}/{st['pair_send']} lastTX={st['last_tx_len']}")
+                print(f"STAT v{st['ver']} flags2=0x{st['flags2']:04X} cur_samples={st['cur_samples']} wr={st['wr']} seq={st['cur_stream_seq']} sentA/B={st['sent0']}/{st['sent1']} dma0/1={st['dma0']}/{st['dma1']} sending={st['sending_ch']} txq {st['txq_depth']}/{st['txq_hwm']} und={st['txq_underrun']} lastTX={st['last_tx_len']}")
         elif len(data) >= 4 and data[0]==0x5A and data[1]==0xA5:
             flags = data[3]
             if flags & 0x80:
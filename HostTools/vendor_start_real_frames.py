@@ -85,7 +85,7 @@ def main():
     last_info_print = 0.0
 
     while shown < args.count:
-        pkt = dev.read(2048, timeout=300)
+        pkt = dev.read(4096, timeout=300)
         if pkt is None:
             now = time.time()
             if shown == 0 and now > first_frame_deadline:
@@ -4,9 +4,12 @@
 # - Reads frames, verifies strict A→B ordering (B immediately after A),
 #   allows STAT only between pairs, prints brief stats and FPS.
 # - Optionally requests STAT with GET_STATUS as a keepalive.
+# - With --crc asks the firmware for crc16 in every frame and verifies it.
+# - With --compress asks for compressed payloads (flag 0x10) and unpacks them via frame_rice.py.
 
-import sys, struct, time, argparse
+import sys, struct, time, argparse, binascii, math
 import usb.core, usb.util
+import frame_rice
 
 # Commands (must match firmware)
 VND_CMD_START_STREAM      = 0x20
@@ -18,6 +21,31 @@ VND_CMD_SET_TRUNC_SAMPLES = 0x16
 VND_CMD_SET_FRAME_SAMPLES = 0x17
 VND_CMD_SET_FULL_MODE     = 0x13
 VND_CMD_SET_PROFILE       = 0x14
+VND_CMD_SET_BURST         = 0x18
+VND_CMD_SET_FRAME_FMT     = 0x19
+VND_CMD_SET_CRC           = 0x32
+VND_CMD_SET_COMPRESS      = 0x1A
+VND_CMD_SET_ACQ           = 0x1B
+VND_CMD_SET_LOCKIN        = 0x1C
+VND_CMD_SET_ROI_US        = 0x15
+VND_CMD_SET_ROI           = 0x1D
+STATUS_PAGE_ACQ           = 4
+STATUS_PAGE_LOCKIN        = 5
+STATUS_PAGE_PHASE         = 6
+STATUS_PAGE_ZONE          = 7
+
+FRAME_VER_STEREO = 0x02   # v2: один кадр на пару, payload 4*ns (L/R)
+FRAME_VER_LOCKIN = 0x03   # v3: ns записей lock-in по 64 байта (SET_FRAME_FMT 3)
+FMT_LOCKIN       = 3
+LOCKIN_REC_SIZE  = 64
+LOCKIN_REC_GAP   = 0x0001 # перед записью был разрыв
+FLAG_PLANAR      = 0x08   # v2: L[0..ns-1], затем R[0..ns-1]; иначе L0 R0 L1 R1 ...
+FLAG_CRC         = 0x04   # crc16 (байты 30..31) валиден
+FLAG_RICE        = 0x10   # payload сжат (разности + код Райса), длина — comp_len (байты 24..27)
+FLAG_RESYNC      = 0x20   # первый кадр после смены профиля: новый ns и период меток
+FLAG_PHASE       = 0x40   # байты 16..23 — фронты меандра TIM2 в кадре (edge_rise, edge_fall, P, H)
+
+BURST_BUF_SIZE = 16384  # максимум одной пачки burst (VND_BURST_BUF_SIZE в прошивке)
 
 MAGIC = 0xA55A
 
@@ -72,28 +100,145 @@ def le32(v):
     return struct.pack('<I', v)
 
 
+def frame_len(ver: int, ns: int, flags: int = 0, comp_len: int = 0, zones: int = 0) -> int:
+    # zones — zone_count (байт 14): таблица зон ROI 4*(zones+1) байт перед отсчётами
+    zt = 4 * (zones + 1) if zones else 0
+    if flags & FLAG_RICE:
+        return 32 + zt + comp_len
+    if ver == FRAME_VER_LOCKIN:
+        return 32 + ns * LOCKIN_REC_SIZE
+    return 32 + zt + ns * (4 if ver >= FRAME_VER_STEREO else 2)
+
+
+def rate_from_code(code: int) -> int:
+    """rate_code заголовка (байты 28..29): Fs = (code & 0xFFF) << (code >> 12), Гц; 0 — не указана."""
+    return (code & 0xFFF) << (code >> 12)
+
+
 def parse_frame(buf: bytes):
     if len(buf) < 32:
         return None
-    magic, ver, flags, seq, ts, total_samples, zone_cnt = struct.unpack_from('<HBBIIHH', buf, 0)[:7]
+    magic, ver, flags, seq, ts, total_samples, zone_cnt, bits = struct.unpack_from('<HBBIIHBB', buf, 0)[:8]
     if magic != MAGIC:
         return None
-    total = 32 + total_samples * 2
+    total = frame_len(ver, total_samples, flags, struct.unpack_from('<I', buf, 24)[0], zone_cnt)
     if total != len(buf):
         # Allow short reads with extra zero padding on some stacks
         if len(buf) < total:
             return None
         buf = buf[:total]
+    # Зоны ROI: {N, 0}, затем (start, len) в отсчётах кадра АЦП; отсчёты зон идут подряд
+    zones, nfull = [], total_samples
+    if zone_cnt:
+        tab = struct.unpack_from(f'<{2 * (zone_cnt + 1)}H', buf, 32)
+        nfull = tab[0]
+        zones = [(tab[2 * i], tab[2 * i + 1]) for i in range(1, zone_cnt + 1)]
+    phase = None
+    if flags & FLAG_PHASE:
+        rise, fall, per, high = struct.unpack_from('<HHHH', buf, 16)
+        phase = {'rise': rise, 'fall': fall, 'P': per, 'H': high}
     return {
         'ver': ver,
         'flags': flags,
+        'phase': phase,
+        'zones': zones,
+        'nfull': nfull,
         'seq': seq,
         'ts': ts,
         'ns': total_samples,
+        'bits': bits,
+        'fs': rate_from_code(struct.unpack_from('<H', buf, 28)[0]),
         'len': len(buf),
         'raw': buf,
     }
 
+def frame_crc_ok(raw: bytes) -> bool:
+    """CRC16-CCITT-FALSE по 30 байтам заголовка и payload (crc_hqx с init 0xFFFF — тот же алгоритм)."""
+    crc = binascii.crc_hqx(raw[32:], binascii.crc_hqx(raw[:30], 0xFFFF))
+    return crc == struct.unpack_from('<H', raw, 30)[0]
+
+
+def parse_lockin(fr):
+    """Записи кадра v3. I/Q/DC — средние на отсчёт в кодах АЦП; опоры с H != P/2 несут постоянную
+    составляющую, она вычитается по сумме отсчётов. Для синуса амплитуды A в фазе с меандром R ≈ 2A/π."""
+    recs = []
+    for k in range(fr['ns']):
+        seq, t_end, m, p, h, flags, i0, i1, q0, q1, s0, s1 = struct.unpack_from('<IIHHHHqqqqQQ', fr['raw'], 32 + k * LOCKIN_REC_SIZE)
+        n = m * p
+        dc_leak = (2 * h - p) / p if p else 0.0
+        ch = []
+        for i, q, sm in ((i0, q0, s0), (i1, q1, s1)):
+            x = (i - sm * dc_leak) / n if n else 0.0
+            y = (q - sm * dc_leak) / n if n else 0.0
+            ch.append({'x': x, 'y': y, 'r': math.hypot(x, y), 'deg': math.degrees(math.atan2(y, x)), 'dc': sm / n if n else 0.0})
+        recs.append({'seq': seq, 't': t_end, 'periods': m, 'P': p, 'H': h, 'flags': flags, 'ch': ch})
+    return recs
+
+
+def phase_k0(ph) -> int:
+    """Фаза первого отсчёта кадра в периоде меандра: первый фронт вверх — отсчёт (P - k0) % P."""
+    return (ph['P'] - ph['rise']) % ph['P']
+
+
+def phase_segments(ph, ns: int):
+    """Разбить кадр на участки высокого/низкого уровня меандра: [(начало, конец, 1|0), ...].
+    Отсчёт i имеет фазу (k0 + i) % P, высокий уровень — фаза < H."""
+    p, h = ph['P'], ph['H']
+    k = phase_k0(ph)
+    segs, i = [], 0
+    while i < ns:
+        lvl = 1 if k < h else 0
+        run = min((h if lvl else p) - k, ns - i)
+        segs.append((i, i + run, lvl))
+        i += run
+        k = (k + run) % p
+    return segs
+
+
+def split_stereo(fr):
+    """Разобрать payload стерео-кадра v2 на списки L и R (сжатый кадр сначала распаковывается)."""
+    ns = fr['ns']
+    pcm = fr['pcm'] if 'pcm' in fr else frame_rice.payload(fr['raw'])
+    s = struct.unpack_from(f'<{2 * ns}H', pcm, 0)
+    if fr['flags'] & FLAG_PLANAR:
+        return list(s[:ns]), list(s[ns:])
+    return list(s[0::2]), list(s[1::2])
+
+
+class TsTrack:
+    """Метки кадров (мкс, u32 с переносом раз в ~71 мин): 64-битное время, период и разрывы по времени."""
+    def __init__(self):
+        self.t64 = None
+        self.prev32 = None
+        self.dts = []
+
+    def add(self, ts32: int) -> int:
+        if self.prev32 is None:
+            self.t64 = ts32
+        else:
+            d = (ts32 - self.prev32) & 0xFFFFFFFF
+            self.t64 += d
+            self.dts.append(d)
+        self.prev32 = ts32
+        return self.t64
+
+    def resync(self):
+        """Смена профиля: время продолжается, период и разрывы считаем заново (для нового профиля)."""
+        self.dts = []
+
+    def summary(self):
+        """(период мкс, макс. отклонение мкс, число разрывов, потеряно кадров) или None."""
+        if len(self.dts) < 2:
+            return None
+        per = sorted(self.dts)[len(self.dts) // 2]
+        if per == 0:
+            return None
+        gaps = [d for d in self.dts if d > per * 3 // 2]
+        lost = sum(round(d / per) - 1 for d in gaps)
+        jit = max((abs(d - per) for d in self.dts if d <= per * 3 // 2), default=0)
+        return per, jit, len(gaps), lost
+
+
 def parse_stat(buf: bytes):
     if len(buf) < 64 or buf[:4] != b'STAT':
         return None
@@ -114,9 +259,11 @@ def parse_stat(buf: bytes):
     st['flags_rt'] = int.from_bytes(buf[48:50], 'little')
     st['flags2'] = int.from_bytes(buf[50:52], 'little')
     st['sending_ch'] = buf[52]
-    st['pair_idx'] = int.from_bytes(buf[54:56], 'little')
+    st['txq_depth'] = buf[54]
+    st['txq_hwm'] = buf[55]
     st['last_tx_len'] = int.from_bytes(buf[56:58], 'little')
     st['cur_stream_seq'] = int.from_bytes(buf[58:62], 'little')
+    st['txq_underrun'] = int.from_bytes(buf[62:64], 'little')
     return st
 
 
@@ -128,6 +275,11 @@ def main():
     ap.add_argument('--ep-in', type=lambda x: int(x,0), default=0x83)
     ap.add_argument('--ep-out', type=lambda x: int(x,0), default=0x03)
     ap.add_argument('--profile', type=int, default=2, help='1=A(200Hz), 2=B(default)')
+    ap.add_argument('--fs', type=int, default=0, help='Arbitrary ADC sample rate, Hz (CMD 0x1B, overrides --profile; 0=use profile)')
+    ap.add_argument('--acq-samples', type=int, default=0, help='ADC frame length for --fs (0=keep current N)')
+    ap.add_argument('--ovs', type=int, default=0, help='ADC hardware oversampling ratio for --fs (0/1=off, up to 1024)')
+    ap.add_argument('--ovs-shift', type=int, default=-1, help='Right shift of the oversampled sum (-1 = ceil(log2 ratio), keeps 16 bits)')
+    ap.add_argument('--switch-every', type=int, default=0, help='Toggle profile 1<->2 every K pairs while streaming (0=off)')
     ap.add_argument('--frame-samples', type=int, default=10, help='Samples per channel per frame (A and B)')
     ap.add_argument('--full-mode', type=int, default=1, help='1=ADC mode, 0=diagnostic')
     ap.add_argument('--block-hz', type=int, default=200, help='ADC block rate hint')
@@ -138,10 +290,19 @@ def main():
     ap.add_argument('--win0-len', type=int, default=300)
     ap.add_argument('--win1-start', type=int, default=700)
     ap.add_argument('--win1-len', type=int, default=300)
+    ap.add_argument('--zones', type=str, default='', help='ROI zones "start:len,start:len,..." in ADC samples (up to 8, replaces --win0/--win1)')
+    ap.add_argument('--roi-us', type=str, default='', help='ROI zones "start:len,..." in microseconds (CMD 0x15, replaces --zones)')
+    ap.add_argument('--roi', action='store_true', help='Send only the zones of every ADC frame (CMD 0x1D, full mode)')
     ap.add_argument('--status-interval', type=float, default=0.5, help='Request GET_STATUS every N seconds (0=off)')
     ap.add_argument('--ctrl-status', action='store_true', help='Use control transfer for GET_STATUS (works even mid-pair)')
     ap.add_argument('--ab-strict', action='store_true', help='Fail if A→B ordering is violated or STAT appears mid-pair')
     ap.add_argument('--quiet', action='store_true', help='Reduce per-frame prints, show only summary and warnings')
+    ap.add_argument('--burst', type=int, default=0, help='Pack K A/B pairs into one bulk transfer (0/1=off, full mode only)')
+    ap.add_argument('--crc', action='store_true', help='Ask firmware for crc16 in every frame (CMD 0x32) and verify it')
+    ap.add_argument('--compress', action='store_true', help='Ask firmware for compressed payloads (CMD 0x1A) and unpack them')
+    ap.add_argument('--stereo', type=int, choices=(0, 1, 2), default=0, help='Frame format: 0=A/B pair, 1=v2 interleaved L/R, 2=v2 planar (full mode only)')
+    ap.add_argument('--lockin', type=int, default=0, help='On-device lock-in: M meander periods per I/Q record (CMD 0x1C + frame format 3, overrides --stereo; 0=off)')
+    ap.add_argument('--lockin-recs', type=int, default=8, help='Lock-in records per USB frame (1..32)')
     args = ap.parse_args()
 
     dev = find_device(args.vid, args.pid)
@@ -153,26 +314,110 @@ def main():
     # Configure
     # Set windows first (some firmware profiles expect non-zero windows to start streaming)
     try:
-        payload = struct.pack('<BHHHH', VND_CMD_SET_WINDOWS, args.win0_start, args.win0_len, args.win1_start, args.win1_len)
+        if args.zones:
+            zl = [tuple(int(v) for v in z.split(':')) for z in args.zones.split(',')]
+            payload = bytes([VND_CMD_SET_WINDOWS]) + b''.join(struct.pack('<HH', a, b) for a, b in zl)
+        else:
+            payload = struct.pack('<BHHHH', VND_CMD_SET_WINDOWS, args.win0_start, args.win0_len, args.win1_start, args.win1_len)
         send_cmd(dev, ep_out, payload)
+        if args.roi_us:
+            zl = [tuple(int(v) for v in z.split(':')) for z in args.roi_us.split(',')]
+            send_cmd(dev, ep_out, bytes([VND_CMD_SET_ROI_US]) + b''.join(struct.pack('<II', a, b) for a, b in zl))
     except Exception:
         pass
+    # ROI задаётся до START, как и burst; 0 возвращает кадры целиком
+    send_cmd(dev, ep_out, bytes([VND_CMD_SET_ROI, 1 if args.roi else 0]))
     send_cmd(dev, ep_out, bytes([VND_CMD_SET_PROFILE, args.profile & 0xFF]))
+    if args.fs:
+        # Fs пересчитывается в PSC/ARR TIM15; что получилось — на странице ACQS (EP0, wValue=4)
+        cmd = bytes([VND_CMD_SET_ACQ]) + le32(args.fs) + le16(args.acq_samples)
+        if args.ovs > 1:
+            shift = args.ovs_shift if args.ovs_shift >= 0 else (args.ovs - 1).bit_length()
+            cmd += le16(args.ovs) + bytes([shift & 0xFF])
+        send_cmd(dev, ep_out, cmd)
+        time.sleep(0.05)
+        try:
+            raw = bytes(dev.ctrl_transfer(0xC0, VND_CMD_GET_STATUS, STATUS_PAGE_ACQ, 0, 64, timeout=300))
+            if raw[:4] == b'ACQS':
+                fs_mhz, = struct.unpack_from('<Q', raw, 12)
+                psc, arr = struct.unpack_from('<HH', raw, 24)
+                n, = struct.unpack_from('<H', raw, 34)
+                ring_ms, = struct.unpack_from('<I', raw, 40)
+                rc = struct.unpack_from('<b', raw, 48)[0]
+                ovs, ovs_sh, bits = struct.unpack_from('<HBB', raw, 49)
+                print(f"[ACQ] req={args.fs} Hz got={fs_mhz/1000:.3f} Hz N={n} psc={psc} arr={arr} ring={ring_ms} ms rc={rc} aligned={int(bool(raw[5] & 0x02))} ovs={ovs}>>{ovs_sh} bits={bits}")
+        except Exception as e:
+            print(f"[ACQ] status read failed: {e}")
     send_cmd(dev, ep_out, bytes([VND_CMD_SET_BLOCK_HZ]) + le16(args.block_hz))
     send_cmd(dev, ep_out, bytes([VND_CMD_SET_FRAME_SAMPLES]) + le16(args.frame_samples))
     send_cmd(dev, ep_out, bytes([VND_CMD_SET_FULL_MODE, 1 if args.full_mode else 0]))
+    # Burst задаётся до START (во время стрима прошивка команду игнорирует); 0 выключает режим
+    send_cmd(dev, ep_out, bytes([VND_CMD_SET_BURST, max(0, min(args.burst, 255))]))
+    # Формат кадра тоже только до START; стерео-кадр v2 вдвое длиннее A/B (до 5472 B)
+    if args.lockin > 0:
+        # Записи I/Q вместо отсчётов: M периодов меандра на запись, K записей в кадре v3
+        send_cmd(dev, ep_out, bytes([VND_CMD_SET_LOCKIN]) + le16(min(args.lockin, 0xFFFF)) + bytes([max(1, min(args.lockin_recs, 32))]))
+        send_cmd(dev, ep_out, bytes([VND_CMD_SET_FRAME_FMT, FMT_LOCKIN]))
+    else:
+        send_cmd(dev, ep_out, bytes([VND_CMD_SET_FRAME_FMT, args.stereo]))
+    # CRC тоже только вне стрима; без --crc явно выключаем, чтобы не унаследовать прошлый запуск
+    send_cmd(dev, ep_out, bytes([VND_CMD_SET_CRC, 1 if args.crc else 0]))
+    send_cmd(dev, ep_out, bytes([VND_CMD_SET_COMPRESS, 1 if args.compress else 0]))
+    if args.compress and not frame_rice.have_c_decoder():
+        print("[INFO] frame_rice_decode.so/.dll not found, using slow Python decoder")
+    read_size = BURST_BUF_SIZE if args.burst > 1 else (8192 if args.stereo else 4096)
 
     # Start
     send_cmd(dev, ep_out, bytes([VND_CMD_START_STREAM]))
 
     want_frames = args.frames
-    got_a = got_b = tests = 0
+    got_a = got_b = got_st = tests = 0
+    crc_ok = crc_bad = crc_missing = 0
+    rice_frames = rice_bad = 0
+    bytes_raw = bytes_wire = 0
     expect_b = False
     last_status = 0.0
     last_seq = None
     first_seq = None
     first_pair_time = None
     last_pair_time = None
+    ts = TsTrack()
+    resyncs = 0
+    switch_prof = args.profile
+    lk_frames = lk_recs = lk_gaps = lk_lost = lk_samples = 0
+    lk_next = None
+    ph_frames = ph_bad = 0
+    ph_next = None
+    roi_frames = roi_full = roi_sent = 0
+    roi_first = True
+
+    def on_pair(fr):
+        # Метки кадра; RESYNC — первый кадр нового профиля, дальше период считается по нему
+        nonlocal resyncs, switch_prof, ph_frames, ph_bad, ph_next
+        if fr['flags'] & FLAG_RESYNC:
+            resyncs += 1
+            ts.resync()
+            print(f"[RESYNC] seq={fr['seq']} ns={fr['ns']}")
+        if ts.prev32 is None or fr['flags'] & FLAG_RESYNC:
+            print(f"[FMT] fs={fr['fs']} Hz bits={fr['bits']} ns={fr['ns']}")
+        ts.add(fr['ts'])
+        # Фаза меандра: без разрыва по seq фаза кадра продолжает предыдущий ((k0 + ns) % P)
+        ph = fr['phase']
+        if ph and ph['P']:
+            k0 = phase_k0(ph)
+            if ph_frames == 0 or (fr['flags'] & FLAG_RESYNC):
+                print(f"[PHASE] seq={fr['seq']} P={ph['P']} H={ph['H']} rise={ph['rise']} fall={ph['fall']}")
+            elif ph_next is not None and ph_next[0] == fr['seq'] and ph_next[1] != k0:
+                ph_bad += 1
+                if not args.quiet:
+                    print(f"[PHASE] seq={fr['seq']} k0={k0} expected {ph_next[1]}")
+            ph_frames += 1
+            ph_next = ((fr['seq'] + 1) & 0xFFFFFFFF, (k0 + fr['nfull']) % ph['P'])
+        else:
+            ph_next = None
+        if args.switch_every > 0 and (got_a + got_st) % args.switch_every == 0:
+            switch_prof = 1 if switch_prof == 2 else 2
+            send_cmd(dev, ep_out, bytes([VND_CMD_SET_PROFILE, switch_prof]))
 
     try:
         t0 = time.time()
@@ -183,7 +428,7 @@ def main():
             out = acc[:n]
             acc = acc[n:]
             return out
-        while got_a + got_b + tests < want_frames:
+        while got_a + got_b + 2 * got_st + tests < want_frames:
             # Periodically ask for status (device will send between pairs)
             now = time.time()
             if args.status_interval > 0 and (now - last_status) >= args.status_interval:
@@ -194,7 +439,7 @@ def main():
                         buf = bytes(raw)
                         st = parse_stat(buf)
                         if st and not args.quiet:
-                            print(f"STAT[vnd-ctl] v{st['ver']} f2=0x{st['flags2']:04X} cur={st['cur_samples']} seq={st['cur_stream_seq']} sentA/B={st['sent0']}/{st['sent1']} wr={st['wr']} dma0/1={st['dma0']}/{st['dma1']} lastTX={st['last_tx_len']} send={st['sending_ch']} pair fs={st['pair_idx']>>8}/{st['pair_idx']&0xFF}")
+                            print(f"STAT[vnd-ctl] v{st['ver']} f2=0x{st['flags2']:04X} cur={st['cur_samples']} seq={st['cur_stream_seq']} sentA/B={st['sent0']}/{st['sent1']} wr={st['wr']} dma0/1={st['dma0']}/{st['dma1']} lastTX={st['last_tx_len']} send={st['sending_ch']} txq {st['txq_depth']}/{st['txq_hwm']} und={st['txq_underrun']}")
                         elif not args.quiet:
                             print("STAT[vnd-ctl]", buf[:16].hex(), "len=", len(buf))
                     else:
@@ -204,9 +449,9 @@ def main():
                         print("GET_STATUS err:", e)
                 last_status = now
 
-            # Читать крупнее, чтобы получить целый кадр HS (до ~2KB)
+            # Читать крупнее, чтобы получить целый кадр (до 2752 B, стерео до 5472 B) или целую пачку burst за один вызов
             try:
-                chunk = dev.read(ep_in, 2048, timeout=args.timeout)
+                chunk = dev.read(ep_in, read_size, timeout=args.timeout)
             except usb.core.USBError as e:
                 if e.errno is None:
                     print(f"IN error: {e}")
@@ -216,7 +461,9 @@ def main():
                 chunk = b""
             acc += bytes(chunk)
 
-            # Парсинг acc: возможен leading мусор — сдвигаем до 'STAT' или 0x5A 0xA5
+            # Парсинг acc: возможен leading мусор — сдвигаем до 'STAT' или 0x5A 0xA5.
+            # Пачка burst — те же кадры A0,B0,A1,B1,... вплотную; нулевой паддинг до MPS в её конце
+            # отбрасывается этим же выравниванием.
             progressed = True
             while progressed:
                 progressed = False
@@ -236,7 +483,7 @@ def main():
                     if not args.quiet:
                         stp = parse_stat(st)
                         if stp:
-                            print(f"STAT v{stp['ver']} f2=0x{stp['flags2']:04X} cur={stp['cur_samples']} seq={stp['cur_stream_seq']} sentA/B={stp['sent0']}/{stp['sent1']} wr={stp['wr']} dma0/1={stp['dma0']}/{stp['dma1']} lastTX={stp['last_tx_len']} send={stp['sending_ch']} pair fs={stp['pair_idx']>>8}/{stp['pair_idx']&0xFF}")
+                            print(f"STAT v{stp['ver']} f2=0x{stp['flags2']:04X} cur={stp['cur_samples']} seq={stp['cur_stream_seq']} sentA/B={stp['sent0']}/{stp['sent1']} wr={stp['wr']} dma0/1={stp['dma0']}/{stp['dma1']} lastTX={stp['last_tx_len']} send={stp['sending_ch']} txq {stp['txq_depth']}/{stp['txq_hwm']} und={stp['txq_underrun']}")
                         else:
                             print("STAT", st[:16].hex(), "len=64")
                     progressed = True
@@ -249,12 +496,12 @@ def main():
                     acc = acc[1:]
                     progressed = True
                     continue
-                # Достанем ns и длину кадра
+                # Достанем ver, ns и длину кадра
                 try:
                     total_samples = struct.unpack_from('<H', acc, 12)[0]
                 except Exception:
                     break
-                total_len = 32 + total_samples * 2
+                total_len = frame_len(acc[2], total_samples, acc[3], struct.unpack_from('<I', acc, 24)[0], acc[14])
                 # В DIAG-режиме устройство может паддировать кадры до кратности 512 (HS MPS)
                 padded_len = total_len
                 if not args.full_mode:
@@ -276,22 +523,109 @@ def main():
                     progressed = True
                     continue
                 fl = fr['flags']
+                if fl & FLAG_CRC:
+                    if frame_crc_ok(fr['raw']):
+                        crc_ok += 1
+                    else:
+                        crc_bad += 1
+                        print(f"[CRC] bad seq={fr['seq']} flags=0x{fl:02X} len={fr['len']}")
+                        if args.ab_strict:
+                            sys.exit(5)
+                elif args.crc and not (fl & 0x80):
+                    crc_missing += 1  # очередь CRC прошивки была полна (PERF.crc_skipped)
+                if not (fl & 0x80) and fr['ver'] != FRAME_VER_LOCKIN:
+                    bps = 4 if fr['ver'] >= FRAME_VER_STEREO else 2
+                    ztab = 4 * (len(fr['zones']) + 1) if fr['zones'] else 0
+                    bytes_wire += fr['len'] - 32 - ztab
+                    bytes_raw += fr['ns'] * bps
+                    if fr['zones']:
+                        roi_frames += 1
+                        roi_full += fr['nfull'] * bps
+                        roi_sent += fr['len'] - 32
+                        if roi_first:
+                            roi_first = False
+                            print(f"[ROI] N={fr['nfull']} zones={fr['zones']} samples/ch={fr['ns']}")
+                if fl & FLAG_RICE:
+                    rice_frames += 1
+                    try:
+                        fr['pcm'] = frame_rice.payload(fr['raw'])
+                    except ValueError as e:
+                        rice_bad += 1
+                        print(f"[RICE] seq={fr['seq']} flags=0x{fl:02X} len={fr['len']}: {e}")
+                        if args.ab_strict:
+                            sys.exit(6)
+                        progressed = True
+                        continue
                 if fl & 0x80:
                     tests += 1
                     if not args.quiet:
                         print(f"TEST len={fr['len']}")
                     progressed = True
                     continue
+                if fr['ver'] == FRAME_VER_LOCKIN:
+                    # Кадр lock-in v3: записи I/Q, пара не делится на A/B
+                    got_st += 1
+                    lk_frames += 1
+                    on_pair(fr)
+                    last_seq = fr['seq']
+                    if first_seq is None:
+                        first_seq = fr['seq']
+                        first_pair_time = time.time()
+                    last_pair_time = time.time()
+                    for r in parse_lockin(fr):
+                        lk_recs += 1
+                        lk_samples += r['periods'] * r['P']
+                        if r['flags'] & LOCKIN_REC_GAP:
+                            lk_gaps += 1
+                        if lk_next is not None and r['seq'] != lk_next:
+                            lk_lost += (r['seq'] - lk_next) & 0xFFFFFFFF
+                        lk_next = (r['seq'] + 1) & 0xFFFFFFFF
+                        if not args.quiet:
+                            c0, c1 = r['ch']
+                            gap = ' GAP' if r['flags'] & LOCKIN_REC_GAP else ''
+                            print(f"LK rec={r['seq']} t={r['t']}us M={r['periods']} P={r['P']} "
+                                  f"ch0 R={c0['r']:.2f} {c0['deg']:+.1f}° dc={c0['dc']:.1f} "
+                                  f"ch1 R={c1['r']:.2f} {c1['deg']:+.1f}° dc={c1['dc']:.1f}{gap}")
+                    bytes_wire += fr['len']
+                    progressed = True
+                    continue
+                if fr['ver'] >= FRAME_VER_STEREO:
+                    # Стерео-кадр v2 — целая пара за один трансфер
+                    if expect_b:
+                        msg = "stereo frame while expecting B"
+                        if args.ab_strict:
+                            print("[VIOLATION]", msg)
+                            sys.exit(4)
+                        print("[WARN]", msg)
+                        expect_b = False
+                    got_st += 1
+                    on_pair(fr)
+                    last_seq = fr['seq']
+                    if first_seq is None:
+                        first_seq = fr['seq']
+                        first_pair_time = time.time()
+                    last_pair_time = time.time()
+                    if not args.quiet:
+                        left, right = split_stereo(fr)
+                        kind = 'planar' if (fl & FLAG_PLANAR) else 'il'
+                        phs = ''
+                        if fr['phase'] and fr['phase']['P']:
+                            segs = phase_segments(fr['phase'], fr['ns'])
+                            phs = f" k0={phase_k0(fr['phase'])} segs={len(segs)} high={sum(e - b for b, e, lvl in segs if lvl)}"
+                        print(f"ST({kind}) seq={fr['seq']} t={ts.t64}us ns={fr['ns']} len={fr['len']} L0={left[0] if left else '-'} R0={right[0] if right else '-'}{phs}")
+                    progressed = True
+                    continue
                 ch = 'A' if (fl & 0x01) else 'B'
                 if ch == 'A':
                     got_a += 1
+                    on_pair(fr)
                     expect_b = True
                     last_seq = fr['seq']
                     if first_seq is None:
                         first_seq = fr['seq']
                         first_pair_time = time.time()
                     if not args.quiet:
-                        print(f"A seq={fr['seq']} ns={fr['ns']} len={fr['len']}")
+                        print(f"A seq={fr['seq']} t={ts.t64}us ns={fr['ns']} len={fr['len']}")
                 else:
                     got_b += 1
                     if last_seq is not None and fr['seq'] != last_seq:
@@ -311,10 +645,57 @@ def main():
     # FPS by completed pairs (seq increments)
         fps = 0.0
         if first_seq is not None and last_pair_time is not None and last_pair_time > first_pair_time:
-            pairs = (fr['seq'] - first_seq + 1) if fr is not None else (got_b)
+            pairs = (fr['seq'] - first_seq + 1) if fr is not None else (got_b + got_st)
             if pairs > 0:
                 fps = pairs / (last_pair_time - first_pair_time)
-        print(f"Done. A={got_a} B={got_b} TEST={tests} time={dt:.2f}s pairs_fps≈{fps:.1f}")
+        print(f"Done. A={got_a} B={got_b} ST={got_st} TEST={tests} time={dt:.2f}s pairs_fps≈{fps:.1f}")
+        tsum = ts.summary()
+        if tsum:
+            per, jit, gaps, lost = tsum
+            ns = fr['nfull'] if fr is not None else 0
+            fs = f" fs≈{ns * 1e6 / per:.0f} S/s" if ns else ""
+            print(f"TS period={per}us{fs} jitter=±{jit}us gaps={gaps} lost≈{lost}")
+        if resyncs or args.switch_every:
+            print(f"RESYNC frames={resyncs}")
+        if roi_frames or args.roi:
+            print(f"ROI frames={roi_frames} payload {roi_full} B -> {roi_sent} B ({roi_sent / roi_full if roi_full else 0:.3f})")
+            try:
+                raw_st = bytes(dev.ctrl_transfer(0xC0, VND_CMD_GET_STATUS, STATUS_PAGE_ZONE, 0, 64, timeout=300))
+                if raw_st[:4] == b'ZONE':
+                    zfl, zcfg, zcnt, zn, zm, zfr, zwh, zsaved = struct.unpack_from('<BBBHHIIQ', raw_st, 5)
+                    print(f"[ZONE] dev flags=0x{zfl:02X} zones={zcnt}/{zcfg} N={zn} samples={zm} "
+                          f"frames zoned/whole={zfr}/{zwh} saved={zsaved} B")
+            except Exception as e:
+                print(f"[ZONE] status read failed: {e}")
+        if ph_frames or args.lockin:
+            print(f"PHASE frames={ph_frames} discontinuities={ph_bad}")
+            try:
+                raw_st = bytes(dev.ctrl_transfer(0xC0, VND_CMD_GET_STATUS, STATUS_PAGE_PHASE, 0, 64, timeout=300))
+                if raw_st[:4] == b'PHAS':
+                    (_, pfl, per, high, _, edges, emeas, cmeas, pfix, pdirty, amb, fph,
+                     fgpio) = struct.unpack_from('<BBHHH8I', raw_st, 4)
+                    print(f"[PHAS] dev flags=0x{pfl:02X} P={per} H={high} edges={edges} amb={amb} "
+                          f"meas edge/counters={emeas}/{cmeas} fix={pfix} dirty={pdirty} frames phase/gpio={fph}/{fgpio}")
+            except Exception as e:
+                print(f"[PHAS] status read failed: {e}")
+        if args.lockin or lk_frames:
+            raw = lk_samples * 4
+            print(f"LOCKIN frames={lk_frames} records={lk_recs} gap_flags={lk_gaps} lost(seq)={lk_lost} "
+                  f"samples {raw} B -> {bytes_wire} B on the wire ({raw / bytes_wire if bytes_wire else 0:.0f}x)")
+            try:
+                raw_st = bytes(dev.ctrl_transfer(0xC0, VND_CMD_GET_STATUS, STATUS_PAGE_LOCKIN, 0, 64, timeout=300))
+                if raw_st[:4] == b'LOCK':
+                    (recs, frames, gaps, nophase, aborted, ovf, pmeas, pfix, pdirty, cyc_avg, cyc_max,
+                     fout) = struct.unpack_from('<12I', raw_st, 16)
+                    print(f"[LOCK] dev records={recs} adc_frames={frames} gaps={gaps} no_phase={nophase} aborted={aborted} "
+                          f"overflow={ovf} phase meas/fix/dirty={pmeas}/{pfix}/{pdirty} cyc/frame avg={cyc_avg} max={cyc_max} v3_frames={fout}")
+            except Exception as e:
+                print(f"[LOCK] status read failed: {e}")
+        if args.crc or crc_ok or crc_bad:
+            print(f"CRC ok={crc_ok} bad={crc_bad} no_crc={crc_missing}")
+        if args.compress or rice_frames:
+            ratio = (bytes_wire / bytes_raw) if bytes_raw else 0.0
+            print(f"RICE frames={rice_frames} bad={rice_bad} payload {bytes_raw}->{bytes_wire} B ratio={ratio:.3f}")
     finally:
         try:
             send_cmd(dev, ep_out, bytes([VND_CMD_STOP_STREAM]))
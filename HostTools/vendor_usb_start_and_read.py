@@ -16,6 +16,8 @@ import argparse
 import usb.core
 import usb.util
 import struct
+import binascii
+import frame_rice
 
 def _parse_args():
     p = argparse.ArgumentParser(description="Vendor USB quick reader: START then read STAT/TEST/A/B")
@@ -34,6 +36,8 @@ def _parse_args():
     p.add_argument('--full-mode', type=int, choices=[0,1], default=int(os.getenv('VND_FULL_MODE','1')), help='1=ADC, 0=DIAG(A-only)')
     p.add_argument('--use-ctrl-status', action='store_true', help='Use control GET_STATUS instead of bulk 0x30')
     p.add_argument('--frame-samples', type=int, default=int(os.getenv('VND_FRAME_SAMPLES','0')), help='Samples per frame per channel (CMD 0x17). E.g., 10 for 200Hz, 15 for 300Hz (~20 FPS). 0=disabled')
+    p.add_argument('--crc', type=int, choices=[0,1], default=int(os.getenv('VND_CRC','0')), help='1=ask firmware for crc16 in frames (CMD 0x32) and verify it')
+    p.add_argument('--compress', type=int, choices=[0,1], default=int(os.getenv('VND_COMPRESS','0')), help='1=ask firmware for compressed payloads (CMD 0x1A) and unpack them')
     return p.parse_args()
 
 args = _parse_args()
@@ -51,11 +55,22 @@ WIN1_START, WIN1_LEN = args.win1
 RATE_HZ = args.rate_hz
 FULL_MODE = args.full_mode
 FRAME_SAMPLES = args.frame_samples
+CRC_MODE = args.crc
+COMPRESS_MODE = args.compress
 # Control GET_STATUS params
 IFACE_INDEX = args.intf  # Vendor interface index in composite config
 VND_CMD_GET_STATUS = 0x30
 VND_CMD_SET_FULL_MODE = 0x13
 VND_CMD_SET_PROFILE   = 0x14
+VND_CMD_SET_CRC       = 0x32
+VFLAG_CRC             = 0x04
+VND_CMD_SET_COMPRESS  = 0x1A
+VFLAG_RICE            = 0x10
+
+
+def frame_crc_ok(frame: bytes) -> bool:
+    # CRC16-CCITT-FALSE по 30 байтам заголовка и payload (поле crc16 в 30..31 пропускается)
+    return binascii.crc_hqx(frame[32:], binascii.crc_hqx(frame[:30], 0xFFFF)) == (frame[30] | (frame[31] << 8))
 USE_CTRL_STATUS = args.use_ctrl_status  # 1=use ctrl_transfer, 0=use bulk 0x30 (default)
 
 # Ensure log file exists early, even if device not found
@@ -118,21 +133,21 @@ def parse_stat_frame(ba: bytes):
         # Extended tail if present (64 bytes total)
         if len(ba) >= 64:
             # Offsets based on packed vnd_status_v1_t
-            # 0..3 sig, 4 version, 5 reserved0
+            # 0..3 sig, 4 version, 5 cpu_load_pct (version>=3)
             flags2 = int.from_bytes(ba[50:52], 'little')
             sending_ch = ba[52]
-            prep_calls = ba[5]   # reserved0 at offset 5
-            prep_ok    = ba[53]  # reserved2 low byte at offset 53
-            pair_idx = int.from_bytes(ba[54:56], 'little')
+            cpu_pct = ba[5]      # 0xFF — не измеряется
+            isr_pct = ba[53]
             last_tx_len = int.from_bytes(ba[56:58], 'little')
             cur_stream_seq = int.from_bytes(ba[58:62], 'little')
             res.update({
                 'flags2': flags2,
                 'sending_ch': sending_ch,
-                'prep_calls': prep_calls,
-                'prep_ok': prep_ok,
-                'pair_fill': (pair_idx >> 8) & 0xFF,
-                'pair_send': pair_idx & 0xFF,
+                'cpu_pct': cpu_pct,
+                'isr_pct': isr_pct,
+                'txq_depth': ba[54],
+                'txq_hwm': ba[55],
+                'txq_underrun': int.from_bytes(ba[62:64], 'little'),
                 'last_tx_len': last_tx_len,
                 'cur_stream_seq': cur_stream_seq,
             })
@@ -263,6 +278,16 @@ def main():
         log_line(f"[HOST] SET_PROFILE(2) written: {w4} bytes")
     except Exception as e:
         log_line(f"[HOST][WARN] SET_PROFILE failed: {e}")
+    try:
+        w5 = dev.write(OUT_EP, bytes([VND_CMD_SET_CRC, CRC_MODE]), timeout=1000)
+        log_line(f"[HOST] SET_CRC({CRC_MODE}) written: {w5} bytes")
+    except Exception as e:
+        log_line(f"[HOST][WARN] SET_CRC failed: {e}")
+    try:
+        w6 = dev.write(OUT_EP, bytes([VND_CMD_SET_COMPRESS, COMPRESS_MODE]), timeout=1000)
+        log_line(f"[HOST] SET_COMPRESS({COMPRESS_MODE}) written: {w6} bytes")
+    except Exception as e:
+        log_line(f"[HOST][WARN] SET_COMPRESS failed: {e}")
 
     # Send START (0x20) to OUT EP
     data = bytes([0x20])
@@ -280,6 +305,8 @@ def main():
 
     # Read several complete frames (STAT/TEST/A/B), reassembling from 512B packets
     got = 0
+    crc_ok = crc_bad = 0
+    rice_ok = rice_bad = 0
     start_time = time.time()
     last_stat_print = 0.0
     rx = bytearray()
@@ -304,21 +331,34 @@ def main():
                         base = f"ver={st['version']} flags=0x{st['flags_runtime']:04X} test={st['test_frames']} seq={st['produced_seq']} sentA/B={st['sent0']}/{st['sent1']} dma={st['dma_done0']}/{st['dma_done1']} cur_samples={st['cur_samples']} wr_seq={st['frame_wr_seq']}"
                         ext = ""
                         if 'flags2' in st:
-                            ext = f" flags2=0x{st['flags2']:04X} send_ch={st['sending_ch']} pair {st['pair_fill']}/{st['pair_send']} lastTX={st['last_tx_len']} cur_seq={st['cur_stream_seq']} prep {st['prep_ok']}/{st['prep_calls']}"
+                            ext = f" flags2=0x{st['flags2']:04X} send_ch={st['sending_ch']} txq {st['txq_depth']}/{st['txq_hwm']} und={st['txq_underrun']} lastTX={st['last_tx_len']} cur_seq={st['cur_stream_seq']} cpu={st['cpu_pct']}% isr={st['isr_pct']}%"
                         log_line(f"[HOST_STAT] {base}{ext}")
                     got += 1
                     continue
                 # Frame header?
-                if rx[0] == 0x5A and rx[1] == 0xA5 and rx[2] == 0x01 and len(rx) >= 16:
+                if rx[0] == 0x5A and rx[1] == 0xA5 and rx[2] == 0x01 and len(rx) >= 32:
                     total_samples = rx[12] | (rx[13] << 8)
-                    flen = 32 + total_samples * 2
+                    flen = frame_rice.frame_len(bytes(rx[:32]))
                     if len(rx) < flen:
                         break
                     flags = rx[3]
-                    ftype = 'TEST' if (flags & 0x80) else ('A' if flags == 0x01 else ('B' if flags == 0x02 else 'UNK'))
+                    ch = flags & 0x03
+                    ftype = 'TEST' if (flags & 0x80) else ('A' if ch == 0x01 else ('B' if ch == 0x02 else 'UNK'))
                     frame = bytes(rx[:flen]); rx = rx[flen:]
                     head = ' '.join(f"{b:02X}" for b in frame[:4])
-                    log_line(f"[HOST_RX] ep=0x{IN_EP:02X} len={len(frame)} type={ftype} head={head}")
+                    crc_txt = ''
+                    if flags & VFLAG_CRC:
+                        if frame_crc_ok(frame):
+                            crc_ok += 1; crc_txt = ' crc=ok'
+                        else:
+                            crc_bad += 1; crc_txt = ' crc=BAD'
+                    if flags & VFLAG_RICE:
+                        try:
+                            frame_rice.payload(frame)
+                            rice_ok += 1; crc_txt += f' rice={len(frame) - 32}/{total_samples * 2}'
+                        except ValueError:
+                            rice_bad += 1; crc_txt += ' rice=BAD'
+                    log_line(f"[HOST_RX] ep=0x{IN_EP:02X} len={len(frame)} type={ftype} head={head}{crc_txt}")
                     got += 1
                     continue
                 # Resync: drop until next plausible header
@@ -353,6 +393,11 @@ def main():
             log_line(f"[HOST_RX][ERR] {e}")
             break
 
+    if CRC_MODE or crc_ok or crc_bad:
+        log_line(f"[HOST] CRC ok={crc_ok} bad={crc_bad}")
+    if COMPRESS_MODE or rice_ok or rice_bad:
+        log_line(f"[HOST] RICE ok={rice_ok} bad={rice_bad} decoder={'C' if frame_rice.have_c_decoder() else 'python'}")
+
     # Optional STOP
     try:
         slen = dev.write(OUT_EP, bytes([0x21]), timeout=1000)
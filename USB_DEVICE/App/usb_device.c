@@ -42,7 +42,7 @@
 /* USER CODE END PFP */
 
 /* USB Device Core handle declaration. */
-USBD_HandleTypeDef hUsbDeviceHS;
+USBD_HandleTypeDef hUsbDeviceHS USBD_NOCACHE; /* EP0 отвечает полями pdev (dev_config_status и др.) */
 
 /*
  * -- Insert your variables declaration here --
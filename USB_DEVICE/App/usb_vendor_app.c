@@ -16,6 +16,17 @@
 #include "usbd_cdc_custom.h" /* для USBD_VND_RequestSoftReset/DeepReset (объявления находятся в .c) */
 /* Для отображения информации о потоке на LCD */
 #include "stream_display.h"
+#include "frame_crc.h"
+#include "frame_rice.h"
+#include "frame_zone.h"
+#include "vnd_tx_chunk.h"
+#include "lockin.h"
+#include "timebase.h"
+#include "boot_time.h"
+#include "uart_log.h"
+#include "trace_tok.h"
+#include "pipe_trace.h"
+#include "cyc_prof.h"
 
 /* Управление дублированием данных кадров в CDC (COM-порт):
  *  0 — отключено (оставляем только события START/STOP и 1 Гц статистику)
@@ -28,8 +39,15 @@
 #ifndef VND_ENABLE_LOG
 #define VND_ENABLE_LOG 0 /* отключаем подробный лог для максимальной скорости DIAG */
 #endif
+/* Без printf подробный лог пишется токенами (trace_tok.h): десятки циклов на вызов, поток не страдает.
+   Текст восстанавливает HostTools/trace_decode.py. */
+#ifndef VND_TRACE_LOG
+#define VND_TRACE_LOG 1
+#endif
 #if VND_ENABLE_LOG
 #define VND_LOG(...) do { printf("[VND] " __VA_ARGS__); printf("\r\n"); } while(0)
+#elif VND_TRACE_LOG
+#define VND_LOG(fmt, ...) TRACE_TOK("[VND] " fmt, ##__VA_ARGS__)
 #else
 #define VND_LOG(...) do{}while(0)
 #endif
@@ -49,17 +67,59 @@ extern USBD_HandleTypeDef hUsbDeviceHS;
 #define VND_DISABLE_TEST 1
 #endif
 
+/* Zero-copy передача кадров: буфер из g_frames/diag отдаётся EP IN напрямую,
+    без memcpy в vnd_tx_buf. 0 — прежний путь с копией (для сравнения по PERF). */
+#ifndef VND_TX_ZERO_COPY
+#define VND_TX_ZERO_COPY 1
+#endif
+
 /* Команды */
 #define VND_CMD_START_STREAM   0x20u
 #define VND_CMD_STOP_STREAM    0x21u
 #define VND_CMD_GET_STATUS     0x30u
 /* ДОБАВЛЕНО: управление окнами/частотой */
-#define VND_CMD_SET_WINDOWS    0x10u /* payload: start0,len0,start1,len1 (LE, u16) */
+#define VND_CMD_SET_WINDOWS    0x10u /* payload: до VND_ZONES_MAX пар u16 start, u16 len (отсчёты кадра АЦП), только вне стрима */
 #define VND_CMD_SET_BLOCK_HZ   0x11u /* payload: u16 hz (20..100) или 0xFFFF=макс (100) */
 /* Новая команда: установка ограничения числа выборок на канал в рабочем кадре */
 #define VND_CMD_SET_TRUNC_SAMPLES 0x16u /* payload: u16 samples (0=отключить усечение) */
 /* Новая команда: явная установка samples_per_frame для управления FPS (пара A+B ≈ Fs/samples) */
 #define VND_CMD_SET_FRAME_SAMPLES 0x17u /* payload: u16 samples_per_frame (на канал) */
+/* Пакетный режим: K пар A/B подряд в одном bulk-трансфере */
+#define VND_CMD_SET_BURST      0x18u /* payload: u8 пар на трансфер (0/1 = выкл., 2..VND_BURST_MAX_PAIRS) */
+/* Формат рабочих кадров: пара A/B (v1) или один стерео-кадр v2 на пару */
+#define VND_CMD_SET_FRAME_FMT  0x19u /* payload: u8 (0 = пара A/B, 1 = стерео L/R чередованием, 2 = стерео блоками, 3 = lock-in) */
+#define VND_FMT_PAIR           0u
+#define VND_FMT_STEREO_IL      1u
+#define VND_FMT_STEREO_PLANAR  2u
+#define VND_FMT_LOCKIN         3u
+/* Сжатие payload рабочих кадров без потерь: разности + код Райса (frame_rice), flags |= VND_FLAGS_RICE */
+#define VND_CMD_SET_COMPRESS   0x1Au /* payload: u8 (0 = выкл., 1 = вкл.), только вне стрима */
+/* Режим захвата: Fs и N произвольные, TIM15 PSC/ARR считаются от фактического такта (adc_stream_set_acq) */
+#define VND_CMD_SET_ACQ        0x1Bu /* payload: u32 fs_hz, u16 samples (0 = текущее N), [u16 ovs_ratio, u8 ovs_shift], только вне стрима */
+/* Синхронное детектирование по меандру TIM2 (lockin.h): вместо отсчётов — записи I/Q за M периодов */
+#define VND_CMD_SET_LOCKIN     0x1Cu /* payload: u16 periods (M, 0 = 1), u8 записей на кадр (0 = по умолчанию), только вне стрима */
+/* ROI: в payload только зоны кадра АЦП (SET_WINDOWS в отсчётах, SET_ROI_US в мкс) с таблицей зон */
+#define VND_CMD_SET_ROI        0x1Du /* payload: u8 (0 = кадр целиком, 1 = только зоны), только вне стрима */
+/* CRC рабочих кадров (roadmap 0x32): crc16 считает аппаратный блок CRC, flags |= VND_FLAGS_CRC */
+#define VND_CMD_SET_CRC        0x32u /* payload: u8 (0 = выкл., 1 = вкл.), только вне стрима */
+
+/* Буфер пачки (burst): пары A0,B0,A1,B1,... вплотную, хвост добит нулями до MPS.
+    Сколько пар реально влезает, зависит от размера кадра (профиль 1360 — 2 пары, 912 — 4). */
+#ifndef VND_BURST_BUF_SIZE
+#define VND_BURST_BUF_SIZE     16384u
+#endif
+#define VND_BURST_MAX_PAIRS    8u
+
+/* Кадр lock-in v3: до VND_LOCKIN_RECS_MAX записей по LOCKIN_REC_SIZE байт в слоте пары */
+#define VND_LOCKIN_RECS_MAX    32u
+#define VND_LOCKIN_RECS_DEF    8u
+
+/* Очередь передачи полного режима: кольцо из VND_TXQ_PAIRS пар кадров (степень двойки).
+    Дескрипторов A,B в кольце вдвое больше; следующий кадр ставит в EP сам TxCplt. */
+#ifndef VND_TXQ_PAIRS
+#define VND_TXQ_PAIRS          4u
+#endif
+#define VND_TXQ_DEPTH          (2u * VND_TXQ_PAIRS)
 
 /* Параметры */
 #define VND_DEFAULT_TEST_SAMPLES   80u
@@ -161,6 +221,15 @@ static volatile uint32_t dbg_prepare_ok = 0;
 static volatile uint32_t dbg_task_calls = 0; /* сколько раз заходили в Vendor_Stream_Task */
 /* Счётчик пропущенных кадров (last-buffer-wins): сколько кадров FIFO было перескочено */
 static volatile uint32_t dbg_skipped_frames = 0;
+/* Смена профиля без остановки DMA: первый кадр нового N помечен в кольце АЦП (adc_stream_frame_samples).
+   Флаг VND_FLAGS_RESYNC ждёт первого отправленного кадра — разорванный кадр его не съедает. */
+static uint8_t vnd_resync_flag = 0;
+static volatile uint32_t dbg_resync = 0;
+/* Фаза меандра первого отсчёта взятого кадра АЦП (adc_stream_frame_phase): фронты в заголовке и
+   раскладка L/R без опроса PA1. ADC_PHASE_NONE — фазы нет, уровень читается с вывода. */
+static uint16_t vnd_frame_k0 = ADC_PHASE_NONE;
+static volatile uint32_t dbg_frames_phase = 0;   /* кадров АЦП с известной фазой */
+static volatile uint32_t dbg_frames_gpio = 0;    /* кадров АЦП без фазы */
 
 /* Состояния передачи пары */
 static uint8_t channel0_sent_curseq = 0;
@@ -182,13 +251,14 @@ static uint32_t diag_period_ms = 0;  /* не используется для т
 static uint32_t diag_next_ms = 0;    /* не используется для темпирования (сохранено для совместимости) */
 static uint16_t diag_samples = VND_DEFAULT_TEST_SAMPLES; /* сэмплов на канал в диагностическом режиме */
 static uint16_t diag_frame_len = 0;  /* общий размер кадра (hdr+payload) в диагностике */
-/* Буферы диагностических кадров A/B (живут до завершения передачи) */
-static uint8_t diag_a_buf[VND_FRAME_MAX_SIZE];
-static uint8_t diag_b_buf[VND_FRAME_MAX_SIZE];
+/* Буферы диагностических кадров A/B (живут до завершения передачи; выровнены под zero-copy).
+   Размер — максимальный кадр, округлённый до 512: diag-кадр паддится до кратности HS MPS. */
+#define VND_DIAG_BUF_SIZE   (((VND_FRAME_MAX_SIZE) + 511u) & ~511u)
+static uint8_t diag_a_buf[VND_DIAG_BUF_SIZE] USBD_DMA_BUF;
+static uint8_t diag_b_buf[VND_DIAG_BUF_SIZE] USBD_DMA_BUF;
 /* Последовательно подготовленная пара для текущего stream_seq в DIAG: */
 static uint32_t diag_prepared_seq = 0xFFFFFFFFu;
 static uint32_t diag_current_pair_seq = 0xFFFFFFFFu;
-static uint16_t win_start0 = 0, win_len0 = 0, win_start1 = 0, win_len1 = 0;
 
 /* --- CDC дублирование: отправляем компактную ASCII строку с первыми 64 сэмплами --- */
 static uint32_t cdc_last_send_ms = 0;       /* для троттлинга */
@@ -211,8 +281,9 @@ static void vnd_cdc_duplicate_preview(const uint8_t *buf, uint16_t len, const ch
     if (magic != 0xA55A) return;
     uint32_t seq = rd_le32(buf + 4);
     uint16_t ns  = rd_le16(buf + 12);
+    uint32_t zt  = VND_ZONE_TAB_BYTES(buf[14]); /* таблица зон ROI перед отсчётами */
     if (ns == 0) return;
-    if ((uint32_t)VND_FRAME_HDR_SIZE + (uint32_t)ns*2u > (uint32_t)len) return;
+    if ((uint32_t)VND_FRAME_HDR_SIZE + zt + (uint32_t)ns*2u > (uint32_t)len) return;
     unsigned off = 0;
     const char *chan = tag ? tag : "?";
     off += (unsigned)snprintf(cdc_line_buf + off, sizeof(cdc_line_buf) - off,
@@ -220,7 +291,7 @@ static void vnd_cdc_duplicate_preview(const uint8_t *buf, uint16_t len, const ch
     uint16_t show = (ns > 64u) ? 64u : ns;
     for (uint16_t i = 0; i < show && off + 8 < sizeof(cdc_line_buf); i++)
     {
-        uint16_t v = rd_le16(buf + VND_FRAME_HDR_SIZE + 2u*i);
+        uint16_t v = rd_le16(buf + VND_FRAME_HDR_SIZE + zt + 2u*i);
         off += (unsigned)snprintf(cdc_line_buf + off, sizeof(cdc_line_buf) - off, " %u", (unsigned)v);
     }
     if (off + 2 < sizeof(cdc_line_buf)) {
@@ -272,15 +343,19 @@ static void vnd_cdc_periodic_stats(uint32_t now_ms)
  * Формат под спецификацию хоста (ровно 32 байта, LE):
  *   [0..1] magic = 0xA55A -> 5A A5
  *   [2]    ver   = 0x01
- *   [3]    flags: 0x01=ADC0, 0x02=ADC1, 0x80=TEST, +0x04 если есть CRC16 (сейчас 0)
+ *   [3]    flags: 0x01=ADC0, 0x02=ADC1, 0x80=TEST, +0x04 если есть CRC16, +0x10 если payload сжат,
+ *          +0x20 первый кадр после смены профиля, +0x40 фаза меандра известна (поля 16..23)
  *   [4..7] seq (u32 LE) — общий для пары
- *   [8..11] timestamp (u32 LE) — одинаковый в паре
+ *   [8..11] timestamp (u32 LE, мкс) — завершение DMA кадра АЦП, одинаковый в паре
  *   [12..13] total_samples (u16 LE)
- *   [14..15] zone_count=0
- *   [16..19] zone1_offset=0
- *   [20..23] zone1_length=0
- *   [24..27] reserved=0
- *   [28..29] reserved2=0
+ *   [14]   zone_count — зон ROI в payload (0 — кадр целиком), таблица зон в начале payload
+ *   [15]   sample_bits — значащих бит отсчёта (16; меньше при оверсэмплинге с большим сдвигом)
+ *   [16..17] edge_rise — номер первого отсчёта кадра с k=0 (фронт TIM2_CH2), может быть >= total_samples
+ *   [18..19] edge_fall — номер первого отсчёта с k=H (спад); далее фронты через каждые P отсчётов
+ *   [20..21] meander_period — P, отсчётов на период меандра
+ *   [22..23] meander_high — H, отсчётов высокого уровня (без флага 0x40 поля 16..23 нулевые)
+ *   [24..27] comp_len — байт сжатого payload при 0x10, иначе 0
+ *   [28..29] rate_code — Fs отсчётов: (rate_code & 0xFFF) << (rate_code >> 12), Гц
  *   [30..31] crc16=0 (флаг 0x04 не используется)
  */
 typedef struct __attribute__((packed)) {
@@ -288,31 +363,93 @@ typedef struct __attribute__((packed)) {
     uint8_t  ver;             /* 0x01 */
     uint8_t  flags;           /* см. описание выше */
     uint32_t seq;             /* номер логической последовательности (пары) */
-    uint32_t timestamp;       /* HAL_GetTick */
+    uint32_t timestamp;       /* мкс, младшие 32 бита adc_stream_frame_time_us() */
     uint16_t total_samples;   /* кол-во сэмплов */
-    uint16_t zone_count;      /* 0 */
-    uint32_t zone1_offset;    /* 0 */
-    uint32_t zone1_length;    /* 0 */
-    uint32_t reserved;        /* 0 */
-    uint16_t reserved2;       /* 0 */
-    uint16_t crc16;           /* 0, пока CRC не используется */
+    uint8_t  zone_count;      /* зон ROI (VND_ZONE_TAB_BYTES байт таблицы в начале payload), 0 — кадр целиком */
+    uint8_t  sample_bits;     /* значащих бит отсчёта (adc_stream_get_sample_bits) */
+    uint16_t edge_rise;       /* первый отсчёт с k=0 при VND_FLAGS_PHASE, иначе 0 */
+    uint16_t edge_fall;       /* первый отсчёт с k=H */
+    uint16_t meander_period;  /* P */
+    uint16_t meander_high;    /* H */
+    uint32_t comp_len;        /* длина сжатого payload при VND_FLAGS_RICE (SET_COMPRESS), иначе 0 */
+    uint16_t rate_code;       /* Fs отсчётов, vnd_rate_code() */
+    uint16_t crc16;           /* CRC16-CCITT-FALSE при VND_FLAGS_CRC (SET_CRC), иначе 0 */
 } vnd_frame_hdr_t;
 _Static_assert(sizeof(vnd_frame_hdr_t)==32, "vnd_frame_hdr_t must be 32 bytes (PACKING ERROR)");
 
 /* Состояние кадра */
 typedef enum { FB_FILL=0, FB_READY=1, FB_SENDING=2 } frame_state_t;
+/* FB_READY с crc_pending != 0: кадр собран, но блок CRC ещё не записал crc16 — в EP не ставим */
 
 typedef struct {
     volatile frame_state_t st;
     uint16_t samples;
-    uint8_t  flags;
+    uint8_t  flags;          /* VND_FLAGS_ADC0 / VND_FLAGS_ADC1; стерео v2 — оба (+ VND_FLAGS_PLANAR) */
     uint16_t frame_size;
+    volatile uint8_t crc_pending; /* кадр в очереди frame_crc */
     uint32_t seq;
-    uint8_t  buf[VND_FRAME_MAX_SIZE];
+    /* Половина слота пары в g_pair_buf (строки кэша 32 байта): уходит в EP IN без копирования.
+       Стерео-кадр v2 занимает слот целиком через кадр [0]. */
+    uint8_t  *buf;
 } ChanFrame;
+_Static_assert((VND_FRAME_MAX_SIZE % 32u) == 0u, "ChanFrame.buf must fill whole cache lines");
+_Static_assert(2u * VND_FRAME_MAX_SIZE >= VND_STEREO_FRAME_MAX_SIZE, "stereo frame must fit one pair slot");
+
+#define VND_PAIR_BUFFERS VND_TXQ_PAIRS
+_Static_assert((VND_TXQ_PAIRS & (VND_TXQ_PAIRS - 1u)) == 0u && VND_TXQ_DEPTH <= 128u, "VND_TXQ_PAIRS must be a power of two");
+DTCM_BSS static ChanFrame g_frames[VND_PAIR_BUFFERS][2];
+/* Слоты пар: A в первой половине, B во второй (при USBD_OTG_DMA_ENABLE — в AXI SRAM) */
+static uint8_t g_pair_buf[VND_PAIR_BUFFERS][2u * VND_FRAME_MAX_SIZE] USBD_DMA_BUF;
+/* Формат рабочих кадров (VND_FMT_*), меняется только вне стрима */
+static volatile uint8_t vnd_frame_fmt = VND_FMT_PAIR;
+/* DIAG всегда шлёт пары A/B v1 */
+static volatile uint8_t vnd_crc_enabled = 0; /* SET_CRC */
+static volatile uint8_t vnd_compress = 0;    /* SET_COMPRESS */
+static inline uint8_t vnd_fmt_stereo(void){
+    return ((vnd_frame_fmt == VND_FMT_STEREO_IL || vnd_frame_fmt == VND_FMT_STEREO_PLANAR) && !diag_mode_active) ? 1u : 0u;
+}
+static inline uint8_t vnd_fmt_lockin(void){ return (vnd_frame_fmt == VND_FMT_LOCKIN && !diag_mode_active) ? 1u : 0u; }
+/* SET_LOCKIN: периодов меандра на запись и записей на кадр v3 */
+static volatile uint16_t vnd_lockin_periods = 1;
+static volatile uint8_t  vnd_lockin_recs = VND_LOCKIN_RECS_DEF;
+static uint32_t vnd_lockin_frames = 0; /* кадров v3 с START */
+_Static_assert(VND_FRAME_HDR_SIZE + VND_LOCKIN_RECS_MAX * LOCKIN_REC_SIZE <= 2u * VND_FRAME_MAX_SIZE, "lock-in frame must fit one pair slot");
+/* Зоны ROI: заданы командами SET_WINDOWS (отсчёты) или SET_ROI_US (мкс), действуют при SET_ROI 1
+   в полном режиме (пара A/B и стерео v2; lock-in и DIAG шлют кадры как раньше). */
+static frame_zone_cfg_t vnd_zone_cfg[VND_ZONES_MAX];
+static uint8_t vnd_zone_cfg_cnt = 0;
+static uint8_t vnd_zone_us = 0;               /* зоны в мкс: отсчёты считаются по Fs кадра */
+static volatile uint8_t vnd_roi_enabled = 0;  /* SET_ROI */
+/* Таблица зон для кадра из n отсчётов (только таск): пересчитывается при смене N или Fs */
+static frame_zone_map_t vnd_zr;
+static uint8_t vnd_frame_zones = 0;           /* зон в кадре, взятом последним (vnd_zone_gather) */
+static uint32_t vnd_zone_frames = 0, vnd_zone_whole = 0;
+static uint64_t vnd_zone_saved = 0;
+static inline uint8_t vnd_roi_active(void){ return (vnd_roi_enabled && !diag_mode_active && !vnd_fmt_lockin()) ? 1u : 0u; }
+
+/* Разрешить зоны для кадра из n отсчётов (frame_zone_resolve), если сменились N или Fs */
+static void vnd_zone_resolve(uint16_t n)
+{
+    uint32_t fs = vnd_zone_us ? adc_stream_get_sample_rate() : 0u;
+    if(vnd_zr.n == n && vnd_zr.fs == fs) return;
+    frame_zone_resolve(&vnd_zr, vnd_zone_cfg, vnd_zone_cfg_cnt, vnd_zone_us, fs, n, vnd_fmt_stereo() ? 4u : 2u);
+}
 
-#define VND_PAIR_BUFFERS 2
-static ChanFrame g_frames[VND_PAIR_BUFFERS][2];
+/* Байт одного кадра (канал A/B или стерео-кадр v2) при n отсчётах кадра АЦП, с учётом зон */
+static uint32_t vnd_frame_bytes(uint16_t n)
+{
+    uint32_t bps = vnd_fmt_stereo() ? 4u : 2u;
+    if(vnd_roi_active()){
+        vnd_zone_resolve(n);
+        return VND_FRAME_HDR_SIZE + frame_zone_payload_bytes(&vnd_zr, n, bps);
+    }
+    return VND_FRAME_HDR_SIZE + (uint32_t)n * bps;
+}
+
+/* Байт на «пару» (A+B или один стерео-кадр) при n отсчётах на канал */
+static inline uint32_t vnd_pair_bytes(uint16_t n){
+    return vnd_fmt_stereo() ? vnd_frame_bytes(n) : 2u * vnd_frame_bytes(n);
+}
 static uint8_t pair_fill_idx = 0;
 static uint8_t pair_send_idx = 0;
 static uint8_t sending_channel = 0xFF; /* 0 /1 когда активна передача */
@@ -323,17 +460,72 @@ static volatile uint8_t pending_B = 0;  /* 1 = нужно отправить B 
 /* Диагностика зависаний между A и B */
 static uint32_t pending_B_since_ms = 0; /* время, когда завершилась передача A и мы начали ждать B */
 
+/* Кольцо дескрипторов готовых кадров: таск добавляет пару A,B (tail), TxCplt снимает head и сразу
+   ставит следующий. Индексы свободно бегущие (маска по глубине), у каждого ровно один писатель. */
+typedef struct {
+    ChanFrame *cf;           /* кадр в g_frames */
+} vnd_txq_desc_t;
+DTCM_BSS static vnd_txq_desc_t vnd_txq[VND_TXQ_DEPTH];
+static volatile uint8_t  vnd_txq_head = 0;     /* следующий к передаче / в EP (двигает только TxCplt) */
+static volatile uint8_t  vnd_txq_tail = 0;     /* место добавления (двигает только таск) */
+static volatile uint8_t  vnd_txq_active = 0;   /* дескриптор head сейчас в EP IN */
+static volatile uint8_t  vnd_txq_hwm = 0;      /* максимум глубины с START */
+static volatile uint32_t vnd_txq_underrun = 0; /* TxCplt кадра застал очередь пустой — EP простаивает */
+static inline uint8_t vnd_txq_depth(void){ return (uint8_t)(vnd_txq_tail - vnd_txq_head); }
+
+/* Пачки burst: пока одна в полёте, вторая собирается из ADC FIFO */
+typedef struct {
+    volatile frame_state_t st;
+    uint8_t  pairs;          /* собрано пар */
+    uint16_t len;            /* длина трансфера с паддингом (валидна в FB_READY) */
+    uint16_t frame_bytes;    /* байт на пару без сжатия: A+B или стерео-кадр (все пары одного размера) */
+    uint16_t used;           /* занято кадрами (сжатые пары короче frame_bytes) */
+    uint32_t first_seq;      /* seq первой пары */
+    volatile uint8_t crc_pending; /* кадров пачки в очереди frame_crc */
+    uint8_t  buf[VND_BURST_BUF_SIZE] __attribute__((aligned(32)));
+} BurstBuf;
+_Static_assert((VND_BURST_BUF_SIZE % 512u) == 0u, "burst buffer must hold a whole number of HS packets");
+static BurstBuf g_burst[2] USBD_DMA_BUF;
+#if USBD_OTG_DMA_ENABLE
+/* .usb_dma — одно окно MPU 64K (ASSERT в .ld): тот же предел при компиляции — пары, burst, diag A/B
+   и bounce vnd_tx_buf (usbd_cdc_custom.c), до 32 байт выравнивания на каждый массив */
+_Static_assert(sizeof(g_pair_buf) + sizeof(g_burst) + 2u * VND_DIAG_BUF_SIZE + VND_TX_CHUNK_MAX + 5u * 32u
+               <= 64u * 1024u, ".usb_dma exceeds its 64K MPU region");
+#endif
+static uint8_t burst_fill_idx = 0;
+static uint8_t burst_send_idx = 0;
+static volatile uint8_t burst_pairs_req = 0;  /* 0/1 = выключено (обычная машина A/B) */
+static volatile uint8_t burst_inflight = 0;   /* пачка в EP IN */
+static volatile uint32_t dbg_burst_sent = 0;  /* завершённых пачек */
+static volatile uint32_t dbg_burst_drop = 0;  /* пачек, снятых вотчдогом без TxCplt */
+
 /* Прототипы */
 static void vnd_reset_buffers(void);
 // static void vnd_send_test_frame(void); // удален, не используется
-static void vnd_prepare_pair(void);
-static void vnd_build_frame(ChanFrame *cf);
+static uint8_t vnd_prepare_pair(void);
+static uint8_t vnd_prepare_lockin(ChanFrame *f0);
+static uint32_t vnd_build_stereo_frame(uint8_t *dst, uint16_t *ch1, uint16_t *ch2, uint16_t n, uint32_t seq, uint32_t ts);
+static void vnd_frame_crc_start(uint8_t *frame, uint32_t len, volatile uint8_t *pending);
+static void vnd_build_frame(ChanFrame *cf, uint32_t comp_len);
+static uint32_t vnd_rice_payload(uint8_t *payload, const uint16_t *src, uint16_t n);
 static void vnd_try_start_tx(void);
 static int  vnd_validate_frame(const uint8_t *buf, uint16_t len, uint8_t expect_test, uint8_t allow_zero_samples);
 static USBD_StatusTypeDef vnd_transmit_frame(uint8_t *buf, uint16_t len, uint8_t is_test, uint8_t allow_zero_samples, const char *tag);
 /* Диагностика: подготовка и отправка A/B тестовой пары (упрощённой) */
 static void vnd_diag_prepare_pair(uint32_t seq, uint16_t samples);
 static int  vnd_diag_try_tx(void);
+/* Очередь передачи полного режима */
+static void vnd_txq_reset(void);
+static void vnd_txq_fill(void);
+static int  vnd_txq_kick(void);
+static void vnd_txq_on_txcplt(void);
+/* Пакетный режим (burst) */
+/* Lock-in уже пакует записи в кадр — пачки ему не нужны */
+static inline uint8_t vnd_burst_enabled(void){ return (burst_pairs_req > 1u && !vnd_fmt_lockin()) ? 1u : 0u; }
+static void vnd_burst_reset(void);
+static uint8_t vnd_burst_pairs_eff(void);
+static int  vnd_burst_task_step(uint32_t now);
+static void vnd_burst_on_txcplt(void);
 /* Классификация последнего отправленного буфера для корректного разбора в TxCplt */
 typedef struct {
     uint8_t  is_frame;      /* 1 = кадр с заголовком */
@@ -413,7 +605,7 @@ static void __attribute__((unused)) vnd_send_fake_pair(void); // удалим п
 static void vnd_log_hdr_layout(void);
 static void vnd_try_send_pending_status_from_task(void);
 static void vnd_try_send_test_from_task(void);
-/* Быстрый пайплайн: немедленная отправка следующего кадра из TxCplt */
+/* DIAG: немедленная отправка следующего кадра из TxCplt */
 static int vnd_try_send_B_immediate(void);
 static int vnd_try_send_A_nextpair_immediate(void);
 /* Аварийный keepalive: если совсем нет успешных завершений передач первые секунды */
@@ -450,7 +642,7 @@ void vnd_pipeline_stop_reset(int deep)
     /* Очистить мета-FIFO и счётчики */
     vnd_tx_meta_head = vnd_tx_meta_tail = 0; meta_push_total = meta_pop_total = meta_empty_events = meta_overflow_events = 0;
     stream_seq = 0; next_seq_to_assign = 0; dbg_produced_seq = 0; first_pair_done = 0;
-    cur_samples_per_frame = 0; cur_expected_frame_size = 0; dbg_any_valid_frame = 0;
+    cur_samples_per_frame = 0; cur_expected_frame_size = 0; dbg_any_valid_frame = 0; vnd_resync_flag = 0;
     vnd_reset_buffers();
     /* Остановить источник данных/ADC DMA при глубоком сбросе */
     if(deep){ extern void adc_stream_stop(void); adc_stream_stop(); }
@@ -527,9 +719,12 @@ static volatile uint8_t vnd_tick_flag = 0;
 void usb_vendor_periodic_tick(void){ vnd_tick_flag = 1; }
 
 /* ---------------- Вспомогательные ---------------- */
+static void vnd_crc_reset(void);
 static void vnd_reset_buffers(void){
-    for(uint8_t p=0;p<VND_PAIR_BUFFERS;p++) for(uint8_t c=0;c<2;c++){ g_frames[p][c].st=FB_FILL; g_frames[p][c].samples=0; g_frames[p][c].flags = c?VND_FLAGS_ADC1:VND_FLAGS_ADC0; g_frames[p][c].frame_size=0; g_frames[p][c].seq=0; memset(g_frames[p][c].buf,0xCC,sizeof(g_frames[p][c].buf)); }
-    pair_fill_idx=pair_send_idx=0; sending_channel=0xFF; channel0_sent_curseq=channel1_sent_curseq=0; pending_B = 0; pending_B_since_ms = 0; }
+    vnd_crc_reset();
+    for(uint8_t p=0;p<VND_PAIR_BUFFERS;p++) for(uint8_t c=0;c<2;c++){ g_frames[p][c].st=FB_FILL; g_frames[p][c].samples=0; g_frames[p][c].flags = c?VND_FLAGS_ADC1:VND_FLAGS_ADC0; g_frames[p][c].frame_size=0; g_frames[p][c].seq=0; g_frames[p][c].buf = g_pair_buf[p] + (uint32_t)c * VND_FRAME_MAX_SIZE; memset(g_frames[p][c].buf,0xCC,VND_FRAME_MAX_SIZE); }
+    pair_fill_idx=pair_send_idx=0; sending_channel=0xFF; channel0_sent_curseq=channel1_sent_curseq=0; pending_B = 0; pending_B_since_ms = 0;
+    vnd_txq_reset(); vnd_burst_reset(); }
 
 uint16_t vnd_build_status(uint8_t *dst, uint16_t max_len){
     if(max_len < sizeof(vnd_status_v1_t)) return 0;
@@ -539,9 +734,9 @@ uint16_t vnd_build_status(uint8_t *dst, uint16_t max_len){
     g_status.sig[1] = 'T';
     g_status.sig[2] = 'A';
     g_status.sig[3] = 'T';
-    g_status.version = 1;
+    g_status.version = 3;
     g_status.cur_samples = cur_samples_per_frame;
-    g_status.frame_bytes = (uint16_t)(VND_FRAME_HDR_SIZE + cur_samples_per_frame*2u);
+    g_status.frame_bytes = cur_samples_per_frame ? cur_expected_frame_size : (uint16_t)VND_FRAME_HDR_SIZE;
     g_status.test_frames = test_sent ? 1u : 0u;
     g_status.produced_seq = dbg_produced_seq;
     g_status.sent0 = dbg_sent_ch0_total;
@@ -556,6 +751,14 @@ uint16_t vnd_build_status(uint8_t *dst, uint16_t max_len){
     g_status.frame_wr_seq = d.frame_wr_seq;
     if(streaming) g_status.flags_runtime |= VND_STFLAG_STREAMING;
     if(diag_mode_active) g_status.flags_runtime |= VND_STFLAG_DIAG_ACTIVE;
+    if(vnd_fmt_stereo()) g_status.flags_runtime |= VND_STFLAG_STEREO;
+    if(vnd_crc_enabled) g_status.flags_runtime |= VND_STFLAG_CRC;
+    if(vnd_compress) g_status.flags_runtime |= VND_STFLAG_RICE;
+    if(vnd_fmt_lockin()) g_status.flags_runtime |= VND_STFLAG_LOCKIN;
+    if(vnd_roi_active()) g_status.flags_runtime |= VND_STFLAG_ROI;
+#if ADC_STREAM_DUAL_MODE
+    g_status.flags_runtime |= VND_STFLAG_ADC_DUAL;
+#endif
     /* Новые поля диагностики */
     uint16_t f2 = 0;
     /* Бит0 = занятость IN EP: локальная (vnd_ep_busy) ИЛИ низкоуровневая (LL vnd_tx_busy) */
@@ -591,23 +794,17 @@ uint16_t vnd_build_status(uint8_t *dst, uint16_t max_len){
     }
     g_status.flags2 = f2;
     g_status.sending_ch = sending_channel;
-    g_status.pair_idx = (uint16_t)(((uint16_t)pair_fill_idx << 8) | (uint16_t)pair_send_idx);
+    g_status.txq_depth = vnd_txq_depth();
+    g_status.txq_hwm = vnd_txq_hwm;
     g_status.last_tx_len = vnd_last_tx_len;
     g_status.cur_stream_seq = stream_seq;
-     /* Переиспользуем резервные поля для отладки на хосте (совместимо с parser'ом):
-        reserved0 = LSB dbg_prepare_calls, reserved2(low) = LSB dbg_prepare_ok,
-        reserved3 = LSW frame_rd_seq (для сравнения с frame_wr_seq). */
-     /* Упаковываем в reserved0: нижние 4 бита = LSB dbg_prepare_calls, старшие 4 = lastTxRC (LL) */
-     do {
-         extern uint8_t USBD_VND_LastTxRC(void);
-         uint8_t rc = USBD_VND_LastTxRC();
-         uint8_t lsb = (uint8_t)(dbg_prepare_calls & 0x0Fu);
-         g_status.reserved0 = (uint8_t)((rc << 4) | lsb);
-     } while(0);
-     /* reserved2: младший байт dbg_prepare_ok */
-     g_status.reserved2 = (uint8_t)(dbg_prepare_ok & 0xFFu);
-     extern volatile uint32_t frame_rd_seq; /* из adc_stream.c */
-     g_status.reserved3 = (uint16_t)(frame_rd_seq & 0xFFFFu);
+     /* Загрузка CPU за последнее секундное окно основного цикла (main.c), ‰ -> % с округлением */
+     {
+         uint16_t load = cpu_load_permille, isr = cpu_isr_permille;
+         g_status.cpu_load_pct = (load == 0xFFFFu) ? 0xFFu : (uint8_t)((load + 5u) / 10u);
+         g_status.isr_pct = (uint8_t)((isr + 5u) / 10u);
+     }
+     g_status.txq_underrun = (uint16_t)(vnd_txq_underrun & 0xFFFFu);
      /* Хак: инкремент dbg_skipped_frames отображаем в sent0/sent1 дельтах, но здесь добавим только
         косвенную диагностику: если skips растут, host увидит разницу produced_seq - sent*. Дополнительно
         можно временно печатать в CDC при отладке (сейчас лог выключен для скорости). */
@@ -617,12 +814,404 @@ uint16_t vnd_build_status(uint8_t *dst, uint16_t max_len){
 
 uint8_t vnd_is_streaming(void){ return streaming; }
 
-/* Helper: Read meander state from GPIO to determine which phase we're in
- * TIM2_CH2 (meander for ADC1) is on PA1
- * Returns 1 if meander is HIGH (left channel), 0 if LOW (right channel)
+/* Есть ли работа таску стрима прямо сейчас (иначе основной цикл спит в WFI до прерывания).
+   Вызывается из main при запрещённых прерываниях. Флаги выставляют ISR: новые кадры АЦП
+   (adc_stream_on_new_frames -> vnd_tx_kick), тик TIM6, TxCplt/DataIn; любое прерывание и так
+   будит WFI, поэтому здесь — только работа, которая останется после итерации без новых IRQ. */
+uint8_t vnd_has_work(void)
+{
+    if(!streaming) return 0;               /* таск не вызывается; kick висит взведённым и при STOP */
+    if(vnd_tx_kick || vnd_tick_flag) return 1;
+    /* Кадры АЦП ждут сборки, а в очереди передачи есть место под пару */
+    if(full_mode && frame_wr_seq != frame_rd_seq && (uint8_t)(VND_TXQ_DEPTH - vnd_txq_depth()) >= 2u) return 1;
+    return 0;
+}
+
+/* Окно замера нагрузки OTG ISR для PERF: от START до запроса страницы */
+static uint32_t vnd_perf_start_ms = 0;
+static void vnd_perf_reset_irq_stats(void)
+{
+    extern volatile uint32_t g_otg_irq_count;
+    extern volatile uint64_t g_otg_irq_cycles;
+    extern volatile uint32_t g_adc_irq_count, g_adc_irq_max;
+    extern volatile uint64_t g_adc_irq_cycles;
+    __disable_irq();
+    g_otg_irq_count = 0; g_otg_irq_cycles = 0;
+    g_adc_irq_count = 0; g_adc_irq_cycles = 0; g_adc_irq_max = 0;
+    vnd_perf_start_ms = HAL_GetTick();
+    __enable_irq();
+}
+
+uint16_t vnd_build_perf(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_perf_v1_t)) return 0;
+    vnd_perf_v1_t p; memset(&p,0,sizeof(p));
+    memcpy(p.sig, "PERF", 4);
+    p.version = 1;
+#if VND_TX_ZERO_COPY
+    p.flags |= 0x01u;
+#endif
+    USBD_VND_TxPrepStats_t st;
+    USBD_VND_GetTxPrepStats(0, &st);
+    p.tx_copy_count = st.count;
+    p.tx_copy_cyc_avg = st.count ? (uint32_t)(st.cyc_sum / st.count) : 0u;
+    p.tx_copy_cyc_max = st.cyc_max;
+    USBD_VND_GetTxPrepStats(1, &st);
+    p.tx_zc_count = st.count;
+    p.tx_zc_cyc_avg = st.count ? (uint32_t)(st.cyc_sum / st.count) : 0u;
+    p.tx_zc_cyc_max = st.cyc_max;
+    p.tx_chained = USBD_VND_GetTxChainedCount();
+    p.tx_chain_err = USBD_VND_GetTxChainErrors();
+    p.burst_pairs = vnd_burst_enabled() ? vnd_burst_pairs_eff() : 0u;
+    p.burst_sent = dbg_burst_sent;
+    p.burst_drop = dbg_burst_drop;
+#if USBD_OTG_DMA_ENABLE
+    p.flags |= 0x02u;
+#endif
+    /* Нагрузка OTG_HS_IRQHandler с START (счётчики ведёт stm32h7xx_it.c) */
+    {
+        extern volatile uint32_t g_otg_irq_count;
+        extern volatile uint64_t g_otg_irq_cycles;
+        __disable_irq();
+        uint32_t n = g_otg_irq_count; uint64_t cyc = g_otg_irq_cycles;
+        __enable_irq();
+        uint32_t el_ms = HAL_GetTick() - vnd_perf_start_ms;
+        p.otg_irq_count = n;
+        p.otg_irq_cyc_per_s = el_ms ? (uint32_t)((cyc * 1000ULL) / el_ms) : 0u;
+        p.otg_irq_permille = SystemCoreClock ? (uint16_t)(((uint64_t)p.otg_irq_cyc_per_s * 1000ULL) / SystemCoreClock) : 0u;
+    }
+    if(vnd_crc_enabled) p.flags |= 0x04u;
+    if(vnd_compress) p.flags |= 0x08u;
+    {
+        frame_crc_stats_t cs;
+        frame_crc_get_stats(&cs);
+        p.crc_frames = cs.frames;
+        p.crc_skipped = (cs.skipped > 0xFFFFu) ? 0xFFFFu : (uint16_t)cs.skipped;
+    }
+    memcpy(dst,&p,sizeof(p));
+    return (uint16_t)sizeof(p);
+}
+
+/* Страница COMP: сжатие payload (SET_COMPRESS) с START — степень сжатия и циклы кодера */
+uint16_t vnd_build_comp(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_comp_v1_t)) return 0;
+    vnd_comp_v1_t c; memset(&c,0,sizeof(c));
+    memcpy(c.sig, "COMP", 4);
+    c.version = 1;
+    if(vnd_compress) c.flags |= 0x01u;
+    frame_rice_stats_t rs;
+    frame_rice_get_stats(&rs);
+    c.frames = rs.frames;
+    c.raw_frames = rs.raw_frames;
+    c.blocks = rs.blocks;
+    c.raw_blocks = rs.raw_blocks;
+    c.bytes_in = rs.bytes_in;
+    c.bytes_out = rs.bytes_out;
+    c.ratio_permille = rs.bytes_in ? (uint16_t)((rs.bytes_out * 1000ULL) / rs.bytes_in) : 0u;
+    uint64_t cps10 = rs.samples ? (rs.cyc_sum * 10ULL) / rs.samples : 0u;
+    c.cyc_per_sample_x10 = (cps10 > 0xFFFFu) ? 0xFFFFu : (uint16_t)cps10;
+    uint32_t nf = rs.frames + rs.raw_frames;
+    c.cyc_frame_avg = nf ? (uint32_t)(rs.cyc_sum / nf) : 0u;
+    c.cyc_frame_max = rs.cyc_max;
+    memcpy(dst,&c,sizeof(c));
+    return (uint16_t)sizeof(c);
+}
+
+/* Страница ADCS: состояние кольца кадров АЦП — потери на переполнении и разорванные кадры */
+uint16_t vnd_build_adc(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_adc_v1_t)) return 0;
+    vnd_adc_v1_t a; memset(&a,0,sizeof(a));
+    memcpy(a.sig, "ADCS", 4);
+    a.version = 1;
+#if ADC_STREAM_DUAL_MODE
+    a.flags |= 0x01u;
+#endif
+    a.profile = adc_stream_get_profile();
+    a.readable = (uint8_t)ADC_RING_READABLE;
+    a.fifo_frames = (uint16_t)FIFO_FRAMES;
+    adc_stream_debug_t d;
+    adc_stream_get_debug(&d);
+    a.samples = d.active_samples;
+    a.wr_seq = d.frame_wr_seq;
+    a.rd_seq = d.frame_rd_seq;
+    a.overflow_drops = d.frame_overflow_drops;
+    a.torn = d.frame_torn;
+    a.backlog_max = d.frame_backlog_max;
+    a.skipped = dbg_skipped_frames;
+    a.dma_full0 = d.dma_full0;
+    a.dma_full1 = d.dma_full1;
+    if(d.switch_pending) a.flags |= 0x02u;
+    a.switches = (uint16_t)d.switches;
+    a.switch_deferred = (uint16_t)d.switch_deferred;
+    a.switch_slip = (uint16_t)d.switch_slip;
+    a.switch_restarts = (uint16_t)d.switch_restarts;
+    if(d.frame_wr_seq){
+        a.last_frame_seq = d.frame_wr_seq - 1u;
+        a.last_frame_us = adc_stream_frame_time_us(a.last_frame_seq);
+    }
+    memcpy(dst,&a,sizeof(a));
+    return (uint16_t)sizeof(a);
+}
+
+/* Страница ACQS: что реально стоит в TIM15/АЦП (для любого профиля) и итог последней SET_ACQ */
+static int8_t vnd_acq_last_rc = 0;
+uint16_t vnd_build_acq(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_acq_v1_t)) return 0;
+    vnd_acq_v1_t q; memset(&q,0,sizeof(q));
+    memcpy(q.sig, "ACQS", 4);
+    q.version = 1;
+    adc_acq_t a;
+    adc_stream_get_acq(&a);
+    q.profile = adc_stream_get_profile();
+    if(q.profile == ADC_PROFILE_CUSTOM) q.flags |= 0x01u;
+    if(a.aligned) q.flags |= 0x02u;
+    q.smp_code = a.smp_code;
+    q.fs_req_hz = a.fs_req_hz;
+    q.fs_millihz = a.fs_millihz;
+    q.tim_clk_hz = a.tim_clk_hz;
+    q.tim_psc = a.tim_psc;
+    q.tim_arr = a.tim_arr;
+    q.adc_clk_hz = a.adc_clk_hz;
+    q.conv_ns = a.conv_ns;
+    q.samples = a.samples;
+    if(a.samples && a.fs_millihz){
+        q.frame_millihz = (uint32_t)(a.fs_millihz / a.samples);
+        q.ring_ms = (uint32_t)(((uint64_t)ADC_RING_READABLE * a.samples * 1000000ULL) / a.fs_millihz);
+    }
+    q.payload_bps = (uint32_t)((a.fs_millihz * 4ULL) / 1000ULL); /* 2 канала по 2 байта */
+    q.last_rc = vnd_acq_last_rc;
+    q.ovs_ratio = a.ovs_ratio;
+    q.ovs_shift = a.ovs_shift;
+    q.bits = a.bits;
+    memcpy(dst,&q,sizeof(q));
+    return (uint16_t)sizeof(q);
+}
+
+/* Страница LOCK: синхронный детектор — геометрия опоры, ведение фазы в adc_stream и учёт записей */
+uint16_t vnd_build_lockin(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_lockin_v1_t)) return 0;
+    vnd_lockin_v1_t l; memset(&l,0,sizeof(l));
+    memcpy(l.sig, "LOCK", 4);
+    l.version = 1;
+    adc_phase_info_t ph; adc_stream_get_phase(&ph);
+    lockin_stats_t st; lockin_get_stats(&st);
+    if(vnd_frame_fmt == VND_FMT_LOCKIN) l.flags |= 0x01u;
+    if(ph.period) l.flags |= 0x02u;
+    if(ph.locked) l.flags |= 0x04u;
+    l.periods = vnd_lockin_periods;
+    l.period_samples = ph.period;
+    l.high_samples = ph.high;
+    l.recs_per_frame = vnd_lockin_recs;
+    l.pending = (uint8_t)lockin_ready();
+    l.records = st.records;
+    l.frames = st.frames;
+    l.gaps = st.gaps;
+    l.no_phase = st.no_phase;
+    l.aborted = st.aborted;
+    l.overflow = st.overflow;
+    l.phase_meas = ph.meas + ph.edge_meas;
+    l.phase_fix = ph.fix;
+    l.phase_dirty = ph.dirty;
+    l.cyc_frame_avg = st.frames ? (uint32_t)(st.cyc_sum / st.frames) : 0u;
+    l.cyc_frame_max = st.cyc_max;
+    l.frames_out = vnd_lockin_frames;
+    memcpy(dst,&l,sizeof(l));
+    return (uint16_t)sizeof(l);
+}
+
+/* Страница PHAS: фаза меандра для кадров АЦП — источник измерения и учёт фронтов */
+uint16_t vnd_build_phase(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_phase_v1_t)) return 0;
+    vnd_phase_v1_t p; memset(&p,0,sizeof(p));
+    memcpy(p.sig, "PHAS", 4);
+    p.version = 1;
+    adc_phase_info_t ph; adc_stream_get_phase(&ph);
+    p.flags = (uint8_t)(ph.src & 0x07u);
+    if(ph.locked) p.flags |= 0x08u;
+    p.period_samples = ph.period;
+    p.high_samples = ph.high;
+    p.edges = ph.edges;
+    p.edge_meas = ph.edge_meas;
+    p.counter_meas = ph.meas;
+    p.fix = ph.fix;
+    p.dirty = ph.dirty;
+    p.edge_amb = ph.edge_amb;
+    p.frames_phase = dbg_frames_phase;
+    p.frames_gpio = dbg_frames_gpio;
+    memcpy(dst,&p,sizeof(p));
+    return (uint16_t)sizeof(p);
+}
+
+/* Страница ZONE: зоны ROI и сэкономленный ими трафик. Таблица — последняя разрешённая таском. */
+uint16_t vnd_build_zone(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_zone_v1_t)) return 0;
+    vnd_zone_v1_t z; memset(&z,0,sizeof(z));
+    memcpy(z.sig, "ZONE", 4);
+    z.version = 1;
+    if(vnd_roi_enabled) z.flags |= 0x01u;
+    if(vnd_zone_us) z.flags |= 0x02u;
+    if(vnd_zr.n && vnd_zr.cnt) z.flags |= 0x04u;
+    z.cfg_count = vnd_zone_cfg_cnt;
+    z.zone_count = vnd_zr.cnt;
+    z.frame_samples = vnd_zr.n;
+    z.zone_samples = vnd_zr.cnt ? vnd_zr.samples : vnd_zr.n;
+    z.frames_zoned = vnd_zone_frames;
+    z.frames_whole = vnd_zone_whole;
+    z.bytes_saved = vnd_zone_saved;
+    for(uint32_t i = 0; i < vnd_zr.cnt; i++){ z.zones[i][0] = vnd_zr.tab[i + 1u][0]; z.zones[i][1] = vnd_zr.tab[i + 1u][1]; }
+    memcpy(dst,&z,sizeof(z));
+    return (uint16_t)sizeof(z);
+}
+
+/* Стоимость vnd_prepare_pair (только вызовы, собравшие кадры) для CACH, с START */
+static uint32_t vnd_prep_count = 0;
+static uint64_t vnd_prep_cyc_sum = 0;
+static uint32_t vnd_prep_cyc_max = 0;
+
+uint16_t vnd_build_cache(uint8_t *dst, uint16_t max_len){
+    extern uint8_t __adc_dma_start__[], __adc_dma_end__[];
+    if(max_len < sizeof(vnd_cache_v1_t)) return 0;
+    vnd_cache_v1_t c; memset(&c,0,sizeof(c));
+    memcpy(c.sig, "CACH", 4);
+    c.version = 1;
+    if(SCB->CCR & SCB_CCR_IC_Msk) c.flags |= 0x01u;
+    if(SCB->CCR & SCB_CCR_DC_Msk) c.flags |= 0x02u;
+    c.loop_cyc_avg = loop_cycle_last_avg;
+    c.cpu_load_permille = cpu_load_permille;
+    c.cpu_isr_permille = cpu_isr_permille;
+    c.wfi_wakeups = cpu_wakeups_per_s;
+    c.prep_count = vnd_prep_count;
+    c.prep_cyc_avg = vnd_prep_count ? (uint32_t)(vnd_prep_cyc_sum / vnd_prep_count) : 0u;
+    c.prep_cyc_max = vnd_prep_cyc_max;
+    c.adc_dma_base = (uint32_t)__adc_dma_start__;
+    c.adc_dma_size = (uint32_t)(__adc_dma_end__ - __adc_dma_start__);
+    {
+        extern volatile uint32_t g_adc_irq_count, g_adc_irq_max;
+        extern volatile uint64_t g_adc_irq_cycles;
+        extern uint8_t _sitcm[], _eitcm[], __dtcm_hot_start__[], __dtcm_hot_end__[];
+        __disable_irq();
+        uint32_t n = g_adc_irq_count; uint64_t cyc = g_adc_irq_cycles;
+        c.adc_irq_cyc_max = g_adc_irq_max;
+        __enable_irq();
+        c.adc_irq_cyc_avg = n ? (uint32_t)(cyc / n) : 0u;
+        c.itcm_bytes = (uint32_t)(_eitcm - _sitcm);
+        c.dtcm_hot_bytes = (uint32_t)(__dtcm_hot_end__ - __dtcm_hot_start__);
+    }
+#if USBD_OTG_DMA_ENABLE
+    {
+        extern uint8_t __usb_dma_start__[], __usb_dma_end__[];
+        c.flags |= 0x04u;
+        c.usb_dma_base = (uint32_t)__usb_dma_start__;
+        c.usb_dma_size = (uint32_t)(__usb_dma_end__ - __usb_dma_start__);
+    }
+#endif
+    memcpy(dst,&c,sizeof(c));
+    return (uint16_t)sizeof(c);
+}
+
+uint16_t vnd_build_boot(uint8_t *dst, uint16_t max_len){
+    extern uint32_t g_pfnVectors[];
+    extern uint8_t _sitcm[], _eitcm[], _sdata[], _edata[], __usb_nocache_start__[], __usb_nocache_end__[];
+    if(max_len < sizeof(vnd_boot_v1_t)) return 0;
+    vnd_boot_v1_t b; memset(&b,0,sizeof(b));
+    memcpy(b.sig, "BOOT", 4);
+    b.version = 1;
+    if(((uint32_t)g_pfnVectors & 0xFF000000u) == 0x08000000u) b.flags |= 0x01u;
+    if(SCB->CCR & SCB_CCR_IC_Msk) b.flags |= 0x02u;
+    if(SCB->CCR & SCB_CCR_DC_Msk) b.flags |= 0x04u;
+    b.sysclk_hz = SystemCoreClock;
+    for(uint32_t i = 0; i < BOOT_MARK_COUNT; i++) b.mark_us[i] = boot_mark_us((boot_mark_t)i);
+    b.itcm_copy_bytes = (uint32_t)(_eitcm - _sitcm);
+    b.data_copy_bytes = (uint32_t)(_edata - _sdata);
+    b.usb_copy_bytes = (uint32_t)(__usb_nocache_end__ - __usb_nocache_start__);
+    memcpy(dst,&b,sizeof(b));
+    return (uint16_t)sizeof(b);
+}
+
+uint16_t vnd_build_ulog(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_ulog_v1_t)) return 0;
+    uart_log_stats_t st; uart_log_get_stats(&st);
+    vnd_ulog_v1_t u; memset(&u,0,sizeof(u));
+    memcpy(u.sig, "ULOG", 4);
+    u.version = 1;
+    if(st.running) u.flags |= 0x01u;
+    if(st.busy) u.flags |= 0x02u;
+    u.ring_size = (uint16_t)UART_LOG_RING;
+    u.level = st.level;
+    u.level_hwm = st.level_hwm;
+    u.writes = st.writes;
+    u.bytes_in = st.bytes_in;
+    u.bytes_out = st.bytes_out;
+    u.dropped_writes = st.dropped_writes;
+    u.dropped_bytes = st.dropped_bytes;
+    u.dma_chunks = st.dma_chunks;
+    u.dma_errors = st.dma_errors;
+    u.wr_cyc_avg = st.writes ? (uint32_t)(st.wr_cyc_sum / st.writes) : 0u;
+    u.wr_cyc_max = st.wr_cyc_max;
+    memcpy(dst,&u,sizeof(u));
+    return (uint16_t)sizeof(u);
+}
+
+uint16_t vnd_build_trace(uint8_t *dst, uint16_t max_len){
+    if(max_len < sizeof(vnd_trace_hdr_t) + 4u * (2u + TRACE_TOK_MAX_ARGS)) return 0; /* влезает самая длинная запись */
+    vnd_trace_hdr_t h; memset(&h,0,sizeof(h));
+    uint32_t *w = (uint32_t*)(void*)(dst + sizeof(h)); /* dst выровнен по 4, заголовок 12 байт */
+    h.words = (uint16_t)trace_tok_read(w, (max_len - sizeof(h)) / 4u);
+    trace_tok_stats_t st; trace_tok_get_stats(&st);
+    h.version = 1;
+    if(st.level) h.flags |= 0x01u;
+    h.dropped = st.dropped;
+    h.sysclk_hz = SystemCoreClock;
+    memcpy(dst,&h,sizeof(h));
+    return (uint16_t)(sizeof(h) + 4u * h.words);
+}
+
+uint16_t vnd_build_events(uint8_t *dst, uint16_t max_len, uint16_t from16){
+    if(max_len < sizeof(vnd_evt_hdr_t) + sizeof(pipe_rec_t)) return 0;
+    vnd_evt_hdr_t h; memset(&h,0,sizeof(h));
+    pipe_rec_t *r = (pipe_rec_t*)(void*)(dst + sizeof(h)); /* dst выровнен по 4, заголовок 20 байт */
+    uint32_t first = 0, wr = 0;
+    h.count = (uint16_t)pipe_trace_read(from16, r, (max_len - sizeof(h)) / sizeof(pipe_rec_t), &first, &wr);
+    h.first = first; h.wr = wr;
+    h.version = 1;
+    h.rec_size = (uint8_t)sizeof(pipe_rec_t);
+    h.ring = (uint16_t)PIPE_TRACE_RECS;
+    h.sysclk_hz = SystemCoreClock;
+    memcpy(dst,&h,sizeof(h));
+    return (uint16_t)(sizeof(h) + h.count * sizeof(pipe_rec_t));
+}
+
+uint16_t vnd_build_prof(uint8_t *dst, uint16_t max_len, uint8_t reset){
+    uint32_t need = sizeof(vnd_prof_hdr_t) + (uint32_t)CYC_PROF_COUNT * sizeof(vnd_prof_rec_t);
+    if(max_len < need) return 0;
+    vnd_prof_hdr_t h; memset(&h,0,sizeof(h));
+    h.version = 1;
+    h.zones = (uint8_t)CYC_PROF_COUNT;
+    h.bins = (uint8_t)CYC_PROF_BINS;
+    h.rec_size = (uint8_t)sizeof(vnd_prof_rec_t);
+    h.sysclk_hz = SystemCoreClock;
+    for(uint32_t i = 0; i < CYC_PROF_COUNT; i++){
+        cyc_prof_stats_t st; vnd_prof_rec_t r; memset(&r,0,sizeof(r));
+        h.elapsed_ms = cyc_prof_get((cyc_prof_id_t)i, &st);
+        strncpy(r.name, cyc_prof_name((cyc_prof_id_t)i), sizeof(r.name));
+        r.count = st.count; r.min_cyc = st.min; r.max_cyc = st.max; r.sum_cyc = st.sum;
+        memcpy(r.hist, st.hist, sizeof(r.hist));
+        memcpy(dst + sizeof(h) + i * sizeof(r), &r, sizeof(r));
+    }
+    if(reset) cyc_prof_reset();
+    memcpy(dst,&h,sizeof(h));
+    return (uint16_t)need;
+}
+
+/* Уровень меандра TIM2_CH2 на первом отсчёте взятого кадра АЦП: 1 — HIGH (ch1 в левый канал),
+ * 0 — LOW (ch2 в левый). По фазе кадра (k0 < H); без неё — чтение PA1 в момент сборки, как раньше
+ * (уровень тогда случаен относительно кадра). Точные границы фаз хост берёт из заголовка (0x40).
  */
 static inline uint8_t vnd_get_meander_state(void)
 {
+    if(vnd_frame_k0 != ADC_PHASE_NONE){
+        adc_phase_info_t ph; adc_stream_get_phase(&ph);
+        if(ph.period) return (vnd_frame_k0 < ph.high) ? 1 : 0;
+    }
     /* Read PA1 state for TIM2_CH2 meander */
     GPIO_PinState state = HAL_GPIO_ReadPin(GPIOA, GPIO_PIN_1);
     return (state == GPIO_PIN_SET) ? 1 : 0;
@@ -634,9 +1223,10 @@ static inline uint8_t vnd_get_meander_state(void)
  * This creates stereo pairs where each ADC channel fills either L or R
  * depending on the meander phase
  */
-static void vnd_prepare_stereo_pair(uint16_t *ch1, uint16_t *ch2, uint16_t samples,
-                                   uint8_t *left_out, uint8_t *right_out, uint16_t out_stride)
+static ITCM_FUNC void vnd_prepare_stereo_pair(uint16_t *ch1, uint16_t *ch2, uint16_t samples,
+                                             uint8_t *left_out, uint8_t *right_out, uint16_t out_stride)
 {
+    CYC_PROF_BEGIN(prof_t0);
     uint8_t meander_high = vnd_get_meander_state();
     
     if (meander_high) {
@@ -674,40 +1264,110 @@ static void vnd_prepare_stereo_pair(uint16_t *ch1, uint16_t *ch2, uint16_t sampl
             right_out += out_stride;
         }
     }
+    CYC_PROF_END(CYC_PROF_PREP_STEREO, prof_t0);
 }
 
-static void vnd_prepare_pair(void)
+#if ADC_STREAM_DUAL_MODE
+/* Dual-режим: кадр АЦП — слова {ADC1 | ADC2<<16} (adc12_buffers). vnd_take_adc_frame отдаёт
+   ch1 = ch2 = NULL и запоминает слова кадра; каналы по отдельности (пара A/B, планарный v2,
+   сжатие) раскладываются в scratch по требованию, чередующийся v2 копирует слова как есть. */
+static const uint32_t *vnd_adc_ab;
+static uint16_t vnd_adc_ch[2][MAX_FRAME_SAMPLES];
+
+static void vnd_adc_planes(uint16_t **ch1, uint16_t **ch2, uint16_t n)
 {
-    dbg_prepare_calls++;
-    uint16_t *ch1 = NULL, *ch2 = NULL; uint16_t samples = 0;
-    /* last-buffer-wins: берём последний доступный кадр; если накопилась очередь >1, пропускаем старые */
-    /* Локальная логика: забрать последний кадр из ADC FIFO, безопасно по отношению к ISR */
-    {
-        uint32_t wr, rd, backlog, seq;
-        __disable_irq();
-        wr = frame_wr_seq; rd = frame_rd_seq;
-        if (wr == rd) { __enable_irq(); return; }
-        backlog = wr - rd;
-        if (backlog > 1u) {
-            /* Перескочить на последний полный кадр и пометить все промежуточные как пропущенные */
-            seq = wr - 1u;
-            dbg_skipped_frames += (backlog - 1u);
-            frame_rd_seq = wr; /* потребили все до последнего */
-        } else {
-            seq = rd; frame_rd_seq = rd + 1u;
+    if(*ch1) return;
+    adc_stream_split(vnd_adc_ab, vnd_adc_ch[0], vnd_adc_ch[1], n);
+    *ch1 = vnd_adc_ch[0]; *ch2 = vnd_adc_ch[1];
+}
+
+/* Payload чередующегося v2 из слов АЦП: L | R<<16. swap — ADC2 в L (низкий меандр) */
+static void vnd_ab_to_lr(const uint32_t *ab, uint16_t n, uint8_t swap, uint8_t *out)
+{
+    if(!swap){ memcpy(out, ab, (uint32_t)n * 4u); return; }
+    uint32_t *dst = (uint32_t*)out;
+    for(uint16_t i = 0; i < n; i++) dst[i] = __ROR(ab[i], 16);
+}
+#else
+static inline void vnd_adc_planes(uint16_t **ch1, uint16_t **ch2, uint16_t n){ (void)ch1; (void)ch2; (void)n; }
+#endif
+
+/* Отсчёты зон ROI подряд в scratch (в dual-режиме — тот же vnd_adc_ch, раскладка только зон).
+   ch1/ch2 переводятся на scratch, дальше payload собирается как для кадра из m отсчётов.
+   Возвращает отсчётов на канал в payload: n — ROI выключен или зоны не дают выигрыша. */
+#if ADC_STREAM_DUAL_MODE
+#define vnd_zone_ch vnd_adc_ch
+#else
+static uint16_t vnd_zone_ch[2][MAX_FRAME_SAMPLES];
+#endif
+static uint16_t vnd_zone_gather(uint16_t **ch1, uint16_t **ch2, uint16_t n)
+{
+    vnd_frame_zones = 0;
+    if(!vnd_roi_active()) return n;
+    vnd_zone_resolve(n);
+    if(!vnd_zr.cnt){ vnd_zone_whole++; return n; }
+    uint32_t o = 0;
+#if ADC_STREAM_DUAL_MODE
+    if(!*ch1){
+        /* Чередованные A/B: раскладка только зон */
+        for(uint32_t z = 1; z <= vnd_zr.cnt; z++){
+            uint32_t st = vnd_zr.tab[z][0], ln = vnd_zr.tab[z][1];
+            adc_stream_split(vnd_adc_ab + st, &vnd_zone_ch[0][o], &vnd_zone_ch[1][o], ln);
+            o += ln;
         }
-        __enable_irq();
-        uint32_t index = (uint32_t)(seq & (FIFO_FRAMES - 1u));
-        ch1 = adc1_buffers[index];
-        ch2 = adc2_buffers[index];
-        /* ИСПРАВЛЕНИЕ: использовать глобальный getter вместо внутреннего debug поля,
-           чтобы получить актуальное значение samples после смены профиля */
-        samples = adc_stream_get_active_samples();
-    }
-    if(samples == 0){
-        /* Нет новых данных от АЦП — ничего не отправляем */
-        return;
+    } else
+#endif
+    o = frame_zone_gather(&vnd_zr, *ch1, *ch2, vnd_zone_ch[0], vnd_zone_ch[1]);
+    *ch1 = vnd_zone_ch[0]; *ch2 = vnd_zone_ch[1];
+    vnd_frame_zones = vnd_zr.cnt;
+    vnd_zone_frames++;
+    /* Отсчёты обоих каналов минус таблица (в паре A/B она в каждом кадре) */
+    uint32_t tabs = VND_ZONE_TAB_BYTES(vnd_zr.cnt) * (vnd_fmt_stereo() ? 1u : 2u);
+    vnd_zone_saved += ((uint32_t)n - o) * 4u - tabs;
+    return (uint16_t)o;
+}
+
+/* Забрать кадр из ADC FIFO без блокировки прерываний (кольцо SPSC, adc_stream_acquire).
+   Возвращает число выборок (0 — данных нет).
+   latest=1: last-buffer-wins — при очереди >1 старые кадры пропускаются;
+   latest=0: строго по порядку (очередь передачи, пачки burst); пропуск только при переполнении кольца.
+   *t_us — время завершения DMA кадра (мкс, 64 бита), в заголовок идут младшие 32 бита.
+   *seq — номер кадра АЦП для adc_stream_validate() после копирования (или сжатия) отсчётов в кадр
+   USB: 0 — DMA занял слот, кадр разорван и не отправляется. Проверять до постановки CRC, чтобы
+   движок CRC не держал отброшенный буфер. */
+static uint16_t vnd_take_adc_frame(uint16_t **ch1, uint16_t **ch2, uint64_t *t_us, uint32_t *seq, uint8_t latest)
+{
+    uint32_t skipped = 0;
+    if (!adc_stream_acquire(seq, &skipped, latest)) return 0;
+    dbg_skipped_frames += skipped;
+    uint32_t index = (uint32_t)(*seq & (FIFO_FRAMES - 1u));
+    *t_us = adc_stream_frame_time_us(*seq);
+    vnd_frame_k0 = adc_stream_frame_phase(*seq);
+    vnd_frame_zones = 0; /* зоны ставит vnd_zone_gather при сборке payload */
+    if(vnd_frame_k0 != ADC_PHASE_NONE) dbg_frames_phase++; else dbg_frames_gpio++;
+#if ADC_STREAM_DUAL_MODE
+    vnd_adc_ab = adc12_buffers[index];
+    *ch1 = NULL; *ch2 = NULL;
+#else
+    *ch1 = adc1_buffers[index];
+    *ch2 = adc2_buffers[index];
+#endif
+    /* N — тот, с которым DMA заполнял слот: при смене профиля на лету он меняется с кадра на кадр */
+    uint8_t first = 0;
+    uint16_t n = adc_stream_frame_samples(*seq, &first);
+    if(first && !vnd_resync_flag){
+        /* Первый кадр нового профиля: перефиксировать размер, хост перефиксирует по флагу в заголовке */
+        VND_LOG("RESYNC N=%u (was %u) adc_seq=%lu", (unsigned)n, (unsigned)cur_samples_per_frame, (unsigned long)*seq);
+        cur_samples_per_frame = 0; cur_expected_frame_size = 0;
+        vnd_resync_flag = VND_FLAGS_RESYNC;
+        dbg_resync++;
     }
+    return n;
+}
+
+/* Применить лимиты хоста и зафиксировать размер кадра. 0 — кадр не совпал с зафиксированным размером */
+static uint16_t vnd_lock_frame_samples(uint16_t samples)
+{
     /* Применяем усечение до блокировки формата */
     uint16_t effective = samples;
     /* Применим явный лимит от хоста (samples_per_frame) если задан */
@@ -716,51 +1376,281 @@ static void vnd_prepare_pair(void)
     if(cur_samples_per_frame == 0){
         if(effective > VND_MAX_SAMPLES) effective = VND_MAX_SAMPLES;
         cur_samples_per_frame = effective;
-        cur_expected_frame_size = (uint16_t)(VND_FRAME_HDR_SIZE + (uint32_t)cur_samples_per_frame * 2u);
+        cur_expected_frame_size = (uint16_t)vnd_frame_bytes(cur_samples_per_frame);
         VND_LOG("SIZE_LOCK %u (raw=%u trunc=%u)", cur_samples_per_frame, samples, vnd_trunc_samples);
     /* Не меняем stream_seq здесь: seq инкрементируется только после завершения кадра B (TxCplt) */
     }
     if(effective != cur_samples_per_frame){
         VND_LOG("SIZE_MISMATCH: eff=%u cur=%u raw=%u", effective, cur_samples_per_frame, samples);
         dbg_partial_frame_abort++;
-        return;
+        return 0;
     }
+    return effective;
+}
+
+/* Собрать пару в свободный слот кольца g_frames[pair_fill_idx].
+   Возвращает число готовых кадров (FB_READY): 2 — A и B, 1 — стерео-кадр v2 в [0], 0 — ничего. */
+static ITCM_FUNC uint8_t vnd_prepare_pair(void)
+{
     ChanFrame *f0 = &g_frames[pair_fill_idx][0];
     ChanFrame *f1 = &g_frames[pair_fill_idx][1];
-    if(f0->st != FB_FILL || f1->st != FB_FILL) return;
-    memset(f0->buf, 0, sizeof(f0->buf)); memset(f1->buf, 0, sizeof(f1->buf));
-    uint32_t pair_timestamp = HAL_GetTick();
+    /* Слот ещё в очереди или у EP IN (zero-copy, TxCplt не пришёл) — кадр АЦП не забираем */
+    if(f0->st != FB_FILL || f1->st != FB_FILL || f0->crc_pending || f1->crc_pending) return 0;
+    if(USBD_VND_TxIsLent(f0->buf) || USBD_VND_TxIsLent(f1->buf)) return 0;
+    if(vnd_fmt_lockin()) return vnd_prepare_lockin(f0);
+    dbg_prepare_calls++;
+    uint16_t *ch1 = NULL, *ch2 = NULL;
+    uint64_t t_us = 0;
+    uint32_t adc_seq = 0;
+    /* Строго по порядку: глубина очереди поглощает задержки таска, кадры не перескакиваем */
+    uint16_t samples = vnd_take_adc_frame(&ch1, &ch2, &t_us, &adc_seq, 0u);
+    if(samples == 0){
+        /* Нет новых данных от АЦП — ничего не отправляем */
+        return 0;
+    }
+    PIPE_EVT(PT_EV_PREP_BEGIN, adc_seq, samples);
+    if(vnd_lock_frame_samples(samples) == 0) return 0;
+    uint32_t pair_timestamp = (uint32_t)t_us;
     /* подробный лог пары убран для снижения нагрузки */
     /* Применяем усечение, если задано и меньше доступного */
     uint16_t use_samples = cur_samples_per_frame; /* уже определено и проверено */
+    if(vnd_fmt_stereo()){
+        /* Стерео v2: один кадр на пару занимает слот целиком (через кадр [0]), B не используется */
+        f0->samples = use_samples; f0->seq = next_seq_to_assign;
+        f0->frame_size = (uint16_t)vnd_build_stereo_frame(f0->buf, ch1, ch2, use_samples, f0->seq, pair_timestamp);
+        if(!adc_stream_validate(adc_seq)){ PIPE_EVT(PT_EV_PREP_END, PT_SEQ_NONE, adc_seq); return 0; } /* разорван: слот остаётся FB_FILL, seq не расходуем */
+        vnd_frame_crc_start(f0->buf, f0->frame_size, &f0->crc_pending);
+        f0->flags = ((const vnd_frame_hdr_t*)f0->buf)->flags;
+        if(!(f0->flags & VND_FLAGS_RICE) && cur_expected_frame_size && f0->frame_size != cur_expected_frame_size) dbg_size_mismatch++;
+        dbg_any_valid_frame = 1; f0->st = FB_READY; vnd_resync_flag = 0;
+        pair_fill_idx = (pair_fill_idx + 1u) % VND_PAIR_BUFFERS;
+        PIPE_EVT(PT_EV_PREP_END, next_seq_to_assign, adc_seq);
+        next_seq_to_assign++;
+        dbg_prepare_ok++;
+        return 1;
+    }
+    f0->flags = VND_FLAGS_ADC0;
+    /* Паддинг за кадром не передаётся: чистим только заголовки */
+    memset(f0->buf, 0, VND_FRAME_HDR_SIZE); memset(f1->buf, 0, VND_FRAME_HDR_SIZE);
     
+    /* ROI: в payload только зоны, за таблицей зон; use_samples — отсчётов на канал в payload */
+    use_samples = vnd_zone_gather(&ch1, &ch2, use_samples);
+    uint32_t tab = VND_ZONE_TAB_BYTES(vnd_frame_zones);
     /* Используем стерео распределение на основе состояния меандра */
-    uint8_t *left_buf = f0->buf + VND_FRAME_HDR_SIZE;
-    uint8_t *right_buf = f1->buf + VND_FRAME_HDR_SIZE;
-    vnd_prepare_stereo_pair(ch1, ch2, use_samples, left_buf, right_buf, 4u);
+    uint8_t *left_buf = f0->buf + VND_FRAME_HDR_SIZE + tab;
+    uint8_t *right_buf = f1->buf + VND_FRAME_HDR_SIZE + tab;
+    uint32_t comp0 = 0, comp1 = 0;
+    vnd_adc_planes(&ch1, &ch2, use_samples);
+    if(vnd_compress){
+        /* Кодер читает отсчёты прямо из буфера АЦП; L/R по меандру, как в vnd_prepare_stereo_pair */
+        const uint16_t *l = ch1, *r = ch2;
+        if(!vnd_get_meander_state()){ l = ch2; r = ch1; }
+        comp0 = vnd_rice_payload(left_buf, l, use_samples);
+        comp1 = vnd_rice_payload(right_buf, r, use_samples);
+    } else {
+        /* Шаг 2 байта: в кадре канала выборки идут подряд (total_samples*2 байт payload) */
+        vnd_prepare_stereo_pair(ch1, ch2, use_samples, left_buf, right_buf, 2u);
+    }
     
+    if(!adc_stream_validate(adc_seq)){ PIPE_EVT(PT_EV_PREP_END, PT_SEQ_NONE, adc_seq); return 0; } /* разорван: слот остаётся FB_FILL, seq не расходуем */
     f0->samples = f1->samples = use_samples; f0->seq = f1->seq = next_seq_to_assign;
     vnd_frame_hdr_t *h0 = (vnd_frame_hdr_t*)f0->buf; h0->timestamp = pair_timestamp;
     vnd_frame_hdr_t *h1 = (vnd_frame_hdr_t*)f1->buf; h1->timestamp = pair_timestamp;
-    vnd_build_frame(f0); vnd_build_frame(f1);
-    if(f0->st == FB_FILL || f1->st == FB_FILL){ dbg_partial_frame_abort++; VND_LOG("build failed"); return; }
+    vnd_build_frame(f0, comp0); vnd_build_frame(f1, comp1);
+    if(f0->st == FB_FILL || f1->st == FB_FILL){ dbg_partial_frame_abort++; VND_LOG("build failed"); f0->st = f1->st = FB_FILL; return 0; }
     /* VND_LOG("Pair prepared, fill_idx=%u", pair_fill_idx); */
+    vnd_resync_flag = 0;
     pair_fill_idx = (pair_fill_idx + 1u) % VND_PAIR_BUFFERS;
+    PIPE_EVT(PT_EV_PREP_END, next_seq_to_assign, adc_seq);
     next_seq_to_assign++;
     dbg_prepare_ok++;
-    /* VND_LOG("vnd_prepare_pair end"); */
+    return 2;
+}
+
+/* Fs в 16 бит заголовка: 12 бит мантиссы, 4 бита сдвига (Fs = m << e), точность не хуже 1/2048 */
+static uint16_t vnd_rate_code(uint32_t hz)
+{
+    uint32_t e = 0;
+    while(hz > 0xFFFu && e < 15u){ hz = (hz + 1u) >> 1; e++; }
+    if(hz > 0xFFFu) hz = 0xFFFu;
+    return (uint16_t)((e << 12) | hz);
 }
 
-static void vnd_build_frame(ChanFrame *cf)
+/* Заполнить заголовок рабочего кадра (timestamp не трогаем — его ставит сборщик пары).
+   Фронты меандра — по фазе кадра АЦП, взятого последним (vnd_frame_k0); при зонах ROI
+   (vnd_frame_zones) сюда же пишется таблица зон в начало payload. */
+static inline void vnd_write_frame_hdr(uint8_t *buf, uint8_t flags, uint32_t seq, uint16_t samples)
+{
+    vnd_frame_hdr_t *h = (vnd_frame_hdr_t*)buf;
+    h->magic = 0xA55A; h->ver = 0x01; h->flags = (uint8_t)(flags | vnd_resync_flag); h->seq = seq; h->total_samples = samples;
+    h->zone_count = vnd_frame_zones; h->comp_len = 0; h->crc16 = 0;
+    if(vnd_frame_zones) memcpy(buf + VND_FRAME_HDR_SIZE, vnd_zr.tab, VND_ZONE_TAB_BYTES(vnd_frame_zones));
+    h->edge_rise = 0; h->edge_fall = 0; h->meander_period = 0; h->meander_high = 0;
+    h->sample_bits = adc_stream_get_sample_bits();
+    h->rate_code = vnd_rate_code(adc_stream_get_sample_rate());
+    if(vnd_frame_k0 != ADC_PHASE_NONE){
+        adc_phase_info_t ph; adc_stream_get_phase(&ph);
+        uint32_t p = ph.period, k0 = vnd_frame_k0;
+        if(p && k0 < p){
+            h->flags |= VND_FLAGS_PHASE;
+            h->edge_rise = (uint16_t)((p - k0) % p);
+            h->edge_fall = (uint16_t)((ph.high + p - k0) % p);
+            h->meander_period = (uint16_t)p; h->meander_high = ph.high;
+        }
+    }
+}
+
+/* Сжатый payload: флаг и длина в заголовке (comp_len = 0 — кадр несжатый, заголовок не трогаем) */
+static inline void vnd_hdr_set_comp(uint8_t *buf, uint32_t comp_len)
+{
+    if(!comp_len) return;
+    vnd_frame_hdr_t *h = (vnd_frame_hdr_t*)buf;
+    h->flags |= VND_FLAGS_RICE; h->comp_len = comp_len;
+}
+
+/* Payload одного канала при SET_COMPRESS: сжатый, если это даёт выигрыш, иначе отсчёты как есть.
+   Возвращает comp_len для заголовка (0 — payload несжатый, 2*n байт). */
+static uint32_t vnd_rice_payload(uint8_t *payload, const uint16_t *src, uint16_t n)
+{
+    uint32_t comp = frame_rice_encode(&src, 1u, n, payload, (uint32_t)n * 2u);
+    if(!comp) memcpy(payload, src, (uint32_t)n * 2u);
+    return comp;
+}
+
+/* Чередование L/R одним проходом: слово payload = L | R<<16 (LE).
+   С DSP-расширением M7 по два отсчёта канала читаются одним словом и собираются PKHBT/PKHTB. */
+static void vnd_interleave_lr(const uint16_t *l, const uint16_t *r, uint16_t n, uint8_t *out)
+{
+    uint32_t *dst = (uint32_t*)out; /* payload кадра выровнен минимум на 4 */
+    uint16_t i = 0;
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    for(; (uint16_t)(i + 1u) < n; i += 2u){
+        uint32_t a, b;
+        memcpy(&a, &l[i], 4u); memcpy(&b, &r[i], 4u); /* l[i] | l[i+1]<<16, r[i] | r[i+1]<<16 */
+        dst[i]      = __PKHBT(a, b, 16);              /* l[i]   | r[i]<<16   */
+        dst[i + 1u] = __PKHTB(b, a, 16);              /* l[i+1] | r[i+1]<<16 */
+    }
+#endif
+    for(; i < n; i++) dst[i] = (uint32_t)l[i] | ((uint32_t)r[i] << 16);
+}
+
+/* CRC кадра (SET_CRC): флаг в заголовке и постановка в очередь блока CRC. Заголовок к этому
+   моменту окончательный. Очередь полна — кадр уходит без флага (счётчик в PERF.crc_skipped). */
+static void vnd_frame_crc_start(uint8_t *frame, uint32_t len, volatile uint8_t *pending)
+{
+    if(!vnd_crc_enabled) return;
+    vnd_frame_hdr_t *h = (vnd_frame_hdr_t*)frame;
+    h->flags |= VND_FLAGS_CRC;
+    if(!frame_crc_submit(frame, len, pending)) h->flags &= (uint8_t)~VND_FLAGS_CRC;
+}
+
+/* Сброс очереди CRC вместе с буферами: недосчитанные кадры больше не ждём */
+static void vnd_crc_reset(void)
+{
+    frame_crc_flush();
+    for(uint8_t p=0;p<VND_PAIR_BUFFERS;p++){ g_frames[p][0].crc_pending = 0; g_frames[p][1].crc_pending = 0; }
+    g_burst[0].crc_pending = 0; g_burst[1].crc_pending = 0;
+}
+
+/* Payload стерео-кадра v2: каналы L/R по меандру, как в паре A/B. Сжатый — плоскости L, R подряд
+   независимо от раскладки. Возвращает comp_len (0 — payload несжатый, 4*n байт). */
+static uint32_t vnd_stereo_payload(uint8_t *payload, uint16_t *ch1, uint16_t *ch2, uint16_t n, uint8_t planar)
+{
+    uint8_t high = vnd_get_meander_state();
+#if ADC_STREAM_DUAL_MODE
+    if(!ch1 && !planar && !vnd_compress){
+        /* Чередование уже сделал АЦП: копия слов кадра, без раскладки по каналам */
+        vnd_ab_to_lr(vnd_adc_ab, n, (uint8_t)!high, payload);
+        return 0;
+    }
+#endif
+    vnd_adc_planes(&ch1, &ch2, n);
+    const uint16_t *l = ch1, *r = ch2;
+    if(!high){ l = ch2; r = ch1; }
+    if(vnd_compress){
+        const uint16_t *planes[2] = { l, r };
+        uint32_t comp = frame_rice_encode(planes, 2u, n, payload, (uint32_t)n * 4u);
+        if(comp) return comp;
+    }
+    if(planar){
+        memcpy(payload, l, (uint32_t)n * 2u);
+        memcpy(payload + (uint32_t)n * 2u, r, (uint32_t)n * 2u);
+    } else {
+        vnd_interleave_lr(l, r, n, payload);
+    }
+    return 0;
+}
+
+/* Собрать стерео-кадр v2 в dst (ver=2, flags=ADC0|ADC1[|PLANAR][|RICE]), n — отсчётов кадра АЦП
+   (при ROI в payload уходят только зоны). Возвращает длину кадра. */
+static uint32_t vnd_build_stereo_frame(uint8_t *dst, uint16_t *ch1, uint16_t *ch2, uint16_t n,
+                                       uint32_t seq, uint32_t ts)
+{
+    uint8_t planar = (vnd_frame_fmt == VND_FMT_STEREO_PLANAR) ? 1u : 0u;
+    n = vnd_zone_gather(&ch1, &ch2, n);
+    uint32_t tab = VND_ZONE_TAB_BYTES(vnd_frame_zones);
+    uint32_t comp = vnd_stereo_payload(dst + VND_FRAME_HDR_SIZE + tab, ch1, ch2, n, planar);
+    vnd_write_frame_hdr(dst, (uint8_t)(VND_FLAGS_ADC0 | VND_FLAGS_ADC1 | (planar ? VND_FLAGS_PLANAR : 0u)), seq, n);
+    vnd_frame_hdr_t *h = (vnd_frame_hdr_t*)dst;
+    h->ver = VND_FRAME_VER_STEREO; h->timestamp = ts;
+    vnd_hdr_set_comp(dst, comp);
+    return VND_FRAME_HDR_SIZE + tab + (comp ? comp : (uint32_t)n * 4u);
+}
+
+/* Lock-in: кадры АЦП уходят в демодулятор по порядку, в USB — только записи I/Q. Кадр v3
+   (flags=ADC0|ADC1, total_samples = число записей) собирается, когда готово vnd_lockin_recs записей,
+   и занимает слот пары через кадр [0], как стерео v2. 1 — кадр готов. */
+static uint8_t vnd_prepare_lockin(ChanFrame *f0)
+{
+    uint8_t want = vnd_lockin_recs;
+    while(lockin_ready() < want){
+        uint16_t *ch1 = NULL, *ch2 = NULL;
+        uint64_t t_us = 0;
+        uint32_t adc_seq = 0;
+        uint16_t n = vnd_take_adc_frame(&ch1, &ch2, &t_us, &adc_seq, 0u);
+        if(n == 0) return 0;
+        dbg_prepare_calls++;
+#if ADC_STREAM_DUAL_MODE
+        const uint32_t *ab = vnd_adc_ab; /* суммы по словам {ADC1 | ADC2<<16}, без раскладки */
+#else
+        const uint32_t *ab = NULL;
+#endif
+        uint32_t closed = lockin_feed(adc_seq, ch1, ch2, ab, n, adc_stream_frame_phase(adc_seq), t_us);
+        /* Разорванный кадр уже в суммах: записи, которые он закрыл, и начатую выбрасываем */
+        if(!adc_stream_validate(adc_seq)) lockin_abort(closed);
+    }
+    uint8_t *payload = f0->buf + VND_FRAME_HDR_SIZE;
+    uint32_t k = lockin_pop(payload, want);
+    const lockin_rec_t *last = (const lockin_rec_t*)(payload + (k - 1u) * LOCKIN_REC_SIZE);
+    f0->samples = (uint16_t)k; f0->seq = next_seq_to_assign;
+    vnd_frame_k0 = ADC_PHASE_NONE; /* в записях нет отсчётов — фронты в заголовке не нужны */
+    vnd_write_frame_hdr(f0->buf, (uint8_t)(VND_FLAGS_ADC0 | VND_FLAGS_ADC1), f0->seq, (uint16_t)k);
+    vnd_frame_hdr_t *h = (vnd_frame_hdr_t*)f0->buf;
+    h->ver = VND_FRAME_VER_LOCKIN; h->timestamp = last->t_end_us;
+    f0->frame_size = (uint16_t)(VND_FRAME_HDR_SIZE + k * LOCKIN_REC_SIZE);
+    vnd_frame_crc_start(f0->buf, f0->frame_size, &f0->crc_pending);
+    f0->flags = h->flags;
+    dbg_any_valid_frame = 1; f0->st = FB_READY; vnd_resync_flag = 0;
+    pair_fill_idx = (pair_fill_idx + 1u) % VND_PAIR_BUFFERS;
+    next_seq_to_assign++;
+    vnd_lockin_frames++;
+    dbg_prepare_ok++;
+    return 1;
+}
+
+/* comp_len — длина сжатого payload (vnd_rice_payload), 0 — payload несжатый */
+static void vnd_build_frame(ChanFrame *cf, uint32_t comp_len)
 {
     if(cf->samples == 0){ cf->st = FB_FILL; return; }
-    uint32_t payload_len = (uint32_t)cf->samples * 2u;
+    uint32_t payload_len = VND_ZONE_TAB_BYTES(vnd_frame_zones) + (comp_len ? comp_len : (uint32_t)cf->samples * 2u);
     uint32_t total = VND_FRAME_HDR_SIZE + payload_len;
-    vnd_frame_hdr_t *h = (vnd_frame_hdr_t*)cf->buf;
-    h->magic = 0xA55A; h->ver = 0x01; h->flags = (cf->flags & VND_FLAGS_ADC0) ? 0x01 : 0x02; h->seq = cf->seq; h->total_samples = (uint16_t)cf->samples;
-    h->zone_count = 0; h->zone1_offset = 0; h->zone1_length = 0; h->reserved = 0; h->reserved2 = 0; h->crc16 = 0;
+    vnd_write_frame_hdr(cf->buf, (cf->flags & VND_FLAGS_ADC0) ? 0x01 : 0x02, cf->seq, (uint16_t)cf->samples);
+    vnd_hdr_set_comp(cf->buf, comp_len);
     cf->frame_size = (uint16_t)total;
-    if(cur_expected_frame_size && cf->frame_size != cur_expected_frame_size) dbg_size_mismatch++;
+    /* timestamp уже записан сборщиком пары: заголовок окончательный, можно считать CRC */
+    vnd_frame_crc_start(cf->buf, total, &cf->crc_pending);
+    cf->flags = ((const vnd_frame_hdr_t*)cf->buf)->flags;
+    if(!comp_len && cur_expected_frame_size && cf->frame_size != cur_expected_frame_size) dbg_size_mismatch++;
     dbg_any_valid_frame = 1; cf->st = FB_READY;
 }
 
@@ -781,7 +1671,18 @@ static int vnd_validate_frame(const uint8_t *buf, uint16_t len, uint8_t expect_t
     if (!(allow_flags & 0x01) && h->total_samples == 0)
         return 0;
     {
-        uint16_t expected = (uint16_t)(VND_FRAME_HDR_SIZE + h->total_samples * 2u);
+        /* Стерео v2 несёт оба канала: 4 байта на отсчёт; lock-in v3 — записи вместо отсчётов */
+        uint32_t bps = (h->ver == VND_FRAME_VER_STEREO) ? 4u : (h->ver == VND_FRAME_VER_LOCKIN) ? LOCKIN_REC_SIZE : 2u;
+        uint32_t payload = (uint32_t)h->total_samples * bps;
+        /* Сжатый payload: длина из заголовка, кодер отдаёт только укороченные кадры */
+        if (h->flags & VND_FLAGS_RICE) {
+            if (h->comp_len == 0u || h->comp_len >= payload) return 0;
+            payload = h->comp_len;
+        }
+        /* Зоны ROI: таблица перед отсчётами */
+        if (h->zone_count > VND_ZONES_MAX) return 0;
+        payload += VND_ZONE_TAB_BYTES(h->zone_count);
+        uint16_t expected = (uint16_t)(VND_FRAME_HDR_SIZE + payload);
         if (len != expected) {
             /* Разрешаем «припадиненные» кадры: длина >= expected и кратна 64 байтам (FS/HS совместимо) */
             if ((allow_flags & 0x02) == 0) return 0;
@@ -811,7 +1712,11 @@ static USBD_StatusTypeDef __attribute__((unused)) vnd_transmit_frame(uint8_t *bu
 
     /* Зафиксируем точный тип текущего кадра в полёте */
     if(len >= VND_FRAME_HDR_SIZE){ const vnd_frame_hdr_t *hh = (const vnd_frame_hdr_t*)buf; if(hh->magic==0xA55A){ inflight_is_frame = 1; inflight_flags = hh->flags; inflight_seq = hh->seq; } else { inflight_is_frame = 0; inflight_flags = 0; inflight_seq = 0; } } else { inflight_is_frame = 0; inflight_flags = 0; inflight_seq = 0; }
+#if VND_TX_ZERO_COPY
+    USBD_StatusTypeDef rc = USBD_VND_TransmitZC(&hUsbDeviceHS, buf, len);
+#else
     USBD_StatusTypeDef rc = USBD_VND_Transmit(&hUsbDeviceHS, buf, len);
+#endif
     if(rc == USBD_BUSY){
         dbg_resend_blocked++; vnd_error_counter++; if(vnd_last_error == 0) vnd_last_error = 4;
         /* Диагностика LL: получим last rc/len и флаг занятости */
@@ -822,6 +1727,12 @@ static USBD_StatusTypeDef __attribute__((unused)) vnd_transmit_frame(uint8_t *bu
         VND_LOG("TX_BUSY tag=%s len=%u ll_busy=%u last_rc=%u last_len=%u", tag?tag:"?", (unsigned)len, (unsigned)ll_busy, (unsigned)ll_rc, (unsigned)ll_len);
         vnd_tx_ready = 1; vnd_ep_busy = 0; vnd_inflight = 0;
     }
+    else if(rc != USBD_OK){
+        /* FAIL от LL: передача не стартовала, TxCplt не придёт — освобождаем тракт так же, как при BUSY */
+        vnd_error_counter++; if(vnd_last_error == 0) vnd_last_error = 4;
+        VND_LOG("TX_FAIL tag=%s len=%u rc=%u", tag?tag:"?", (unsigned)len, (unsigned)rc);
+        vnd_tx_ready = 1; vnd_ep_busy = 0; vnd_inflight = 0;
+    }
     else {
         /* Фиксируем метаданные ТОЛЬКО после успешного запуска передачи, иначе не сместим FIFO зря */
         vnd_tx_meta_after(buf, len);
@@ -841,6 +1752,265 @@ static USBD_StatusTypeDef __attribute__((unused)) vnd_transmit_frame(uint8_t *bu
     return rc;
 }
 
+/* ---------------- Очередь передачи полного режима ----------------
+   Таск только собирает пары из ADC FIFO и добавляет дескрипторы A,B в хвост кольца. Передачу
+   ведёт TxCplt: снимает завершённый head и тут же ставит следующий, так что темп кадров не зависит
+   от частоты вызова Vendor_Stream_Task. Таск запускает EP сам лишь после простоя (очередь была пуста). */
+static void vnd_txq_reset(void)
+{
+    vnd_txq_head = vnd_txq_tail = 0; vnd_txq_active = 0;
+    vnd_txq_hwm = 0; vnd_txq_underrun = 0;
+}
+
+static inline void vnd_txq_push(ChanFrame *cf)
+{
+    vnd_txq[vnd_txq_tail & (VND_TXQ_DEPTH - 1u)].cf = cf;
+    __DMB(); /* дескриптор виден TxCplt раньше нового tail */
+    vnd_txq_tail = (uint8_t)(vnd_txq_tail + 1u);
+    uint8_t d = vnd_txq_depth();
+    if(d > vnd_txq_hwm) vnd_txq_hwm = d;
+}
+
+/* Дособрать пары, пока в кольце есть свободные слоты и в ADC FIFO есть кадры (только из таска) */
+static void vnd_txq_fill(void)
+{
+    while((uint8_t)(VND_TXQ_DEPTH - vnd_txq_depth()) >= 2u){
+        uint8_t idx = pair_fill_idx;
+        uint32_t c0 = DWT->CYCCNT;
+        uint8_t n = vnd_prepare_pair();
+        if(!n) return;
+        uint32_t cyc = DWT->CYCCNT - c0;
+        CYC_PROF_ADD(CYC_PROF_PREP_PAIR, cyc);
+        vnd_prep_count++; vnd_prep_cyc_sum += cyc;
+        if(cyc > vnd_prep_cyc_max) vnd_prep_cyc_max = cyc;
+        vnd_txq_push(&g_frames[idx][0]);
+        if(n > 1u) vnd_txq_push(&g_frames[idx][1]);
+    }
+}
+
+/* Поставить head в EP IN, если канал свободен. 1 — передача запущена.
+   Из таска вызывать с запрещёнными прерываниями (гонка с TxCplt). Короткий путь, как у пачек:
+   кадр собран сборщиком пары с точной длиной (vnd_build_frame), поэтому без vnd_validate_frame,
+   меты FIFO и логов — TxCplt узнаёт кадр очереди по vnd_txq_active. */
+static ITCM_FUNC int vnd_txq_kick(void)
+{
+    if(vnd_txq_active || vnd_ep_busy || vnd_inflight || !vnd_tx_ready) return 0;
+    if(vnd_txq_head == vnd_txq_tail) return 0;
+    ChanFrame *cf = vnd_txq[vnd_txq_head & (VND_TXQ_DEPTH - 1u)].cf;
+    if(cf->crc_pending) return 0; /* crc16 ещё считается — таск повторит пуск */
+    dbg_tx_attempt++;
+    vnd_tx_ready = 0; vnd_ep_busy = 1; vnd_inflight = 1; vnd_last_tx_len = cf->frame_size; vnd_last_tx_start_ms = HAL_GetTick();
+#if VND_TX_ZERO_COPY
+    USBD_StatusTypeDef rc = USBD_VND_TransmitZC(&hUsbDeviceHS, cf->buf, cf->frame_size);
+#else
+    USBD_StatusTypeDef rc = USBD_VND_Transmit(&hUsbDeviceHS, cf->buf, cf->frame_size);
+#endif
+    if(rc != USBD_OK){
+        vnd_error_counter++; if(rc == USBD_BUSY) dbg_resend_blocked++;
+        vnd_tx_ready = 1; vnd_ep_busy = 0; vnd_inflight = 0;
+        return 0;
+    }
+    cf->st = FB_SENDING; vnd_txq_active = 1;
+    return 1;
+}
+
+/* TxCplt кадра из очереди: учёт, освобождение слота после B, постановка следующего */
+static ITCM_FUNC void vnd_txq_on_txcplt(void)
+{
+    ChanFrame *cf = vnd_txq[vnd_txq_head & (VND_TXQ_DEPTH - 1u)].cf;
+    PIPE_EVT(PT_EV_TXCPLT, cf->seq, vnd_last_tx_len);
+    vnd_txq_active = 0;
+    cf->st = FB_FILL;
+    dbg_tx_sent++;
+    uint8_t pair_done = 0;
+    if(cf->flags & VND_FLAGS_ADC0){
+        dbg_sent_ch0_total++; dbg_sent_seq_adc0++;
+    }
+    if(cf->flags & VND_FLAGS_ADC1){
+        /* B (или стерео-кадр с обоими каналами) закрывает пару: слот снова доступен сборщику */
+        dbg_sent_ch1_total++; dbg_sent_seq_adc1++;
+        pair_send_idx = (pair_send_idx + 1u) % VND_PAIR_BUFFERS;
+        stream_seq++; dbg_produced_seq++;
+        if(!first_pair_done){ first_pair_done = 1; boot_mark(BOOT_MARK_TX_FRAME); }
+        pair_done = 1;
+    }
+    vnd_txq_head = (uint8_t)(vnd_txq_head + 1u);
+    if(!streaming || stop_request){ vnd_tx_kick = 1; return; }
+    /* Отложенный STAT по bulk уходит из таска, строго между парами */
+    if(pair_done && pending_status){ vnd_tx_kick = 1; return; }
+    if(!vnd_txq_kick()){
+        if(vnd_txq_head == vnd_txq_tail) vnd_txq_underrun++;
+        vnd_tx_kick = 1;
+    }
+}
+
+/* ---------------- Пакетный режим (burst) ----------------
+   Вместо пары трансферов A,B на каждый кадр АЦП собираем K пар подряд в один буфер и отдаём
+   его одним USBD_VND_TransmitZC: один DataIn/TxCplt и один проход таска на K пар. Кадры внутри
+   пачки идут вплотную с обычными заголовками, хост делит поток по magic/total_samples и
+   пропускает нулевой паддинг в конце. Включается командой SET_BURST, только в полном режиме. */
+static void vnd_burst_reset(void)
+{
+    for(uint8_t i=0;i<2;i++){ g_burst[i].st = FB_FILL; g_burst[i].pairs = 0; g_burst[i].used = 0; g_burst[i].len = 0; g_burst[i].first_seq = 0; }
+    burst_fill_idx = burst_send_idx = 0; burst_inflight = 0;
+}
+
+/* Пар в пачке с учётом размера буфера для текущего размера кадра */
+static uint8_t vnd_burst_pairs_eff(void)
+{
+    uint32_t fit = VND_BURST_BUF_SIZE / vnd_pair_bytes(cur_samples_per_frame);
+    uint8_t k = burst_pairs_req;
+    if(k > fit) k = (uint8_t)fit;
+    return k ? k : 1u;
+}
+
+/* Пачка готова: паддинг нулями до кратности MPS текущей скорости */
+static void vnd_burst_close(BurstBuf *b)
+{
+    uint32_t used = b->used;
+    uint32_t mps = (hUsbDeviceHS.dev_speed == USBD_SPEED_HIGH) ? 512u : 64u;
+    uint32_t padded = ((used + mps - 1u) / mps) * mps;
+    memset(b->buf + used, 0, padded - used);
+    b->len = (uint16_t)padded;
+    b->st = FB_READY;
+    burst_fill_idx ^= 1u;
+}
+
+/* Дособрать текущую пачку из ADC FIFO (строго по порядку кадров). Буфер в EP не трогаем. */
+static void vnd_burst_collect(void)
+{
+    BurstBuf *b = &g_burst[burst_fill_idx];
+    if(b->st != FB_FILL) return; /* обе пачки заняты: одна в EP, другая ждёт */
+    if(USBD_VND_TxIsLent(b->buf)) return;
+    for(;;){
+        uint16_t *ch1 = NULL, *ch2 = NULL;
+        uint64_t t_us = 0;
+        uint32_t adc_seq = 0;
+        uint16_t samples = vnd_take_adc_frame(&ch1, &ch2, &t_us, &adc_seq, 0u);
+        if(samples == 0) return;
+        dbg_prepare_calls++;
+        uint16_t n = vnd_lock_frame_samples(samples);
+        if(n == 0) continue;
+        /* frame_bytes — байт на пару: A+B или один стерео-кадр v2 */
+        uint32_t frame_bytes = vnd_pair_bytes(n);
+        if(b->pairs && b->frame_bytes != frame_bytes){
+            /* Размер кадра сменился посреди пачки (смена профиля, SET_FRAME_SAMPLES/TRUNC): начатую
+               пачку отдаём короче, кадр возвращаем в кольцо — он откроет следующую пачку */
+            adc_stream_unget(adc_seq);
+            vnd_burst_close(b);
+            return;
+        }
+        b->frame_bytes = (uint16_t)frame_bytes;
+        uint8_t k = vnd_burst_pairs_eff();
+        /* Кадры вплотную: сжатые пары занимают меньше frame_bytes */
+        uint8_t *fa = b->buf + b->used;
+        uint32_t ts = (uint32_t)t_us;
+        if(vnd_fmt_stereo()){
+            uint32_t fl = vnd_build_stereo_frame(fa, ch1, ch2, n, next_seq_to_assign, ts);
+            if(!adc_stream_validate(adc_seq)) continue; /* разорван: used не двигаем, место перезапишет следующий */
+            vnd_frame_crc_start(fa, fl, &b->crc_pending);
+            b->used = (uint16_t)(b->used + fl);
+        } else {
+            uint32_t la = frame_bytes / 2u, lb = frame_bytes / 2u, ca = 0, cb = 0;
+            uint8_t *fb;
+            n = vnd_zone_gather(&ch1, &ch2, n);
+            uint32_t hl = VND_FRAME_HDR_SIZE + VND_ZONE_TAB_BYTES(vnd_frame_zones); /* заголовок + таблица зон */
+            vnd_adc_planes(&ch1, &ch2, n);
+            if(vnd_compress){
+                const uint16_t *l = ch1, *r = ch2;
+                if(!vnd_get_meander_state()){ l = ch2; r = ch1; }
+                ca = vnd_rice_payload(fa + hl, l, n);
+                if(ca) la = hl + ca;
+                fb = fa + la;
+                cb = vnd_rice_payload(fb + hl, r, n);
+                if(cb) lb = hl + cb;
+            } else {
+                fb = fa + la;
+                vnd_prepare_stereo_pair(ch1, ch2, n, fa + hl, fb + hl, 2u);
+            }
+            if(!adc_stream_validate(adc_seq)) continue;
+            vnd_write_frame_hdr(fa, 0x01, next_seq_to_assign, n); ((vnd_frame_hdr_t*)fa)->timestamp = ts;
+            vnd_write_frame_hdr(fb, 0x02, next_seq_to_assign, n); ((vnd_frame_hdr_t*)fb)->timestamp = ts;
+            vnd_hdr_set_comp(fa, ca); vnd_hdr_set_comp(fb, cb);
+            vnd_frame_crc_start(fa, la, &b->crc_pending);
+            vnd_frame_crc_start(fb, lb, &b->crc_pending);
+            b->used = (uint16_t)(b->used + la + lb);
+        }
+        if(b->pairs == 0) b->first_seq = next_seq_to_assign;
+        next_seq_to_assign++; b->pairs++; dbg_prepare_ok++; dbg_any_valid_frame = 1; vnd_resync_flag = 0;
+        if(b->pairs >= k){
+            vnd_burst_close(b);
+            return;
+        }
+    }
+}
+
+/* Поставить готовую пачку в EP IN (из таска или из TxCplt) */
+static int vnd_burst_try_send(void)
+{
+    if(vnd_ep_busy || vnd_inflight || !vnd_tx_ready || burst_inflight) return 0;
+    BurstBuf *b = &g_burst[burst_send_idx];
+    if(b->st != FB_READY || b->crc_pending) return 0;
+    dbg_tx_attempt++;
+    vnd_tx_ready = 0; vnd_ep_busy = 1; vnd_inflight = 1; vnd_last_tx_len = b->len; vnd_last_tx_start_ms = HAL_GetTick();
+    inflight_is_frame = 0; inflight_flags = 0; inflight_seq = 0;
+#if VND_TX_ZERO_COPY
+    USBD_StatusTypeDef rc = USBD_VND_TransmitZC(&hUsbDeviceHS, b->buf, b->len);
+#else
+    USBD_StatusTypeDef rc = USBD_VND_Transmit(&hUsbDeviceHS, b->buf, b->len);
+#endif
+    if(rc != USBD_OK){
+        vnd_error_counter++; if(rc == USBD_BUSY) dbg_resend_blocked++;
+        vnd_tx_ready = 1; vnd_ep_busy = 0; vnd_inflight = 0;
+        return 0;
+    }
+    b->st = FB_SENDING; burst_inflight = 1; /* TxCplt узнаёт пачку по burst_inflight, меты FIFO нет */
+    VND_LOG("BURST_TX pairs=%u len=%u seq=%lu", (unsigned)b->pairs, (unsigned)b->len, (unsigned long)b->first_seq);
+    return 1;
+}
+
+/* Шаг таска в режиме burst: 1 — пачка поставлена в EP */
+static int vnd_burst_task_step(uint32_t now)
+{
+    vnd_burst_collect();
+    /* Вотчдог: EP_UNSTUCK снял busy, а TxCplt так и не пришёл — пачку считаем потерянной */
+    if(burst_inflight && !vnd_ep_busy && (now - vnd_last_tx_start_ms) > 200){
+        BurstBuf *b = &g_burst[burst_send_idx];
+        VND_LOG("BURST_DROP pairs=%u seq=%lu", (unsigned)b->pairs, (unsigned long)b->first_seq);
+        PIPE_EVT(PT_EV_UNSTICK, b->first_seq, PT_UNSTICK_BURST_DROP | ((now - vnd_last_tx_start_ms) << 8));
+        b->st = FB_FILL; b->pairs = 0; b->used = 0; b->len = 0;
+        burst_send_idx ^= 1u; burst_inflight = 0; vnd_inflight = 0; vnd_tx_ready = 1;
+        dbg_burst_drop++;
+    }
+    /* STAT по bulk — только между пачками */
+    if(!vnd_ep_busy && !vnd_inflight && pending_status && first_pair_done){
+        vnd_try_send_pending_status_from_task();
+        if(vnd_ep_busy) return 1;
+    }
+    if(vnd_tx_kick) vnd_tx_kick = 0;
+    /* Пачку ставят в EP и TxCplt, и колбэк CRC (frame_crc_on_done) — пуск из таска под запретом IRQ */
+    __disable_irq();
+    int started = vnd_burst_try_send();
+    __enable_irq();
+    return started;
+}
+
+/* TxCplt пачки: все K пар считаются отправленными разом */
+static void vnd_burst_on_txcplt(void)
+{
+    BurstBuf *b = &g_burst[burst_send_idx];
+    uint8_t k = b->pairs;
+    burst_inflight = 0;
+    dbg_tx_sent += 2u * k; dbg_sent_ch0_total += k; dbg_sent_ch1_total += k;
+    dbg_sent_seq_adc0 += k; dbg_sent_seq_adc1 += k;
+    stream_seq += k; dbg_produced_seq += k; dbg_burst_sent++;
+    b->st = FB_FILL; b->pairs = 0; b->used = 0; b->len = 0;
+    burst_send_idx ^= 1u;
+    if(!first_pair_done){ first_pair_done = 1; boot_mark(BOOT_MARK_TX_FRAME); }
+    /* Следующая пачка могла собраться, пока эта была в полёте — отдаём сразу */
+    if(!streaming || stop_request || !vnd_burst_try_send()){ vnd_tx_kick = 1; }
+}
+
 /* Упрощённая диагностическая пара A/B: подготовка буферов по текущему cur_samples_per_frame */
 static void vnd_diag_prepare_pair(uint32_t seq, uint16_t samples)
 {
@@ -851,11 +2021,12 @@ static void vnd_diag_prepare_pair(uint32_t seq, uint16_t samples)
     uint16_t pad_unit = 512u;
     uint16_t padded = (uint16_t)(((uint32_t)(base_len + (pad_unit-1u)) / pad_unit) * pad_unit);
     if (padded < base_len) padded = base_len; /* защита от переполнения (не ожидается) */
+    if (padded > VND_DIAG_BUF_SIZE) padded = VND_DIAG_BUF_SIZE;
     diag_frame_len = padded;
     /* A */
     memset(diag_a_buf, 0, diag_frame_len);
     vnd_frame_hdr_t *ha = (vnd_frame_hdr_t*)diag_a_buf;
-    ha->magic = 0xA55A; ha->ver = 0x01; ha->flags = 0x01; ha->seq = seq; ha->timestamp = HAL_GetTick(); ha->total_samples = samples;
+    ha->magic = 0xA55A; ha->ver = 0x01; ha->flags = 0x01; ha->seq = seq; ha->timestamp = (uint32_t)timebase_us64(); ha->total_samples = samples;
     for(uint16_t i=0;i<samples;i++){ uint16_t v=i; diag_a_buf[VND_FRAME_HDR_SIZE+2*i]=(uint8_t)(v & 0xFF); diag_a_buf[VND_FRAME_HDR_SIZE+2*i+1]=(uint8_t)(v>>8); }
     /* B */
     memset(diag_b_buf, 0, diag_frame_len);
@@ -922,70 +2093,41 @@ static int vnd_diag_try_tx(void)
 #endif
 }
 
-/* === Немедленная отправка B после завершения A (внутри TxCplt) === */
+/* === DIAG: немедленная отправка B после завершения A (внутри TxCplt) ===
+   Полный режим ведёт очередь передачи (vnd_txq_on_txcplt). */
 static int vnd_try_send_B_immediate(void)
 {
     if(vnd_ep_busy) return 0;
-    /* DIAG режим: используем заранее подготовленный diag_b_buf с текущим seq */
-    if(diag_mode_active){
-        if(!pending_B) return 0;
-        if(diag_frame_len == 0) return 0;
-        if(diag_frame_len >= VND_FRAME_HDR_SIZE){
-            vnd_frame_hdr_t *hb = (vnd_frame_hdr_t*)diag_b_buf;
-            const vnd_frame_hdr_t *ha = (const vnd_frame_hdr_t*)diag_a_buf;
-            /* В DIAG заголовок B копируем из A для гарантированной идентичности пары */
-            if(hb->magic == 0xA55A && ha->magic == 0xA55A){
-                hb->seq = ha->seq;
-                hb->timestamp = ha->timestamp;
-                hb->total_samples = ha->total_samples;
-            }
-        }
-        if(!vnd_validate_frame(diag_b_buf, diag_frame_len, 0, 0x02)) return 0;
-        if(vnd_transmit_frame(diag_b_buf, diag_frame_len, 0, 0x02, "ADC1-IMM") == USBD_OK){
-            sending_channel = 1; /* B в полёте */
-            return 1;
+    /* Используем заранее подготовленный diag_b_buf с текущим seq */
+    if(!pending_B) return 0;
+    if(diag_frame_len == 0) return 0;
+    if(diag_frame_len >= VND_FRAME_HDR_SIZE){
+        vnd_frame_hdr_t *hb = (vnd_frame_hdr_t*)diag_b_buf;
+        const vnd_frame_hdr_t *ha = (const vnd_frame_hdr_t*)diag_a_buf;
+        /* В DIAG заголовок B копируем из A для гарантированной идентичности пары */
+        if(hb->magic == 0xA55A && ha->magic == 0xA55A){
+            hb->seq = ha->seq;
+            hb->timestamp = ha->timestamp;
+            hb->total_samples = ha->total_samples;
         }
-        return 0;
     }
-    /* Полный режим: отправляем B из текущего pair_send_idx, если READY */
-    ChanFrame *fB = &g_frames[pair_send_idx][1];
-    if(fB->st != FB_READY) return 0;
-    /* Корректируем seq при необходимости (безопасно) */
-    if(fB->frame_size >= VND_FRAME_HDR_SIZE){
-        vnd_frame_hdr_t *hb = (vnd_frame_hdr_t*)fB->buf;
-        if(hb->magic == 0xA55A && hb->seq != stream_seq){ hb->seq = stream_seq; fB->seq = stream_seq; }
-    }
-    if(vnd_transmit_frame(fB->buf, fB->frame_size, 0, 0, "ADC1-IMM") == USBD_OK){
-        fB->st = FB_SENDING; sending_channel = 1;
+    if(!vnd_validate_frame(diag_b_buf, diag_frame_len, 0, 0x02)) return 0;
+    if(vnd_transmit_frame(diag_b_buf, diag_frame_len, 0, 0x02, "ADC1-IMM") == USBD_OK){
+        sending_channel = 1; /* B в полёте */
         return 1;
     }
     return 0;
 }
 
-/* === Немедленная отправка A следующей пары после завершения B (внутри TxCplt) === */
+/* === DIAG: немедленная отправка A следующей пары после завершения B (внутри TxCplt) === */
 static int vnd_try_send_A_nextpair_immediate(void)
 {
     if(vnd_ep_busy) return 0;
-    /* После B мы уже сдвинули pair_send_idx/seq во внешней логике — тут пытаемся сразу выстрелить A новой пары */
-    if(diag_mode_active){
-        /* Подготовим следующую пару под новый stream_seq и сразу пошлём A */
-        vnd_diag_prepare_pair(stream_seq, cur_samples_per_frame ? cur_samples_per_frame : diag_samples);
-        if(!vnd_validate_frame(diag_a_buf, diag_frame_len, 0, 0x02)) return 0;
-        if(vnd_transmit_frame(diag_a_buf, diag_frame_len, 0, 0x02, "ADC0-IMM") == USBD_OK){
-            sending_channel = 0; pending_B = 1; pending_B_since_ms = HAL_GetTick();
-            return 1;
-        }
-        return 0;
-    }
-    /* Полный режим: убедимся, что в буфере подготовки есть готовый A; если нет — попробуем собрать */
-    ChanFrame *fA = &g_frames[pair_send_idx][0];
-    if(fA->st != FB_READY){
-        vnd_prepare_pair();
-        fA = &g_frames[pair_send_idx][0];
-        if(fA->st != FB_READY) return 0;
-    }
-    if(vnd_transmit_frame(fA->buf, fA->frame_size, 0, 0, "ADC0-IMM") == USBD_OK){
-        fA->st = FB_SENDING; sending_channel = 0; pending_B = 1; pending_B_since_ms = HAL_GetTick();
+    /* Подготовим следующую пару под новый stream_seq и сразу пошлём A */
+    vnd_diag_prepare_pair(stream_seq, cur_samples_per_frame ? cur_samples_per_frame : diag_samples);
+    if(!vnd_validate_frame(diag_a_buf, diag_frame_len, 0, 0x02)) return 0;
+    if(vnd_transmit_frame(diag_a_buf, diag_frame_len, 0, 0x02, "ADC0-IMM") == USBD_OK){
+        sending_channel = 0; pending_B = 1; pending_B_since_ms = HAL_GetTick();
         return 1;
     }
     return 0;
@@ -1012,7 +2154,7 @@ static void vnd_emergency_keepalive(uint32_t now_ms)
     last_emerg_ms = now_ms;
     uint8_t tbuf[32+16]; memset(tbuf,0,sizeof(tbuf));
     vnd_frame_hdr_t *h = (vnd_frame_hdr_t*)tbuf;
-    h->magic = 0xA55A; h->ver = 0x01; h->flags = 0x80; h->seq = 0; h->timestamp = HAL_GetTick(); h->total_samples = 8;
+    h->magic = 0xA55A; h->ver = 0x01; h->flags = 0x80; h->seq = 0; h->timestamp = (uint32_t)timebase_us64(); h->total_samples = 8;
     for(uint16_t i=0;i<8;i++){ tbuf[32+2*i]=(uint8_t)i; tbuf[32+2*i+1]=(uint8_t)(i>>8); }
     vnd_tx_ready = 0; vnd_ep_busy = 1; vnd_last_tx_len = sizeof(tbuf); vnd_last_tx_start_ms = HAL_GetTick();
     if(USBD_VND_Transmit(&hUsbDeviceHS, tbuf, sizeof(tbuf)) == USBD_OK){
@@ -1041,7 +2183,7 @@ static void vnd_try_send_test_from_task(void)
     last_try_ms = now;
     uint8_t tbuf[32+16]; memset(tbuf,0,sizeof(tbuf));
     vnd_frame_hdr_t *h = (vnd_frame_hdr_t*)tbuf;
-    h->magic = 0xA55A; h->ver = 0x01; h->flags = 0x80; h->seq = 0; h->timestamp = HAL_GetTick(); h->total_samples = 8;
+    h->magic = 0xA55A; h->ver = 0x01; h->flags = 0x80; h->seq = 0; h->timestamp = (uint32_t)timebase_us64(); h->total_samples = 8;
     for(uint16_t i=0;i<8;i++){ tbuf[32+2*i]=(uint8_t)i; tbuf[32+2*i+1]=(uint8_t)(i>>8); }
     vnd_tx_ready = 0; vnd_ep_busy = 1; vnd_last_tx_len = sizeof(tbuf); vnd_last_tx_start_ms = HAL_GetTick();
     if(USBD_VND_Transmit(&hUsbDeviceHS, tbuf, sizeof(tbuf)) == USBD_OK){
@@ -1080,6 +2222,75 @@ void __attribute__((unused)) vnd_diag_send64_once(void)
     }
 }
 
+/* Общий хвост таска стрима (A/B и burst): DMA-таймаут, CDC-статистика, LCD, вотчдоги.
+   Выполняется, только если на этом проходе ничего не поставлено в EP. */
+static void vnd_stream_task_tail(uint32_t now)
+{
+    if(vnd_tick_flag) vnd_tick_flag = 0;
+    if(cur_samples_per_frame == 0 && start_cmd_ms && (now - start_cmd_ms) > VND_DMA_TIMEOUT_MS && !no_dma_status_sent){
+        adc_stream_debug_t dbg; adc_stream_get_debug(&dbg);
+        if(dbg.dma_full0 == dma_snapshot_full0 && dbg.dma_full1 == dma_snapshot_full1){ no_dma_status_sent = 1; if(vnd_last_error == 0) vnd_last_error = 1; VND_LOG("ERR DMA_TIMEOUT"); }
+    }
+    /* Периодическая CDC-статистика по байтам/скорости */
+    vnd_cdc_periodic_stats(now);
+    /* Периодическое обновление дисплея LCD с информацией о потоке */
+    stream_display_periodic_update();
+    /* Небольшой NAK-watchdog: если давно не было завершений — попросим мягкий ресет класса.
+       Он выполнится асинхронно и не блокирует EP0. */
+    if((now - vnd_last_txcplt_ms) > 1500){
+        extern void USBD_VND_RequestSoftReset(void);
+        USBD_VND_RequestSoftReset();
+        vnd_last_txcplt_ms = now; /* предотвратить лавину запросов */
+        VND_LOG("WDG_SOFT_RESET_REQ");
+    }
+    /* Аварийный keepalive тестом — только в диагностике; в полном режиме не посылаем TEST повторно */
+    if(!full_mode){
+        /* В DIAG режиме можно слать keepalive TEST — оставляем как было. */
+    if(dbg_tx_cplt == 0 && (now - start_cmd_ms) > 150 && !vnd_ep_busy){
+#if !VND_DISABLE_TEST
+        vnd_emergency_keepalive(now);
+#endif
+    }
+    }
+    /* Периодический диагностический лог ранней стадии: пока нет ни одного TXCPLT или отсутствует прогресс */
+    do {
+        static uint32_t last_diag_ms = 0;
+        static uint32_t last_diag_txcplt = 0;
+        if(now - last_diag_ms > 200){
+            if(dbg_tx_cplt == 0 || dbg_tx_cplt != last_diag_txcplt){
+                /* Получим отладочные счётчики DMA, если доступны */
+                VND_LOG("DIAG txcplt=%lu test_sent=%u test_in_flight=%u pendB=%u ep_busy=%u inflight=%u ch=%u ackPend=%u seq=%lu prod=%lu sent0=%lu sent1=%lu wr=%lu rd=%lu metaDepth=%u", (unsigned long)dbg_tx_cplt, (unsigned)test_sent, (unsigned)test_in_flight, (unsigned)pending_B, (unsigned)vnd_ep_busy, (unsigned)vnd_inflight, (unsigned)sending_channel, (unsigned)status_ack_pending, (unsigned long)stream_seq, (unsigned long)dbg_produced_seq, (unsigned long)dbg_sent_ch0_total, (unsigned long)dbg_sent_ch1_total, (unsigned long)frame_wr_seq, (unsigned long)frame_rd_seq, (unsigned)vnd_tx_meta_depth());
+                last_diag_txcplt = dbg_tx_cplt;
+            }
+            last_diag_ms = now;
+        }
+    } while(0);
+
+    /* Ускоренный watchdog: 600мс без завершений передачи считаем зависанием */
+    if(streaming && (now - vnd_last_txcplt_ms) > 600){
+        VND_LOG("WDG_RESTART (no TXCPLT >600ms) reset test/pendingB");
+        /* Полный мягкий сброс внутренней машины, без остановки DMA */
+        stream_seq = 0; dbg_produced_seq = 0; cur_samples_per_frame = 0; cur_expected_frame_size = 0;
+        vnd_ep_busy = 0; vnd_tx_ready = 1; vnd_inflight = 0; sending_channel = 0xFF; pending_B = 0; pending_B_since_ms = 0;
+        test_sent = 0; test_in_flight = 0;
+        start_ack_done = 1; status_ack_pending = 0;
+        vnd_last_txcplt_ms = now;
+        vnd_tx_meta_head = vnd_tx_meta_tail = 0; meta_push_total = meta_pop_total = meta_empty_events = meta_overflow_events = 0; /* clear FIFO */
+        /* Разрешаем немедленный запуск следующей пары и готовим её прямо сейчас */
+        next_seq_to_assign = stream_seq; /* критично: выровнять назначение seq к текущему */
+        vnd_next_pair_ms = now; /* не ждать периода */
+        /* Кольца кадров пустые; буферы не чистим — они могут быть ещё у EP */
+        for(uint8_t p=0;p<VND_PAIR_BUFFERS;p++){ g_frames[p][0].st = g_frames[p][1].st = FB_FILL; }
+        vnd_crc_reset();
+        pair_fill_idx = pair_send_idx = 0;
+        vnd_txq_reset(); vnd_burst_reset();
+        if(!vnd_burst_enabled()) vnd_txq_fill();
+        vnd_tx_kick = 1;
+    }
+
+    /* Если нет прогресса — не синтезируем кадры; ждём реальные данные от АЦП */
+}
+
 /* Основной периодический таск */
 void __attribute__((unused)) Vendor_Stream_Task(void)
 {
@@ -1124,6 +2335,7 @@ void __attribute__((unused)) Vendor_Stream_Task(void)
             USBD_VND_ForceTxIdle();
             vnd_ep_busy = 0; vnd_tx_ready = 1;
             VND_LOG("EP_UNSTUCK after %lums (len=%u) vbusy=%u", (unsigned long)(now_ms - vnd_last_tx_start_ms), (unsigned)vnd_last_tx_len, (unsigned)vbusy);
+            PIPE_EVT(PT_EV_UNSTICK, PT_SEQ_NONE, PT_UNSTICK_EP | ((now_ms - vnd_last_tx_start_ms) << 8));
         }
     } while(0);
 
@@ -1140,6 +2352,7 @@ void __attribute__((unused)) Vendor_Stream_Task(void)
             vnd_ep_busy = 0; vnd_tx_ready = 1;
             extern void USBD_VND_ForceTxIdle(void); USBD_VND_ForceTxIdle();
             VND_LOG("ACK_FALLBACK(no inflight) -> allow TEST");
+            PIPE_EVT(PT_EV_UNSTICK, PT_SEQ_NONE, PT_UNSTICK_ACK_FALLBACK | ((now - start_cmd_ms) << 8));
             if(!vnd_ep_busy){ vnd_try_send_test_from_task(); }
         }
     }
@@ -1150,6 +2363,7 @@ void __attribute__((unused)) Vendor_Stream_Task(void)
             start_stat_inflight = 0; start_ack_done = 1; vnd_ep_busy = 0; vnd_tx_ready = 1;
             extern void USBD_VND_ForceTxIdle(void); USBD_VND_ForceTxIdle();
             VND_LOG("ACK_TIMEOUT -> unlock test");
+            PIPE_EVT(PT_EV_UNSTICK, PT_SEQ_NONE, PT_UNSTICK_ACK_TIMEOUT | ((now - vnd_last_tx_start_ms) << 8));
             /* Сразу отдадим ещё один STAT (если был queued) и попробуем отправить TEST */
             if(pending_status && !vnd_ep_busy){
                 vnd_try_send_pending_status_from_task();
@@ -1168,12 +2382,9 @@ void __attribute__((unused)) Vendor_Stream_Task(void)
         start_ack_done = 1;
         VND_LOG("TEST_FALLTHRU after %lums -> proceed to A/B", (unsigned long)(now - start_cmd_ms));
     }
-    /* ВАЖНО: сначала попробуем подготовить пару A/B, чтобы не зациклиться на ранних STAT.
-       Подготовка пары не зависит от занятости EP, поэтому убираем лишний гейтинг по vnd_ep_busy. */
-    {
-        ChanFrame *fA0 = &g_frames[pair_send_idx][0];
-        if(fA0->st != FB_READY){ vnd_prepare_pair(); }
-    }
+    /* ВАЖНО: сначала дособираем пары в очередь передачи, чтобы не зациклиться на ранних STAT.
+       Сборка не зависит от занятости EP, поэтому гейтинга по vnd_ep_busy нет. */
+    if(full_mode && !diag_mode_active && !vnd_burst_enabled()){ vnd_txq_fill(); }
     /* Раннее окно для GET_STATUS до первой пары — отключено: STAT по IN только между парами. */
     /* Дополнительный ранний запуск TEST: если после START прошло >50 мс и EP свободен */
     if(!test_sent && !test_in_flight) {
@@ -1194,6 +2405,7 @@ void __attribute__((unused)) Vendor_Stream_Task(void)
     extern void USBD_VND_ForceTxIdle(void); USBD_VND_ForceTxIdle();
         vnd_tx_kick = 1;
         VND_LOG("TEST_TIMEOUT -> unlock EP");
+        PIPE_EVT(PT_EV_UNSTICK, PT_SEQ_NONE, PT_UNSTICK_TEST_TIMEOUT | ((now - vnd_last_tx_start_ms) << 8));
     }
     if(!test_sent){
         if(!vnd_ep_busy){
@@ -1228,15 +2440,28 @@ void __attribute__((unused)) Vendor_Stream_Task(void)
     }
     if(!full_mode){ if(vnd_tick_flag) vnd_tick_flag = 0; return; }
 
-    /* Упреждающая подготовка пары: когда TEST уже завершён и B не ожидается. */
-    if(test_sent && !pending_B){
-        ChanFrame *fa_chk = &g_frames[pair_send_idx][0];
-        if(fa_chk->st != FB_READY){ vnd_prepare_pair(); }
+    /* Пакетный режим: машина A/B ниже не используется, пары уходят пачками */
+    if(vnd_burst_enabled()){
+        if(vnd_burst_task_step(now)) return;
+        vnd_stream_task_tail(now);
+        return;
+    }
+
+    /* Очередь передачи: пары дособираются выше (vnd_txq_fill), дальше кадры уходят из TxCplt.
+       Таск нужен только для STAT между парами, вотчдога и запуска EP после простоя. */
+    /* Вотчдог: EP_UNSTUCK снял busy, а TxCplt кадра head так и не пришёл — ставим его заново */
+    if(vnd_txq_active && !vnd_ep_busy && (now - vnd_last_tx_start_ms) > 200){
+        ChanFrame *cf = vnd_txq[vnd_txq_head & (VND_TXQ_DEPTH - 1u)].cf;
+        cf->st = FB_READY; vnd_txq_active = 0; vnd_inflight = 0; vnd_tx_ready = 1;
+        VND_LOG("TXQ_RETRY fl=0x%02X seq=%lu depth=%u", (unsigned)cf->flags, (unsigned long)cf->seq, (unsigned)vnd_txq_depth());
+        PIPE_EVT(PT_EV_UNSTICK, cf->seq, PT_UNSTICK_TXQ_RETRY | ((now - vnd_last_tx_start_ms) << 8));
     }
 
-    /* Окно для GET_STATUS: отправлять STAT строго между парами, чтобы не разрывать A/B. */
-    if(!vnd_ep_busy && !vnd_inflight && pending_status){
-        if (test_sent && !pending_B && first_pair_done && sending_channel == 0xFF) {
+    /* Окно для GET_STATUS: STAT строго между парами (head — A или очередь пуста), чтобы не разрывать A/B */
+    if(!vnd_ep_busy && !vnd_inflight && !vnd_txq_active && pending_status && test_sent && first_pair_done){
+        uint8_t at_pair_boundary = (vnd_txq_head == vnd_txq_tail) ||
+            (vnd_txq[vnd_txq_head & (VND_TXQ_DEPTH - 1u)].cf->flags & VND_FLAGS_ADC0);
+        if(at_pair_boundary){
             vnd_try_send_pending_status_from_task();
             if(vnd_ep_busy){ if(vnd_tick_flag) vnd_tick_flag = 0; return; }
         }
@@ -1246,203 +2471,41 @@ void __attribute__((unused)) Vendor_Stream_Task(void)
     if(vnd_ep_busy){ if(vnd_tick_flag) vnd_tick_flag = 0; return; }
 
     /* Если TEST уже логически завершён, но его мета застряла в FIFO (нет TxCplt) —
-       через ~60 мс превращаем её в служебную, чтобы не блокировать отправку A. */
+       через ~60 мс превращаем её в служебную, чтобы классификация TxCplt не сбилась. */
     vnd_force_complete_test_meta_if_stale();
 
-    static uint8_t first_pair_logged = 0; /* диагностический лог первой пары */
-
-    static uint8_t first_bq_logged = 0; /* однократный лог первой постановки B */
-    if(pending_B){
-        /* Гарантируем, что текущая пара действительно подготовлена: если A ещё не готов (FB_FILL) — соберём пару сейчас. */
-        ChanFrame *fA_pre = &g_frames[pair_send_idx][0];
-        if(fA_pre->st == FB_FILL && !vnd_ep_busy){ vnd_prepare_pair(); }
-        ChanFrame *fB = &g_frames[pair_send_idx][1];
-        if(fB->st == FB_READY){
-            /* Перед отправкой B корректируем seq, если он отличается от ожидаемого stream_seq */
-            if(fB->frame_size >= VND_FRAME_HDR_SIZE){
-                vnd_frame_hdr_t *hb = (vnd_frame_hdr_t*)fB->buf;
-                if(hb->magic == 0xA55A && hb->seq != stream_seq){
-                    VND_LOG("PATCH_B_SEQ hdr=%lu -> %lu", (unsigned long)hb->seq, (unsigned long)stream_seq);
-                    hb->seq = stream_seq; fB->seq = stream_seq;
-                }
-            }
-            USBD_StatusTypeDef rcB = vnd_transmit_frame(fB->buf, fB->frame_size, 0, 0, "ADC1");
-            if (rcB == USBD_OK) {
-                if(!first_bq_logged){ first_bq_logged = 1; VND_LOG("FIRST_B queued size=%u", (unsigned)fB->frame_size); }
-                fB->st = FB_SENDING; sending_channel = 1; return;
-            } else if (rcB == USBD_BUSY) {
-                static uint32_t b_busy_retry = 0; b_busy_retry++;
-                if (b_busy_retry == 1 || (b_busy_retry % 10) == 0) {
-                    VND_LOG("B_BUSY_RETRY cnt=%lu", (unsigned long)b_busy_retry);
-                }
-                /* оставляем кадр в READY и попробуем позже */
-            } else {
-                VND_LOG("B_TX_FAIL rc=%d", (int)rcB);
-            }
-        } else {
-            /* Диагностируем, почему ждём B: выводим однократно переход в нестандартное состояние */
-            static uint32_t last_log_ms = 0;
-            uint32_t now_ms = HAL_GetTick();
-            if(now_ms - last_log_ms > 200){
-                VND_LOG("WAIT_B st=%u pair_send=%u fill_idx=%u seq=%lu cur_seq=%lu", (unsigned)fB->st, (unsigned)pair_send_idx, (unsigned)pair_fill_idx, (unsigned long)fB->seq, (unsigned long)stream_seq);
-                last_log_ms = now_ms;
-            }
-            /* Watchdog B: если B уже в полёте и нет TxCplt слишком долго — форсируем завершение пары */
-            if(fB->st == FB_SENDING && (now_ms - vnd_last_tx_start_ms) > 150){
-                /* Не закрываем пару! Снимаем busy, нейтрализуем старую мета и переотправляем B */
-                extern void USBD_VND_ForceTxIdle(void); USBD_VND_ForceTxIdle();
-                vnd_ep_busy = 0; vnd_tx_ready = 1; vnd_inflight = 0;
-                vnd_meta_neutralize(0x02, g_frames[pair_send_idx][1].seq);
-                g_frames[pair_send_idx][1].st = FB_READY; sending_channel = 0xFF;
-                VND_LOG("B_TXCPLT_WD (>150ms) -> retry B seq=%lu", (unsigned long)g_frames[pair_send_idx][1].seq);
-                /* Попробуем сразу переотправить */
-                ChanFrame *fB2 = &g_frames[pair_send_idx][1];
-                if(!vnd_ep_busy && fB2->st == FB_READY){
-                    if(vnd_transmit_frame(fB2->buf, fB2->frame_size, 0, 0, "ADC1-RETRY") == USBD_OK){ fB2->st = FB_SENDING; sending_channel = 1; return; }
-                }
-            }
-            /* Не синтезируем B: ждём реальные данные, пока EP свободен */
-        }
-        /* Дополнительный watchdog зависшего pending_B, даже если fB->st перешёл из READY в FILL из-за сброса */
-        do {
-            uint32_t now_ms2 = HAL_GetTick();
-            if(!vnd_ep_busy && sending_channel == 0xFF && (now_ms2 - vnd_last_txcplt_ms) > 40){
-                ChanFrame *fBchk = &g_frames[pair_send_idx][1];
-                ChanFrame *fAchk = &g_frames[pair_send_idx][0];
-                if(fAchk->st != FB_SENDING && fBchk->st != FB_SENDING){
-                    if(fBchk->st == FB_READY){
-                        /* Перед отправкой по вотчдогу также поправим seq при необходимости */
-                        if(fBchk->frame_size >= VND_FRAME_HDR_SIZE){
-                            vnd_frame_hdr_t *hb2 = (vnd_frame_hdr_t*)fBchk->buf;
-                            if(hb2->magic == 0xA55A && hb2->seq != stream_seq){ hb2->seq = stream_seq; fBchk->seq = stream_seq; VND_LOG("PATCH_B_SEQ_WDG->%lu", (unsigned long)stream_seq); }
-                        }
-                        if (vnd_transmit_frame(fBchk->buf, fBchk->frame_size, 0, 0, "ADC1-WDG") == USBD_OK){
-                            fBchk->st = FB_SENDING; sending_channel = 1; VND_LOG("PEND_B_WDG_RETRY len=%u", (unsigned)fBchk->frame_size); return; }
-                    }
-                    /* Строгий порядок A→B: НЕ сбрасываем pending_B.
-                       Ждём или синтезируем B выше (см. B_SYNTH_READY), чтобы закрыть пару. */
-                    if(fBchk->st != FB_READY){
-                        VND_LOG("PEND_B_WDG_WAIT (a_st=%u b_st=%u seq=%lu)", (unsigned)fAchk->st, (unsigned)fBchk->st, (unsigned long)stream_seq);
-                    }
-                }
-            }
-        } while(0);
-    } else {
-    ChanFrame *fA = &g_frames[pair_send_idx][0];
-        /* Watchdog: если A завис в SENDING и долго нет TxCplt — считаем A завершённым и переходим к B */
-        do {
-            uint32_t now_ms = HAL_GetTick();
-            if (fA->st == FB_SENDING && (now_ms - vnd_last_tx_start_ms) > 120) {
-                /* Не считаем A завершённым — лишь снимаем busy, нейтрализуем старую мета и открываем ожидание B */
-                VND_LOG("A_TXCPLT_WD (>120ms) -> open pending_B, neutralize A meta, continue");
-                extern void USBD_VND_ForceTxIdle(void); USBD_VND_ForceTxIdle();
-                vnd_ep_busy = 0; vnd_tx_ready = 1; vnd_inflight = 0; sending_channel = 0xFF;
-                vnd_meta_neutralize(0x01, g_frames[pair_send_idx][0].seq);
-                pending_B = 1; pending_B_since_ms = now_ms;
-            }
-        } while(0);
-        if(fA->st != FB_READY){ vnd_prepare_pair(); fA = &g_frames[pair_send_idx][0]; }
-    if(fA->st == FB_READY){
-            /* Искусственных задержек между кадрами нет: отправляем A сразу при готовности EP и данных */
-            /* Отправляем A: в режиме без TEST не проверяем test_in_flight вовсе */
-#if VND_DISABLE_TEST
-            VND_LOG("TRY_A len=%u hdr_seq=%lu", (unsigned)fA->frame_size, (unsigned long)((vnd_frame_hdr_t*)fA->buf)->seq);
-            if (vnd_transmit_frame(fA->buf, fA->frame_size, 0, 0, "ADC0") == USBD_OK) {
-                static uint8_t first_a_logged = 0;
-                if(!first_a_logged){ first_a_logged = 1; VND_LOG("FIRST_A queued size=%u", (unsigned)fA->frame_size); }
-                fA->st = FB_SENDING; sending_channel = 0;
-                /* Ранний запрет STAT между A и B: сразу помечаем ожидание B */
-                pending_B = 1; pending_B_since_ms = HAL_GetTick();
-                return;
-            }
-#else
-            /* Отправляем A только если нет теста в полёте и нет необработанного TEST в FIFO */
-            if(!test_in_flight){
-                if (vnd_transmit_frame(fA->buf, fA->frame_size, 0, 0, "ADC0") == USBD_OK) {
-                    static uint8_t first_a_logged = 0;
-                    if(!first_a_logged){ first_a_logged = 1; VND_LOG("FIRST_A queued size=%u", (unsigned)fA->frame_size); }
-                    fA->st = FB_SENDING; sending_channel = 0;
-                    /* Ранний запрет STAT между A и B: сразу помечаем ожидание B */
-                    pending_B = 1; pending_B_since_ms = HAL_GetTick();
-                    return;
-                }
-            }
-#endif
-        }
-    }
-    if(vnd_tick_flag) vnd_tick_flag = 0;
-    if(cur_samples_per_frame == 0 && start_cmd_ms && (now - start_cmd_ms) > VND_DMA_TIMEOUT_MS && !no_dma_status_sent){
-        adc_stream_debug_t dbg; adc_stream_get_debug(&dbg);
-        if(dbg.dma_full0 == dma_snapshot_full0 && dbg.dma_full1 == dma_snapshot_full1){ no_dma_status_sent = 1; if(vnd_last_error == 0) vnd_last_error = 1; VND_LOG("ERR DMA_TIMEOUT"); }
-    }
-    /* Периодическая CDC-статистика по байтам/скорости */
-    vnd_cdc_periodic_stats(now);
-    /* Периодическое обновление дисплея LCD с информацией о потоке */
-    stream_display_periodic_update();
-    /* Небольшой NAK-watchdog: если давно не было завершений — попросим мягкий ресет класса.
-       Он выполнится асинхронно и не блокирует EP0. */
-    if((now - vnd_last_txcplt_ms) > 1500){
-        extern void USBD_VND_RequestSoftReset(void);
-        USBD_VND_RequestSoftReset();
-        vnd_last_txcplt_ms = now; /* предотвратить лавину запросов */
-        VND_LOG("WDG_SOFT_RESET_REQ");
-    }
-    /* Аварийный keepalive тестом — только в диагностике; в полном режиме не посылаем TEST повторно */
-    if(!full_mode){
-        /* В DIAG режиме можно слать keepalive TEST — оставляем как было. */
-    if(dbg_tx_cplt == 0 && (now - start_cmd_ms) > 150 && !vnd_ep_busy){
-#if !VND_DISABLE_TEST
-        vnd_emergency_keepalive(now);
-#endif
-    }
-    }
-    /* Периодический диагностический лог ранней стадии: пока нет ни одного TXCPLT или отсутствует прогресс */
-    do {
-        static uint32_t last_diag_ms = 0;
-        static uint32_t last_diag_txcplt = 0;
-        if(now - last_diag_ms > 200){
-            if(dbg_tx_cplt == 0 || dbg_tx_cplt != last_diag_txcplt){
-                /* Получим отладочные счётчики DMA, если доступны */
-                VND_LOG("DIAG txcplt=%lu test_sent=%u test_in_flight=%u pendB=%u ep_busy=%u inflight=%u ch=%u ackPend=%u seq=%lu prod=%lu sent0=%lu sent1=%lu wr=%lu rd=%lu metaDepth=%u", (unsigned long)dbg_tx_cplt, (unsigned)test_sent, (unsigned)test_in_flight, (unsigned)pending_B, (unsigned)vnd_ep_busy, (unsigned)vnd_inflight, (unsigned)sending_channel, (unsigned)status_ack_pending, (unsigned long)stream_seq, (unsigned long)dbg_produced_seq, (unsigned long)dbg_sent_ch0_total, (unsigned long)dbg_sent_ch1_total, (unsigned long)frame_wr_seq, (unsigned long)frame_rd_seq, (unsigned)vnd_tx_meta_depth());
-                last_diag_txcplt = dbg_tx_cplt;
-            }
-            last_diag_ms = now;
+    /* EP простаивал (очередь была пуста или STAT/TEST занимал канал) — запускаем head сами */
+    {
+        int started;
+        __disable_irq();
+        started = vnd_txq_kick();
+        __enable_irq();
+        if(started){
+            static uint8_t first_a_logged = 0;
+            if(!first_a_logged){ first_a_logged = 1; VND_LOG("FIRST_A queued depth=%u", (unsigned)vnd_txq_depth()); }
+            if(vnd_tick_flag) vnd_tick_flag = 0;
+            return;
         }
-    } while(0);
-
-    /* Ускоренный watchdog: 600мс без завершений передачи считаем зависанием */
-    if(streaming && (now - vnd_last_txcplt_ms) > 600){
-        VND_LOG("WDG_RESTART (no TXCPLT >600ms) reset test/pendingB");
-        /* Полный мягкий сброс внутренней машины, без остановки DMA */
-        stream_seq = 0; dbg_produced_seq = 0; cur_samples_per_frame = 0; cur_expected_frame_size = 0;
-        vnd_ep_busy = 0; vnd_tx_ready = 1; vnd_inflight = 0; sending_channel = 0xFF; pending_B = 0; pending_B_since_ms = 0;
-        test_sent = 0; test_in_flight = 0;
-        start_ack_done = 1; status_ack_pending = 0;
-        vnd_last_txcplt_ms = now;
-        vnd_tx_meta_head = vnd_tx_meta_tail = 0; meta_push_total = meta_pop_total = meta_empty_events = meta_overflow_events = 0; /* clear FIFO */
-        /* Разрешаем немедленный запуск следующей пары и готовим её прямо сейчас */
-        next_seq_to_assign = stream_seq; /* критично: выровнять назначение seq к текущему */
-        vnd_next_pair_ms = now; /* не ждать периода */
-        vnd_prepare_pair();
-        vnd_tx_kick = 1;
     }
-
-    /* Если нет прогресса — не синтезируем кадры; ждём реальные данные от АЦП */
+    vnd_stream_task_tail(now);
 }
 
 /* Обработчик завершения передачи */
-void USBD_VND_TxCplt(void)
+ITCM_FUNC void USBD_VND_TxCplt(void)
 {
-    uint8_t prev_sending = sending_channel;
     dbg_tx_cplt++;
     vnd_tx_ready = 1;
     vnd_ep_busy = 0;
     vnd_inflight = 0;
     vnd_last_txcplt_ms = HAL_GetTick();
+    vnd_total_tx_bytes += vnd_last_tx_len; /* учитывать и тестовые, и статусные, и рабочие */
+    /* Рабочие кадры полного режима ведут свой учёт (очередь, пачки): мета FIFO, классификация
+       и логи ниже — только для DIAG, STAT и TEST */
+    if(burst_inflight){ PIPE_EVT(PT_EV_TXCPLT, PT_SEQ_NONE, vnd_last_tx_len); vnd_burst_on_txcplt(); return; }
+    if(vnd_txq_active){ vnd_txq_on_txcplt(); return; }
     VND_LOG("TXCPLT len=%u dt=%lums depth=%u push=%lu pop=%lu empty=%lu ovf=%lu", (unsigned)vnd_last_tx_len,
         (unsigned long)(HAL_GetTick() - vnd_last_tx_start_ms), (unsigned)vnd_tx_meta_depth(),
         (unsigned long)meta_push_total, (unsigned long)meta_pop_total, (unsigned long)meta_empty_events, (unsigned long)meta_overflow_events);
-    vnd_total_tx_bytes += vnd_last_tx_len; /* учитывать и тестовые, и статусные, и рабочие */
     /* Зафиксировать завершение стартового ACK (если был) */
     if(start_stat_inflight){ start_stat_inflight = 0; start_ack_done = 1; }
 
@@ -1455,6 +2518,7 @@ void USBD_VND_TxCplt(void)
     else { eff_is_frame = last_tx_is_frame; eff_flags = last_tx_flags; eff_seq = last_tx_seq; }
     inflight_is_frame = 0; inflight_flags = 0; inflight_seq = 0;
     VND_LOG("TXCPLT_CLASS is_frame=%u fl=0x%02X seq=%lu depth_now=%u (meta_have=%d)", (unsigned)eff_is_frame, (unsigned)eff_flags, (unsigned long)eff_seq, (unsigned)vnd_tx_meta_depth(), have_meta);
+    PIPE_EVT(PT_EV_TXCPLT, eff_is_frame ? eff_seq : PT_SEQ_NONE, vnd_last_tx_len);
 
     /* Если это был ACK на STOP — после него переводим систему в остановленное состояние */
     if(stop_stat_inflight){
@@ -1514,7 +2578,7 @@ void USBD_VND_TxCplt(void)
             stream_seq++; dbg_produced_seq++;
             pending_B = 0; pending_B_since_ms = 0; sending_channel = 0xFF;
             diag_prepared_seq = 0xFFFFFFFFu; /* заставим подготовить новую пару */
-            if(!first_pair_done){ first_pair_done = 1; }
+            if(!first_pair_done){ first_pair_done = 1; boot_mark(BOOT_MARK_TX_FRAME); }
             /* Сразу пытаемся отправить следующий A новой пары */
             if(!vnd_try_send_A_nextpair_immediate()){
                 /* печать в CDC отключена для максимальной скорости */
@@ -1532,96 +2596,39 @@ void USBD_VND_TxCplt(void)
         }
     }
 
-    /* Ниже — обычная ветка для полнофункционального режима */
-    if(!eff_is_frame){
-        /* STAT или иной служебный пакет — используем предыдущее состояние канала как подсказку */
-        if(prev_sending == 0){
-            if(!pending_B){ pending_B = 1; pending_B_since_ms = HAL_GetTick(); VND_LOG("GUARD(NON-FRAME): pending_B"); }
-            sending_channel = 0xFF; vnd_tx_kick = 1; return;
-        } else if(prev_sending == 1){
-            /* Считаем, что завершился B: закрываем пару безопасно */
-        ChanFrame *f0 = &g_frames[pair_send_idx][0];
-        ChanFrame *f1 = &g_frames[pair_send_idx][1];
-        f0->st = f1->st = FB_FILL;
-        pair_send_idx = (pair_send_idx + 1u) % VND_PAIR_BUFFERS;
-        stream_seq++; dbg_produced_seq++;
-        pending_B = 0; pending_B_since_ms = 0; sending_channel = 0xFF;
-    /* Не планируем задержку следующей пары: передавать сразу при готовности */
-            if(!first_pair_done){ first_pair_done = 1; }
-            VND_LOG("GUARD(NON-FRAME): assume B done -> advance seq=%lu", (unsigned long)stream_seq);
-            vnd_tx_kick = 1; return;
-        } else {
-            sending_channel = 0xFF; vnd_tx_kick = 1; return;
-        }
+    /* Полный режим: кадры учитывает vnd_txq_on_txcplt. Сюда приходят STAT/TEST и запоздавшие
+       завершения после вотчдога — после них продолжаем очередь, если она не пуста. */
+    if(eff_is_frame && eff_flags != 0x80){
+        VND_LOG("WARN TXCPLT_OUTSIDE_TXQ fl=0x%02X seq=%lu", (unsigned)eff_flags, (unsigned long)eff_seq);
     }
-    uint8_t fl = eff_flags;
-    if(fl == 0x80){
-        /* TEST */
-        sending_channel = 0xFF; /* тест одиночный */
-        vnd_tx_kick = 1; return;
-    }
-    if(fl == 0x01){
-        /* Это канал A */
-        if(pending_B){ VND_LOG("WARN A_WHILE_PENDING_B seq=%lu hdr.seq=%lu", (unsigned long)stream_seq, (unsigned long)eff_seq); }
-        if(eff_seq != stream_seq){
-            VND_LOG("WARN A_SEQ_MISMATCH hdr=%lu stream_seq=%lu", (unsigned long)eff_seq, (unsigned long)stream_seq);
-        }
-        static uint8_t first_a_txcplt_logged = 0; if(!first_a_txcplt_logged){ first_a_txcplt_logged = 1; VND_LOG("FIRST_A txcplt seq=%lu", (unsigned long)eff_seq); }
-        dbg_tx_sent++; dbg_sent_ch0_total++; dbg_sent_seq_adc0++;
-        /* пометим A как завершённый для наглядности статуса */
-        g_frames[pair_send_idx][0].st = FB_FILL;
-        sending_channel = 0xFF;
-        /* Запускаем ожидание B ровно здесь */
-        pending_B = 1; pending_B_since_ms = HAL_GetTick();
-        /* Попытаемся немедленно отправить B, чтобы не ждать захода таска */
-        if(!vnd_try_send_B_immediate()){
-            vnd_tx_kick = 1; return;
-        } else { return; }
-    } else if(fl == 0x02){
-    /* Канал B завершён — закрываем пару */
-        if(!pending_B){ VND_LOG("WARN B_WITHOUT_PENDING seq=%lu hdr.seq=%lu", (unsigned long)stream_seq, (unsigned long)eff_seq); }
-        if(eff_seq != stream_seq){
-            VND_LOG("WARN B_SEQ_MISMATCH hdr=%lu stream_seq=%lu", (unsigned long)eff_seq, (unsigned long)stream_seq);
-        }
-        static uint8_t first_b_logged = 0; if(!first_b_logged){ first_b_logged = 1; VND_LOG("FIRST_B txcplt seq=%lu", (unsigned long)eff_seq); }
-        dbg_tx_sent++; dbg_sent_ch1_total++; dbg_sent_seq_adc1++;
-        ChanFrame *f0 = &g_frames[pair_send_idx][0];
-        ChanFrame *f1 = &g_frames[pair_send_idx][1];
-        f0->st = f1->st = FB_FILL;
-        pair_send_idx = (pair_send_idx + 1u) % VND_PAIR_BUFFERS;
-        stream_seq++; dbg_produced_seq++;
-        pending_B = 0; pending_B_since_ms = 0; sending_channel = 0xFF;
-        if(!first_pair_done){ first_pair_done = 1; }
-        /* Сразу пытаемся отправить следующий A новой пары (если готов) */
-        if(!vnd_try_send_A_nextpair_immediate()){
-            /* Без планирования задержек: следующая пара начнётся как только готова */
-            vnd_tx_kick = 1; return;
-        } else { return; }
-    } else {
-        VND_LOG("WARN UNKNOWN FLAGS 0x%02X in TxCplt", (unsigned)fl);
-        sending_channel = 0xFF;
-        /* РЕЗЕРВ: если классификация не распознала, но прямо перед этим слали B — закроем пару */
-        if(pending_B && (prev_sending == 1 || last_tx_flags == 0x02)){
-            ChanFrame *f0 = &g_frames[pair_send_idx][0];
-            ChanFrame *f1 = &g_frames[pair_send_idx][1];
-            f0->st = f1->st = FB_FILL;
-            pair_send_idx = (pair_send_idx + 1u) % VND_PAIR_BUFFERS;
-            stream_seq++; dbg_produced_seq++;
-            pending_B = 0; pending_B_since_ms = 0; sending_channel = 0xFF;
-            /* Без планирования задержек */
-            VND_LOG("FALLBACK_CLOSE_PAIR after UNKNOWN meta (assume B)");
-            vnd_tx_kick = 1; return;
+    if(stop_request || !full_mode || vnd_burst_enabled() || !vnd_txq_kick()){ vnd_tx_kick = 1; }
+}
+
+/* Приём команд */
+/* Запомнить зоны ROI (SET_WINDOWS / SET_ROI_US): по возрастанию и без перекрытий, иначе отказ.
+   k = 0 — зон нет, при SET_ROI 1 кадры идут целиком. */
+static void vnd_zone_set(const frame_zone_cfg_t *z, uint8_t k, uint8_t us, const char *tag)
+{
+    for(uint8_t i = 1; i < k; i++){
+        if(z[i].start < z[i - 1u].start + z[i - 1u].len){
+            VND_LOG("%s rejected: zone %u overlaps or not ascending", tag, (unsigned)i);
+            cdc_logf("EVT %s rejected: zones must ascend without overlap", tag);
+            return;
         }
-        vnd_tx_kick = 1; return;
     }
+    memcpy(vnd_zone_cfg, z, (uint32_t)k * sizeof(frame_zone_cfg_t));
+    vnd_zone_cfg_cnt = k; vnd_zone_us = us;
+    vnd_zr.n = 0; /* таблица пересчитается при сборке кадра */
+    VND_LOG("%s zones=%u first=%lu+%lu", tag, (unsigned)k, (unsigned long)(k ? z[0].start : 0u), (unsigned long)(k ? z[0].len : 0u));
+    cdc_logf("EVT %s zones=%u%s", tag, (unsigned)k, us ? " us" : "");
 }
 
-/* Приём команд */
 void USBD_VND_DataReceived(const uint8_t *data, uint32_t len)
 {
     if(!len) return;
     uint8_t cmd = data[0];
     VND_LOG("CMD 0x%02X len=%lu", cmd, (unsigned long)len);
+    PIPE_EVT(PT_EV_CMD, PT_SEQ_NONE, cmd | (len << 8));
     switch(cmd)
     {
         case VND_CMD_START_STREAM:
@@ -1647,6 +2654,22 @@ void USBD_VND_DataReceived(const uint8_t *data, uint32_t len)
                 stream_seq = 0; next_seq_to_assign = 0; dbg_produced_seq = 0;
                 first_pair_done = 0;
                 dbg_sent_ch0_total = 0; dbg_sent_ch1_total = 0;
+                USBD_VND_ResetTxPrepStats(); /* PERF считаем с начала сессии */
+                vnd_perf_reset_irq_stats();
+                boot_mark(BOOT_MARK_START);
+                vnd_prep_count = 0; vnd_prep_cyc_sum = 0; vnd_prep_cyc_max = 0;
+                frame_crc_reset_stats();
+                frame_rice_reset_stats();
+                {
+                    /* Lock-in: геометрия опоры по текущим TIM2/TIM15, суммы с нуля */
+                    adc_phase_info_t ph; adc_stream_get_phase(&ph);
+                    lockin_reset(ph.period, ph.high, vnd_lockin_periods, adc_stream_get_sample_rate());
+                    vnd_lockin_frames = 0;
+                    if(vnd_frame_fmt == VND_FMT_LOCKIN && !ph.period) cdc_logf("EVT LOCKIN no phase: TIM2/TIM15 clocks differ or no edge capture (see PHAS)");
+                }
+                /* ROI: таблица зон заново под формат и N этого стрима, счётчики ZONE с нуля */
+                vnd_zr.n = 0; vnd_zone_frames = 0; vnd_zone_whole = 0; vnd_zone_saved = 0;
+                if(vnd_roi_enabled && !vnd_zone_cfg_cnt) cdc_logf("EVT ROI on but no zones: frames stay whole");
                 start_cmd_ms = HAL_GetTick();
                 /* Снимем DMA снапшот для контроля таймаута */
                 adc_stream_debug_t dbg; adc_stream_get_debug(&dbg);
@@ -1726,6 +2749,86 @@ void USBD_VND_DataReceived(const uint8_t *data, uint32_t len)
                 cdc_logf("EVT SET_FRAME_SAMPLES %u", (unsigned)vnd_frame_samples_req);
             }
             break;
+        case VND_CMD_SET_BURST:
+            if(len >= 2){
+                uint8_t k = data[1];
+                if(k > VND_BURST_MAX_PAIRS) k = VND_BURST_MAX_PAIRS;
+                /* Переключение только вне стрима: пачки и пары A/B делят один FIFO АЦП и seq */
+                if(streaming){ VND_LOG("SET_BURST ignored while streaming"); break; }
+                burst_pairs_req = (k > 1u) ? k : 0u;
+                vnd_burst_reset();
+                VND_LOG("SET_BURST %u", (unsigned)burst_pairs_req);
+                cdc_logf("EVT SET_BURST %u", (unsigned)burst_pairs_req);
+            }
+            break;
+        case VND_CMD_SET_CRC:
+            if(len >= 2){
+                /* Вкл./выкл. только между стримами: кадры одного стрима либо все с crc16, либо все без */
+                if(streaming){ VND_LOG("SET_CRC ignored while streaming"); break; }
+                vnd_crc_enabled = data[1] ? 1u : 0u;
+                VND_LOG("SET_CRC %u", (unsigned)vnd_crc_enabled);
+                cdc_logf("EVT SET_CRC %u", (unsigned)vnd_crc_enabled);
+            }
+            break;
+        case VND_CMD_SET_COMPRESS:
+            if(len >= 2){
+                /* Как и CRC — только между стримами; DIAG всегда шлёт несжатые кадры */
+                if(streaming){ VND_LOG("SET_COMPRESS ignored while streaming"); break; }
+                vnd_compress = data[1] ? 1u : 0u;
+                VND_LOG("SET_COMPRESS %u", (unsigned)vnd_compress);
+                cdc_logf("EVT SET_COMPRESS %u", (unsigned)vnd_compress);
+            }
+            break;
+        case VND_CMD_SET_ACQ:
+            if(len >= 5){
+                uint32_t fs = (uint32_t)(data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t)data[4] << 24));
+                uint16_t ns = (len >= 7) ? (uint16_t)(data[5] | (data[6] << 8)) : 0u;
+                uint16_t ovs = (len >= 9) ? (uint16_t)(data[7] | (data[8] << 8)) : 0u;
+                uint8_t ovs_shift = (len >= 10) ? data[9] : 0u;
+                if(ns == 0) ns = adc_stream_get_active_samples();
+                /* Перезапуск DMA АЦП с новым N и триггером — только вне стрима */
+                if(streaming){ VND_LOG("SET_ACQ ignored while streaming"); break; }
+                adc_acq_t a;
+                int rc = adc_stream_set_acq(fs, ns, ovs, ovs_shift, &a);
+                vnd_acq_last_rc = (int8_t)rc;
+                if(rc == 0){
+                    vnd_recompute_pair_timing(vnd_frame_samples_req ? vnd_frame_samples_req : ns);
+                    VND_LOG("SET_ACQ fs=%lu N=%u -> %lu.%03lu Hz psc=%u arr=%u smp=%u ovs=%u>>%u bits=%u", (unsigned long)fs, (unsigned)ns,
+                            (unsigned long)(a.fs_millihz / 1000u), (unsigned long)(a.fs_millihz % 1000u),
+                            (unsigned)a.tim_psc, (unsigned)a.tim_arr, (unsigned)a.smp_code,
+                            (unsigned)a.ovs_ratio, (unsigned)a.ovs_shift, (unsigned)a.bits);
+                    cdc_logf("EVT SET_ACQ fs=%lu N=%u got=%lu mHz ovs=%u bits=%u", (unsigned long)fs, (unsigned)ns,
+                             (unsigned long)a.fs_millihz, (unsigned)a.ovs_ratio, (unsigned)a.bits);
+                } else {
+                    VND_LOG("SET_ACQ fs=%lu N=%u rejected rc=%d", (unsigned long)fs, (unsigned)ns, rc);
+                }
+            }
+            break;
+        case VND_CMD_SET_FRAME_FMT:
+            if(len >= 2){
+                uint8_t fmt = data[1];
+                if(fmt > VND_FMT_LOCKIN){ VND_LOG("SET_FRAME_FMT bad %u", (unsigned)fmt); break; }
+                /* Формат кадра меняет размер и число трансферов на пару — только вне стрима */
+                if(streaming){ VND_LOG("SET_FRAME_FMT ignored while streaming"); break; }
+                vnd_frame_fmt = fmt;
+                VND_LOG("SET_FRAME_FMT %u", (unsigned)vnd_frame_fmt);
+                cdc_logf("EVT SET_FRAME_FMT %u", (unsigned)vnd_frame_fmt);
+            }
+            break;
+        case VND_CMD_SET_LOCKIN:
+            if(len >= 3){
+                uint16_t m = (uint16_t)(data[1] | (data[2] << 8));
+                uint8_t k = (len >= 4) ? data[3] : 0u;
+                /* Длина записи и кадра v3 постоянны в пределах стрима */
+                if(streaming){ VND_LOG("SET_LOCKIN ignored while streaming"); break; }
+                if(k == 0u) k = VND_LOCKIN_RECS_DEF;
+                if(k > VND_LOCKIN_RECS_MAX) k = VND_LOCKIN_RECS_MAX;
+                vnd_lockin_periods = m ? m : 1u;
+                vnd_lockin_recs = k;
+                VND_LOG("SET_LOCKIN periods=%u recs=%u", (unsigned)vnd_lockin_periods, (unsigned)vnd_lockin_recs);
+                cdc_logf("EVT SET_LOCKIN periods=%u recs=%u", (unsigned)vnd_lockin_periods, (unsigned)vnd_lockin_recs);
+            }
+            break;
         case VND_CMD_STOP_STREAM:
         {
             /* В полном режиме: STOP с ACK-STAT между парами; в DIAG — немедленная остановка без STAT по bulk */
@@ -1790,14 +2893,17 @@ void USBD_VND_DataReceived(const uint8_t *data, uint32_t len)
         }
         break;
         case VND_CMD_SET_WINDOWS:
-            if(len >= 9)
+            if(len >= 5)
             {
-                /* 1 + 8 байт */
-                win_start0 = (uint16_t)(data[1] | (data[2] << 8));
-                win_len0   = (uint16_t)(data[3] | (data[4] << 8));
-                win_start1 = (uint16_t)(data[5] | (data[6] << 8));
-                win_len1   = (uint16_t)(data[7] | (data[8] << 8));
-                VND_LOG("SET_WINDOWS s0=%u l0=%u s1=%u l1=%u", win_start0, win_len0, win_start1, win_len1);
+                /* 1 + 4 байта на зону (u16 start, u16 len); окна нулевой длины пропускаются.
+                   Размер кадра постоянен в пределах стрима — зоны меняются только между стримами. */
+                if(streaming){ VND_LOG("SET_WINDOWS ignored while streaming"); break; }
+                frame_zone_cfg_t z[VND_ZONES_MAX]; uint8_t k = 0;
+                for(uint32_t o = 1; o + 4u <= len && k < VND_ZONES_MAX; o += 4u){
+                    z[k].start = rd_le16(data + o); z[k].len = rd_le16(data + o + 2u);
+                    if(z[k].len) k++;
+                }
+                vnd_zone_set(z, k, 0u, "SET_WINDOWS");
             }
             break;
         case VND_CMD_SET_BLOCK_HZ:
@@ -1870,9 +2976,29 @@ void USBD_VND_DataReceived(const uint8_t *data, uint32_t len)
         case VND_CMD_SET_ROI_US:
             if(len >= 5)
             {
-                uint32_t us = (uint32_t)(data[1] | (data[2] << 8) | (data[3] << 16) | (data[4] << 24));
-                /* TODO: применить ROI к цепочке выборки */
-                VND_LOG("SET_ROI_US %lu", (unsigned long)us);
+                /* u32 — одна зона от начала кадра; иначе пары u32 start_us, u32 len_us.
+                   Отсчёты считаются по Fs при сборке кадров (и заново после смены профиля). */
+                if(streaming){ VND_LOG("SET_ROI_US ignored while streaming"); break; }
+                frame_zone_cfg_t z[VND_ZONES_MAX]; uint8_t k = 0;
+                if(len < 9u){
+                    z[0].start = 0; z[0].len = rd_le32(data + 1);
+                    if(z[0].len) k = 1;
+                } else {
+                    for(uint32_t o = 1; o + 8u <= len && k < VND_ZONES_MAX; o += 8u){
+                        z[k].start = rd_le32(data + o); z[k].len = rd_le32(data + o + 4u);
+                        if(z[k].len) k++;
+                    }
+                }
+                vnd_zone_set(z, k, 1u, "SET_ROI_US");
+            }
+            break;
+        case VND_CMD_SET_ROI:
+            if(len >= 2){
+                if(streaming){ VND_LOG("SET_ROI ignored while streaming"); break; }
+                vnd_roi_enabled = data[1] ? 1u : 0u;
+                vnd_zr.n = 0;
+                VND_LOG("SET_ROI %u zones=%u", (unsigned)vnd_roi_enabled, (unsigned)vnd_zone_cfg_cnt);
+                cdc_logf("EVT SET_ROI %u zones=%u", (unsigned)vnd_roi_enabled, (unsigned)vnd_zone_cfg_cnt);
             }
             break;
         default:
@@ -1895,4 +3021,15 @@ void adc_stream_on_new_frames(uint32_t frames_added)
     if(streaming){ vnd_tx_kick = 1; }
 }
 
+/* Хук frame_crc (IRQ MDMA, приоритет как у OTG_HS — с TxCplt не вытесняют друг друга): crc16
+   записан, а голова очереди или готовая пачка ждали только его. Ставим в EP сразу; если канал
+   занят или ждёт STAT — взводим kick, чтобы основной цикл не уснул в WFI с готовым кадром. */
+void frame_crc_on_done(void)
+{
+    if(!streaming) return;
+    if(stop_request || !full_mode || pending_status){ vnd_tx_kick = 1; return; }
+    int started = vnd_burst_enabled() ? vnd_burst_try_send() : vnd_txq_kick();
+    if(!started) vnd_tx_kick = 1;
+}
+
 /* EOF (clean version) */
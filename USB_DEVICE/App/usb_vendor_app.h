@@ -1,6 +1,8 @@
 #pragma once
 #include <stdint.h>
 #include "main.h" /* для MAX_FRAME_SAMPLES */
+#include "cyc_prof.h" /* CYC_PROF_BINS для vnd_prof_rec_t */
+#include "frame_zone.h" /* FRAME_ZONES_MAX, FRAME_ZONE_TAB_BYTES */
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -8,16 +10,26 @@ extern "C" {
 #define VND_CMD_START_STREAM    0x20u
 #define VND_CMD_STOP_STREAM     0x21u
 #define VND_CMD_GET_STATUS      0x30u
+#define VND_CMD_GET_TRACE       0x31u /* EP0 IN: забрать записи токенизированного трейса (trace_tok.h) */
+#define VND_CMD_GET_EVENTS      0x33u /* EP0 IN: страница журнала событий тракта (pipe_trace.h), wValue = с какой записи */
+#define VND_CMD_GET_PROF        0x34u /* EP0 IN: профиль участков горячего пути (cyc_prof.h), wValue bit0 = сбросить после чтения */
+#define VND_CMD_PROF_RESET      0x35u /* EP0 OUT без данных: сбросить профиль */
 /* Дополнение из спецификации */
 #define VND_CMD_SET_FULL_MODE   0x13u /* 1 байт: 0=ROI, 1=FULL */
 #define VND_CMD_SET_PROFILE     0x14u /* 1 байт profile */
-#define VND_CMD_SET_ROI_US      0x15u /* 4 байта u32 (микросекунды) */
+#define VND_CMD_SET_ROI_US      0x15u /* u32 мкс от начала кадра или до VND_ZONES_MAX пар u32 start_us, u32 len_us */
 /* Новая команда: установить явный размер кадра (samples_per_frame) для ~20 FPS режимов */
 #define VND_CMD_SET_FRAME_SAMPLES 0x17u /* 2 байта u16 */
 
 /* Флаги статуса времени выполнения */
 #define VND_STFLAG_STREAMING    0x0001u
 #define VND_STFLAG_DIAG_ACTIVE  0x0002u
+#define VND_STFLAG_STEREO       0x0004u /* рабочие кадры идут стерео v2 */
+#define VND_STFLAG_CRC          0x0008u /* рабочие кадры несут crc16 (SET_CRC) */
+#define VND_STFLAG_RICE         0x0010u /* рабочие кадры сжимаются (SET_COMPRESS) */
+#define VND_STFLAG_ADC_DUAL     0x0020u /* ADC1+ADC2 в dual regular simultaneous (ADC_STREAM_DUAL_MODE) */
+#define VND_STFLAG_LOCKIN       0x0040u /* рабочие кадры — записи lock-in v3 (SET_FRAME_FMT 3) */
+#define VND_STFLAG_ROI          0x0080u /* в payload только зоны ROI (SET_ROI 1) */
 
 /* Общие константы формата кадров/параметров (централизовано) */
 #ifndef VND_MAX_SAMPLES
@@ -35,6 +47,28 @@ extern "C" {
 #ifndef VND_FLAGS_ADC1
 #define VND_FLAGS_ADC1      0x02u
 #endif
+/* Стерео-кадр v2 (ver=2, flags=ADC0|ADC1): оба канала в одном payload, total_samples — на канал.
+   Без VND_FLAGS_PLANAR отсчёты чередуются L0,R0,L1,R1…; с ним — блок L, затем блок R. */
+#define VND_FRAME_VER_PAIR   0x01u
+#define VND_FRAME_VER_STEREO 0x02u
+/* Кадр lock-in v3 (ver=3, flags=ADC0|ADC1): payload — total_samples записей lockin_rec_t по 64 байта */
+#define VND_FRAME_VER_LOCKIN 0x03u
+#define VND_FLAGS_PLANAR     0x08u
+/* crc16 заголовка валиден: CRC16-CCITT-FALSE по байтам 0..29 и payload (аппаратный блок CRC) */
+#define VND_FLAGS_CRC        0x04u
+/* payload сжат без потерь (разности + код Райса, frame_rice.h); длина payload — поле comp_len заголовка */
+#define VND_FLAGS_RICE       0x10u
+/* первый кадр после смены профиля (N и/или Fs): хост перефиксирует размер кадра и период меток */
+#define VND_FLAGS_RESYNC     0x20u
+/* фаза меандра известна: поля 16..23 — первые фронт/спад TIM2_CH2 в отсчётах кадра, P и H */
+#define VND_FLAGS_PHASE      0x40u
+/* Зоны ROI: zone_count > 0 — payload начинается с таблицы {u16 N, u16 0}, затем zone_count пар
+   {u16 start, u16 len} (отсчёты кадра АЦП); за ней отсчёты зон подряд, total_samples — их сумма */
+#define VND_ZONES_MAX        FRAME_ZONES_MAX
+#define VND_ZONE_TAB_BYTES(zc) FRAME_ZONE_TAB_BYTES(zc)
+#ifndef VND_STEREO_FRAME_MAX_SIZE
+#define VND_STEREO_FRAME_MAX_SIZE  (VND_FRAME_HDR_SIZE + 4u*VND_MAX_SAMPLES)
+#endif
 #ifndef VND_DMA_TIMEOUT_MS
 #define VND_DMA_TIMEOUT_MS  300u
 #endif
@@ -43,8 +77,8 @@ extern "C" {
 #pragma pack(push,1)
 typedef struct {
     char     sig[4];            /* 'STAT' */
-    uint8_t  version;           /* 1 */
-    uint8_t  reserved0;         /* 0 */
+    uint8_t  version;           /* 3: reserved0/reserved2 заменены загрузкой CPU (2: счётчики очереди передачи) */
+    uint8_t  cpu_load_pct;      /* занятость CPU за последнюю секунду, % (0xFF — не измеряется) */
     uint16_t cur_samples;       /* зафиксированный cur_samples_per_frame */
     uint16_t frame_bytes;       /* 32 + 2*cur_samples */
     uint16_t test_frames;       /* сколько тестовых кадров отправлено */
@@ -77,25 +111,359 @@ typedef struct {
          */
         uint16_t flags2;
     uint8_t  sending_ch;        /* 0=A,1=B,0xFF=нет */
-    uint8_t  reserved2;         /* выравнивание */
-    uint16_t pair_idx;          /* pair_fill_idx (hi8) <<8 | pair_send_idx (lo8) */
+    uint8_t  isr_pct;           /* доля ISR DMA АЦП/TIM6/OTG_HS в то же окно, % */
+    uint8_t  txq_depth;         /* кадров в очереди передачи (вкл. кадр в EP) */
+    uint8_t  txq_hwm;           /* максимум txq_depth с START */
     uint16_t last_tx_len;       /* длина последней передачи */
     uint32_t cur_stream_seq;    /* текущее значение stream_seq */
-    uint16_t reserved3;         /* паддинг до 64 байт */
+    uint16_t txq_underrun;      /* TxCplt застал очередь пустой (младшие 16 бит) */
 } vnd_status_v1_t; /* 64 байта */
 #pragma pack(pop)
 _Static_assert(sizeof(vnd_status_v1_t) == 64, "vnd_status_v1_t must be 64 bytes");
 
+/* Страницы GET_STATUS по EP0: wValue выбирает структуру (0 = STAT v1, 1 = PERF, 2 = COMP, 3 = ADCS, 4 = ACQS, 5 = LOCK, 6 = PHAS, 7 = ZONE, 8 = CACH, 9 = BOOT, 10 = ULOG) */
+#define VND_STATUS_PAGE_STAT    0u
+#define VND_STATUS_PAGE_PERF    1u
+#define VND_STATUS_PAGE_COMP    2u
+#define VND_STATUS_PAGE_ADC     3u
+#define VND_STATUS_PAGE_ACQ     4u
+#define VND_STATUS_PAGE_LOCKIN  5u
+#define VND_STATUS_PAGE_PHASE   6u
+#define VND_STATUS_PAGE_ZONE    7u
+#define VND_STATUS_PAGE_CACHE   8u
+#define VND_STATUS_PAGE_BOOT    9u
+#define VND_STATUS_PAGE_ULOG    10u
+
+/* PERF v1: счётчики стоимости тракта передачи (DWT циклы CPU), <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'PERF' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = кадры идут zero-copy (VND_TX_ZERO_COPY), bit1 = DMA ядра OTG (USBD_OTG_DMA_ENABLE), bit2 = CRC кадров, bit3 = сжатие */
+    uint8_t  burst_pairs;       /* пар A/B в одной пачке burst (0 — режим выключен) */
+    uint8_t  reserved0;
+    uint32_t tx_copy_count;     /* передач через копию в vnd_tx_buf */
+    uint32_t tx_copy_cyc_avg;   /* средние циклы memcpy + синхронизации с DMA на передачу */
+    uint32_t tx_copy_cyc_max;   /* максимум */
+    uint32_t tx_zc_count;       /* передач zero-copy из пула кадров */
+    uint32_t tx_zc_cyc_avg;     /* средние циклы подготовки zero-copy (только DSB) */
+    uint32_t tx_zc_cyc_max;     /* максимум */
+    uint32_t tx_chained;        /* передач длиннее одного LL-куска (2048 B), ушедших цепочкой */
+    uint32_t tx_chain_err;      /* отказы LL при постановке очередного куска цепочки */
+    uint32_t burst_sent;        /* завершённых пачек burst */
+    uint32_t burst_drop;        /* пачек, снятых вотчдогом без TxCplt */
+    uint32_t otg_irq_count;     /* входов в OTG_HS_IRQHandler с START */
+    uint32_t otg_irq_cyc_per_s; /* циклов CPU в OTG_HS_IRQHandler на секунду стрима */
+    uint16_t otg_irq_permille;  /* то же в промилле от SystemCoreClock */
+    uint32_t crc_frames;        /* кадров с crc16, посчитанных блоком CRC + MDMA */
+    uint16_t crc_skipped;       /* кадров без CRC: очередь движка была полна (насыщение) */
+} vnd_perf_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_perf_v1_t) == 64, "vnd_perf_v1_t must be 64 bytes");
+
+/* COMP v1: сжатие payload рабочих кадров (SET_COMPRESS) с START, <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'COMP' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = сжатие включено */
+    uint16_t reserved0;
+    uint32_t frames;            /* кадров ушло сжатыми */
+    uint32_t raw_frames;        /* кадров без выигрыша (ушли несжатыми) */
+    uint32_t blocks;            /* блоков разностей (по 32 отсчёта) */
+    uint32_t raw_blocks;        /* из них без сжатия (шум/скачки) */
+    uint64_t bytes_in;          /* payload до сжатия */
+    uint64_t bytes_out;         /* payload в эфире */
+    uint16_t ratio_permille;    /* bytes_out / bytes_in, ‰ */
+    uint16_t cyc_per_sample_x10;/* циклы CPU кодера на отсчёт, x10 */
+    uint32_t cyc_frame_avg;     /* циклы на кадр, среднее */
+    uint32_t cyc_frame_max;     /* максимум */
+    uint8_t  reserved[12];
+} vnd_comp_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_comp_v1_t) == 64, "vnd_comp_v1_t must be 64 bytes");
+
+/* ADCS v1: кольцо кадров АЦП (SPSC без блокировок, adc_stream), <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'ADCS' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = dual regular simultaneous (ADC_STREAM_DUAL_MODE), bit1 = смена профиля ждёт границы кадра */
+    uint8_t  profile;           /* активный профиль АЦП */
+    uint8_t  readable;          /* кадров, которые кольцо удерживает для потребителя (FIFO_FRAMES-2) */
+    uint16_t samples;           /* отсчётов в кадре АЦП */
+    uint16_t fifo_frames;       /* слотов в кольце */
+    uint32_t wr_seq;            /* кадров записано DMA */
+    uint32_t rd_seq;            /* кадров взято потребителем */
+    uint32_t overflow_drops;    /* кадров потеряно: потребитель отстал больше, чем на readable */
+    uint32_t torn;              /* кадров отброшено: DMA занял слот во время чтения */
+    uint32_t backlog_max;       /* максимум очереди wr-rd */
+    uint32_t skipped;           /* кадров пропущено при выборке (переполнение и режим «последний») */
+    uint32_t dma_full0;         /* завершений DMA ADC1 */
+    uint32_t dma_full1;         /* завершений DMA ADC2 (в dual-режиме равно dma_full0) */
+    uint64_t last_frame_us;     /* время завершения DMA последнего кадра, мкс */
+    uint32_t last_frame_seq;    /* его номер (wr_seq-1) */
+    uint16_t switches;          /* смен профиля на границе кадра, DMA не останавливался */
+    uint16_t switch_deferred;   /* границ пропущено: в новый банк уже пришёл отсчёт */
+    uint16_t switch_slip;       /* отсчёт пришёл между проверкой и остановкой потока (потерян) */
+    uint16_t switch_restarts;   /* смен N перезапуском DMA (SET_ACQ, выход из CUSTOM, DMA стоял) */
+} vnd_adc_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_adc_v1_t) == 64, "vnd_adc_v1_t must be 64 bytes");
+
+/* ACQS v1: фактический режим захвата — TIM15, время выборки АЦП, достигнутая Fs (SET_ACQ), <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'ACQS' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = произвольный режим SET_ACQ, bit1 = период меандра TIM2 кратен периоду TIM15 */
+    uint8_t  profile;           /* активный профиль (ADC_PROFILE_CUSTOM = 0xFF) */
+    uint8_t  smp_code;          /* время выборки АЦП, ADC_SAMPLETIME_* (0 = 1.5 такта ... 7 = 810.5) */
+    uint32_t fs_req_hz;         /* запрошенная Fs (для профилей из таблицы — табличная) */
+    uint64_t fs_millihz;        /* достигнутая Fs, мГц: tim_clk / ((PSC+1)(ARR+1)) */
+    uint32_t tim_clk_hz;        /* такт ядра TIM15 */
+    uint16_t tim_psc;           /* PSC */
+    uint16_t tim_arr;           /* ARR */
+    uint32_t adc_clk_hz;        /* такт АЦП */
+    uint16_t conv_ns;           /* выборка + SAR (× ovs_ratio), нс */
+    uint16_t samples;           /* N отсчётов в кадре */
+    uint32_t frame_millihz;     /* кадров в секунду, мГц */
+    uint32_t ring_ms;           /* запас кольца кадров: ADC_RING_READABLE * N / Fs, мс */
+    uint32_t payload_bps;       /* отсчётов обоих каналов, байт/с (без заголовков) */
+    int8_t   last_rc;           /* результат последней SET_ACQ (0 — применена) */
+    uint16_t ovs_ratio;         /* аппаратный оверсэмплинг: преобразований на отсчёт (1 — выключен) */
+    uint8_t  ovs_shift;         /* сдвиг суммы вправо */
+    uint8_t  bits;              /* значащих бит отсчёта, как sample_bits в заголовке кадра */
+    uint8_t  reserved[11];
+} vnd_acq_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_acq_v1_t) == 64, "vnd_acq_v1_t must be 64 bytes");
+
+/* LOCK v1: синхронный детектор по меандру TIM2 (SET_FRAME_FMT 3, SET_LOCKIN) с START, <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'LOCK' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = формат lock-in выбран, bit1 = фаза доступна (PHAS), bit2 = фаза измерена */
+    uint16_t periods;           /* M: периодов меандра на запись */
+    uint16_t period_samples;    /* P: отсчётов на период меандра */
+    uint16_t high_samples;      /* H: отсчётов высокого уровня TIM2_CH2 */
+    uint8_t  recs_per_frame;    /* записей в кадре v3 */
+    uint8_t  pending;           /* записей ждут отправки */
+    uint16_t reserved0;
+    uint32_t records;           /* записей закрыто */
+    uint32_t frames;            /* кадров АЦП через демодулятор */
+    uint32_t gaps;              /* разрывов: пропуск кадров АЦП или фаза не сошлась */
+    uint32_t no_phase;          /* кадров без фазы */
+    uint32_t aborted;           /* незаконченных записей сброшено */
+    uint32_t overflow;          /* записей потеряно: очередь на отправку полна */
+    uint32_t phase_meas;        /* измерений фазы в TC ADC1 (adc_stream) */
+    uint32_t phase_fix;         /* измерение поправило ведение фазы по N */
+    uint32_t phase_dirty;       /* TC рядом с триггером: фаза кадра — из ведения по N */
+    uint32_t cyc_frame_avg;     /* циклы CPU демодулятора на кадр АЦП, среднее */
+    uint32_t cyc_frame_max;     /* максимум */
+    uint32_t frames_out;        /* кадров v3 собрано */
+} vnd_lockin_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_lockin_v1_t) == 64, "vnd_lockin_v1_t must be 64 bytes");
+
+/* PHAS v1: фаза меандра TIM2 для кадров АЦП (захват фронта DMA2, счётчики TIM2/TIM15), <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'PHAS' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = счётчики годны, bit1 = поток захвата запущен, bit2 = захват годен, bit3 = фаза измерена */
+    uint16_t period_samples;    /* P: отсчётов на период меандра (0 — фазы нет) */
+    uint16_t high_samples;      /* H */
+    uint16_t reserved0;
+    uint32_t edges;             /* фронтов захвачено */
+    uint32_t edge_meas;         /* кадров АЦП с фазой по захваченному фронту */
+    uint32_t counter_meas;      /* кадров с фазой по счётчикам TIM2/TIM15 */
+    uint32_t fix;               /* измерение разошлось с ведением по N */
+    uint32_t dirty;             /* кадров без измерения: фаза из ведения по N */
+    uint32_t edge_amb;          /* фронтов у границы банка DMA, не использованных */
+    uint32_t frames_phase;      /* кадров АЦП взято с фазой (флаг 0x40, L/R по фазе) */
+    uint32_t frames_gpio;       /* кадров без фазы (L/R по PA1) */
+    uint8_t  reserved[20];
+} vnd_phase_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_phase_v1_t) == 64, "vnd_phase_v1_t must be 64 bytes");
+
+/* ZONE v1: зоны ROI (SET_WINDOWS/SET_ROI_US, SET_ROI) и сэкономленный трафик с START, <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'ZONE' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = ROI включён, bit1 = зоны заданы в мкс (SET_ROI_US), bit2 = таблица действует для текущего N */
+    uint8_t  cfg_count;         /* зон задано */
+    uint8_t  zone_count;        /* зон в кадре после обрезки по N (0 — кадр целиком) */
+    uint16_t frame_samples;     /* N кадра АЦП, для которого разрешена таблица */
+    uint16_t zone_samples;      /* отсчётов на канал в payload */
+    uint32_t frames_zoned;      /* кадров АЦП ушло зонами */
+    uint32_t frames_whole;      /* кадров АЦП ушло целиком при включённом ROI (зоны вне кадра или без выигрыша) */
+    uint64_t bytes_saved;       /* байт payload не отправлено благодаря зонам */
+    uint16_t zones[VND_ZONES_MAX][2]; /* {start, len} действующих зон, отсчёты */
+    uint8_t  reserved[4];
+} vnd_zone_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_zone_v1_t) == 64, "vnd_zone_v1_t must be 64 bytes");
+
+/* CACH v1: кэши ядра, регионы DMA, размещение в TCM и стоимость горячего пути (сравнение сборок), <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'CACH' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = I-Cache, bit1 = D-Cache включены, bit2 = пул кадров USB write-through (USBD_OTG_DMA_ENABLE) */
+    uint16_t reserved0;
+    uint32_t loop_cyc_avg;      /* средние циклы итерации основного цикла за последнюю секунду */
+    uint32_t prep_count;        /* вызовов vnd_prepare_pair с START, собравших кадры */
+    uint32_t prep_cyc_avg;      /* средние циклы на такой вызов (взятие кадра АЦП, сборка, сжатие) */
+    uint32_t prep_cyc_max;      /* максимум */
+    uint32_t adc_dma_base;      /* секция .adc_dma: некэшируемый регион MPU 64K */
+    uint32_t adc_dma_size;      /* занято байт */
+    uint32_t usb_dma_base;      /* секция .usb_dma: write-through регион MPU 64K (0 байт без DMA ядра OTG) */
+    uint32_t usb_dma_size;
+    uint32_t adc_irq_cyc_avg;   /* циклы ISR DMA АЦП (DMA1_Stream0) с START, среднее */
+    uint32_t adc_irq_cyc_max;   /* максимум */
+    uint32_t itcm_bytes;        /* занято ITCM горячим кодом (.itcm_text) */
+    uint32_t dtcm_hot_bytes;    /* метаданные кольца и vendor в начале .bss (DTCM_BSS) */
+    uint16_t cpu_load_permille; /* занятость CPU за последнюю секунду, ‰ (0xFFFF — MAIN_IDLE_WFI=0) */
+    uint16_t cpu_isr_permille;  /* доля ISR DMA АЦП/TIM6/OTG_HS, ‰ */
+    uint32_t wfi_wakeups;       /* пробуждений основного цикла из WFI в секунду */
+} vnd_cache_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_cache_v1_t) == 64, "vnd_cache_v1_t must be 64 bytes");
+
+/* BOOT v1: время от сброса до первого кадра по меткам boot_time.h, мкс от сброса, <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'BOOT' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = образ во flash (вектора в 0x08xxxxxx), bit1 = I-Cache, bit2 = D-Cache */
+    uint16_t reserved0;
+    uint32_t sysclk_hz;         /* SystemCoreClock */
+    uint32_t mark_us[8];        /* по boot_mark_t: MAIN, CLOCK, USB_INIT, LOOP, CONFIGURED, START,
+                                   ADC_FRAME, TX_FRAME; 0xFFFFFFFF — ещё не было */
+    uint32_t itcm_copy_bytes;   /* скопировано стартапом в ITCM (.itcm_text) */
+    uint32_t data_copy_bytes;   /* скопировано в .data (DTCM) */
+    uint32_t usb_copy_bytes;    /* скопировано в .usb_nocache (AXI SRAM) */
+    uint8_t  reserved[8];
+} vnd_boot_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_boot_v1_t) == 64, "vnd_boot_v1_t must be 64 bytes");
+
+/* ULOG v1: неблокирующий лог USART1 (uart_log.h) — кольцо, выгрузка DMA, потери, стоимость printf, <=64B */
+#pragma pack(push,1)
+typedef struct {
+    char     sig[4];            /* 'ULOG' */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = выгрузка запущена, bit1 = DMA-кусок в полёте */
+    uint16_t ring_size;         /* байт кольца */
+    uint16_t level;             /* занято сейчас */
+    uint16_t level_hwm;         /* максимум занятости с загрузки */
+    uint32_t writes;            /* строк принято */
+    uint32_t bytes_in;          /* байт принято */
+    uint32_t bytes_out;         /* байт выгружено в UART */
+    uint32_t dropped_writes;    /* строк отброшено (кольцо полно) */
+    uint32_t dropped_bytes;
+    uint32_t dma_chunks;        /* запусков TX DMA */
+    uint32_t dma_errors;        /* ошибок UART/DMA, кусок потерян */
+    uint32_t wr_cyc_avg;        /* циклы DWT на запись строки (printf после форматирования), среднее */
+    uint32_t wr_cyc_max;        /* максимум */
+    uint8_t  reserved[16];
+} vnd_ulog_v1_t; /* 64 байта */
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_ulog_v1_t) == 64, "vnd_ulog_v1_t must be 64 bytes");
+
+/* Ответ VND_CMD_GET_TRACE: заголовок, затем words слов целых записей трейса (trace_tok.h) */
+#pragma pack(push,1)
+typedef struct {
+    uint16_t words;             /* слов записей после заголовка */
+    uint8_t  version;           /* 1 */
+    uint8_t  flags;             /* bit0 = в кольце остались записи (читать ещё) */
+    uint32_t dropped;           /* записей потеряно с загрузки (кольцо было полно) */
+    uint32_t sysclk_hz;         /* частота CYCCNT для перевода меток в мкс */
+} vnd_trace_hdr_t;
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_trace_hdr_t) == 12, "vnd_trace_hdr_t must be 12 bytes");
+
+/* Ответ VND_CMD_GET_EVENTS: заголовок, затем count записей pipe_rec_t по 16 байт */
+#pragma pack(push,1)
+typedef struct {
+    uint32_t first;             /* номер первой записи ответа */
+    uint32_t wr;                /* номер следующей записи (всего записано с загрузки) */
+    uint16_t count;             /* записей в ответе */
+    uint8_t  version;           /* 1 */
+    uint8_t  rec_size;          /* 16 */
+    uint16_t ring;              /* записей в кольце (старше wr - ring перезаписаны) */
+    uint16_t reserved;
+    uint32_t sysclk_hz;         /* частота CYCCNT */
+} vnd_evt_hdr_t;
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_evt_hdr_t) == 20, "vnd_evt_hdr_t must be 20 bytes");
+
+/* Ответ VND_CMD_GET_PROF: заголовок, затем zones записей vnd_prof_rec_t (cyc_prof.h) */
+#pragma pack(push,1)
+typedef struct {
+    uint8_t  version;           /* 1 */
+    uint8_t  zones;             /* записей участков */
+    uint8_t  bins;              /* корзин гистограммы log2 */
+    uint8_t  rec_size;          /* байт на запись участка */
+    uint32_t sysclk_hz;         /* частота CYCCNT */
+    uint32_t elapsed_ms;        /* мс с последнего сброса профиля */
+} vnd_prof_hdr_t;
+typedef struct {
+    char     name[8];           /* имя участка, без завершающего нуля при длине 8 */
+    uint32_t count;
+    uint32_t min_cyc;
+    uint32_t max_cyc;
+    uint64_t sum_cyc;           /* среднее = sum_cyc / count */
+    uint32_t hist[CYC_PROF_BINS]; /* корзина k: [2^k, 2^(k+1)) циклов, последняя — и длиннее */
+} vnd_prof_rec_t;
+#pragma pack(pop)
+_Static_assert(sizeof(vnd_prof_hdr_t) == 12, "vnd_prof_hdr_t must be 12 bytes");
+_Static_assert(sizeof(vnd_prof_rec_t) == 28u + 4u * CYC_PROF_BINS, "vnd_prof_rec_t packing");
+
 /* Публичные функции */
 void Vendor_Stream_Task(void);
 void usb_vendor_periodic_tick(void); /* тик от TIM6 */
 uint8_t vnd_is_streaming(void);
+/* Для основного цикла: 1 — таску стрима есть работа, 0 — можно спать в WFI (вызывать при PRIMASK=1) */
+uint8_t vnd_has_work(void);
 /* Построить статус в буфере (возвращает длину или 0 при ошибке) */
 uint16_t vnd_build_status(uint8_t *dst, uint16_t max_len);
+/* Построить страницу PERF (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_perf(uint8_t *dst, uint16_t max_len);
+/* Построить страницу COMP (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_comp(uint8_t *dst, uint16_t max_len);
+/* Построить страницу ADCS (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_adc(uint8_t *dst, uint16_t max_len);
+/* Построить страницу ACQS (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_acq(uint8_t *dst, uint16_t max_len);
+/* Построить страницу LOCK (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_lockin(uint8_t *dst, uint16_t max_len);
+/* Построить страницу PHAS (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_phase(uint8_t *dst, uint16_t max_len);
+/* Построить страницу ZONE (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_zone(uint8_t *dst, uint16_t max_len);
+/* Построить страницу CACH (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_cache(uint8_t *dst, uint16_t max_len);
+/* Построить страницу BOOT (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_boot(uint8_t *dst, uint16_t max_len);
+/* Построить страницу ULOG (возвращает длину или 0 при ошибке) */
+uint16_t vnd_build_ulog(uint8_t *dst, uint16_t max_len);
+/* Ответ VND_CMD_GET_TRACE: заголовок и записи, забранные из кольца (возвращает длину или 0) */
+uint16_t vnd_build_trace(uint8_t *dst, uint16_t max_len);
+/* Ответ VND_CMD_GET_EVENTS: страница журнала событий с записи from16 (возвращает длину или 0) */
+uint16_t vnd_build_events(uint8_t *dst, uint16_t max_len, uint16_t from16);
+/* Ответ VND_CMD_GET_PROF (возвращает длину или 0); reset — обнулить профиль после снимка */
+uint16_t vnd_build_prof(uint8_t *dst, uint16_t max_len, uint8_t reset);
 /* Диагностическая одноразовая отправка 64B шаблона (оставляем) */
 void vnd_diag_send64_once(void);
 /* ISR уведомление о появлении новых кадров (override слабого hook из adc_stream) */
 void adc_stream_on_new_frames(uint32_t frames_added);
+/* IRQ MDMA: crc16 кадров досчитан — поставить ждавший кадр в EP (override слабого hook из frame_crc) */
+void frame_crc_on_done(void);
 /* Статистика передачи */
 uint64_t vnd_get_total_tx_bytes(void);
 uint32_t vnd_get_last_txcplt_ms(void);
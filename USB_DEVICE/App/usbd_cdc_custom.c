@@ -2,8 +2,15 @@
 #ifndef USBD_VND_LOG_ENABLE
 #define USBD_VND_LOG_ENABLE 0
 #endif
+/* Без printf — токенизированный трейс (trace_tok.h), текст восстанавливает HostTools/trace_decode.py */
+#ifndef USBD_VND_TRACE_LOG
+#define USBD_VND_TRACE_LOG 1
+#endif
 #if USBD_VND_LOG_ENABLE
 #define VND_LOGF(...) printf(__VA_ARGS__)
+#elif USBD_VND_TRACE_LOG
+#include "trace_tok.h"
+#define VND_LOGF(fmt, ...) TRACE_TOK(fmt, ##__VA_ARGS__)
 #else
 #define VND_LOGF(...) do{}while(0)
 #endif
@@ -15,10 +22,15 @@
  */
 #include "usbd_cdc.h"      // для типов и макросов CDC
 #include "usbd_ctlreq.h"
+#include "usbd_cdc_custom.h" /* USBD_VND_TxPrepStats_t */
 #include <stdio.h>
 #include "usb_vendor_app.h" // ДОБАВЛЕНО: для VND_CMD_* и vnd_build_status
 #include <string.h>
-#include "stm32h7xx_hal.h"  // для SCB_CleanDCache_by_Addr (H7, D-Cache)
+#include "stm32h7xx_hal.h"  // для __DSB и DWT (H7)
+#include "boot_time.h"      // метка CONFIGURED, страница BOOT
+#include "pipe_trace.h"     // события LL_TX/DATAIN/ZLP
+#include "cyc_prof.h"       // участки VND_TX, TXCPLT
+#include "vnd_tx_chunk.h"   // куски передачи и bounce-копия
 
 #ifndef USBD_CDC_USERDATA_INDEX
 #define USBD_CDC_USERDATA_INDEX 0
@@ -31,8 +43,9 @@
 #define VND_DATA_HS_MAX_PACKET_SIZE    512U
 #define VND_DATA_FS_MAX_PACKET_SIZE    64U
 
-/* Максимальный размер одного кадра Vendor (32 байта заголовок + до 1024 выборок *2) */
-#define VND_MAX_FRAME_SIZE             (32u + 1024u*2u) /* =2080 */
+/* Кусок одного LL-трансфера VND_TX_CHUNK_MAX — vnd_tx_chunk.h; он должен быть кратен MPS */
+_Static_assert((VND_TX_CHUNK_MAX % VND_DATA_HS_MAX_PACKET_SIZE) == 0u, "chunk must be a multiple of HS MPS");
+_Static_assert((VND_TX_CHUNK_MAX % VND_DATA_FS_MAX_PACKET_SIZE) == 0u, "chunk must be a multiple of FS MPS");
 
 /*
  * Конфигурационный дескриптор: добавляем Vendor IF#2 с двумя alt-setting:
@@ -71,12 +84,15 @@ extern void vnd_pipeline_stop_reset(int deep);
 void USBD_VND_ForceTxIdle(void);
 
 /* Простейшие буферы Vendor (нужны до VND_Class_*Reset) */
-static uint8_t vnd_rx_buf[VND_DATA_HS_MAX_PACKET_SIZE];
-static uint8_t vnd_tx_buf[VND_MAX_FRAME_SIZE];
+static uint8_t vnd_rx_buf[VND_DATA_HS_MAX_PACKET_SIZE] USBD_NOCACHE;
+static uint8_t vnd_tx_buf[VND_TX_CHUNK_MAX] USBD_DMA_BUF;
+/* Длинные ответы EP0 (трейс, журнал событий): по одному control-трансферу за раз */
+static uint8_t vnd_ep0_buf[1024] __attribute__((aligned(4))) USBD_NOCACHE;
 static volatile uint32_t vnd_rx_len = 0;
 static volatile uint8_t vnd_tx_busy = 0;
 static volatile uint8_t vnd_last_tx_rc = 0xFF; /* последний rc из USBD_LL_Transmit */
 static volatile uint16_t vnd_last_tx_len = 0;
+static uint32_t vnd_tx_seq = PT_SEQ_NONE; /* seq рабочего кадра текущей передачи — для журнала событий */
 
 /* Запросить soft/deep reset откуда угодно (в т.ч. из приложения) */
 void USBD_VND_RequestSoftReset(void){ g_req_soft_reset = 1; }
@@ -137,7 +153,7 @@ void USBD_VND_ProcessControlRequests(void)
 }
 
 /* Удаляем зависимость от статического дескриптора оригинального файла */
-static __ALIGN_BEGIN uint8_t USBD_CDCVND_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END = {
+static __ALIGN_BEGIN uint8_t USBD_CDCVND_DeviceQualifierDesc[USB_LEN_DEV_QUALIFIER_DESC] __ALIGN_END USBD_NOCACHE = {
   USB_LEN_DEV_QUALIFIER_DESC,
   USB_DESC_TYPE_DEVICE_QUALIFIER,
   0x00, 0x02, /* USB 2.00 */
@@ -155,36 +171,89 @@ __weak void USBD_VND_DataReceived(const uint8_t *data, uint32_t len) { (void)dat
 /* Слабый callback завершения передачи Vendor IN */
 __weak void USBD_VND_TxCplt(void) {}
 
-/* API для передачи по Vendor */
-uint8_t USBD_VND_Transmit(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len)
+/* Zero-copy: буфер приложения, отданный EP IN до DataIn (NULL — свободно либо передача через vnd_tx_buf) */
+static const uint8_t * volatile vnd_tx_lent_buf = NULL;
+/* Текущая логическая передача (возможно, из нескольких кусков VND_TX_CHUNK_MAX) */
+static const uint8_t * volatile vnd_tx_src = NULL; /* источник данных */
+static volatile uint32_t vnd_tx_total = 0;         /* полный размер */
+static volatile uint32_t vnd_tx_queued = 0;        /* уже поставлено в LL */
+static volatile uint8_t  vnd_tx_bounce = 0;        /* 1 — куски копируются в vnd_tx_buf */
+static volatile uint32_t vnd_tx_chained = 0;       /* передач, потребовавших >1 куска */
+static volatile uint32_t vnd_tx_chain_err = 0;     /* отказ LL на продолжении цепочки */
+/* Замеры подготовки передачи по DWT: [0] — копия в vnd_tx_buf, [1] — zero-copy */
+static USBD_VND_TxPrepStats_t vnd_tx_prep[2];
+
+static inline void vnd_tx_prep_begin(uint8_t zc)
 {
-  if (len > (uint16_t)sizeof(vnd_tx_buf)) return (uint8_t)USBD_FAIL; /* недопустимо: кадр больше ожидаемого */
-  /* Сначала проверяем занятость; при BUSY — минимальный лог без засорения основного [VND_TX] */
-  if (vnd_tx_busy) {
-    if (len >= 4) {
-      VND_LOGF("[VND_BUSY] ep=0x%02X len=%u head=%02X %02X %02X %02X\r\n", (unsigned)VND_IN_EP, (unsigned)len,
-             (unsigned)data[0], (unsigned)data[1], (unsigned)data[2], (unsigned)data[3]);
-    } else {
-      VND_LOGF("[VND_BUSY] ep=0x%02X len=%u\r\n", (unsigned)VND_IN_EP, (unsigned)len);
-    }
-    return (uint8_t)USBD_BUSY;
-  }
-  memcpy(vnd_tx_buf, data, len);
-  /* ВАЖНО (STM32H7, включён D-Cache): очистить кэш перед DMA/USB IN,
-     иначе хост увидит старые/нулевые данные в памяти. Выравниваем адрес/длину на 32 байта. */
-#if defined (SCB_CleanDCache_by_Addr)
-  {
-    uintptr_t addr = (uintptr_t)vnd_tx_buf;
-    uint32_t  clean_addr = (uint32_t)(addr & ~((uintptr_t)31U));
-    uint32_t  clean_len  = (uint32_t)(((addr + len + 31U) & ~((uintptr_t)31U)) - clean_addr);
-    SCB_CleanDCache_by_Addr((uint32_t*)clean_addr, (int32_t)clean_len);
-  }
+  USBD_VND_TxPrepStats_t *st = &vnd_tx_prep[zc ? 1 : 0];
+  st->count++;
+  st->cyc_last = 0;
+}
+
+/* Циклы подготовки суммируются по всем кускам одной передачи */
+static inline void vnd_tx_prep_add(uint8_t zc, uint32_t cyc)
+{
+  USBD_VND_TxPrepStats_t *st = &vnd_tx_prep[zc ? 1 : 0];
+  st->cyc_last += cyc;
+  st->cyc_sum += cyc;
+  if (st->cyc_last > st->cyc_max) st->cyc_max = st->cyc_last;
+}
+
+void USBD_VND_GetTxPrepStats(uint8_t zero_copy, USBD_VND_TxPrepStats_t *out)
+{
+  if (!out) return;
+  __disable_irq();
+  *out = vnd_tx_prep[zero_copy ? 1 : 0];
+  __enable_irq();
+}
+
+void USBD_VND_ResetTxPrepStats(void)
+{
+  __disable_irq();
+  memset(vnd_tx_prep, 0, sizeof(vnd_tx_prep));
+  vnd_tx_chained = 0; vnd_tx_chain_err = 0;
+  __enable_irq();
+}
+
+uint32_t USBD_VND_GetTxChainedCount(void) { return vnd_tx_chained; }
+uint32_t USBD_VND_GetTxChainErrors(void) { return vnd_tx_chain_err; }
+
+/* Буферы IN (USBD_DMA_BUF): при USBD_OTG_DMA_ENABLE — секция .usb_dma, регион MPU write-through,
+   запись CPU уже в RAM, DMA ядра нужен только DSB (дождаться буфера записи). Без DMA ядра
+   буферы в DTCM (кэш её не обслуживает), FIFO пишет CPU — обслуживание не нужно. */
+static inline void vnd_dcache_clean(const uint8_t *buf, uint32_t len)
+{
+  (void)buf; (void)len;
+#if USBD_OTG_DMA_ENABLE
+  __DSB();
 #endif
+}
+
+/* Поставить в LL следующий кусок текущей передачи (из Transmit или из DataIn) */
+static ITCM_FUNC uint8_t vnd_tx_next_chunk(USBD_HandleTypeDef *pdev)
+{
+  uint32_t n = vnd_tx_chunk_len(vnd_tx_total, vnd_tx_queued);
+  const uint8_t *p = vnd_tx_src + vnd_tx_queued;
+  if (vnd_tx_bounce) {
+    uint32_t t0 = DWT->CYCCNT;
+    p = vnd_tx_chunk_bounce(vnd_tx_buf, p, n);
+    vnd_dcache_clean(vnd_tx_buf, n);
+    vnd_tx_prep_add(0U, DWT->CYCCNT - t0);
+  }
+  vnd_tx_queued += n;
+  PIPE_EVT(PT_EV_LL_TX, vnd_tx_seq, n);
+  return (uint8_t)USBD_LL_Transmit(pdev, VND_IN_EP, (uint8_t*)p, n);
+}
+
+/* Общая часть Transmit/TransmitZC: фильтр STAT mid-stream, запуск цепочки кусков, логи */
+static uint8_t vnd_tx_submit(USBD_HandleTypeDef *pdev, const uint8_t *buf, uint16_t len, uint8_t lend)
+{
+  CYC_PROF_BEGIN(prof_t0);
   /* Жёсткий запрет STAT mid-stream: если это не рабочий кадр (не 0x5A 0xA5) и идёт стрим, разрешаем только при явном разрешении */
   extern uint8_t streaming; /* из usb_vendor_app.c */
   extern volatile uint8_t vnd_status_permit_once; /* одноразовое разрешение STAT */
   if (streaming) {
-    if (!(len >= 2 && vnd_tx_buf[0]==0x5A && vnd_tx_buf[1]==0xA5)) {
+    if (!(len >= 2 && buf[0]==0x5A && buf[1]==0xA5)) {
       if (vnd_status_permit_once) {
         vnd_status_permit_once = 0; /* использовать разрешение один раз */
       } else {
@@ -192,42 +261,96 @@ uint8_t USBD_VND_Transmit(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_
         /* Лёгкая диагностика блокировки */
         if (len >= 4) {
           VND_LOGF("[VND_BLOCK] ep=0x%02X len=%u head=%02X %02X %02X %02X\r\n", (unsigned)VND_IN_EP, (unsigned)len,
-                 (unsigned)vnd_tx_buf[0], (unsigned)vnd_tx_buf[1], (unsigned)vnd_tx_buf[2], (unsigned)vnd_tx_buf[3]);
+                 (unsigned)buf[0], (unsigned)buf[1], (unsigned)buf[2], (unsigned)buf[3]);
         } else {
           VND_LOGF("[VND_BLOCK] ep=0x%02X len=%u\r\n", (unsigned)VND_IN_EP, (unsigned)len);
         }
+        CYC_PROF_END(CYC_PROF_VND_TX, prof_t0);
         return (uint8_t)USBD_BUSY;
       }
     }
   }
   vnd_tx_busy = 1U;
+  /* Буфер считается отданным до вызова LL: DataIn может прийти раньше возврата из USBD_LL_Transmit */
+  vnd_tx_lent_buf = lend ? buf : NULL;
+  vnd_tx_src = buf; vnd_tx_total = len; vnd_tx_queued = 0; vnd_tx_bounce = lend ? 0U : 1U;
+  vnd_tx_seq = PT_SEQ_NONE;
+  if (len >= 8 && buf[0]==0x5A && buf[1]==0xA5) memcpy(&vnd_tx_seq, buf + 4, 4); /* seq заголовка кадра */
+  if (len > VND_TX_CHUNK_MAX) vnd_tx_chained++;
   /* ВАЖНО: сообщаем стеку общий размер передачи, чтобы DataIn знал,
     нужно ли отправлять ZLP для длины, кратной размеру пакета, и
-    вызывал USBD_VND_TxCplt только ПОСЛЕ полного кадра (после ZLP). */
+    вызывал USBD_VND_TxCplt только ПОСЛЕ полного кадра (после всех кусков и ZLP). */
   pdev->ep_in[VND_IN_EP & 0x0FU].total_length = len;
   vnd_last_tx_len = len;
-  vnd_last_tx_rc = (uint8_t)USBD_LL_Transmit(pdev, VND_IN_EP, vnd_tx_buf, len);
+  vnd_last_tx_rc = vnd_tx_next_chunk(pdev);
   /* Логируем только реально поставленные в LL передачи как [VND_TX] */
   if (vnd_last_tx_rc == (uint8_t)USBD_OK) {
     if (len >= 4) {
-      VND_LOGF("[VND_TX] ep=0x%02X len=%u head=%02X %02X %02X %02X\r\n", (unsigned)VND_IN_EP, (unsigned)len,
-             (unsigned)vnd_tx_buf[0], (unsigned)vnd_tx_buf[1], (unsigned)vnd_tx_buf[2], (unsigned)vnd_tx_buf[3]);
+      VND_LOGF("[VND_TX] ep=0x%02X len=%u zc=%u head=%02X %02X %02X %02X\r\n", (unsigned)VND_IN_EP, (unsigned)len, (unsigned)lend,
+             (unsigned)buf[0], (unsigned)buf[1], (unsigned)buf[2], (unsigned)buf[3]);
     } else {
-      VND_LOGF("[VND_TX] ep=0x%02X len=%u\r\n", (unsigned)VND_IN_EP, (unsigned)len);
+      VND_LOGF("[VND_TX] ep=0x%02X len=%u zc=%u\r\n", (unsigned)VND_IN_EP, (unsigned)len, (unsigned)lend);
     }
   } else {
-    /* Если LL вернул BUSY/FAIL — снимаем флаг занятости и логируем как FAIL */
+    /* Если LL вернул BUSY/FAIL — снимаем флаг занятости, возвращаем буфер и логируем как FAIL */
     vnd_tx_busy = 0U;
+    vnd_tx_lent_buf = NULL;
+    vnd_tx_src = NULL; vnd_tx_total = 0; vnd_tx_queued = 0;
     if (len >= 4) {
       VND_LOGF("[VND_FAIL] ep=0x%02X rc=%u len=%u head=%02X %02X %02X %02X\r\n", (unsigned)VND_IN_EP, (unsigned)vnd_last_tx_rc, (unsigned)len,
-             (unsigned)vnd_tx_buf[0], (unsigned)vnd_tx_buf[1], (unsigned)vnd_tx_buf[2], (unsigned)vnd_tx_buf[3]);
+             (unsigned)buf[0], (unsigned)buf[1], (unsigned)buf[2], (unsigned)buf[3]);
     } else {
       VND_LOGF("[VND_FAIL] ep=0x%02X rc=%u len=%u\r\n", (unsigned)VND_IN_EP, (unsigned)vnd_last_tx_rc, (unsigned)len);
     }
   }
+  CYC_PROF_END(CYC_PROF_VND_TX, prof_t0);
   return vnd_last_tx_rc;
 }
 
+/* API для передачи по Vendor через bounce-буфер vnd_tx_buf (STAT, TEST, невыровненные буферы).
+   Передача длиннее VND_TX_CHUNK_MAX копируется кусками по ходу DataIn — тогда источник
+   должен жить до USBD_VND_TxCplt; короткие (стековые) буферы копируются сразу целиком. */
+uint8_t USBD_VND_Transmit(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len)
+{
+  /* Сначала проверяем занятость; при BUSY — минимальный лог без засорения основного [VND_TX] */
+  if (vnd_tx_busy) {
+    if (len >= 4) {
+      VND_LOGF("[VND_BUSY] ep=0x%02X len=%u head=%02X %02X %02X %02X\r\n", (unsigned)VND_IN_EP, (unsigned)len,
+             (unsigned)data[0], (unsigned)data[1], (unsigned)data[2], (unsigned)data[3]);
+    } else {
+      VND_LOGF("[VND_BUSY] ep=0x%02X len=%u\r\n", (unsigned)VND_IN_EP, (unsigned)len);
+    }
+    return (uint8_t)USBD_BUSY;
+  }
+  vnd_tx_prep_begin(0U);
+  return vnd_tx_submit(pdev, data, len, 0U);
+}
+
+/* Zero-copy: отдаём EP IN сам буфер кадра (любой длины, кусками VND_TX_CHUNK_MAX).
+   Буфер обязан жить и не меняться до USBD_VND_TxCplt (см. USBD_VND_TxIsLent).
+   Буфер начинается на границе строки кэша 32 байта (USBD_DMA_BUF), как и пул кадров. */
+uint8_t USBD_VND_TransmitZC(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len)
+{
+  if (((uintptr_t)data & 31U) != 0U) {
+    /* Невыровненный буфер — не из пула кадров: уходим в копию */
+    return USBD_VND_Transmit(pdev, data, len);
+  }
+  if (vnd_tx_busy) {
+    VND_LOGF("[VND_BUSY] ep=0x%02X len=%u zc=1\r\n", (unsigned)VND_IN_EP, (unsigned)len);
+    return (uint8_t)USBD_BUSY;
+  }
+  vnd_tx_prep_begin(1U);
+  uint32_t t0 = DWT->CYCCNT;
+  vnd_dcache_clean(data, len);
+  vnd_tx_prep_add(1U, DWT->CYCCNT - t0);
+  return vnd_tx_submit(pdev, data, len, 1U);
+}
+
+uint8_t USBD_VND_TxIsLent(const void *buf)
+{
+  return (buf != NULL && (const void*)vnd_tx_lent_buf == buf) ? 1U : 0U;
+}
+
 uint32_t USBD_VND_Read(uint8_t *dst, uint32_t max_len)
 {
   uint32_t copy = (vnd_rx_len < max_len) ? vnd_rx_len : max_len;
@@ -248,10 +371,12 @@ void USBD_VND_ForceTxIdle(void)
     VND_LOGF("[VND_FORCE_IDLE] clearing busy (last len=%u rc=%u)\r\n", (unsigned)vnd_last_tx_len, (unsigned)vnd_last_tx_rc);
   }
   vnd_tx_busy = 0U;
+  vnd_tx_lent_buf = NULL;
+  vnd_tx_src = NULL; vnd_tx_total = 0; vnd_tx_queued = 0;
 }
 
 /* Конфигурационные дескрипторы (HS/FS/Other) */
-__ALIGN_BEGIN static uint8_t USBD_CDCVND_CfgHSDesc[USB_CDC_VENDOR_CONFIG_DESC_SIZ] __ALIGN_END = {
+__ALIGN_BEGIN static uint8_t USBD_CDCVND_CfgHSDesc[USB_CDC_VENDOR_CONFIG_DESC_SIZ] __ALIGN_END USBD_NOCACHE = {
   /* Configuration Descriptor */
   0x09, USB_DESC_TYPE_CONFIGURATION,
   LOBYTE(USB_CDC_VENDOR_CONFIG_DESC_SIZ), HIBYTE(USB_CDC_VENDOR_CONFIG_DESC_SIZ),
@@ -290,7 +415,7 @@ __ALIGN_BEGIN static uint8_t USBD_CDCVND_CfgHSDesc[USB_CDC_VENDOR_CONFIG_DESC_SI
   LOBYTE(VND_DATA_HS_MAX_PACKET_SIZE), HIBYTE(VND_DATA_HS_MAX_PACKET_SIZE), 0x00,
 };
 
-__ALIGN_BEGIN static uint8_t USBD_CDCVND_CfgFSDesc[USB_CDC_VENDOR_CONFIG_DESC_SIZ] __ALIGN_END = {
+__ALIGN_BEGIN static uint8_t USBD_CDCVND_CfgFSDesc[USB_CDC_VENDOR_CONFIG_DESC_SIZ] __ALIGN_END USBD_NOCACHE = {
   0x09, USB_DESC_TYPE_CONFIGURATION,
   LOBYTE(USB_CDC_VENDOR_CONFIG_DESC_SIZ), HIBYTE(USB_CDC_VENDOR_CONFIG_DESC_SIZ),
   0x03, 0x01, 0x00,
@@ -321,7 +446,7 @@ __ALIGN_BEGIN static uint8_t USBD_CDCVND_CfgFSDesc[USB_CDC_VENDOR_CONFIG_DESC_SI
   LOBYTE(VND_DATA_FS_MAX_PACKET_SIZE), HIBYTE(VND_DATA_FS_MAX_PACKET_SIZE), 0x00,
 };
 
-__ALIGN_BEGIN static uint8_t USBD_CDCVND_OtherSpeedCfgDesc[USB_CDC_VENDOR_CONFIG_DESC_SIZ] __ALIGN_END = {
+__ALIGN_BEGIN static uint8_t USBD_CDCVND_OtherSpeedCfgDesc[USB_CDC_VENDOR_CONFIG_DESC_SIZ] __ALIGN_END USBD_NOCACHE = {
   0x09, USB_DESC_TYPE_OTHER_SPEED_CONFIGURATION,
   LOBYTE(USB_CDC_VENDOR_CONFIG_DESC_SIZ), HIBYTE(USB_CDC_VENDOR_CONFIG_DESC_SIZ),
   0x03, 0x01, 0x04,
@@ -369,6 +494,7 @@ static uint8_t USBD_CDCVND_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
 {
   g_alt_if2 = 0; /* при конфигурации по умолчанию IF2 в alt0 (idle) */
   UNUSED(cfgidx);
+  boot_mark(BOOT_MARK_CONFIGURED);
   USBD_CDC_HandleTypeDef *hcdc = USBD_malloc(sizeof(USBD_CDC_HandleTypeDef));
   if (!hcdc) { pdev->pClassData = NULL; return (uint8_t)USBD_EMEM; }
   pdev->pClassData = hcdc;
@@ -438,19 +564,57 @@ static uint8_t USBD_CDCVND_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
 {
   USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)pdev->pClassData;
   if (!hcdc) return (uint8_t)USBD_FAIL;
-  uint16_t status_info = 0; uint16_t len;
+  /* static: данные EP0 уходят после выхода из Setup (в режиме DMA — ещё и не из стека/DTCM) */
+  static uint16_t status_info USBD_NOCACHE; uint16_t len;
+  status_info = 0;
   /* ДОБАВЛЕНО: ветка обработки vendor-specific control (GET_STATUS / SOFT/DEEP RESET) */
   if ( (req->bmRequest & USB_REQ_TYPE_MASK) == USB_REQ_TYPE_VENDOR ) {
     VND_LOGF("[SETUP:VND] bm=0x%02X bReq=0x%02X wIndex=%u wLength=%u", (unsigned)req->bmRequest, (unsigned)req->bRequest, (unsigned)req->wIndex, (unsigned)req->wLength);
     /* Принимаем IN GET_STATUS вне зависимости от получателя и номера интерфейса (wIndex),
        чтобы упростить жизнь хостам, где CTRL к Interface может быть ограничен. */
     if ( (req->bmRequest & 0x80U) && req->bRequest == VND_CMD_GET_STATUS ) {
-      uint8_t buf[64];
-      uint16_t l = vnd_build_status(buf, sizeof(buf));
+      /* static: EP0 дописывает FIFO из прерывания уже после выхода из Setup */
+      static uint8_t buf[64] USBD_NOCACHE;
+      /* wValue — номер страницы: 0 = STAT, 1 = PERF, 2 = COMP, 3 = ADCS, 4 = ACQS, 5 = LOCK, 6 = PHAS, 7 = ZONE, 8 = CACH, 9 = BOOT, 10 = ULOG */
+      uint16_t l = (req->wValue == VND_STATUS_PAGE_PERF) ? vnd_build_perf(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_COMP) ? vnd_build_comp(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_ADC)  ? vnd_build_adc(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_ACQ)  ? vnd_build_acq(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_LOCKIN) ? vnd_build_lockin(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_PHASE) ? vnd_build_phase(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_ZONE) ? vnd_build_zone(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_CACHE) ? vnd_build_cache(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_BOOT) ? vnd_build_boot(buf, sizeof(buf))
+                 : (req->wValue == VND_STATUS_PAGE_ULOG) ? vnd_build_ulog(buf, sizeof(buf))
+                                                         : vnd_build_status(buf, sizeof(buf));
       if(!l){ USBD_CtlError(pdev, req); return (uint8_t)USBD_FAIL; }
-      VND_LOGF("[SETUP:VND] -> STAT %uB", (unsigned)l);
+      VND_LOGF("[SETUP:VND] -> STAT page=%u %uB", (unsigned)req->wValue, (unsigned)l);
+      if (l > req->wLength) l = req->wLength;
       USBD_CtlSendData(pdev, buf, l);
       return (uint8_t)USBD_OK;
+    } else if ( (req->bmRequest & 0x80U) && req->bRequest == VND_CMD_GET_TRACE ) {
+      /* Трейс забирается порциями до wLength: только целые записи, хост повторяет, пока flags bit0 */
+      uint16_t max = (req->wLength < 512U) ? req->wLength : 512U;
+      uint16_t l = vnd_build_trace(vnd_ep0_buf, max);
+      if(!l){ USBD_CtlError(pdev, req); return (uint8_t)USBD_FAIL; }
+      USBD_CtlSendData(pdev, vnd_ep0_buf, l);
+      return (uint8_t)USBD_OK;
+    } else if ( (req->bmRequest & 0x80U) && req->bRequest == VND_CMD_GET_EVENTS ) {
+      /* Журнал событий страницами: wValue — младшие 16 бит номера первой записи, стрим не прерывается */
+      uint16_t max = (req->wLength < sizeof(vnd_ep0_buf)) ? req->wLength : (uint16_t)sizeof(vnd_ep0_buf);
+      uint16_t l = vnd_build_events(vnd_ep0_buf, max, req->wValue);
+      if(!l){ USBD_CtlError(pdev, req); return (uint8_t)USBD_FAIL; }
+      USBD_CtlSendData(pdev, vnd_ep0_buf, l);
+      return (uint8_t)USBD_OK;
+    } else if ( (req->bmRequest & 0x80U) && req->bRequest == VND_CMD_GET_PROF ) {
+      /* Профиль участков целиком (~760 байт); wValue bit0 — сбросить после снимка */
+      uint16_t l = vnd_build_prof(vnd_ep0_buf, sizeof(vnd_ep0_buf), (uint8_t)(req->wValue & 1U));
+      if(!l){ USBD_CtlError(pdev, req); return (uint8_t)USBD_FAIL; }
+      if (l > req->wLength) l = req->wLength;
+      USBD_CtlSendData(pdev, vnd_ep0_buf, l);
+      return (uint8_t)USBD_OK;
+    } else if ( (req->bmRequest & 0x80U) == 0 && req->wLength == 0 && req->bRequest == VND_CMD_PROF_RESET ) {
+      cyc_prof_reset(); USBD_CtlSendStatus(pdev); return (uint8_t)USBD_OK;
     } else if ( (req->bmRequest & 0x80U) == 0 && req->wLength == 0 && req->bRequest == 0x7Eu ) {
       /* SOFT_RESET: мгновенно подтверждаем статусом и выполняем ресет в фоне */
       g_req_soft_reset = 1; USBD_CtlSendStatus(pdev); return (uint8_t)USBD_OK;
@@ -485,7 +649,8 @@ static uint8_t USBD_CDCVND_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
           break;
         case USB_REQ_GET_INTERFACE:
           if (pdev->dev_state == USBD_STATE_CONFIGURED) {
-            uint8_t cur = 0;
+            static uint8_t cur USBD_NOCACHE;
+            cur = 0;
             if (req->wIndex == 2) cur = (uint8_t)g_alt_if2; /* наш Vendor IF */
             /* CDC интерфейсы IF0/IF1 всегда alt0 */
             USBD_CtlSendData(pdev, &cur, 1U);
@@ -535,7 +700,7 @@ static uint8_t USBD_CDCVND_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef
   return (uint8_t)USBD_OK;
 }
 
-static uint8_t USBD_CDCVND_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
+static ITCM_FUNC uint8_t USBD_CDCVND_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
 {
   USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)pdev->pClassData;
   if (!hcdc) return (uint8_t)USBD_FAIL;
@@ -553,21 +718,35 @@ static uint8_t USBD_CDCVND_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
        Если длина передачи кратна размеру пакета (MPS), требуется отправить ZLP,
        иначе некоторые хосты (Windows/libusb FS) будут ждать продолжения и в итоге
        получать таймаут. Поведение аналогично CDC. */
-    uint16_t tl = pdev->ep_in[epnum].total_length;
-    uint16_t mps = hpcd->IN_ep[epnum].maxpacket;
+    uint32_t tl = pdev->ep_in[epnum].total_length;
+    uint32_t mps = hpcd->IN_ep[epnum].maxpacket;
     static uint32_t vnd_dataIn_counter = 0; vnd_dataIn_counter++;
-    VND_LOGF("[VND_DataIn:ENTER] ep=%u tl=%u mps=%u busy=%u cnt=%lu\r\n", (unsigned)epnum, (unsigned)tl,(unsigned)mps,(unsigned)vnd_tx_busy,(unsigned long)vnd_dataIn_counter);
-    if ((tl > 0U) && ((tl % mps) == 0U)) {
+    VND_LOGF("[VND_DataIn:ENTER] ep=%u tl=%lu mps=%lu busy=%u cnt=%lu\r\n", (unsigned)epnum, (unsigned long)tl,(unsigned long)mps,(unsigned)vnd_tx_busy,(unsigned long)vnd_dataIn_counter);
+    PIPE_EVT(PT_EV_DATAIN, vnd_tx_seq, vnd_tx_queued);
+    if (vnd_tx_busy && vnd_tx_queued < vnd_tx_total) {
+      /* Завершился промежуточный кусок длинного кадра: сразу ставим следующий.
+         Кусок кратен MPS, короткого пакета не было — для хоста это тот же трансфер. ZLP/TxCplt — только в конце. */
+      if (vnd_tx_next_chunk(pdev) != (uint8_t)USBD_OK) {
+        /* Оставляем busy: приложение снимет его вотчдогом (ForceTxIdle) и сбросит класс */
+        vnd_tx_chain_err++;
+        VND_LOGF("[VND_DataIn] ep=%u chain fail at %lu/%lu\r\n", (unsigned)epnum, (unsigned long)vnd_tx_queued, (unsigned long)vnd_tx_total);
+      }
+    } else if ((tl > 0U) && ((tl % mps) == 0U)) {
       /* Нужен ZLP для корректного завершения трансфера */
-      VND_LOGF("[VND_DataIn] ep=%u total=%u -> SEND ZLP (phase1) cnt=%lu\r\n", (unsigned)epnum, (unsigned)tl, (unsigned long)vnd_dataIn_counter);
+      VND_LOGF("[VND_DataIn] ep=%u total=%lu -> SEND ZLP (phase1) cnt=%lu\r\n", (unsigned)epnum, (unsigned long)tl, (unsigned long)vnd_dataIn_counter);
       pdev->ep_in[epnum].total_length = 0U;
+      PIPE_EVT(PT_EV_ZLP, vnd_tx_seq, tl);
       (void)USBD_LL_Transmit(pdev, epnum, NULL, 0U); /* ZLP */
     } else {
       /* Обычное завершение */
-      VND_LOGF("[VND_DataIn] ep=%u total=%u -> COMPLETE (TxCplt) cnt=%lu\r\n", (unsigned)epnum, (unsigned)tl, (unsigned long)vnd_dataIn_counter);
+      VND_LOGF("[VND_DataIn] ep=%u total=%lu -> COMPLETE (TxCplt) cnt=%lu\r\n", (unsigned)epnum, (unsigned long)tl, (unsigned long)vnd_dataIn_counter);
       pdev->ep_in[epnum].total_length = 0U; /* очистить остаток для надёжности */
+      vnd_tx_src = NULL; vnd_tx_total = 0; vnd_tx_queued = 0;
       vnd_tx_busy = 0U;
+      vnd_tx_lent_buf = NULL; /* zero-copy буфер возвращается владельцу */
+      CYC_PROF_BEGIN(prof_t0);
       USBD_VND_TxCplt();
+      CYC_PROF_END(CYC_PROF_VND_TXCPLT, prof_t0);
     }
   }
   return (uint8_t)USBD_OK;
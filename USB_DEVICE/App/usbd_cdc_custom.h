@@ -8,6 +8,12 @@ extern "C" {
 extern USBD_ClassTypeDef USBD_CDC_VENDOR;
 
 uint8_t USBD_VND_Transmit(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len);
+/* Zero-copy передача: буфер (выровнен на 32 байта) отдаётся EP IN без копирования
+   и принадлежит стеку до USBD_VND_TxCplt. Невыровненный буфер уходит через копию.
+   Оба пути принимают кадр любой длины: длинный уходит цепочкой кусков одного трансфера. */
+uint8_t USBD_VND_TransmitZC(USBD_HandleTypeDef *pdev, const uint8_t *data, uint16_t len);
+/* 1 — буфер ещё отдан EP IN (передача zero-copy не завершена), менять его нельзя */
+uint8_t USBD_VND_TxIsLent(const void *buf);
 uint32_t USBD_VND_Read(uint8_t *dst, uint32_t max_len);
 void USBD_VND_DataReceived(const uint8_t *data, uint32_t len); /* weak */
 
@@ -18,6 +24,20 @@ uint16_t USBD_VND_LastTxLen(void);
 /* Экстренный сброс флага занятости (на случай, если DataIn не вызвался на FS) */
 void USBD_VND_ForceTxIdle(void);
 
+/* Стоимость подготовки передачи (DWT циклы: memcpy + clean D-Cache или только clean) */
+typedef struct {
+  uint32_t count;     /* измеренных передач */
+  uint32_t cyc_last;  /* циклы последней подготовки */
+  uint32_t cyc_max;   /* максимум */
+  uint64_t cyc_sum;   /* сумма (для среднего) */
+} USBD_VND_TxPrepStats_t;
+/* zero_copy: 0 — путь с копией в vnd_tx_buf, 1 — zero-copy */
+void USBD_VND_GetTxPrepStats(uint8_t zero_copy, USBD_VND_TxPrepStats_t *out);
+void USBD_VND_ResetTxPrepStats(void);
+/* Передачи длиннее одного LL-куска (цепочки) и отказы LL на продолжении цепочки */
+uint32_t USBD_VND_GetTxChainedCount(void);
+uint32_t USBD_VND_GetTxChainErrors(void);
+
 #ifdef __cplusplus
 }
 #endif
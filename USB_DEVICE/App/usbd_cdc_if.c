@@ -91,10 +91,10 @@
 /* Create buffer for reception and transmission           */
 /* It's up to user to redefine and/or remove those define */
 /** Received data over USB are stored in this buffer      */
-uint8_t UserRxBufferHS[APP_RX_DATA_SIZE];
+uint8_t UserRxBufferHS[APP_RX_DATA_SIZE] USBD_NOCACHE;
 
 /** Data to send over USB CDC are stored in this buffer   */
-uint8_t UserTxBufferHS[APP_TX_DATA_SIZE];
+uint8_t UserTxBufferHS[APP_TX_DATA_SIZE] USBD_NOCACHE;
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
 
@@ -311,6 +311,15 @@ uint8_t CDC_Transmit_HS(uint8_t* Buf, uint16_t Len)
   if (hcdc->TxState != 0){
     return USBD_BUSY;
   }
+#if USBD_OTG_DMA_ENABLE
+  /* DMA ядра не видит DTCM/стек вызывающего: отправляем копию из UserTxBufferHS.
+     Больше буфера не отправляем вовсе: молча обрезанный ответ хуже явной ошибки */
+  if (Len > APP_TX_DATA_SIZE){
+    return USBD_FAIL;
+  }
+  memcpy(UserTxBufferHS, Buf, Len);
+  Buf = UserTxBufferHS;
+#endif
   USBD_CDC_SetTxBuffer(&hUsbDeviceHS, Buf, Len);
   result = USBD_CDC_TransmitPacket(&hUsbDeviceHS);
   /* USER CODE END 12 */
@@ -42,7 +42,8 @@ volatile uint8_t g_usb_softdisc_active = 0;
 static uint32_t g_usb_last_poll_ms = 0;
 /* USER CODE END PV */
 
-PCD_HandleTypeDef hpcd_USB_OTG_HS;
+/* В режиме DMA ядро пишет SETUP-пакеты EP0 прямо в hpcd->Setup */
+PCD_HandleTypeDef hpcd_USB_OTG_HS USBD_NOCACHE;
 void Error_Handler(void);
 
 /* External functions --------------------------------------------------------*/
@@ -357,7 +358,11 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
   hpcd_USB_OTG_HS.Instance = USB_OTG_HS;
   hpcd_USB_OTG_HS.Init.dev_endpoints = 9;
   hpcd_USB_OTG_HS.Init.speed = PCD_SPEED_FULL;
+#if USBD_OTG_DMA_ENABLE
+  hpcd_USB_OTG_HS.Init.dma_enable = ENABLE;
+#else
   hpcd_USB_OTG_HS.Init.dma_enable = DISABLE;
+#endif
   hpcd_USB_OTG_HS.Init.phy_itface = USB_OTG_EMBEDDED_PHY;
   /* Включаем генерацию SOF, чтобы UI мог отслеживать активность хоста */
   hpcd_USB_OTG_HS.Init.Sof_enable = ENABLE;
@@ -659,7 +664,7 @@ USBD_StatusTypeDef USBD_LL_SetTestMode(USBD_HandleTypeDef *pdev, uint8_t testmod
 void *USBD_static_malloc(uint32_t size)
 {
   UNUSED(size);
-  static uint32_t mem[(sizeof(USBD_CDC_HandleTypeDef)/4)+1];/* On 32-bit boundary */
+  static uint32_t mem[(sizeof(USBD_CDC_HandleTypeDef)/4)+1] USBD_NOCACHE;/* On 32-bit boundary; hcdc->data — буфер EP0 */
   return mem;
 }
 
@@ -64,6 +64,23 @@
 
 /*---------- -----------*/
 #define USBD_MAX_NUM_INTERFACES     3U
+
+/* Внутренний DMA ядра OTG_HS (работает и со встроенным FS PHY): FIFO заполняет DMA,
+   а не CPU из OTG_HS_IRQHandler. 0 — прежний режим (FIFO пишет ISR).
+   DMA ядра не видит DTCM (.bss/.data/стек), поэтому всё, что ходит по USB, размещается
+   через USBD_DMA_BUF/USBD_NOCACHE в AXI SRAM (секции .usb_dma/.usb_nocache в .ld). */
+#ifndef USBD_OTG_DMA_ENABLE
+#define USBD_OTG_DMA_ENABLE     0
+#endif
+#if USBD_OTG_DMA_ENABLE
+/* Крупные TX-буферы кадров: кэшируемые, перед передачей — clean D-Cache */
+#define USBD_DMA_BUF            __attribute__((section(".usb_dma"), aligned(32)))
+/* EP0/OUT-буферы, дескрипторы, хэндлы стека: некэшируемый регион MPU, без обслуживания кэша */
+#define USBD_NOCACHE            __attribute__((section(".usb_nocache"), aligned(32)))
+#else
+#define USBD_DMA_BUF            __attribute__((aligned(32)))
+#define USBD_NOCACHE
+#endif
 /*---------- -----------*/
 #define USBD_MAX_NUM_CONFIGURATION     1U
 /*---------- -----------*/